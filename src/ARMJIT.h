@@ -70,6 +70,13 @@ public:
         if (CodeMemRegions[region][(localAddr & 0x7FFFFFF) / 512].Code & (1 << ((localAddr & 0x1FF) / 16)))
             InvalidateByAddr(localAddr);
     }
+    template <u32 num, int region>
+    void CheckAndInvalidateRange(u32 addr, u32 len) noexcept
+    {
+        // code is tracked in 16 byte steps
+        for (u32 cur = addr & ~0xF; cur < addr + len; cur += 16)
+            CheckAndInvalidate<num, region>(cur);
+    }
     JitBlockEntry LookUpBlock(u32 num, u64* entries, u32 offset, u32 addr) noexcept;
     bool SetupExecutableRegion(u32 num, u32 blockAddr, u64*& entry, u32& start, u32& size) noexcept;
     u32 LocaliseCodeAddress(u32 num, u32 addr) const noexcept;
@@ -203,6 +210,8 @@ public:
     void ResetBlockCache() noexcept {}
     template <u32, int>
     void CheckAndInvalidate(u32 addr) noexcept {}
+    template <u32, int>
+    void CheckAndInvalidateRange(u32 addr, u32 len) noexcept {}
 
     ARMJIT_Memory Memory;
 };
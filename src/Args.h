@@ -128,6 +128,11 @@ struct NDSArgs
     /// Defaults to the software renderer.
     /// Can be changed later at any time.
     std::unique_ptr<melonDS::Renderer3D> Renderer3D = std::make_unique<SoftRenderer>();
+
+    /// Whether cart ROM data read by a DMA is sent a block at a time.
+    /// Defaults to disabled.
+    /// See NDSCartSlot::SetBurstTransfers().
+    bool CartBurstTransfers = false;
 };
 
 /// Arguments to pass into the DSi constructor.
@@ -147,6 +152,10 @@ struct DSiArgs final : public NDSArgs
     std::optional<FATStorage> DSiSDCard;
 
     bool FullBIOSBoot = false;
+
+    /// Whether to run the DSP on its own thread.
+    /// See DSi_DSP::SetThreaded().
+    bool DSPThreaded = false;
 };
 }
 #endif //MELONDS_ARGS_H
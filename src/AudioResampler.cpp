@@ -0,0 +1,248 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "AudioResampler.h"
+#include "SIMD.h"
+
+namespace melonDS
+{
+
+// Kaiser window shape, about 60dB of stopband attenuation
+static constexpr double KaiserBeta = 6.0;
+
+// modified Bessel function of the first kind, order 0
+static double BesselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2*k)) * (x / (2*k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+
+    return sum;
+}
+
+AudioResampler::AudioResampler(double inrate, double outrate) noexcept
+{
+    SetRates(inrate, outrate);
+    Reset();
+}
+
+void AudioResampler::SetRates(double inrate, double outrate) noexcept
+{
+    InputRate = inrate;
+    OutputRate = outrate;
+
+    ComputeCoefficients();
+    UpdateStep();
+}
+
+void AudioResampler::Reset() noexcept
+{
+    // prime the history so that the first output sample is centered on the first input sample
+    memset(HistoryLeft, 0, sizeof(HistoryLeft));
+    memset(HistoryRight, 0, sizeof(HistoryRight));
+    HistoryLength = Taps/2 - 1;
+    Position = 0;
+
+    RateAdjust = 0;
+    UpdateStep();
+}
+
+void AudioResampler::ComputeCoefficients() noexcept
+{
+    // cutoff frequency as a fraction of the input rate, leaving room for the transition band
+    // below the Nyquist frequency of whichever side is lower
+    double cutoff = 0.44 * std::min(1.0, OutputRate / InputRate);
+    double window = BesselI0(KaiserBeta);
+
+    for (int p = 0; p < Phases; p++)
+    {
+        // each phase covers a range of fractional positions, it's computed for the middle of it
+        double frac = (p + 0.5) / Phases;
+
+        double coefs[Taps];
+        double sum = 0;
+        for (int k = 0; k < Taps; k++)
+        {
+            double x = k - (Taps/2 - 1) - frac;
+            double t = x / (Taps/2);
+            double w = BesselI0(KaiserBeta * sqrt(std::max(0.0, 1.0 - t*t))) / window;
+            double s = (x == 0) ? 1.0 : sin(M_PI * 2*cutoff * x) / (M_PI * 2*cutoff * x);
+
+            coefs[k] = 2*cutoff * s * w;
+            sum += coefs[k];
+        }
+
+        // normalize the gain of every phase, putting the rounding error in the largest tap
+        s32 total = 0;
+        int largest = 0;
+        for (int k = 0; k < Taps; k++)
+        {
+            s32 c = (s32)lround(coefs[k] / sum * (1 << CoefShift));
+            Coefficients[p][k] = c;
+            total += c;
+
+            if (abs(c) > abs(Coefficients[p][largest]))
+                largest = k;
+        }
+
+        Coefficients[p][largest] += (1 << CoefShift) - total;
+    }
+}
+
+void AudioResampler::UpdateStep() noexcept
+{
+    Step = (u64)((InputRate / OutputRate) * (1.0 + RateAdjust) * 4294967296.0);
+}
+
+void AudioResampler::UpdateRateControl(int buffered, int target) noexcept
+{
+    if (target <= 0)
+        return;
+
+    // consume input faster when it's piling up, slower when it's running out.
+    // the adjustment is smoothed, the fill level jumps around with every callback and emulated frame
+    double error = std::clamp((double)(buffered - target) / target, -1.0, 1.0);
+    RateAdjust += (error * MaxRateAdjust - RateAdjust) * 0.05;
+
+    UpdateStep();
+}
+
+int AudioResampler::GetInputNeeded(int outsamples) const noexcept
+{
+    if (outsamples <= 0)
+        return 0;
+
+    u64 last = Position + Step * (outsamples - 1);
+    int needed = (int)(last >> 32) + Taps - HistoryLength;
+    return std::max(needed, 0);
+}
+
+int AudioResampler::Push(const s16* data, int samples) noexcept
+{
+    samples = std::clamp(samples, 0, HistorySize - HistoryLength);
+
+    for (int i = 0; i < samples; i++)
+    {
+        HistoryLeft[HistoryLength + i] = data[i*2];
+        HistoryRight[HistoryLength + i] = data[i*2 + 1];
+    }
+
+    HistoryLength += samples;
+    return samples;
+}
+
+// applies one filter phase to both channels
+static inline void ApplyFilter(const s16* coefs, const s16* left, const s16* right, int taps, s32& outleft, s32& outright)
+{
+    int k = 0;
+#if defined(MELONDS_SIMD_SSE2)
+    __m128i accleft = _mm_setzero_si128();
+    __m128i accright = _mm_setzero_si128();
+
+    for (; k + 8 <= taps; k += 8)
+    {
+        __m128i c = _mm_load_si128((const __m128i*)&coefs[k]);
+        accleft = _mm_add_epi32(accleft, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&left[k]), c));
+        accright = _mm_add_epi32(accright, _mm_madd_epi16(_mm_loadu_si128((const __m128i*)&right[k]), c));
+    }
+
+    // sum both accumulators at once, leaving left in the first lane and right in the second
+    __m128i sum = _mm_add_epi32(_mm_unpacklo_epi32(accleft, accright), _mm_unpackhi_epi32(accleft, accright));
+    sum = _mm_add_epi32(sum, _mm_srli_si128(sum, 8));
+
+    s32 l = _mm_cvtsi128_si32(sum);
+    s32 r = _mm_cvtsi128_si32(_mm_srli_si128(sum, 4));
+#elif defined(MELONDS_SIMD_NEON)
+    int32x4_t accleft = vdupq_n_s32(0);
+    int32x4_t accright = vdupq_n_s32(0);
+
+    for (; k + 8 <= taps; k += 8)
+    {
+        int16x8_t c = vld1q_s16(&coefs[k]);
+        int16x8_t valleft = vld1q_s16(&left[k]);
+        int16x8_t valright = vld1q_s16(&right[k]);
+
+        accleft = vmlal_s16(accleft, vget_low_s16(valleft), vget_low_s16(c));
+        accleft = vmlal_high_s16(accleft, valleft, c);
+        accright = vmlal_s16(accright, vget_low_s16(valright), vget_low_s16(c));
+        accright = vmlal_high_s16(accright, valright, c);
+    }
+
+    s32 l = vaddvq_s32(accleft);
+    s32 r = vaddvq_s32(accright);
+#else
+    s32 l = 0, r = 0;
+#endif
+
+    for (; k < taps; k++)
+    {
+        l += left[k] * coefs[k];
+        r += right[k] * coefs[k];
+    }
+
+    outleft = l;
+    outright = r;
+}
+
+int AudioResampler::Pull(s16* data, int samples, int volume) noexcept
+{
+    int i = 0;
+    for (; i < samples; i++)
+    {
+        int pos = (int)(Position >> 32);
+        if (pos + Taps > HistoryLength)
+            break;
+
+        const s16* coefs = Coefficients[(u32)Position >> (32 - PhaseBits)];
+
+        s32 l, r;
+        ApplyFilter(coefs, &HistoryLeft[pos], &HistoryRight[pos], Taps, l, r);
+
+        l = ((l + (1 << (CoefShift-1))) >> CoefShift) * volume >> 8;
+        r = ((r + (1 << (CoefShift-1))) >> CoefShift) * volume >> 8;
+
+        // the filter can overshoot on sharp transitions
+        data[i*2] = std::clamp(l, -0x8000, 0x7FFF);
+        data[i*2 + 1] = std::clamp(r, -0x8000, 0x7FFF);
+
+        Position += Step;
+    }
+
+    // drop the input that is behind the filter window
+    int consumed = std::min((int)(Position >> 32), HistoryLength);
+    if (consumed > 0)
+    {
+        HistoryLength -= consumed;
+        memmove(&HistoryLeft[0], &HistoryLeft[consumed], HistoryLength * sizeof(s16));
+        memmove(&HistoryRight[0], &HistoryRight[consumed], HistoryLength * sizeof(s16));
+        Position -= (u64)consumed << 32;
+    }
+
+    return i;
+}
+
+}
@@ -0,0 +1,105 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef AUDIORESAMPLER_H
+#define AUDIORESAMPLER_H
+
+#include "types.h"
+
+namespace melonDS
+{
+
+// Converts the SPU output (stereo, signed 16-bit) to the sample rate of the host audio device.
+//
+// This is a polyphase windowed-sinc resampler: every output sample is a 32-tap FIR filter
+// applied around its position in the input stream, with the filter phase picked from
+// a precomputed table. The low-pass cutoff follows the lower of both rates,
+// which keeps aliasing out of the audible range when upsampling to 48 kHz or
+// when downsampling.
+//
+// The input and output side are decoupled: input is pushed as it comes out of the SPU,
+// output is pulled in whatever amounts the audio device asks for. UpdateRateControl()
+// nudges the conversion ratio to keep the amount of buffered SPU output around a target,
+// so that small differences between the emulated and the host audio clocks don't
+// build up into buffer underruns or dropped samples.
+//
+// Not thread-safe; all calls are expected to happen from the audio thread.
+class AudioResampler
+{
+public:
+    // the rate at which the SPU outputs samples
+    static constexpr double SPUOutputRate = 32823.6328125;
+
+    AudioResampler(double inrate = SPUOutputRate, double outrate = 48000) noexcept;
+
+    void SetRates(double inrate, double outrate) noexcept;
+    [[nodiscard]] double GetInputRate() const noexcept { return InputRate; }
+    [[nodiscard]] double GetOutputRate() const noexcept { return OutputRate; }
+
+    // clears the buffered input and the rate control state
+    void Reset() noexcept;
+
+    // how many input samples need to be pushed so that the given number of samples can be pulled
+    [[nodiscard]] int GetInputNeeded(int outsamples) const noexcept;
+
+    // appends input samples, returns how many were accepted
+    int Push(const s16* data, int samples) noexcept;
+
+    // produces up to the given number of output samples, with volume as a 0-256 scale.
+    // returns how many were produced, which is less than requested if there isn't enough input.
+    int Pull(s16* data, int samples, int volume = 256) noexcept;
+
+    // adjusts the conversion ratio from the amount of input waiting upstream (eg. SPU::GetOutputSize()).
+    // meant to be called once per audio callback, before GetInputNeeded().
+    void UpdateRateControl(int buffered, int target) noexcept;
+    [[nodiscard]] double GetRateAdjust() const noexcept { return RateAdjust; }
+
+private:
+    static constexpr int Taps = 32;
+    static constexpr int PhaseBits = 10;
+    static constexpr int Phases = 1 << PhaseBits;
+    static constexpr int CoefShift = 14; // the coefficients of each phase add up to 1<<CoefShift
+
+    // the conversion ratio is allowed to stray this far from the nominal one,
+    // which is small enough to not be audible as a change in pitch
+    static constexpr double MaxRateAdjust = 0.005;
+
+    // input history, one buffer per channel so that the filter can be applied with plain vector loads
+    static constexpr int HistorySize = 4096 + Taps;
+    s16 HistoryLeft[HistorySize];
+    s16 HistoryRight[HistorySize];
+    int HistoryLength;
+
+    // position of the first filter tap of the next output sample in the history,
+    // in 32.32 fixed point, and how much it advances per output sample
+    u64 Position;
+    u64 Step;
+
+    double InputRate;
+    double OutputRate;
+    double RateAdjust;
+
+    alignas(16) s16 Coefficients[Phases][Taps];
+
+    void ComputeCoefficients() noexcept;
+    void UpdateStep() noexcept;
+};
+
+}
+
+#endif // AUDIORESAMPLER_H
@@ -0,0 +1,217 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <string.h>
+#include <algorithm>
+#include "ChunkedROM.h"
+
+namespace melonDS
+{
+using namespace Platform;
+
+std::unique_ptr<ChunkedROM> ChunkedROM::Open(const std::string& path, Decompressor&& decompressor, u32 cachesize) noexcept
+{
+    FileHandle* file = OpenFile(path, FileMode::Read);
+    if (!file) return nullptr;
+
+    u64 filelen = FileLength(file);
+    ChunkedROMHeader header {};
+    FileRewind(file);
+    if (FileRead(&header, sizeof(header), 1, file) != 1 ||
+        header.Magic != ChunkedROMMagic ||
+        header.Version != ChunkedROMVersion)
+    {
+        Log(LogLevel::Error, "ChunkedROM: %s is not a chunked ROM file\n", path.c_str());
+        CloseFile(file);
+        return nullptr;
+    }
+
+    u32 blocksize = header.BlockSize;
+    if (blocksize < ChunkedROMMinBlockSize || blocksize > ChunkedROMMaxBlockSize || (blocksize & (blocksize-1)) ||
+        header.ROMLength == 0 || header.ROMLength > 0x40000000 ||
+        header.NumBlocks != (header.ROMLength + blocksize - 1) / blocksize)
+    {
+        Log(LogLevel::Error, "ChunkedROM: bad header in %s\n", path.c_str());
+        CloseFile(file);
+        return nullptr;
+    }
+
+    if (header.Codec != ChunkedROMCodec::None && !decompressor)
+    {
+        Log(LogLevel::Error, "ChunkedROM: no decompressor for codec %d\n", (int)header.Codec);
+        CloseFile(file);
+        return nullptr;
+    }
+
+    std::vector<u64> index(header.NumBlocks + 1);
+    if (FileRead(index.data(), sizeof(u64), index.size(), file) != index.size())
+    {
+        Log(LogLevel::Error, "ChunkedROM: couldn't read the block index of %s\n", path.c_str());
+        CloseFile(file);
+        return nullptr;
+    }
+
+    u64 datastart = sizeof(header) + index.size() * sizeof(u64);
+    for (u32 i = 0; i < header.NumBlocks; i++)
+    {
+        u32 rawlen = std::min(blocksize, header.ROMLength - i*blocksize);
+        if (index[i] < datastart || index[i+1] < index[i] || index[i+1] > filelen || (index[i+1] - index[i]) > rawlen)
+        {
+            Log(LogLevel::Error, "ChunkedROM: bad index entry for block %d in %s\n", i, path.c_str());
+            CloseFile(file);
+            return nullptr;
+        }
+    }
+
+    u32 numslots = std::max(cachesize / blocksize, 4u);
+    return std::unique_ptr<ChunkedROM>(new ChunkedROM(file, header, std::move(index), std::move(decompressor), numslots));
+}
+
+ChunkedROM::ChunkedROM(FileHandle* file, const ChunkedROMHeader& header, std::vector<u64>&& index, Decompressor&& decompressor, u32 numslots) noexcept :
+    File(file),
+    Header(header),
+    Index(std::move(index)),
+    Decompress(std::move(decompressor)),
+    Cache(std::min(numslots, header.NumBlocks)),
+    BlockSlots(header.NumBlocks, -1)
+{
+    CompressedBuffer = std::make_unique<u8[]>(Header.BlockSize);
+}
+
+ChunkedROM::~ChunkedROM()
+{
+    CloseFile(File);
+}
+
+bool ChunkedROM::LoadBlock(u32 block, u8* data) noexcept
+{
+    u32 rawlen = std::min(Header.BlockSize, Header.ROMLength - block*Header.BlockSize);
+    u32 storedlen = Index[block+1] - Index[block];
+
+    // blocks that didn't compress well are stored as-is
+    u8* dst = (storedlen == rawlen) ? data : CompressedBuffer.get();
+    if (!FileSeek(File, Index[block], FileSeekOrigin::Start) ||
+        FileRead(dst, storedlen, 1, File) != 1)
+    {
+        Log(LogLevel::Error, "ChunkedROM: couldn't read block %d\n", block);
+        return false;
+    }
+
+    if (storedlen == rawlen)
+        return true;
+
+    if (Header.Codec == ChunkedROMCodec::None || !Decompress(dst, storedlen, data, rawlen))
+    {
+        Log(LogLevel::Error, "ChunkedROM: couldn't decompress block %d\n", block);
+        return false;
+    }
+
+    return true;
+}
+
+const u8* ChunkedROM::GetBlock(u32 block) noexcept
+{
+    s32 slot = BlockSlots[block];
+    if (slot >= 0)
+    {
+        Cache[slot].LastUse = ++UseCounter;
+        return Cache[slot].Data.get();
+    }
+
+    // evict the least recently used block
+    slot = 0;
+    for (u32 i = 1; i < Cache.size(); i++)
+    {
+        if (Cache[i].LastUse < Cache[slot].LastUse)
+            slot = i;
+    }
+
+    CacheSlot& entry = Cache[slot];
+    if (entry.Block >= 0)
+        BlockSlots[entry.Block] = -1;
+    if (!entry.Data)
+        entry.Data = std::make_unique<u8[]>(Header.BlockSize);
+
+    if (!LoadBlock(block, entry.Data.get()))
+    {
+        // don't cache the failure, but don't crash the emulation either
+        memset(entry.Data.get(), 0, Header.BlockSize);
+        entry.Block = -1;
+        entry.LastUse = 0;
+        return entry.Data.get();
+    }
+
+    entry.Block = block;
+    entry.LastUse = ++UseCounter;
+    BlockSlots[block] = slot;
+    return entry.Data.get();
+}
+
+void ChunkedROM::Read(u32 offset, u32 len, u8* data) noexcept
+{
+    u32 start = offset;
+    u32 end = offset + len;
+
+    // the ROM is padded with zeroes
+    if (end > Header.ROMLength)
+    {
+        u32 padstart = std::max(start, Header.ROMLength);
+        memset(data + (padstart - start), 0, end - padstart);
+        end = padstart;
+    }
+
+    u8* dst = data;
+    for (u32 pos = start; pos < end;)
+    {
+        u32 block = pos / Header.BlockSize;
+        u32 blockoffset = pos & (Header.BlockSize - 1);
+        u32 chunk = std::min(Header.BlockSize - blockoffset, end - pos);
+
+        memcpy(dst, GetBlock(block) + blockoffset, chunk);
+        dst += chunk;
+        pos += chunk;
+    }
+
+    for (const PinnedRange& pin : Pins)
+    {
+        u32 pinend = pin.Offset + pin.Length;
+        if (pin.Offset >= offset + len || pinend <= offset)
+            continue;
+
+        u32 overlapstart = std::max(pin.Offset, offset);
+        u32 overlapend = std::min(pinend, offset + len);
+        memcpy(data + (overlapstart - offset), &pin.Data[overlapstart - pin.Offset], overlapend - overlapstart);
+    }
+}
+
+u8* ChunkedROM::Pin(u32 offset, u32 len) noexcept
+{
+    for (PinnedRange& pin : Pins)
+    {
+        if (offset >= pin.Offset && (offset + len) <= (pin.Offset + pin.Length))
+            return &pin.Data[offset - pin.Offset];
+    }
+
+    auto data = std::make_unique<u8[]>(len);
+    Read(offset, len, data.get());
+
+    Pins.push_back({offset, len, std::move(data)});
+    return Pins.back().Data.get();
+}
+
+}
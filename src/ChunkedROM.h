@@ -0,0 +1,145 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef MELONDS_CHUNKEDROM_H
+#define MELONDS_CHUNKEDROM_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "types.h"
+#include "Platform.h"
+
+namespace melonDS
+{
+// Chunked ROM files (.ndz) hold a ROM split into fixed-size blocks
+// that are compressed independently, so that any part of the ROM
+// can be read without decompressing the rest of it.
+//
+// Layout (all values little-endian):
+//   ChunkedROMHeader
+//   u64 index[NumBlocks + 1]    file offset of each block; the last entry is the end of the data
+//   block data
+//
+// A block whose stored size is the same as its uncompressed size is stored as-is.
+// Every block is BlockSize bytes long once decompressed, except for the last one.
+
+constexpr u32 ChunkedROMMagic = 0x1A5A444E; // "NDZ\x1A"
+constexpr u16 ChunkedROMVersion = 1;
+
+constexpr u32 ChunkedROMMinBlockSize = 0x1000;
+constexpr u32 ChunkedROMMaxBlockSize = 0x1000000;
+constexpr u32 ChunkedROMDefaultBlockSize = 0x10000;
+
+enum class ChunkedROMCodec : u16
+{
+    None = 0,
+    Zstd = 1,
+};
+
+struct ChunkedROMHeader
+{
+    u32 Magic;
+    u16 Version;
+    ChunkedROMCodec Codec;
+    u32 BlockSize;
+    u32 ROMLength;
+    u32 NumBlocks;
+    u8 Reserved[12];
+};
+
+static_assert(sizeof(ChunkedROMHeader) == 32, "ChunkedROMHeader is not 32 bytes!");
+
+/// Reads ROM data from a chunked ROM file,
+/// decompressing blocks as they're needed and keeping the most recently used ones around.
+/// Not thread-safe.
+class ChunkedROM
+{
+public:
+    /// Decompresses one block.
+    /// @param src The compressed block.
+    /// @param srclen The length of the compressed block.
+    /// @param dst Where to decompress the block to.
+    /// @param dstlen The length of the block once decompressed.
+    /// @return \c true if exactly \c dstlen bytes were decompressed.
+    using Decompressor = std::function<bool(const u8* src, u32 srclen, u8* dst, u32 dstlen)>;
+
+    /// Opens a chunked ROM file.
+    /// @param path The path to the file.
+    /// @param decompressor Used to decompress the blocks.
+    /// The core doesn't depend on any compression library, so this has to be provided by the frontend.
+    /// May be empty for files whose codec is ChunkedROMCodec::None.
+    /// @param cachesize How much decompressed data to keep around, in bytes.
+    /// @return The opened file, or \c nullptr if it isn't a valid chunked ROM file.
+    static std::unique_ptr<ChunkedROM> Open(const std::string& path, Decompressor&& decompressor, u32 cachesize = 0x1000000) noexcept;
+
+    ~ChunkedROM();
+    ChunkedROM(const ChunkedROM&) = delete;
+    ChunkedROM& operator=(const ChunkedROM&) = delete;
+
+    [[nodiscard]] ChunkedROMCodec Codec() const noexcept { return Header.Codec; }
+    [[nodiscard]] u32 BlockSize() const noexcept { return Header.BlockSize; }
+
+    /// @return The length of the ROM, as it was before being compressed.
+    [[nodiscard]] u32 Length() const noexcept { return Header.ROMLength; }
+
+    /// Reads part of the ROM.
+    /// Anything past the end of the ROM reads as zero.
+    void Read(u32 offset, u32 len, u8* data) noexcept;
+
+    /// Keeps part of the ROM in memory for good.
+    /// The returned data can be modified, and the changes are seen by any later ::Read().
+    /// @return A pointer to the pinned data, which stays valid for as long as this object exists.
+    u8* Pin(u32 offset, u32 len) noexcept;
+private:
+    struct CacheSlot
+    {
+        s32 Block = -1;
+        u64 LastUse = 0;
+        std::unique_ptr<u8[]> Data = nullptr;
+    };
+
+    struct PinnedRange
+    {
+        u32 Offset;
+        u32 Length;
+        std::unique_ptr<u8[]> Data;
+    };
+
+    ChunkedROM(Platform::FileHandle* file, const ChunkedROMHeader& header, std::vector<u64>&& index, Decompressor&& decompressor, u32 numslots) noexcept;
+
+    const u8* GetBlock(u32 block) noexcept;
+    bool LoadBlock(u32 block, u8* data) noexcept;
+
+    Platform::FileHandle* File;
+    ChunkedROMHeader Header;
+    std::vector<u64> Index;
+    Decompressor Decompress;
+
+    std::vector<CacheSlot> Cache;
+    std::vector<s32> BlockSlots;
+    u64 UseCounter = 0;
+    std::unique_ptr<u8[]> CompressedBuffer = nullptr;
+
+    std::vector<PinnedRange> Pins;
+};
+
+}
+
+#endif // MELONDS_CHUNKEDROM_H
@@ -17,6 +17,8 @@
 */
 
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
 #include "NDS.h"
 #include "DSi.h"
 #include "DMA.h"
@@ -550,6 +552,101 @@ u32 DMA::UnitTimings7_32(bool burststart)
     }
 }
 
+// Fast path for transfers between plain memory (main RAM, WRAM...): instead of going through
+// the regular memory handlers for every unit, this only works out the timings unit by unit,
+// then copies everything that went through in one go.
+// Returns false if the transfer can't be done this way, in which case nothing was done.
+template <u32 cpu, typename T>
+bool DMA::RunDirect(bool& burststart)
+{
+    if (DstAddrInc != 1 || (SrcAddrInc != 1 && SrcAddrInc != 0))
+        return false;
+
+    u32 srcaddr = CurSrcAddr & ~(sizeof(T)-1);
+    u32 dstaddr = CurDstAddr & ~(sizeof(T)-1);
+
+    MemRegion srcrgn, dstrgn;
+    if (cpu == 0)
+    {
+        if (!NDS.ARM9GetMemRegion(srcaddr, false, &srcrgn)) return false;
+        if (!NDS.ARM9GetMemRegion(dstaddr, true, &dstrgn)) return false;
+    }
+    else
+    {
+        if (!NDS.ARM7GetMemRegion(srcaddr, false, &srcrgn)) return false;
+        if (!NDS.ARM7GetMemRegion(dstaddr, true, &dstrgn)) return false;
+    }
+
+    // stop where either side wraps around its mirror
+    u32 srcoffset = srcaddr & srcrgn.Mask;
+    u32 dstoffset = dstaddr & dstrgn.Mask;
+    u32 maxunits = std::min(IterCount, (dstrgn.Mask + 1 - dstoffset) / (u32)sizeof(T));
+    if (SrcAddrInc)
+        maxunits = std::min(maxunits, (srcrgn.Mask + 1 - srcoffset) / (u32)sizeof(T));
+    if (maxunits < 2)
+        return false;
+
+    // copying unit by unit over an overlapping range doesn't give the same result as a memcpy
+    u8* src = &srcrgn.Mem[srcoffset];
+    u8* dst = &dstrgn.Mem[dstoffset];
+    u32 srclen = SrcAddrInc ? (maxunits * sizeof(T)) : sizeof(T);
+    if (src < dst + maxunits * sizeof(T) && dst < src + srclen)
+        return false;
+
+    u32 units = 0;
+    while (units < maxunits)
+    {
+        if (cpu == 0)
+        {
+            if (sizeof(T) == 2)
+                NDS.ARM9Timestamp += (UnitTimings9_16(burststart) << NDS.ARM9ClockShift);
+            else
+                NDS.ARM9Timestamp += (UnitTimings9_32(burststart) << NDS.ARM9ClockShift);
+        }
+        else
+        {
+            if (sizeof(T) == 2)
+                NDS.ARM7Timestamp += UnitTimings7_16(burststart);
+            else
+                NDS.ARM7Timestamp += UnitTimings7_32(burststart);
+        }
+        burststart = false;
+
+        CurSrcAddr += SrcAddrInc * sizeof(T);
+        CurDstAddr += sizeof(T);
+        units++;
+
+        if (cpu == 0 && NDS.ARM9Timestamp >= NDS.ARM9Target) break;
+        if (cpu == 1 && NDS.ARM7Timestamp >= NDS.ARM7Target) break;
+    }
+
+    if (SrcAddrInc)
+    {
+        memcpy(dst, src, units * sizeof(T));
+    }
+    else
+    {
+        T val = *(T*)src;
+        for (u32 i = 0; i < units; i++)
+            *(T*)&dst[i * sizeof(T)] = val;
+    }
+
+    // only plain RAM can be written here, VRAM and such always go through the memory handlers
+    if ((dstaddr >> 24) == 0x03)
+    {
+        if (cpu == 0)
+            NDS.JIT.CheckAndInvalidateRange<0, ARMJIT_Memory::memregion_SharedWRAM>(dstaddr, units * sizeof(T));
+        else
+            NDS.JIT.CheckAndInvalidateRange<1, ARMJIT_Memory::memregion_WRAM7>(dstaddr, units * sizeof(T));
+    }
+    else
+        NDS.JIT.CheckAndInvalidateRange<cpu, ARMJIT_Memory::memregion_MainRAM>(dstaddr, units * sizeof(T));
+
+    IterCount -= units;
+    RemCount -= units;
+    return true;
+}
+
 void DMA::Run9()
 {
     if (NDS.ARM9Timestamp >= NDS.ARM9Target) return;
@@ -560,10 +657,24 @@ void DMA::Run9()
     bool burststart = (Running == 2);
     Running = 1;
 
+    // only try the fast path until it fails once, so that transfers that never use it
+    // don't pay for looking up the memory regions on every unit
+    bool direct = true;
+
     if (!(Cnt & (1<<26)))
     {
         while (IterCount > 0 && !Stall)
         {
+            if (direct)
+            {
+                if (RunDirect<0, u16>(burststart))
+                {
+                    if (NDS.ARM9Timestamp >= NDS.ARM9Target) break;
+                    continue;
+                }
+                direct = false;
+            }
+
             NDS.ARM9Timestamp += (UnitTimings9_16(burststart) << NDS.ARM9ClockShift);
             burststart = false;
 
@@ -581,6 +692,16 @@ void DMA::Run9()
     {
         while (IterCount > 0 && !Stall)
         {
+            if (direct)
+            {
+                if (RunDirect<0, u32>(burststart))
+                {
+                    if (NDS.ARM9Timestamp >= NDS.ARM9Target) break;
+                    continue;
+                }
+                direct = false;
+            }
+
             NDS.ARM9Timestamp += (UnitTimings9_32(burststart) << NDS.ARM9ClockShift);
             burststart = false;
 
@@ -621,6 +742,11 @@ void DMA::Run9()
     Running = 0;
     InProgress = false;
     NDS.ResumeCPU(0, 1<<Num);
+
+    // the cart may have the next word ready already, when it sends a whole block at once
+    // (see NDSCartSlot::GetTransferBurst())
+    if (StartMode == 0x05 && !(NDS.ExMemCnt[0] & (1<<11)) && (NDS.NDSCartSlot.GetROMCnt() & (1<<23)))
+        StartIfNeeded(0x05);
 }
 
 void DMA::Run7()
@@ -633,10 +759,24 @@ void DMA::Run7()
     bool burststart = (Running == 2);
     Running = 1;
 
+    // only try the fast path until it fails once, so that transfers that never use it
+    // don't pay for looking up the memory regions on every unit
+    bool direct = true;
+
     if (!(Cnt & (1<<26)))
     {
         while (IterCount > 0 && !Stall)
         {
+            if (direct)
+            {
+                if (RunDirect<1, u16>(burststart))
+                {
+                    if (NDS.ARM7Timestamp >= NDS.ARM7Target) break;
+                    continue;
+                }
+                direct = false;
+            }
+
             NDS.ARM7Timestamp += UnitTimings7_16(burststart);
             burststart = false;
 
@@ -654,6 +794,16 @@ void DMA::Run7()
     {
         while (IterCount > 0 && !Stall)
         {
+            if (direct)
+            {
+                if (RunDirect<1, u32>(burststart))
+                {
+                    if (NDS.ARM7Timestamp >= NDS.ARM7Target) break;
+                    continue;
+                }
+                direct = false;
+            }
+
             NDS.ARM7Timestamp += UnitTimings7_32(burststart);
             burststart = false;
 
@@ -691,6 +841,11 @@ void DMA::Run7()
     Running = 0;
     InProgress = false;
     NDS.ResumeCPU(1, 1<<Num);
+
+    // the cart may have the next word ready already, when it sends a whole block at once
+    // (see NDSCartSlot::GetTransferBurst())
+    if (StartMode == 0x12 && (NDS.ExMemCnt[0] & (1<<11)) && (NDS.NDSCartSlot.GetROMCnt() & (1<<23)))
+        StartIfNeeded(0x12);
 }
 
 void DMA::Run()
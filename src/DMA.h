@@ -78,6 +78,9 @@ public:
     u32 Cnt {};
 
 private:
+    template <u32 cpu, typename T>
+    bool RunDirect(bool& burststart);
+
     melonDS::NDS& NDS;
     u32 CPU {};
     u32 Num {};
@@ -115,10 +115,15 @@ DSi::DSi(DSiArgs&& args, void* userdata) noexcept :
     NWRAM_A = JIT.Memory.GetNWRAM_A();
     NWRAM_B = JIT.Memory.GetNWRAM_B();
     NWRAM_C = JIT.Memory.GetNWRAM_C();
+
+    DSP.SetThreaded(args.DSPThreaded);
 }
 
 DSi::~DSi() noexcept
 {
+    // the DSP thread needs to be stopped before the memory it accesses goes away
+    DSP.SetThreaded(false);
+
     // Memory is owned externally
     NWRAM_A = nullptr;
     NWRAM_B = nullptr;
@@ -312,8 +317,7 @@ void DSi::DecryptModcryptArea(u32 offset, u32 size, const u8* iv)
         (header.AppFlags & (1<<7)))
     {
         // dev key
-        const u8* cartrom = NDSCartSlot.GetCart()->GetROM();
-        memcpy(key, &cartrom[0], 16);
+        NDSCartSlot.GetCart()->ReadROM(0, 16, key, 0);
     }
     else
     {
@@ -400,7 +404,7 @@ void DSi::SetupDirectBoot()
 {
     bool dsmode = false;
     NDSHeader& header = NDSCartSlot.GetCart()->GetHeader();
-    const u8* cartrom = NDSCartSlot.GetCart()->GetROM();
+    std::unique_ptr<u8[]> cartheader = NDSCartSlot.GetCart()->CopyROM(0, 0x1000);
     u32 cartid = NDSCartSlot.GetCart()->ID();
     DSi_TSC* tsc = (DSi_TSC*)SPI.GetTSC();
 
@@ -442,7 +446,7 @@ void DSi::SetupDirectBoot()
         MBK[1][8] = 0;
 
         u32 mbk[12];
-        memcpy(mbk, &cartrom[0x180], 12*4);
+        memcpy(mbk, &cartheader[0x180], 12*4);
 
         MapNWRAM_A(0, mbk[0] & 0xFF);
         MapNWRAM_A(1, (mbk[0] >> 8) & 0xFF);
@@ -491,7 +495,7 @@ void DSi::SetupDirectBoot()
     {
         for (u32 i = 0; i < 0x170; i+=4)
         {
-            u32 tmp = *(u32*)&cartrom[i];
+            u32 tmp = *(u32*)&cartheader[i];
             ARM9Write32(0x027FFE00+i, tmp);
         }
 
@@ -518,14 +522,14 @@ void DSi::SetupDirectBoot()
 
         for (u32 i = 0; i < 0x160; i+=4)
         {
-            u32 tmp = *(u32*)&cartrom[i];
+            u32 tmp = *(u32*)&cartheader[i];
             ARM9Write32(0x02FFFA80+i, tmp);
             ARM9Write32(0x02FFFE00+i, tmp);
         }
 
         for (u32 i = 0; i < 0x1000; i+=4)
         {
-            u32 tmp = *(u32*)&cartrom[i];
+            u32 tmp = *(u32*)&cartheader[i];
             ARM9Write32(0x02FFC000+i, tmp);
             ARM9Write32(0x02FFE000+i, tmp);
         }
@@ -599,15 +603,17 @@ void DSi::SetupDirectBoot()
         }
     }
 
+    std::unique_ptr<u8[]> arm9bin = NDSCartSlot.GetCart()->CopyROM(header.ARM9ROMOffset, header.ARM9Size);
     for (u32 i = arm9start; i < header.ARM9Size; i+=4)
     {
-        u32 tmp = *(u32*)&cartrom[header.ARM9ROMOffset+i];
+        u32 tmp = *(u32*)&arm9bin[i];
         ARM9Write32(header.ARM9RAMAddress+i, tmp);
     }
 
+    std::unique_ptr<u8[]> arm7bin = NDSCartSlot.GetCart()->CopyROM(header.ARM7ROMOffset, header.ARM7Size);
     for (u32 i = 0; i < header.ARM7Size; i+=4)
     {
-        u32 tmp = *(u32*)&cartrom[header.ARM7ROMOffset+i];
+        u32 tmp = *(u32*)&arm7bin[i];
         ARM7Write32(header.ARM7RAMAddress+i, tmp);
     }
 
@@ -615,15 +621,17 @@ void DSi::SetupDirectBoot()
     {
         // load DSi-specific regions
 
+        std::unique_ptr<u8[]> arm9ibin = NDSCartSlot.GetCart()->CopyROM(header.DSiARM9iROMOffset, header.DSiARM9iSize);
         for (u32 i = 0; i < header.DSiARM9iSize; i+=4)
         {
-            u32 tmp = *(u32*)&cartrom[header.DSiARM9iROMOffset+i];
+            u32 tmp = *(u32*)&arm9ibin[i];
             ARM9Write32(header.DSiARM9iRAMAddress+i, tmp);
         }
 
+        std::unique_ptr<u8[]> arm7ibin = NDSCartSlot.GetCart()->CopyROM(header.DSiARM7iROMOffset, header.DSiARM7iSize);
         for (u32 i = 0; i < header.DSiARM7iSize; i+=4)
         {
-            u32 tmp = *(u32*)&cartrom[header.DSiARM7iROMOffset+i];
+            u32 tmp = *(u32*)&arm7ibin[i];
             ARM7Write32(header.DSiARM7iRAMAddress+i, tmp);
         }
 
@@ -1001,6 +1009,11 @@ bool DSi::NDMAsInMode(u32 cpu, u32 mode) const
     return false;
 }
 
+bool DSi::NDMAsInDMAMode(u32 cpu, u32 mode) const
+{
+    return NDMAsInMode(cpu, NDMAModes[mode]);
+}
+
 bool DSi::NDMAsRunning(u32 cpu) const
 {
     cpu <<= 2;
@@ -1106,6 +1119,8 @@ void DSi::MapNWRAM_B(u32 num, u8 val)
     u8 oldval = (MBK[0][mbkn] >> mbks) & 0xFF;
     if (oldval == val) return;
 
+    // the DSP thread might be reading through the old mapping
+    DSP.SyncThread();
     JIT.Memory.RemapNWRAM(1);
 
     MBK[0][mbkn] &= ~(0xFF << mbks);
@@ -1134,6 +1149,8 @@ void DSi::MapNWRAM_B(u32 num, u8 val)
             NWRAMMap_B[mVal & 0x03][(mVal >> 2) & 0x7] = ptr;
         }
     }
+
+    DSP.InvalidateProgramCache();
 }
 
 void DSi::MapNWRAM_C(u32 num, u8 val)
@@ -1153,6 +1170,8 @@ void DSi::MapNWRAM_C(u32 num, u8 val)
     u8 oldval = (MBK[0][mbkn] >> mbks) & 0xFF;
     if (oldval == val) return;
 
+    // the DSP thread might be reading through the old mapping
+    DSP.SyncThread();
     JIT.Memory.RemapNWRAM(2);
 
     MBK[0][mbkn] &= ~(0xFF << mbks);
@@ -1181,6 +1200,8 @@ void DSi::MapNWRAM_C(u32 num, u8 val)
             NWRAMMap_C[mVal & 0x03][(mVal >> 2) & 0x7] = ptr;
         }
     }
+
+    DSP.InvalidateProgramCache();
 }
 
 void DSi::MapNWRAMRange(u32 cpu, u32 num, u32 val)
@@ -88,6 +88,8 @@ public:
     void RunNDMAs(u32 cpu);
     void StallNDMAs();
     bool NDMAsInMode(u32 cpu, u32 mode) const;
+    // same as NDMAsInMode(), with a start mode of the legacy DMAs
+    bool NDMAsInDMAMode(u32 cpu, u32 mode) const;
     bool NDMAsRunning(u32 cpu) const;
     void CheckNDMAs(u32 cpu, u32 mode);
     void StopNDMAs(u32 cpu, u32 mode);
@@ -53,23 +53,32 @@ u16 DSi_DSP::GetPSTS() const
     return r;
 }
 
+void DSi_DSP::SetDSPIRQ()
+{
+    // the DSP thread can't touch the IRQ registers, it's raised once the thread is waited for
+    if (OnDSPThread)
+        ThreadIRQ = true;
+    else
+        DSi.SetIRQ(0, IRQ_DSi_DSP);
+}
+
 void DSi_DSP::IrqRep0()
 {
-    if (DSP_PCFG & (1<< 9)) DSi.SetIRQ(0, IRQ_DSi_DSP);
+    if (DSP_PCFG & (1<< 9)) SetDSPIRQ();
 }
 void DSi_DSP::IrqRep1()
 {
-    if (DSP_PCFG & (1<<10)) DSi.SetIRQ(0, IRQ_DSi_DSP);
+    if (DSP_PCFG & (1<<10)) SetDSPIRQ();
 }
 void DSi_DSP::IrqRep2()
 {
-    if (DSP_PCFG & (1<<11)) DSi.SetIRQ(0, IRQ_DSi_DSP);
+    if (DSP_PCFG & (1<<11)) SetDSPIRQ();
 }
 void DSi_DSP::IrqSem()
 {
     DSP_PSTS |= 1<<9;
     // apparently these are always fired?
-    DSi.SetIRQ(0, IRQ_DSi_DSP);
+    SetDSPIRQ();
 }
 
 u16 DSi_DSP::DSPRead16(u32 addr)
@@ -107,6 +116,47 @@ void DSi_DSP::AudioCb(std::array<s16, 2> frame)
     // TODO
 }
 
+u32 DSi_DSP::AHBMAccessNow(u32 addr, u32 val, u32 size, bool write)
+{
+    if (write)
+    {
+        switch (size)
+        {
+        case 8: DSi.ARM9Write8(addr, val); break;
+        case 16: DSi.ARM9Write16(addr, val); break;
+        case 32: DSi.ARM9Write32(addr, val); break;
+        }
+        return 0;
+    }
+
+    switch (size)
+    {
+    case 8: return DSi.ARM9Read8(addr);
+    case 16: return DSi.ARM9Read16(addr);
+    case 32: return DSi.ARM9Read32(addr);
+    }
+    return 0;
+}
+
+u32 DSi_DSP::AHBMAccess(u32 addr, u32 val, u32 size, bool write)
+{
+    if (!OnDSPThread)
+        return AHBMAccessNow(addr, val, size, write);
+
+    // the ARM9 bus belongs to the emulation thread, hand the access over
+    // and wait for it to be carried out in SyncThread()
+    BusWrite = write;
+    BusSize = size;
+    BusAddr = addr;
+    BusValue = val;
+    BusRequest = true;
+
+    Platform::Semaphore_Post(Sema_RunEvent);
+    Platform::Semaphore_Wait(Sema_BusDone);
+
+    return BusValue;
+}
+
 DSi_DSP::DSi_DSP(melonDS::DSi& dsi) : DSi(dsi)
 {
     DSi.RegisterEventFunc(Event_DSi_DSP, 0, MemberEventFunc(DSi_DSP, DSPCatchUpU32));
@@ -133,22 +183,32 @@ DSi_DSP::DSi_DSP(melonDS::DSi& dsi) : DSi(dsi)
     // these happen instantaneously and without too much regard for bus aribtration
     // rules, so, this might have to be changed later on
     Teakra::AHBMCallback cb;
-    cb.read8 = [this](auto addr) { return DSi.ARM9Read8(addr); };
-    cb.write8 = [this](auto addr, auto val) { DSi.ARM9Write8(addr, val); };
-    cb.read16 = [this](auto addr) { return DSi.ARM9Read16(addr); };
-    cb.write16 = [this](auto addr, auto val) { DSi.ARM9Write16(addr, val); };
-    cb.read32 = [this](auto addr) { return DSi.ARM9Read32(addr); };
-    cb.write32 = [this](auto addr, auto val) { DSi.ARM9Write32(addr, val); };
+    cb.read8 = [this](auto addr) { return (u8)AHBMAccess(addr, 0, 8, false); };
+    cb.write8 = [this](auto addr, auto val) { AHBMAccess(addr, val, 8, true); };
+    cb.read16 = [this](auto addr) { return (u16)AHBMAccess(addr, 0, 16, false); };
+    cb.write16 = [this](auto addr, auto val) { AHBMAccess(addr, val, 16, true); };
+    cb.read32 = [this](auto addr) { return AHBMAccess(addr, 0, 32, false); };
+    cb.write32 = [this](auto addr, auto val) { AHBMAccess(addr, val, 32, true); };
     TeakraCore->SetAHBMCallback(cb);
 
     TeakraCore->SetAudioCallback(std::bind(&DSi_DSP::AudioCb, this, _1));
 
     //PDATAReadFifo = new FIFO<u16>(16);
     //PDATAWriteFifo = new FIFO<u16>(16);
+
+    Sema_RunStart = Platform::Semaphore_Create();
+    Sema_RunEvent = Platform::Semaphore_Create();
+    Sema_BusDone = Platform::Semaphore_Create();
 }
 
 DSi_DSP::~DSi_DSP()
 {
+    StopDSPThread();
+
+    Platform::Semaphore_Free(Sema_RunStart);
+    Platform::Semaphore_Free(Sema_RunEvent);
+    Platform::Semaphore_Free(Sema_BusDone);
+
     //if (PDATAWriteFifo) delete PDATAWriteFifo;
     if (TeakraCore) delete TeakraCore;
 
@@ -161,6 +221,8 @@ DSi_DSP::~DSi_DSP()
 
 void DSi_DSP::Reset()
 {
+    SyncThread();
+
     DSPTimestamp = 0;
 
     DSP_PADR = 0;
@@ -206,6 +268,15 @@ inline bool DSi_DSP::IsDSPIOEnabled() const
 bool DSi_DSP::DSPCatchUp()
 {
     //asm volatile("int3");
+
+    // whatever the DSP thread is working on is in the past, it needs to be done first
+    SyncThread();
+
+    // unless this is an access made on behalf of the DSP thread, see SyncThread()
+    // the core is in the middle of running on it, and is already caught up
+    if (ThreadBusy)
+        return IsDSPCoreEnabled();
+
     if (!IsDSPCoreEnabled())
     {
         // nothing to do, but advance the current time so that we don't do an
@@ -231,7 +302,133 @@ bool DSi_DSP::DSPCatchUp()
 
     return true;
 }
-void DSi_DSP::DSPCatchUpU32(u32 _) { DSPCatchUp(); }
+void DSi_DSP::DSPCatchUpU32(u32 _)
+{
+    if (Threaded)
+        RunSliceOnThread();
+    else
+        DSPCatchUp();
+}
+
+void DSi_DSP::RunSliceOnThread()
+{
+    SyncThread();
+
+    if (!IsDSPCoreEnabled())
+    {
+        if (DSPTimestamp < DSi.ARM9Timestamp)
+            DSPTimestamp = DSi.ARM9Timestamp;
+
+        return;
+    }
+
+    u64 curtime = DSi.ARM9Timestamp;
+    if (DSPTimestamp < curtime)
+    {
+        u64 backlog = curtime - DSPTimestamp;
+        if (backlog > 0xFFFFFFFF) backlog = 0xFFFFFFFF;
+
+        ThreadCycles = (u32)backlog;
+        DSPTimestamp += backlog;
+
+        ThreadBusy = true;
+        Platform::Semaphore_Post(Sema_RunStart);
+    }
+
+    DSi.ScheduleEvent(Event_DSi_DSP, false, SliceLength, 0, 0);
+}
+
+void DSi_DSP::SyncThread()
+{
+    if (!ThreadBusy)
+        return;
+
+    // a bus access from the DSP thread can end up here again, through the DSP or NWRAM
+    // registers. The thread is blocked until that access is done, so there's nothing to wait for
+    if (ServingBusRequest)
+        return;
+
+    for (;;)
+    {
+        Platform::Semaphore_Wait(Sema_RunEvent);
+        if (!BusRequest)
+            break;
+
+        ServingBusRequest = true;
+        BusValue = AHBMAccessNow(BusAddr, BusValue, BusSize, BusWrite);
+        ServingBusRequest = false;
+        BusRequest = false;
+        Platform::Semaphore_Post(Sema_BusDone);
+    }
+
+    ThreadBusy = false;
+
+    if (ThreadIRQ)
+    {
+        ThreadIRQ = false;
+        DSi.SetIRQ(0, IRQ_DSi_DSP);
+    }
+}
+
+void DSi_DSP::DSPThreadFunc()
+{
+    for (;;)
+    {
+        Platform::Semaphore_Wait(Sema_RunStart);
+        if (!DSPThreadRunning) return;
+
+        OnDSPThread = true;
+        TeakraCore->Run(ThreadCycles);
+        OnDSPThread = false;
+
+        Platform::Semaphore_Post(Sema_RunEvent);
+    }
+}
+
+void DSi_DSP::StartDSPThread()
+{
+    if (DSPThread)
+        return;
+
+    Platform::Semaphore_Reset(Sema_RunStart);
+    Platform::Semaphore_Reset(Sema_RunEvent);
+    Platform::Semaphore_Reset(Sema_BusDone);
+
+    DSPThreadRunning = true;
+    DSPThread = Platform::Thread_Create([this]() { DSPThreadFunc(); });
+}
+
+void DSi_DSP::StopDSPThread()
+{
+    if (!DSPThread)
+        return;
+
+    SyncThread();
+
+    DSPThreadRunning = false;
+    Platform::Semaphore_Post(Sema_RunStart);
+
+    Platform::Thread_Wait(DSPThread);
+    Platform::Thread_Free(DSPThread);
+    DSPThread = nullptr;
+}
+
+void DSi_DSP::SetThreaded(bool threaded)
+{
+    if (Threaded == threaded)
+        return;
+
+    Threaded = threaded;
+    if (Threaded)
+        StartDSPThread();
+    else
+        StopDSPThread();
+}
+
+void DSi_DSP::InvalidateProgramCache()
+{
+    TeakraCore->InvalidateProgramCache();
+}
 
 void DSi_DSP::PDataDMAWrite(u16 wrval)
 {
@@ -380,10 +577,24 @@ u16 DSi_DSP::PDataDMAReadMMIO()
 u8 DSi_DSP::Read8(u32 addr)
 {
     //if (!IsDSPIOEnabled()) return 0;
-    DSPCatchUp();
-
     addr &= 0x3F; // mirroring wheee
 
+    if (Threaded)
+    {
+        // these only read back what the ARM9 wrote, so they don't have to wait for the DSP thread
+        switch (addr)
+        {
+        case 0x08: return DSP_PCFG & 0xFF;
+        case 0x09: return DSP_PCFG >> 8;
+        case 0x10: return DSP_PSEM & 0xFF;
+        case 0x11: return DSP_PSEM >> 8;
+        case 0x14: return DSP_PMASK & 0xFF;
+        case 0x15: return DSP_PMASK >> 8;
+        }
+    }
+
+    DSPCatchUp();
+
     // ports are a bit weird, 16-bit regs in 32-bit spaces
     switch (addr)
     {
@@ -408,10 +619,24 @@ u16 DSi_DSP::Read16(u32 addr)
 {
     //printf("DSP READ16 %d %08X   %08X\n", IsDSPCoreEnabled(), addr, NDS::GetPC(0));
     //if (!IsDSPIOEnabled()) return 0;
-    DSPCatchUp();
-
     addr &= 0x3E; // mirroring wheee
 
+    if (Threaded)
+    {
+        // these only read back what the ARM9 wrote, so they don't have to wait for the DSP thread
+        switch (addr)
+        {
+        case 0x08: return DSP_PCFG;
+        case 0x10: return DSP_PSEM;
+        case 0x14: return DSP_PMASK;
+        case 0x20: return DSP_CMD[0];
+        case 0x28: return DSP_CMD[1];
+        case 0x30: return DSP_CMD[2];
+        }
+    }
+
+    DSPCatchUp();
+
     // ports are a bit weird, 16-bit regs in 32-bit spaces
     switch (addr)
     {
@@ -566,12 +791,13 @@ void DSi_DSP::Run(u32 cycles)
     DSPTimestamp += cycles;
 
     DSi.CancelEvent(Event_DSi_DSP);
-    DSi.ScheduleEvent(Event_DSi_DSP, false,
-            16384/*from citra (TeakraSlice)*/, 0, 0);
+    DSi.ScheduleEvent(Event_DSi_DSP, false, SliceLength, 0, 0);
 }
 
 void DSi_DSP::DoSavestate(Savestate* file)
 {
+    SyncThread();
+
     file->Section("DSPi");
 
     PDATAReadFifo.DoSavestate(file);
@@ -593,6 +819,10 @@ void DSi_DSP::DoSavestate(Savestate* file)
     file->Var16(&DSP_REP[2]);
     file->Var8((u8*)&SCFG_RST);
 
+    // NWRAM was restored along with the rest of the DSi state
+    if (!file->Saving)
+        TeakraCore->InvalidateProgramCache();
+
     // TODO: save the Teakra state!!!
 }
 
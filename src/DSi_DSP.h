@@ -19,8 +19,11 @@
 #ifndef DSI_DSP_H
 #define DSI_DSP_H
 
+#include <atomic>
+
 #include "types.h"
 #include "Savestate.h"
+#include "Platform.h"
 
 // TODO: for actual sound output
 // * audio callbacks
@@ -40,6 +43,19 @@ public:
 
     void DSPCatchUpU32(u32 _);
 
+    // In threaded mode, the DSP runs on its own thread, one slice at a time: every slice
+    // event hands the cycles the DSP is behind the ARM9 to the DSP thread, and the emulation
+    // carries on. The DSP is only waited for when its state is observed (most DSP register
+    // accesses), when something it accesses on its own changes (NWRAM mappings), or at the
+    // next slice, so it never lags more than two slices behind.
+    // Interrupts and AHBM accesses from the DSP thread are carried out when it is waited for,
+    // which happens at the same emulated time on every run.
+    void SetThreaded(bool threaded);
+    [[nodiscard]] bool IsThreaded() const { return Threaded; }
+
+    // waits for the DSP thread to finish the cycles it was given
+    void SyncThread();
+
     // SCFG_RST bit0
     bool IsRstReleased() const;
     void SetRstLine(bool release);
@@ -60,6 +76,9 @@ public:
     // NOTE: checks SCFG_CLK9
     void Run(u32 cycles);
 
+    // needs to be called when the NWRAM banks mapped to the DSP change
+    void InvalidateProgramCache();
+
     void IrqRep0();
     void IrqRep1();
     void IrqRep2();
@@ -88,6 +107,30 @@ private:
 
     u64 DSPTimestamp;
 
+    // how often the DSP is caught up when its state isn't observed (from citra's TeakraSlice)
+    static constexpr u32 SliceLength = 16384;
+
+    bool Threaded = false;
+    Platform::Thread* DSPThread = nullptr;
+    std::atomic_bool DSPThreadRunning {false};
+    Platform::Semaphore* Sema_RunStart;
+    Platform::Semaphore* Sema_RunEvent; // the DSP thread is done, or has a bus request
+    Platform::Semaphore* Sema_BusDone;
+
+    // only changed by the emulation thread
+    bool ThreadBusy = false;
+    u32 ThreadCycles = 0;
+    bool ServingBusRequest = false;
+
+    // only changed by the DSP thread while it is busy
+    bool OnDSPThread = false;
+    bool ThreadIRQ = false;
+    bool BusRequest = false;
+    bool BusWrite;
+    u32 BusSize;
+    u32 BusAddr;
+    u32 BusValue;
+
     FIFO<u16, 16> PDATAReadFifo/*, *PDATAWriteFifo*/;
     int PDataDMALen;
 
@@ -100,6 +143,15 @@ private:
 
     bool DSPCatchUp();
 
+    void StartDSPThread();
+    void StopDSPThread();
+    void DSPThreadFunc();
+    void RunSliceOnThread();
+    void SetDSPIRQ();
+
+    u32 AHBMAccess(u32 addr, u32 val, u32 size, bool write);
+    u32 AHBMAccessNow(u32 addr, u32 val, u32 size, bool write);
+
     void PDataDMAWrite(u16 wrval);
     u16 PDataDMARead();
     void PDataDMAFetch();
@@ -166,11 +166,7 @@ void GPU::Reset() noexcept
     memset(VRAMPtr_BBG, 0, sizeof(VRAMPtr_BBG));
     memset(VRAMPtr_BOBJ, 0, sizeof(VRAMPtr_BOBJ));
 
-    size_t fbsize;
-    if (GPU3D.IsRendererAccelerated())
-        fbsize = (256*3 + 1) * 192;
-    else
-        fbsize = 256 * 192;
+    size_t fbsize = GetFramebufferSize();
 
     for (size_t i = 0; i < fbsize; i++)
     {
@@ -198,11 +194,7 @@ void GPU::Reset() noexcept
 
 void GPU::Stop() noexcept
 {
-    int fbsize;
-    if (GPU3D.IsRendererAccelerated())
-        fbsize = (256*3 + 1) * 192;
-    else
-        fbsize = 256 * 192;
+    size_t fbsize = GetFramebufferSize();
 
     memset(Framebuffer[0][0].get(), 0, fbsize*4);
     memset(Framebuffer[0][1].get(), 0, fbsize*4);
@@ -302,13 +294,18 @@ void GPU::SetRenderer3D(std::unique_ptr<Renderer3D>&& renderer) noexcept
     InitFramebuffers();
 }
 
-void GPU::InitFramebuffers() noexcept
+size_t GPU::GetFramebufferSize() const noexcept
 {
-    int fbsize;
     if (GPU3D.IsRendererAccelerated())
-        fbsize = (256*3 + 1) * 192;
-    else
-        fbsize = 256 * 192;
+        return (256*3 + 1) * 192;
+
+    int scale = GPU3D.GetFramebufferScale();
+    return (256 * scale) * (192 * scale);
+}
+
+void GPU::InitFramebuffers() noexcept
+{
+    size_t fbsize = GetFramebufferSize();
 
     Framebuffer[0][0] = std::make_unique<u32[]>(fbsize);
     Framebuffer[1][0] = std::make_unique<u32[]>(fbsize);
@@ -934,11 +931,7 @@ void GPU::FinishFrame(u32 lines) noexcept
 void GPU::BlankFrame() noexcept
 {
     int backbuf = FrontBuffer ? 0 : 1;
-    int fbsize;
-    if (GPU3D.IsRendererAccelerated())
-        fbsize = (256*3 + 1) * 192;
-    else
-        fbsize = 256 * 192;
+    size_t fbsize = GetFramebufferSize();
 
     memset(Framebuffer[backbuf][0].get(), 0, fbsize*4);
     memset(Framebuffer[backbuf][1].get(), 0, fbsize*4);
@@ -69,6 +69,14 @@ public:
     [[nodiscard]] const Renderer3D& GetRenderer3D() const noexcept { return GPU3D.GetCurrentRenderer(); }
     [[nodiscard]] Renderer3D& GetRenderer3D() noexcept { return GPU3D.GetCurrentRenderer(); }
 
+    /// Framebuffers hold 256*192 pixels per screen, times the square of this scale.
+    /// It is above 1 when the software 3D renderer renders above the native resolution.
+    [[nodiscard]] int GetFramebufferScale() const noexcept { return GPU3D.GetFramebufferScale(); }
+
+    /// Reallocates the framebuffers for the current 3D renderer.
+    /// Needs to be called when the renderer's framebuffer scale changes.
+    void InitFramebuffers() noexcept;
+
     u8* GetUniqueBankPtr(u32 mask, u32 offset) noexcept;
     const u8* GetUniqueBankPtr(u32 mask, u32 offset) const noexcept;
 
@@ -607,7 +615,7 @@ public:
 private:
     void ResetVRAMCache() noexcept;
     void AssignFramebuffers() noexcept;
-    void InitFramebuffers() noexcept;
+    size_t GetFramebufferSize() const noexcept;
     template<typename T>
     T ReadVRAM_ABGExtPal(u32 addr) const noexcept
     {
@@ -106,9 +106,21 @@ void SoftRenderer::DrawScanline(u32 line, Unit* unit)
 {
     CurUnit = unit;
 
+    // when the 3D renderer outputs more than 256x192, the 3D layer is kept apart
+    // from the 2D layers like in accelerated mode, and composited at the higher
+    // resolution once the scanline is done
+    int scale = GPU.GPU3D.GetFramebufferScale();
+    Deferred3D = GPU.GPU3D.IsRendererAccelerated() || (scale > 1);
+
     int stride = GPU.GPU3D.IsRendererAccelerated() ? (256*3 + 1) : 256;
     u32* dst = &Framebuffer[CurUnit->Num][stride * line];
 
+    // output lines at the 3D renderer's resolution
+    // at 1x, this is the same as dst
+    u32* scaleddst = &Framebuffer[CurUnit->Num][256*scale*scale * line];
+    int scaledsize = 256*scale*scale;
+    if (scale > 1) dst = NativeLine;
+
     int n3dline = line;
     line = GPU.VCount;
 
@@ -160,6 +172,12 @@ void SoftRenderer::DrawScanline(u32 line, Unit* unit)
         for (int i = 0; i < 256; i++)
             dst[i] = 0xFFFFFFFF;
 
+        if (scale > 1)
+        {
+            for (int i = 0; i < scaledsize; i++)
+                scaleddst[i] = 0xFFFFFFFF;
+        }
+
         if (GPU.GPU3D.IsRendererAccelerated())
         {
             dst[256*3] = 0;
@@ -234,6 +252,10 @@ void SoftRenderer::DrawScanline(u32 line, Unit* unit)
         break;
     }
 
+    // the capture overwrites the deferred layers, so the scaled output goes first
+    if (scale > 1)
+        DrawScaledLine(scaleddst, n3dline, scale, (CurUnit->Num == 0) && (dispmode == 1));
+
     // capture
     if ((CurUnit->Num == 0) && CurUnit->CaptureLatch)
     {
@@ -271,9 +293,9 @@ void SoftRenderer::DrawScanline(u32 line, Unit* unit)
             u32 factor = masterBrightness & 0x1F;
             if (factor > 16) factor = 16;
 
-            for (int i = 0; i < 256; i++)
+            for (int i = 0; i < scaledsize; i++)
             {
-                dst[i] = ColorBrightnessUp(dst[i], factor, 0x0);
+                scaleddst[i] = ColorBrightnessUp(scaleddst[i], factor, 0x0);
             }
         }
         else if ((masterBrightness >> 14) == 2)
@@ -282,9 +304,9 @@ void SoftRenderer::DrawScanline(u32 line, Unit* unit)
             u32 factor = masterBrightness & 0x1F;
             if (factor > 16) factor = 16;
 
-            for (int i = 0; i < 256; i++)
+            for (int i = 0; i < scaledsize; i++)
             {
-                dst[i] = ColorBrightnessDown(dst[i], factor, 0xF);
+                scaleddst[i] = ColorBrightnessDown(scaleddst[i], factor, 0xF);
             }
         }
     }
@@ -292,16 +314,16 @@ void SoftRenderer::DrawScanline(u32 line, Unit* unit)
     // convert to 32-bit BGRA
     // note: 32-bit RGBA would be more straightforward, but
     // BGRA seems to be more compatible (Direct2D soft, cairo...)
-    for (int i = 0; i < 256; i+=2)
+    for (int i = 0; i < scaledsize; i+=2)
     {
-        u64 c = *(u64*)&dst[i];
+        u64 c = *(u64*)&scaleddst[i];
 
         u64 r = (c << 18) & 0xFC000000FC0000;
         u64 g = (c << 2) & 0xFC000000FC00;
         u64 b = (c >> 14) & 0xFC000000FC;
         c = r | g | b;
 
-        *(u64*)&dst[i] = c | ((c & 0x00C0C0C000C0C0C0) >> 6) | 0xFF000000FF000000;
+        *(u64*)&scaleddst[i] = c | ((c & 0x00C0C0C000C0C0C0) >> 6) | 0xFF000000FF000000;
     }
 }
 
@@ -318,6 +340,81 @@ void SoftRenderer::VBlankEnd(Unit* unitA, Unit* unitB)
 #endif
 }
 
+u32 SoftRenderer::Composite3D(u32 val1, u32 val2, u32 val3, u32 _3dval)
+{
+    // same as the compositing shader used in accelerated mode
+    // val1-3 are the deferred layers, val3 holds the compositing mode
+
+    u32 compmode = (val3 >> 24) & 0xF;
+
+    if (compmode == 4)
+    {
+        // 3D on top, blending
+
+        if ((_3dval >> 24) > 0)
+            val1 = ColorBlend5(_3dval, val1);
+        else
+            val1 = val2;
+    }
+    else if (compmode == 1)
+    {
+        // 3D on bottom, blending
+
+        if ((_3dval >> 24) > 0)
+        {
+            u32 eva = (val3 >> 8) & 0x1F;
+            u32 evb = (val3 >> 16) & 0x1F;
+
+            val1 = ColorBlend4(val1, _3dval, eva, evb);
+        }
+        else
+            val1 = val2;
+    }
+    else if (compmode <= 3)
+    {
+        // 3D on top, normal/fade
+
+        if ((_3dval >> 24) > 0)
+        {
+            u32 evy = (val3 >> 8) & 0x1F;
+
+            val1 = _3dval;
+            if      (compmode == 2) val1 = ColorBrightnessUp(val1, evy, 0x8);
+            else if (compmode == 3) val1 = ColorBrightnessDown(val1, evy, 0x7);
+        }
+        else
+            val1 = val2;
+    }
+
+    return val1;
+}
+
+void SoftRenderer::DrawScaledLine(u32* dst, u32 line, int scale, bool composite3D)
+{
+    int width = 256 * scale;
+
+    for (int y = 0; y < scale; y++)
+    {
+        if (composite3D)
+        {
+            const u32* _3dline = GPU.GPU3D.GetScaledLine(line*scale + y);
+
+            for (int x = 0; x < width; x++)
+            {
+                int i = x / scale;
+                dst[x] = Composite3D(BGOBJLine[i], BGOBJLine[256+i], BGOBJLine[512+i], _3dline[x]);
+            }
+        }
+        else
+        {
+            for (int x = 0; x < width; x++)
+                dst[x] = NativeLine[x / scale];
+        }
+
+        dst += width;
+    }
+}
+
 void SoftRenderer::DoCapture(u32 line, u32 width)
 {
     u32 captureCnt = CurUnit->CaptureCnt;
@@ -341,64 +438,14 @@ void SoftRenderer::DoCapture(u32 line, u32 width)
     else
     {
         srcA = BGOBJLine;
-        if (GPU.GPU3D.IsRendererAccelerated())
+        if (Deferred3D)
         {
-            // in GPU3D::CurrentRenderer->Accelerated mode, compositing is normally done on the GPU
-            // but when doing display capture, we do need the composited output
-            // so we do it here
+            // when the 3D layer is deferred, compositing is normally done on the GPU
+            // or at the 3D renderer's resolution, but when doing display capture,
+            // we do need the composited output so we do it here
 
             for (int i = 0; i < 256; i++)
-            {
-                u32 val1 = BGOBJLine[i];
-                u32 val2 = BGOBJLine[256+i];
-                u32 val3 = BGOBJLine[512+i];
-
-                u32 compmode = (val3 >> 24) & 0xF;
-
-                if (compmode == 4)
-                {
-                    // 3D on top, blending
-
-                    u32 _3dval = _3DLine[i];
-                    if ((_3dval >> 24) > 0)
-                        val1 = ColorBlend5(_3dval, val1);
-                    else
-                        val1 = val2;
-                }
-                else if (compmode == 1)
-                {
-                    // 3D on bottom, blending
-
-                    u32 _3dval = _3DLine[i];
-                    if ((_3dval >> 24) > 0)
-                    {
-                        u32 eva = (val3 >> 8) & 0x1F;
-                        u32 evb = (val3 >> 16) & 0x1F;
-
-                        val1 = ColorBlend4(val1, _3dval, eva, evb);
-                    }
-                    else
-                        val1 = val2;
-                }
-                else if (compmode <= 3)
-                {
-                    // 3D on top, normal/fade
-
-                    u32 _3dval = _3DLine[i];
-                    if ((_3dval >> 24) > 0)
-                    {
-                        u32 evy = (val3 >> 8) & 0x1F;
-
-                        val1 = _3dval;
-                        if      (compmode == 2) val1 = ColorBrightnessUp(val1, evy, 0x8);
-                        else if (compmode == 3) val1 = ColorBrightnessDown(val1, evy, 0x7);
-                    }
-                    else
-                        val1 = val2;
-                }
-
-                BGOBJLine[i] = val1;
-            }
+                BGOBJLine[i] = Composite3D(BGOBJLine[i], BGOBJLine[256+i], BGOBJLine[512+i], _3DLine[i]);
         }
     }
 
@@ -545,12 +592,12 @@ void SoftRenderer::DoCapture(u32 line, u32 width)
     { \
         if ((bgCnt[num] & 0x0040) && (CurUnit->BGMosaicSize[0] > 0)) \
         { \
-            if (GPU.GPU3D.IsRendererAccelerated()) DrawBG_##type<true, DrawPixel_Accel>(line, num); \
+            if (Deferred3D) DrawBG_##type<true, DrawPixel_Accel>(line, num); \
             else DrawBG_##type<true, DrawPixel_Normal>(line, num); \
         } \
         else \
         { \
-            if (GPU.GPU3D.IsRendererAccelerated()) DrawBG_##type<false, DrawPixel_Accel>(line, num); \
+            if (Deferred3D) DrawBG_##type<false, DrawPixel_Accel>(line, num); \
             else DrawBG_##type<false, DrawPixel_Normal>(line, num); \
         } \
     } while (false)
@@ -560,18 +607,18 @@ void SoftRenderer::DoCapture(u32 line, u32 width)
     { \
         if ((bgCnt[2] & 0x0040) && (CurUnit->BGMosaicSize[0] > 0)) \
         { \
-            if (GPU.GPU3D.IsRendererAccelerated()) DrawBG_Large<true, DrawPixel_Accel>(line); \
+            if (Deferred3D) DrawBG_Large<true, DrawPixel_Accel>(line); \
             else DrawBG_Large<true, DrawPixel_Normal>(line); \
         } \
         else \
         { \
-            if (GPU.GPU3D.IsRendererAccelerated()) DrawBG_Large<false, DrawPixel_Accel>(line); \
+            if (Deferred3D) DrawBG_Large<false, DrawPixel_Accel>(line); \
             else DrawBG_Large<false, DrawPixel_Normal>(line); \
         } \
     } while (false)
 
 #define DoInterleaveSprites(prio) \
-    if (GPU.GPU3D.IsRendererAccelerated()) InterleaveSprites<DrawPixel_Accel>(prio); else InterleaveSprites<DrawPixel_Normal>(prio);
+    if (Deferred3D) InterleaveSprites<DrawPixel_Accel>(prio); else InterleaveSprites<DrawPixel_Normal>(prio);
 
 template<u32 bgmode>
 void SoftRenderer::DrawScanlineBGMode(u32 line)
@@ -697,6 +744,13 @@ void SoftRenderer::DrawScanline_BGOBJ(u32 line)
         for (int i = 0; i < 256; i++)
             BGOBJLine[i] = 0xFF3F3F3F;
 
+        // don't let the deferred 3D layer show through
+        if (Deferred3D)
+        {
+            for (int i = 0; i < 256; i++)
+                BGOBJLine[512+i] = 0x07000000;
+        }
+
         return;
     }
 
@@ -739,7 +793,7 @@ void SoftRenderer::DrawScanline_BGOBJ(u32 line)
     // color special effects
     // can likely be optimized
 
-    if (!GPU.GPU3D.IsRendererAccelerated())
+    if (!Deferred3D)
     {
         for (int i = 0; i < 256; i++)
         {
@@ -885,7 +939,7 @@ void SoftRenderer::DrawBG_3D()
 {
     int i = 0;
 
-    if (GPU.GPU3D.IsRendererAccelerated())
+    if (Deferred3D)
     {
         for (i = 0; i < 256; i++)
         {
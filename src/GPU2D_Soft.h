@@ -41,6 +41,11 @@ private:
     alignas(8) u32 BGOBJLine[256*3];
     u32* _3DLine;
 
+    // whether the 3D layer is composited after the 2D layers, see DrawScanline()
+    bool Deferred3D;
+    // native resolution output when the 3D renderer outputs more than 256x192
+    alignas(8) u32 NativeLine[256];
+
     alignas(8) u8 WindowMask[256];
 
     alignas(8) u32 OBJLine[2][256];
@@ -118,6 +123,8 @@ private:
         return rb | g | 0xFF000000;
     }
     u32 ColorComposite(int i, u32 val1, u32 val2) const;
+    static u32 Composite3D(u32 val1, u32 val2, u32 val3, u32 _3dval);
+    void DrawScaledLine(u32* dst, u32 line, int scale, bool composite3D);
 
     template<u32 bgmode> void DrawScanlineBGMode(u32 line);
     void DrawScanlineBGMode6(u32 line);
@@ -25,6 +25,8 @@
 #include "GPU3D_Soft.h"
 #include "Platform.h"
 #include "GPU3D.h"
+#include "GPU3D_Math.h"
+#include "SIMD.h"
 
 namespace melonDS
 {
@@ -192,6 +194,9 @@ void GPU3D::Reset() noexcept
 
     CmdStallQueue.Clear();
 
+    CurGeometryStats = {};
+    FrameGeometryStats = {};
+
     ZeroDotWLimit = 0xFFFFFF;
 
     GXStat = 0;
@@ -305,6 +310,8 @@ void GPU3D::Reset() noexcept
 
     RenderXPos = 0;
 
+    Capture = nullptr;
+
     if (CurrentRenderer)
         CurrentRenderer->Reset(NDS.GPU);
 }
@@ -313,6 +320,10 @@ void GPU3D::DoSavestate(Savestate* file) noexcept
 {
     file->Section("GP3D");
 
+    // a capture can't survive the state changing under it
+    if (!file->Saving)
+        Capture = nullptr;
+
     SoftRenderer* softRenderer = dynamic_cast<SoftRenderer*>(CurrentRenderer.get());
     if (softRenderer && softRenderer->IsThreaded())
     {
@@ -566,6 +577,8 @@ void GPU3D::DoSavestate(Savestate* file) noexcept
 
 void GPU3D::SetEnabled(bool geometry, bool rendering) noexcept
 {
+    if (Capture) Capture->RecordSetEnabled(geometry, rendering);
+
     GeometryEnabled = geometry;
     RenderingEnabled = rendering;
 
@@ -601,25 +614,10 @@ void MatrixMult4x4(s32* m, s32* s)
     memcpy(tmp, m, 16*4);
 
     // m = s*m
-    m[0] = ((s64)s[0]*tmp[0] + (s64)s[1]*tmp[4] + (s64)s[2]*tmp[8] + (s64)s[3]*tmp[12]) >> 12;
-    m[1] = ((s64)s[0]*tmp[1] + (s64)s[1]*tmp[5] + (s64)s[2]*tmp[9] + (s64)s[3]*tmp[13]) >> 12;
-    m[2] = ((s64)s[0]*tmp[2] + (s64)s[1]*tmp[6] + (s64)s[2]*tmp[10] + (s64)s[3]*tmp[14]) >> 12;
-    m[3] = ((s64)s[0]*tmp[3] + (s64)s[1]*tmp[7] + (s64)s[2]*tmp[11] + (s64)s[3]*tmp[15]) >> 12;
-
-    m[4] = ((s64)s[4]*tmp[0] + (s64)s[5]*tmp[4] + (s64)s[6]*tmp[8] + (s64)s[7]*tmp[12]) >> 12;
-    m[5] = ((s64)s[4]*tmp[1] + (s64)s[5]*tmp[5] + (s64)s[6]*tmp[9] + (s64)s[7]*tmp[13]) >> 12;
-    m[6] = ((s64)s[4]*tmp[2] + (s64)s[5]*tmp[6] + (s64)s[6]*tmp[10] + (s64)s[7]*tmp[14]) >> 12;
-    m[7] = ((s64)s[4]*tmp[3] + (s64)s[5]*tmp[7] + (s64)s[6]*tmp[11] + (s64)s[7]*tmp[15]) >> 12;
-
-    m[8] = ((s64)s[8]*tmp[0] + (s64)s[9]*tmp[4] + (s64)s[10]*tmp[8] + (s64)s[11]*tmp[12]) >> 12;
-    m[9] = ((s64)s[8]*tmp[1] + (s64)s[9]*tmp[5] + (s64)s[10]*tmp[9] + (s64)s[11]*tmp[13]) >> 12;
-    m[10] = ((s64)s[8]*tmp[2] + (s64)s[9]*tmp[6] + (s64)s[10]*tmp[10] + (s64)s[11]*tmp[14]) >> 12;
-    m[11] = ((s64)s[8]*tmp[3] + (s64)s[9]*tmp[7] + (s64)s[10]*tmp[11] + (s64)s[11]*tmp[15]) >> 12;
-
-    m[12] = ((s64)s[12]*tmp[0] + (s64)s[13]*tmp[4] + (s64)s[14]*tmp[8] + (s64)s[15]*tmp[12]) >> 12;
-    m[13] = ((s64)s[12]*tmp[1] + (s64)s[13]*tmp[5] + (s64)s[14]*tmp[9] + (s64)s[15]*tmp[13]) >> 12;
-    m[14] = ((s64)s[12]*tmp[2] + (s64)s[13]*tmp[6] + (s64)s[14]*tmp[10] + (s64)s[15]*tmp[14]) >> 12;
-    m[15] = ((s64)s[12]*tmp[3] + (s64)s[13]*tmp[7] + (s64)s[14]*tmp[11] + (s64)s[15]*tmp[15]) >> 12;
+    MatrixRowMult<4>(&m[0], &s[0], tmp);
+    MatrixRowMult<4>(&m[4], &s[4], tmp);
+    MatrixRowMult<4>(&m[8], &s[8], tmp);
+    MatrixRowMult<4>(&m[12], &s[12], tmp);
 }
 
 void MatrixMult4x3(s32* m, s32* s)
@@ -628,25 +626,12 @@ void MatrixMult4x3(s32* m, s32* s)
     memcpy(tmp, m, 16*4);
 
     // m = s*m
-    m[0] = ((s64)s[0]*tmp[0] + (s64)s[1]*tmp[4] + (s64)s[2]*tmp[8]) >> 12;
-    m[1] = ((s64)s[0]*tmp[1] + (s64)s[1]*tmp[5] + (s64)s[2]*tmp[9]) >> 12;
-    m[2] = ((s64)s[0]*tmp[2] + (s64)s[1]*tmp[6] + (s64)s[2]*tmp[10]) >> 12;
-    m[3] = ((s64)s[0]*tmp[3] + (s64)s[1]*tmp[7] + (s64)s[2]*tmp[11]) >> 12;
-
-    m[4] = ((s64)s[3]*tmp[0] + (s64)s[4]*tmp[4] + (s64)s[5]*tmp[8]) >> 12;
-    m[5] = ((s64)s[3]*tmp[1] + (s64)s[4]*tmp[5] + (s64)s[5]*tmp[9]) >> 12;
-    m[6] = ((s64)s[3]*tmp[2] + (s64)s[4]*tmp[6] + (s64)s[5]*tmp[10]) >> 12;
-    m[7] = ((s64)s[3]*tmp[3] + (s64)s[4]*tmp[7] + (s64)s[5]*tmp[11]) >> 12;
-
-    m[8] = ((s64)s[6]*tmp[0] + (s64)s[7]*tmp[4] + (s64)s[8]*tmp[8]) >> 12;
-    m[9] = ((s64)s[6]*tmp[1] + (s64)s[7]*tmp[5] + (s64)s[8]*tmp[9]) >> 12;
-    m[10] = ((s64)s[6]*tmp[2] + (s64)s[7]*tmp[6] + (s64)s[8]*tmp[10]) >> 12;
-    m[11] = ((s64)s[6]*tmp[3] + (s64)s[7]*tmp[7] + (s64)s[8]*tmp[11]) >> 12;
-
-    m[12] = ((s64)s[9]*tmp[0] + (s64)s[10]*tmp[4] + (s64)s[11]*tmp[8] + (s64)0x1000*tmp[12]) >> 12;
-    m[13] = ((s64)s[9]*tmp[1] + (s64)s[10]*tmp[5] + (s64)s[11]*tmp[9] + (s64)0x1000*tmp[13]) >> 12;
-    m[14] = ((s64)s[9]*tmp[2] + (s64)s[10]*tmp[6] + (s64)s[11]*tmp[10] + (s64)0x1000*tmp[14]) >> 12;
-    m[15] = ((s64)s[9]*tmp[3] + (s64)s[10]*tmp[7] + (s64)s[11]*tmp[11] + (s64)0x1000*tmp[15]) >> 12;
+    MatrixRowMult<3>(&m[0], &s[0], tmp);
+    MatrixRowMult<3>(&m[4], &s[3], tmp);
+    MatrixRowMult<3>(&m[8], &s[6], tmp);
+
+    s32 lastrow[4] = {s[9], s[10], s[11], 0x1000};
+    MatrixRowMult<4>(&m[12], lastrow, tmp);
 }
 
 void MatrixMult3x3(s32* m, s32* s)
@@ -655,46 +640,27 @@ void MatrixMult3x3(s32* m, s32* s)
     memcpy(tmp, m, 12*4);
 
     // m = s*m
-    m[0] = ((s64)s[0]*tmp[0] + (s64)s[1]*tmp[4] + (s64)s[2]*tmp[8]) >> 12;
-    m[1] = ((s64)s[0]*tmp[1] + (s64)s[1]*tmp[5] + (s64)s[2]*tmp[9]) >> 12;
-    m[2] = ((s64)s[0]*tmp[2] + (s64)s[1]*tmp[6] + (s64)s[2]*tmp[10]) >> 12;
-    m[3] = ((s64)s[0]*tmp[3] + (s64)s[1]*tmp[7] + (s64)s[2]*tmp[11]) >> 12;
-
-    m[4] = ((s64)s[3]*tmp[0] + (s64)s[4]*tmp[4] + (s64)s[5]*tmp[8]) >> 12;
-    m[5] = ((s64)s[3]*tmp[1] + (s64)s[4]*tmp[5] + (s64)s[5]*tmp[9]) >> 12;
-    m[6] = ((s64)s[3]*tmp[2] + (s64)s[4]*tmp[6] + (s64)s[5]*tmp[10]) >> 12;
-    m[7] = ((s64)s[3]*tmp[3] + (s64)s[4]*tmp[7] + (s64)s[5]*tmp[11]) >> 12;
-
-    m[8] = ((s64)s[6]*tmp[0] + (s64)s[7]*tmp[4] + (s64)s[8]*tmp[8]) >> 12;
-    m[9] = ((s64)s[6]*tmp[1] + (s64)s[7]*tmp[5] + (s64)s[8]*tmp[9]) >> 12;
-    m[10] = ((s64)s[6]*tmp[2] + (s64)s[7]*tmp[6] + (s64)s[8]*tmp[10]) >> 12;
-    m[11] = ((s64)s[6]*tmp[3] + (s64)s[7]*tmp[7] + (s64)s[8]*tmp[11]) >> 12;
+    MatrixRowMult<3>(&m[0], &s[0], tmp);
+    MatrixRowMult<3>(&m[4], &s[3], tmp);
+    MatrixRowMult<3>(&m[8], &s[6], tmp);
 }
 
 void MatrixScale(s32* m, s32* s)
 {
-    m[0] = ((s64)s[0]*m[0]) >> 12;
-    m[1] = ((s64)s[0]*m[1]) >> 12;
-    m[2] = ((s64)s[0]*m[2]) >> 12;
-    m[3] = ((s64)s[0]*m[3]) >> 12;
-
-    m[4] = ((s64)s[1]*m[4]) >> 12;
-    m[5] = ((s64)s[1]*m[5]) >> 12;
-    m[6] = ((s64)s[1]*m[6]) >> 12;
-    m[7] = ((s64)s[1]*m[7]) >> 12;
-
-    m[8] = ((s64)s[2]*m[8]) >> 12;
-    m[9] = ((s64)s[2]*m[9]) >> 12;
-    m[10] = ((s64)s[2]*m[10]) >> 12;
-    m[11] = ((s64)s[2]*m[11]) >> 12;
+    MatrixRowMult<1>(&m[0], &s[0], &m[0]);
+    MatrixRowMult<1>(&m[4], &s[1], &m[4]);
+    MatrixRowMult<1>(&m[8], &s[2], &m[8]);
 }
 
 void MatrixTranslate(s32* m, s32* s)
 {
-    m[12] += ((s64)s[0]*m[0] + (s64)s[1]*m[4] + (s64)s[2]*m[8]) >> 12;
-    m[13] += ((s64)s[0]*m[1] + (s64)s[1]*m[5] + (s64)s[2]*m[9]) >> 12;
-    m[14] += ((s64)s[0]*m[2] + (s64)s[1]*m[6] + (s64)s[2]*m[10]) >> 12;
-    m[15] += ((s64)s[0]*m[3] + (s64)s[1]*m[7] + (s64)s[2]*m[11]) >> 12;
+    s32 trans[4];
+    MatrixRowMult<3>(trans, s, m);
+
+    m[12] += trans[0];
+    m[13] += trans[1];
+    m[14] += trans[2];
+    m[15] += trans[3];
 }
 
 void GPU3D::UpdateClipMatrix() noexcept
@@ -836,6 +802,35 @@ void ClipSegment(Vertex* outbuf, Vertex* vin, Vertex* vout)
 #undef INTERPOLATE
 }
 
+// combines the outcodes of the vertices that are subject to clipping
+// returns the sides any of them is outside of, allout receives the sides all of them are outside of
+inline u32 ClipOutcodes(const Vertex* vertices, int nverts, int clipstart, u32& allout)
+{
+    u32 anyout = 0;
+    allout = 0x77;
+    for (int i = clipstart; i < nverts; i++)
+    {
+        u32 outcode = ClipOutcode(vertices[i].Position);
+        anyout |= outcode;
+        allout &= outcode;
+    }
+
+    return anyout;
+}
+
+// checkme
+inline void ClipAdjustColors(Vertex* vertices, int nverts)
+{
+    for (int i = 0; i < nverts; i++)
+    {
+        Vertex* vtx = &vertices[i];
+
+        vtx->Color[0] &= ~0xFFF; vtx->Color[0] += 0xFFF;
+        vtx->Color[1] &= ~0xFFF; vtx->Color[1] += 0xFFF;
+        vtx->Color[2] &= ~0xFFF; vtx->Color[2] += 0xFFF;
+    }
+}
+
 template<int comp, bool attribs>
 int ClipAgainstPlane(const GPU3D& gpu, Vertex* vertices, int nverts, int clipstart)
 {
@@ -843,6 +838,15 @@ int ClipAgainstPlane(const GPU3D& gpu, Vertex* vertices, int nverts, int clipsta
     int prev, next;
     int c = clipstart;
 
+    u32 allout;
+    if (!(ClipOutcodes(vertices, nverts, clipstart, allout) & (0x11 << comp)))
+    {
+        // no vertex is outside of this plane, they are all kept as they are
+        nverts = std::max(nverts, clipstart);
+        ClipAdjustColors(vertices, nverts);
+        return nverts;
+    }
+
     if (clipstart == 2)
     {
         temp[0] = vertices[0];
@@ -904,16 +908,7 @@ int ClipAgainstPlane(const GPU3D& gpu, Vertex* vertices, int nverts, int clipsta
             vertices[c++] = vtx;
     }
 
-    // checkme
-    for (int i = 0; i < c; i++)
-    {
-        Vertex* vtx = &vertices[i];
-
-        vtx->Color[0] &= ~0xFFF; vtx->Color[0] += 0xFFF;
-        vtx->Color[1] &= ~0xFFF; vtx->Color[1] += 0xFFF;
-        vtx->Color[2] &= ~0xFFF; vtx->Color[2] += 0xFFF;
-    }
-
+    ClipAdjustColors(vertices, c);
     return c;
 }
 
@@ -930,6 +925,33 @@ int ClipPolygon(GPU3D& gpu, Vertex* vertices, int nverts, int clipstart)
     // some vertices that should get Y=-0x1000 get Y=0x1000 for some reason on hardware. it doesn't make sense.
     // clipping seems to process the Y plane before the X plane.
 
+    // most polygons are either entirely inside the view volume, or entirely
+    // outside of one of its planes
+    u32 allout;
+    u32 anyout = ClipOutcodes(vertices, nverts, clipstart, allout);
+    if (!anyout)
+    {
+        ClipAdjustColors(vertices, nverts);
+        return nverts;
+    }
+
+    // the vertices aren't tested against the planes in a single pass, so a polygon can
+    // only be rejected here if none of the planes that come before would clip it.
+    // vertices reused from strips are never tested, and always kept.
+    if (clipstart == 0)
+    {
+        for (int comp : {2, 1, 0})
+        {
+            u32 above = 1 << comp;
+            u32 below = 0x10 << comp;
+
+            if ((allout & above) || ((allout & below) && !(anyout & above)))
+                return 0;
+            if (anyout & (above | below))
+                break;
+        }
+    }
+
     // Z clipping
     nverts = ClipAgainstPlane<2, attribs>(gpu, vertices, nverts, clipstart);
 
@@ -1000,11 +1022,14 @@ void GPU3D::SubmitPolygon() noexcept
 
     bool facingview = (dot <= 0);
 
+    CurGeometryStats.PolygonsSubmitted++;
+
     if (dot < 0)
     {
         if (!(CurPolygonAttr & (1<<7)))
         {
             LastStripPolygon = NULL;
+            CurGeometryStats.PolygonsCulled++;
             return;
         }
     }
@@ -1013,6 +1038,7 @@ void GPU3D::SubmitPolygon() noexcept
         if (!(CurPolygonAttr & (1<<6)))
         {
             LastStripPolygon = NULL;
+            CurGeometryStats.PolygonsCulled++;
             return;
         }
     }
@@ -1087,6 +1113,7 @@ void GPU3D::SubmitPolygon() noexcept
     if (nverts == 0)
     {
         LastStripPolygon = NULL;
+        CurGeometryStats.PolygonsClipped++;
         return;
     }
 
@@ -1095,6 +1122,7 @@ void GPU3D::SubmitPolygon() noexcept
     if (NumPolygons >= 2048 || NumVertices+nverts > 6144)
     {
         LastStripPolygon = NULL;
+        CurGeometryStats.PolygonsDropped++;
         DispCnt |= (1<<13);
         return;
     }
@@ -1184,6 +1212,7 @@ void GPU3D::SubmitPolygon() noexcept
         if (zerodot && allbehind)
         {
             LastStripPolygon = NULL;
+            CurGeometryStats.PolygonsClipped++;
             return;
         }
     }
@@ -1360,11 +1389,11 @@ void GPU3D::SubmitVertex() noexcept
     s64 vertex[4] = {(s64)CurVertex[0], (s64)CurVertex[1], (s64)CurVertex[2], 0x1000};
     Vertex* vertextrans = &TempVertexBuffer[VertexNumInPoly];
 
+    CurGeometryStats.VerticesSubmitted++;
+
     UpdateClipMatrix();
-    vertextrans->Position[0] = (vertex[0]*ClipMatrix[0] + vertex[1]*ClipMatrix[4] + vertex[2]*ClipMatrix[8] + vertex[3]*ClipMatrix[12]) >> 12;
-    vertextrans->Position[1] = (vertex[0]*ClipMatrix[1] + vertex[1]*ClipMatrix[5] + vertex[2]*ClipMatrix[9] + vertex[3]*ClipMatrix[13]) >> 12;
-    vertextrans->Position[2] = (vertex[0]*ClipMatrix[2] + vertex[1]*ClipMatrix[6] + vertex[2]*ClipMatrix[10] + vertex[3]*ClipMatrix[14]) >> 12;
-    vertextrans->Position[3] = (vertex[0]*ClipMatrix[3] + vertex[1]*ClipMatrix[7] + vertex[2]*ClipMatrix[11] + vertex[3]*ClipMatrix[15]) >> 12;
+    s32 position[4] = {CurVertex[0], CurVertex[1], CurVertex[2], 0x1000};
+    MatrixRowMult<4>(vertextrans->Position, position, ClipMatrix);
 
     // this probably shouldn't be.
     // the way color is handled during clipping needs investigation. TODO
@@ -1461,10 +1490,11 @@ void GPU3D::CalculateLighting() noexcept
         TexCoords[1] = RawTexCoords[1] + (((s64)Normal[0]*TexMatrix[1] + (s64)Normal[1]*TexMatrix[5] + (s64)Normal[2]*TexMatrix[9]) >> 21);
     }
 
-    s32 normaltrans[3]; // should be 1 bit sign 10 bits frac
-    normaltrans[0] = ((Normal[0]*VecMatrix[0] + Normal[1]*VecMatrix[4] + Normal[2]*VecMatrix[8]) << 9) >> 21;
-    normaltrans[1] = ((Normal[0]*VecMatrix[1] + Normal[1]*VecMatrix[5] + Normal[2]*VecMatrix[9]) << 9) >> 21;
-    normaltrans[2] = ((Normal[0]*VecMatrix[2] + Normal[1]*VecMatrix[6] + Normal[2]*VecMatrix[10]) << 9) >> 21;
+    s32 normaltrans[4]; // should be 1 bit sign 10 bits frac
+    NormalTransform(normaltrans, Normal, VecMatrix);
+    normaltrans[0] = (normaltrans[0] << 9) >> 21;
+    normaltrans[1] = (normaltrans[1] << 9) >> 21;
+    normaltrans[2] = (normaltrans[2] << 9) >> 21;
 
     s32 c = 0;
     u32 vtxbuff[3] =
@@ -1579,14 +1609,8 @@ void GPU3D::BoxTest(const u32* params) noexcept
     UpdateClipMatrix();
     for (int i = 0; i < 8; i++)
     {
-        s32 x = cube[i].Position[0];
-        s32 y = cube[i].Position[1];
-        s32 z = cube[i].Position[2];
-
-        cube[i].Position[0] = ((s64)x*ClipMatrix[0] + (s64)y*ClipMatrix[4] + (s64)z*ClipMatrix[8] + (s64)0x1000*ClipMatrix[12]) >> 12;
-        cube[i].Position[1] = ((s64)x*ClipMatrix[1] + (s64)y*ClipMatrix[5] + (s64)z*ClipMatrix[9] + (s64)0x1000*ClipMatrix[13]) >> 12;
-        cube[i].Position[2] = ((s64)x*ClipMatrix[2] + (s64)y*ClipMatrix[6] + (s64)z*ClipMatrix[10] + (s64)0x1000*ClipMatrix[14]) >> 12;
-        cube[i].Position[3] = ((s64)x*ClipMatrix[3] + (s64)y*ClipMatrix[7] + (s64)z*ClipMatrix[11] + (s64)0x1000*ClipMatrix[15]) >> 12;
+        cube[i].Position[3] = 0x1000;
+        MatrixRowMult<4>(cube[i].Position, cube[i].Position, ClipMatrix);
     }
 
     // front face (-Z)
@@ -1646,13 +1670,10 @@ void GPU3D::BoxTest(const u32* params) noexcept
 
 void GPU3D::PosTest() noexcept
 {
-    s64 vertex[4] = {(s64)CurVertex[0], (s64)CurVertex[1], (s64)CurVertex[2], 0x1000};
+    s32 vertex[4] = {CurVertex[0], CurVertex[1], CurVertex[2], 0x1000};
 
     UpdateClipMatrix();
-    PosTestResult[0] = (vertex[0]*ClipMatrix[0] + vertex[1]*ClipMatrix[4] + vertex[2]*ClipMatrix[8] + vertex[3]*ClipMatrix[12]) >> 12;
-    PosTestResult[1] = (vertex[0]*ClipMatrix[1] + vertex[1]*ClipMatrix[5] + vertex[2]*ClipMatrix[9] + vertex[3]*ClipMatrix[13]) >> 12;
-    PosTestResult[2] = (vertex[0]*ClipMatrix[2] + vertex[1]*ClipMatrix[6] + vertex[2]*ClipMatrix[10] + vertex[3]*ClipMatrix[14]) >> 12;
-    PosTestResult[3] = (vertex[0]*ClipMatrix[3] + vertex[1]*ClipMatrix[7] + vertex[2]*ClipMatrix[11] + vertex[3]*ClipMatrix[15]) >> 12;
+    MatrixRowMult<4>(PosTestResult, vertex, ClipMatrix);
 
     AddCycles(5);
 }
@@ -1667,9 +1688,11 @@ void GPU3D::VecTest(u32 param) noexcept
     normal[1] = (s16)((param & 0x000FFC00) >> 4) >> 6;
     normal[2] = (s16)((param & 0x3FF00000) >> 14) >> 6;
 
-    VecTestResult[0] = (normal[0]*VecMatrix[0] + normal[1]*VecMatrix[4] + normal[2]*VecMatrix[8]) >> 9;
-    VecTestResult[1] = (normal[0]*VecMatrix[1] + normal[1]*VecMatrix[5] + normal[2]*VecMatrix[9]) >> 9;
-    VecTestResult[2] = (normal[0]*VecMatrix[2] + normal[1]*VecMatrix[6] + normal[2]*VecMatrix[10]) >> 9;
+    s32 normaltrans[4];
+    NormalTransform(normaltrans, normal, VecMatrix);
+    VecTestResult[0] = normaltrans[0] >> 9;
+    VecTestResult[1] = normaltrans[1] >> 9;
+    VecTestResult[2] = normaltrans[2] >> 9;
 
     if (VecTestResult[0] & 0x1000) VecTestResult[0] |= 0xF000;
     if (VecTestResult[1] & 0x1000) VecTestResult[1] |= 0xF000;
@@ -1694,6 +1717,9 @@ void GPU3D::CmdFIFOWrite(const CmdFIFOEntry& entry) noexcept
             // worst case is if a STMxx opcode causes this, which is why our stall queue
             // has 64 entries. this is less complicated than trying to make STMxx stall-able.
 
+            if (CmdStallQueue.IsEmpty())
+                FIFOStallStart = NDS.ARM9Timestamp >> NDS.ARM9ClockShift;
+
             CmdStallQueue.Write(entry);
             NDS.GXFIFOStall();
             return;
@@ -1739,7 +1765,13 @@ GPU3D::CmdFIFOEntry GPU3D::CmdFIFORead() noexcept
             }
 
             if (CmdStallQueue.IsEmpty())
+            {
                 NDS.GXFIFOUnstall();
+
+                u64 now = NDS.ARM9Timestamp >> NDS.ARM9ClockShift;
+                if (now > FIFOStallStart)
+                    CurGeometryStats.FIFOStallCycles += now - FIFOStallStart;
+            }
         }
 
         CheckFIFODMA();
@@ -2458,6 +2490,8 @@ bool YSort(Polygon* a, Polygon* b)
 
 void GPU3D::VBlank() noexcept
 {
+    if (Capture) Capture->RecordVBlank();
+
     if (GeometryEnabled)
     {
         if (RenderingEnabled)
@@ -2487,6 +2521,9 @@ void GPU3D::VBlank() noexcept
 
                 RenderNumPolygons = NumPolygons;
                 RenderFrameIdentical = false;
+
+                FrameGeometryStats = CurGeometryStats;
+                CurGeometryStats = {};
             }
             else
             {
@@ -2535,9 +2572,22 @@ void GPU3D::VBlank() noexcept
 
 void GPU3D::VCount215(GPU& gpu) noexcept
 {
+    if (Capture && Capture->RecordRender(gpu))
+    {
+        Capture->Save();
+        Capture = nullptr;
+    }
+
     CurrentRenderer->RenderFrame(gpu);
 }
 
+void GPU3D::StartCapture(std::unique_ptr<GXCapture>&& capture) noexcept
+{
+    Capture = std::move(capture);
+    if (Capture)
+        Capture->Begin(*this);
+}
+
 void GPU3D::SetRenderXPos(u16 xpos) noexcept
 {
     if (!RenderingEnabled) return;
@@ -2581,11 +2631,62 @@ u32* GPU3D::GetLine(int line) noexcept
     return ScrolledLine;
 }
 
+GPU3DStats GPU3D::GetStats() const noexcept
+{
+    return {FrameGeometryStats, CurrentRenderer->GetStats()};
+}
+
+u32* GPU3D::GetScaledLine(int line) noexcept
+{
+    int scale = GetFramebufferScale();
+    if (scale == 1) return GetLine(line);
+
+    int width = 256 * scale;
+
+    if (!AbortFrame)
+    {
+        u32* rawline = CurrentRenderer->GetScaledLine(line);
+
+        if (RenderXPos == 0) return rawline;
+
+        // apply X scroll, in steps of one native pixel
+
+        int xpos = (RenderXPos & 0xFF) * scale;
+        if (RenderXPos & 0x100)
+        {
+            int i = 0, j = xpos;
+            for (; j < width; i++, j++)
+                ScrolledLine[i] = 0;
+            for (j = 0; i < width; i++, j++)
+                ScrolledLine[i] = rawline[j];
+        }
+        else
+        {
+            int i = 0, j = xpos;
+            for (; j < width; i++, j++)
+                ScrolledLine[i] = rawline[j];
+            for (; i < width; i++)
+                ScrolledLine[i] = 0;
+        }
+    }
+    else
+    {
+        memset(ScrolledLine, 0, width*4);
+    }
+
+    return ScrolledLine;
+}
+
 bool GPU3D::IsRendererAccelerated() const noexcept
 {
     return CurrentRenderer && CurrentRenderer->Accelerated;
 }
 
+int GPU3D::GetFramebufferScale() const noexcept
+{
+    return CurrentRenderer ? CurrentRenderer->GetFramebufferScale() : 1;
+}
+
 void GPU3D::WriteToGXFIFO(u32 val) noexcept
 {
     if (NumCommands == 0)
@@ -2607,6 +2708,7 @@ void GPU3D::WriteToGXFIFO(u32 val) noexcept
             CmdFIFOEntry entry;
             entry.Command = CurCommand & 0xFF;
             entry.Param = val;
+            if (Capture) Capture->RecordCommand(entry.Command, entry.Param);
             CmdFIFOWrite(entry);
         }
 
@@ -2766,6 +2868,10 @@ void GPU3D::Write8(u32 addr, u8 val) noexcept
     if (!RenderingEnabled && addr >= 0x04000320 && addr < 0x04000400) return;
     if (!GeometryEnabled  && addr >= 0x04000400 && addr < 0x04000700) return;
 
+    // GX FIFO and command port writes are recorded as commands
+    if (Capture && (addr & ~0x1FF) != 0x04000400)
+        Capture->RecordWrite(GXCaptureRecord::Write8, addr, val);
+
     switch (addr)
     {
     case 0x04000340:
@@ -2816,6 +2922,10 @@ void GPU3D::Write16(u32 addr, u16 val) noexcept
     if (!RenderingEnabled && addr >= 0x04000320 && addr < 0x04000400) return;
     if (!GeometryEnabled  && addr >= 0x04000400 && addr < 0x04000700) return;
 
+    // GX FIFO and command port writes are recorded as commands
+    if (Capture && (addr & ~0x1FF) != 0x04000400)
+        Capture->RecordWrite(GXCaptureRecord::Write16, addr, val);
+
     switch (addr)
     {
     case 0x04000060:
@@ -2903,6 +3013,10 @@ void GPU3D::Write32(u32 addr, u32 val) noexcept
     if (!RenderingEnabled && addr >= 0x04000320 && addr < 0x04000400) return;
     if (!GeometryEnabled  && addr >= 0x04000400 && addr < 0x04000700) return;
 
+    // GX FIFO and command port writes are recorded as commands
+    if (Capture && (addr & ~0x1FF) != 0x04000400)
+        Capture->RecordWrite(GXCaptureRecord::Write32, addr, val);
+
     switch (addr)
     {
     case 0x04000060:
@@ -2962,6 +3076,7 @@ void GPU3D::Write32(u32 addr, u32 val) noexcept
         CmdFIFOEntry entry;
         entry.Command = (addr & 0x1FC) >> 2;
         entry.Param = val;
+        if (Capture) Capture->RecordCommand(entry.Command, entry.Param);
         CmdFIFOWrite(entry);
         return;
     }
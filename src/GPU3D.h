@@ -24,6 +24,7 @@
 
 #include "Savestate.h"
 #include "FIFO.h"
+#include "GPU3D_Capture.h"
 
 namespace melonDS
 {
@@ -82,6 +83,41 @@ struct Polygon
     void DoSavestate(Savestate* file) noexcept;
 };
 
+// per-frame statistics, for profiling
+
+// counted by the geometry engine between two buffer swaps
+struct GeometryStats
+{
+    u32 VerticesSubmitted;
+    u32 PolygonsSubmitted;
+    u32 PolygonsCulled; // by their facing
+    u32 PolygonsClipped; // entirely outside of the view volume
+    u32 PolygonsDropped; // polygon or vertex RAM full
+    u64 FIFOStallCycles; // spent by the CPU waiting for the GX FIFO, in system clock cycles
+};
+
+// counted by the renderer over the rendering of a frame
+// accelerated renderers only report the number of polygons
+struct RenderStats
+{
+    u32 PolygonsRendered;
+    u32 ShadowPolygons; // shadow masks and shadows
+    u64 PixelsRasterized; // covered by polygon spans
+    u64 DepthRejects;
+    u64 TranslucentPixels;
+
+    // software renderer phases, in microseconds
+    u32 SetupTime;
+    u32 RasterTime;
+    u32 FinalPassTime;
+};
+
+struct GPU3DStats
+{
+    GeometryStats Geometry;
+    RenderStats Render;
+};
+
 class Renderer3D;
 class NDS;
 
@@ -114,9 +150,14 @@ public:
     [[nodiscard]] u16 GetRenderXPos() const noexcept { return RenderXPos; }
     u32* GetLine(int line) noexcept;
 
+    // lines at the 3D renderer's output resolution, for renderers whose framebuffer scale is above 1
+    // each scanline is made of GetFramebufferScale() lines of 256*GetFramebufferScale() pixels
+    u32* GetScaledLine(int line) noexcept;
+
     void WriteToGXFIFO(u32 val) noexcept;
 
     [[nodiscard]] bool IsRendererAccelerated() const noexcept;
+    [[nodiscard]] int GetFramebufferScale() const noexcept;
     [[nodiscard]] Renderer3D& GetCurrentRenderer() noexcept { return *CurrentRenderer; }
     [[nodiscard]] const Renderer3D& GetCurrentRenderer() const noexcept { return *CurrentRenderer; }
     void SetCurrentRenderer(std::unique_ptr<Renderer3D>&& renderer) noexcept;
@@ -128,7 +169,20 @@ public:
     void Write16(u32 addr, u16 val) noexcept;
     void Write32(u32 addr, u32 val) noexcept;
     void Blit(const GPU& gpu) noexcept;
+
+    static constexpr int MaxFramebufferScale = 4;
+
+    // statistics for the last frame that was rendered
+    // the renderer ones are a snapshot taken at VCount144, once the frame is done
+    [[nodiscard]] GPU3DStats GetStats() const noexcept;
+
+    // records the GX command stream until the capture's frame count is reached,
+    // at which point it is saved
+    void StartCapture(std::unique_ptr<GXCapture>&& capture) noexcept;
+    [[nodiscard]] bool IsCapturing() const noexcept { return Capture != nullptr; }
 private:
+    friend class GXReplay;
+
     melonDS::NDS& NDS;
     typedef union
     {
@@ -188,6 +242,12 @@ private:
     }
 
     std::unique_ptr<Renderer3D> CurrentRenderer = nullptr;
+    std::unique_ptr<GXCapture> Capture = nullptr;
+
+    // not part of the hardware state, don't serialize
+    GeometryStats CurGeometryStats {};
+    GeometryStats FrameGeometryStats {};
+    u64 FIFOStallStart = 0;
 
     u16 RenderXPos = 0;
 
@@ -326,7 +386,7 @@ public:
 
     u32 FlushRequest = 0;
     u32 FlushAttributes = 0;
-    u32 ScrolledLine[256]; // not part of the hardware state, don't serialize
+    u32 ScrolledLine[256 * MaxFramebufferScale]; // not part of the hardware state, don't serialize
 };
 
 class Renderer3D
@@ -351,6 +411,13 @@ public:
     virtual u32* GetLine(int line) = 0;
     virtual void Blit(const GPU& gpu) {};
 
+    // Non-accelerated renderers may render above the native resolution,
+    // in which case the 2D renderer composites their output at that resolution
+    // and the GPU framebuffers are enlarged by the same factor.
+    // GetLine() still returns native resolution lines (used by display capture).
+    virtual int GetFramebufferScale() const { return 1; }
+    virtual u32* GetScaledLine(int line) { return GetLine(line); }
+
     virtual void SetupAccelFrame() {}
     virtual void PrepareCaptureFrame() {}
     virtual void BindOutputTexture(int buffer) {}
@@ -358,8 +425,13 @@ public:
     virtual bool NeedsShaderCompile() { return false; }
     virtual void ShaderCompileStep(int& current, int& count) {}
 
+    [[nodiscard]] const RenderStats& GetStats() const noexcept { return Stats; }
+
 protected:
     Renderer3D(bool Accelerated);
+
+    // the last finished frame's statistics, only written from the emulation thread
+    RenderStats Stats {};
 };
 
 }
@@ -0,0 +1,310 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <string.h>
+#include "GPU3D_Capture.h"
+#include "GPU.h"
+#include "Platform.h"
+
+namespace melonDS
+{
+using Platform::Log;
+using Platform::LogLevel;
+
+GXCapture::GXCapture(std::string path, u32 numframes) noexcept :
+    Path(std::move(path)),
+    NumFrames(numframes ? numframes : 1),
+    FramesLeft(NumFrames)
+{
+}
+
+void GXCapture::Begin(GPU3D& gpu3d) noexcept
+{
+    Savestate state(4*1024*1024);
+    gpu3d.DoSavestate(&state);
+    state.Finish();
+
+    const u8* statedata = (const u8*)state.Buffer();
+    State.assign(statedata, statedata + state.Length());
+
+    Stream.clear();
+    FramesLeft = NumFrames;
+    LastTexture = nullptr;
+    LastTexPal = nullptr;
+
+    // the enable flags come from POWCNT1 and aren't part of the GPU3D state
+    RecordSetEnabled(gpu3d.GeometryEnabled, gpu3d.RenderingEnabled);
+}
+
+void GXCapture::AddRecord(u8 type, u32 addr, u32 val) noexcept
+{
+    GXCaptureRecord record {};
+    record.Type = type;
+    record.Addr = addr;
+    record.Value = val;
+
+    const u8* data = (const u8*)&record;
+    Stream.insert(Stream.end(), data, data + sizeof(record));
+}
+
+void GXCapture::RecordCommand(u8 command, u32 param) noexcept
+{
+    AddRecord(GXCaptureRecord::Command, command, param);
+}
+
+void GXCapture::RecordWrite(u8 type, u32 addr, u32 val) noexcept
+{
+    AddRecord(type, addr, val);
+}
+
+void GXCapture::RecordSetEnabled(bool geometry, bool rendering) noexcept
+{
+    AddRecord(GXCaptureRecord::SetEnabled, 0, (geometry ? 1 : 0) | (rendering ? 2 : 0));
+}
+
+void GXCapture::RecordVBlank() noexcept
+{
+    AddRecord(GXCaptureRecord::VBlank, 0, 0);
+}
+
+bool GXCapture::RecordRender(const GPU& gpu) noexcept
+{
+    auto texture = std::make_unique<u8[]>(GXCaptureTextureSize);
+    auto texpal = std::make_unique<u8[]>(GXCaptureTexPalSize);
+
+    for (u32 i = 0; i < GXCaptureTextureSize; i += 8)
+        *(u64*)&texture[i] = gpu.ReadVRAM_Texture<u64>(i);
+    for (u32 i = 0; i < GXCaptureTexPalSize; i += 8)
+        *(u64*)&texpal[i] = gpu.ReadVRAM_TexPal<u64>(i);
+
+    // only store the VRAM contents when they changed since the last render point
+    u32 flags = 0;
+    if (!LastTexture || memcmp(LastTexture.get(), texture.get(), GXCaptureTextureSize))
+        flags |= (1<<0);
+    if (!LastTexPal || memcmp(LastTexPal.get(), texpal.get(), GXCaptureTexPalSize))
+        flags |= (1<<1);
+
+    AddRecord(GXCaptureRecord::Render, 0, flags);
+
+    if (flags & (1<<0))
+    {
+        Stream.insert(Stream.end(), &texture[0], &texture[GXCaptureTextureSize]);
+        LastTexture = std::move(texture);
+    }
+    if (flags & (1<<1))
+    {
+        Stream.insert(Stream.end(), &texpal[0], &texpal[GXCaptureTexPalSize]);
+        LastTexPal = std::move(texpal);
+    }
+
+    FramesLeft--;
+    return FramesLeft == 0;
+}
+
+bool GXCapture::Save() const noexcept
+{
+    Platform::FileHandle* file = Platform::OpenFile(Path, Platform::FileMode::Write);
+    if (!file)
+    {
+        Log(LogLevel::Error, "GX capture: failed to open %s for writing\n", Path.c_str());
+        return false;
+    }
+
+    GXCaptureHeader header {};
+    memcpy(header.Magic, "GXCP", 4);
+    header.Version = GXCaptureVersion;
+    header.NumFrames = NumFrames - FramesLeft;
+    header.StateLength = State.size();
+
+    bool ok = Platform::FileWrite(&header, sizeof(header), 1, file) == 1
+        && Platform::FileWrite(State.data(), State.size(), 1, file) == 1
+        && (Stream.empty() || Platform::FileWrite(Stream.data(), Stream.size(), 1, file) == 1);
+
+    Platform::CloseFile(file);
+
+    if (!ok)
+        Log(LogLevel::Error, "GX capture: failed to write %s\n", Path.c_str());
+    else
+        Log(LogLevel::Info, "GX capture: saved %d frames to %s\n", header.NumFrames, Path.c_str());
+
+    return ok;
+}
+
+
+bool GXReplay::Load(const std::string& path) noexcept
+{
+    Platform::FileHandle* file = Platform::OpenFile(path, Platform::FileMode::Read);
+    if (!file)
+    {
+        Log(LogLevel::Error, "GX replay: failed to open %s\n", path.c_str());
+        return false;
+    }
+
+    u64 len = Platform::FileLength(file);
+    GXCaptureHeader header {};
+    bool ok = len >= sizeof(header) && Platform::FileRead(&header, sizeof(header), 1, file) == 1;
+
+    if (ok && (memcmp(header.Magic, "GXCP", 4) || header.Version != GXCaptureVersion))
+    {
+        Log(LogLevel::Error, "GX replay: %s is not a supported GX capture\n", path.c_str());
+        Platform::CloseFile(file);
+        return false;
+    }
+
+    ok = ok && header.StateLength <= len - sizeof(header);
+    if (ok)
+    {
+        State.resize(header.StateLength);
+        Stream.resize(len - sizeof(header) - header.StateLength);
+
+        ok = Platform::FileRead(State.data(), State.size(), 1, file) == 1
+            && (Stream.empty() || Platform::FileRead(Stream.data(), Stream.size(), 1, file) == 1);
+    }
+
+    Platform::CloseFile(file);
+
+    if (!ok)
+    {
+        Log(LogLevel::Error, "GX replay: %s is truncated\n", path.c_str());
+        return false;
+    }
+
+    NumFrames = header.NumFrames;
+    StreamPos = 0;
+    return true;
+}
+
+bool GXReplay::Restore(GPU& gpu) noexcept
+{
+    Savestate state(State.data(), State.size(), false);
+    if (state.Error)
+        return false;
+
+    gpu.GPU3D.DoSavestate(&state);
+    if (state.Error)
+        return false;
+
+    gpu.GPU3D.RenderFrameIdentical = false;
+
+    // map banks A-D to texture slots 0-3 and banks E-G to texture palette slots 0-5,
+    // so that the snapshots can be copied to them linearly
+    gpu.MapVRAM_AB(0, 0x83);
+    gpu.MapVRAM_AB(1, 0x8B);
+    gpu.MapVRAM_CD(2, 0x93);
+    gpu.MapVRAM_CD(3, 0x9B);
+    gpu.MapVRAM_E(4, 0x83);
+    gpu.MapVRAM_FG(5, 0x93);
+    gpu.MapVRAM_FG(6, 0x9B);
+
+    StreamPos = 0;
+    return true;
+}
+
+void GXReplay::RunCommands(GPU3D& gpu3d) noexcept
+{
+    // run the geometry engine until it runs out of commands or waits for VBlank.
+    // there is no CPU side to this, timings don't matter.
+    while (!gpu3d.FlushRequest && !gpu3d.CmdPIPE.IsEmpty())
+        gpu3d.ExecuteCommand();
+}
+
+bool GXReplay::AdvanceToRender(GPU& gpu) noexcept
+{
+    GPU3D& gpu3d = gpu.GPU3D;
+
+    while (StreamPos + sizeof(GXCaptureRecord) <= Stream.size())
+    {
+        GXCaptureRecord record;
+        memcpy(&record, &Stream[StreamPos], sizeof(record));
+        StreamPos += sizeof(record);
+
+        switch (record.Type)
+        {
+        case GXCaptureRecord::Command:
+            {
+                GPU3D::CmdFIFOEntry entry;
+                entry.Command = record.Addr;
+                entry.Param = record.Value;
+                gpu3d.CmdFIFOWrite(entry);
+                RunCommands(gpu3d);
+            }
+            break;
+
+        case GXCaptureRecord::Write8:
+            gpu3d.Write8(record.Addr, record.Value);
+            break;
+        case GXCaptureRecord::Write16:
+            gpu3d.Write16(record.Addr, record.Value);
+            break;
+        case GXCaptureRecord::Write32:
+            gpu3d.Write32(record.Addr, record.Value);
+            break;
+
+        case GXCaptureRecord::SetEnabled:
+            gpu3d.SetEnabled(record.Value & 1, record.Value & 2);
+            break;
+
+        case GXCaptureRecord::VBlank:
+            gpu3d.VBlank();
+            RunCommands(gpu3d);
+            break;
+
+        case GXCaptureRecord::Render:
+            {
+                u32 needed = ((record.Value & 1) ? GXCaptureTextureSize : 0)
+                    + ((record.Value & 2) ? GXCaptureTexPalSize : 0);
+                if (StreamPos + needed > Stream.size())
+                {
+                    Log(LogLevel::Error, "GX replay: truncated VRAM snapshot\n");
+                    StreamPos = Stream.size();
+                    return false;
+                }
+
+                if (record.Value & 1)
+                {
+                    for (int bank = 0; bank < 4; bank++)
+                    {
+                        memcpy(gpu.VRAM[bank], &Stream[StreamPos], 128*1024);
+                        gpu.VRAMDirty[bank].SetRange(0, 128*1024 / VRAMDirtyGranularity);
+                        StreamPos += 128*1024;
+                    }
+                }
+                if (record.Value & 2)
+                {
+                    memcpy(gpu.VRAM_E, &Stream[StreamPos], 64*1024);
+                    memcpy(gpu.VRAM_F, &Stream[StreamPos + 64*1024], 16*1024);
+                    memcpy(gpu.VRAM_G, &Stream[StreamPos + 80*1024], 16*1024);
+                    gpu.VRAMDirty[4].SetRange(0, 64*1024 / VRAMDirtyGranularity);
+                    gpu.VRAMDirty[5].SetRange(0, 16*1024 / VRAMDirtyGranularity);
+                    gpu.VRAMDirty[6].SetRange(0, 16*1024 / VRAMDirtyGranularity);
+                    StreamPos += GXCaptureTexPalSize;
+                }
+            }
+            return true;
+
+        default:
+            Log(LogLevel::Error, "GX replay: bad record type %d\n", record.Type);
+            StreamPos = Stream.size();
+            return false;
+        }
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,133 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef GPU3D_CAPTURE_H
+#define GPU3D_CAPTURE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace melonDS
+{
+class GPU;
+class GPU3D;
+
+// GX capture files record everything the 3D engine is fed over a few frames,
+// so that the geometry engine and renderers can be run on their own.
+//
+// A capture starts with a snapshot of the GPU3D state, followed by a stream
+// of records: GX commands (as they enter the command FIFO), writes to the 3D
+// registers, VBlanks and render points. Each render point may be followed by
+// the texture and texture palette VRAM contents the renderer saw, if they
+// changed since the previous one.
+
+struct GXCaptureHeader
+{
+    char Magic[4]; // GXCP
+    u32 Version;
+    u32 NumFrames;
+    u32 StateLength; // followed by that many bytes of GPU3D savestate
+};
+
+struct GXCaptureRecord
+{
+    enum : u8
+    {
+        Command = 0, // Addr = command, Value = parameter
+        Write8,
+        Write16,
+        Write32,
+        SetEnabled, // Value: bit0 = geometry, bit1 = rendering
+        VBlank,
+        Render, // Value: bit0 = texture snapshot follows, bit1 = palette snapshot follows
+    };
+
+    u8 Type;
+    u8 Reserved[3];
+    u32 Addr;
+    u32 Value;
+};
+
+constexpr u32 GXCaptureVersion = 1;
+constexpr u32 GXCaptureTextureSize = 512*1024;
+constexpr u32 GXCaptureTexPalSize = 128*1024;
+
+class GXCapture
+{
+public:
+    GXCapture(std::string path, u32 numframes) noexcept;
+
+    // called by GPU3D
+    void Begin(GPU3D& gpu3d) noexcept;
+    void RecordCommand(u8 command, u32 param) noexcept;
+    void RecordWrite(u8 type, u32 addr, u32 val) noexcept;
+    void RecordSetEnabled(bool geometry, bool rendering) noexcept;
+    void RecordVBlank() noexcept;
+    bool RecordRender(const GPU& gpu) noexcept; // returns true once all frames are recorded
+
+    bool Save() const noexcept;
+
+    [[nodiscard]] const std::string& GetPath() const noexcept { return Path; }
+
+private:
+    void AddRecord(u8 type, u32 addr, u32 val) noexcept;
+
+    std::string Path;
+    u32 NumFrames;
+    u32 FramesLeft;
+
+    std::vector<u8> State;
+    std::vector<u8> Stream;
+
+    std::unique_ptr<u8[]> LastTexture;
+    std::unique_ptr<u8[]> LastTexPal;
+};
+
+// Feeds a GX capture back into a GPU3D.
+// The texture VRAM banks (A-D) and texture palette banks (E-G) are remapped
+// to hold the captured VRAM contents, the rest of the emulator isn't touched.
+class GXReplay
+{
+public:
+    bool Load(const std::string& path) noexcept;
+
+    [[nodiscard]] u32 GetNumFrames() const noexcept { return NumFrames; }
+
+    // restores the captured GPU3D state, rewinding the command stream
+    bool Restore(GPU& gpu) noexcept;
+
+    // runs the command stream up to the next render point,
+    // leaving the GPU ready for GPU3D::VCount215().
+    // returns false when the end of the capture is reached.
+    bool AdvanceToRender(GPU& gpu) noexcept;
+
+private:
+    void RunCommands(GPU3D& gpu3d) noexcept;
+
+    u32 NumFrames = 0;
+    std::vector<u8> State;
+    std::vector<u8> Stream;
+    u32 StreamPos = 0;
+};
+
+}
+
+#endif // GPU3D_CAPTURE_H
@@ -597,6 +597,10 @@ void ComputeRenderer::RenderFrame(GPU& gpu)
         return;
     }
 
+    // rasterization happens on the GPU, only the polygon counts are known here
+    Stats = {};
+    Stats.PolygonsRendered = gpu.GPU3D.RenderNumPolygons;
+
     int numYSpans = 0;
     int numSetupIndices = 0;
 
@@ -620,6 +624,8 @@ void ComputeRenderer::RenderFrame(GPU& gpu)
     for (int i = 0; i < gpu.GPU3D.RenderNumPolygons; i++)
     {
         Polygon* polygon = gpu.GPU3D.RenderPolygonRAM[i];
+        if (polygon->IsShadowMask || polygon->IsShadow)
+            Stats.ShadowPolygons++;
 
         u32 nverts = polygon->NumVertices;
         u32 vtop = polygon->VTop, vbot = polygon->VBottom;
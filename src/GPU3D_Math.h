@@ -0,0 +1,176 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef GPU3D_MATH_H
+#define GPU3D_MATH_H
+
+#include "types.h"
+#include "SIMD.h"
+
+// Fixed-point kernels used by the geometry engine.
+// Each one has a scalar version, which is what the vectorised ones have to match
+// bit for bit. The scalar versions are also used directly on other targets.
+
+namespace melonDS
+{
+
+// multiplies a row vector of N 20.12 fixed-point values by the first N rows
+// of a 4x4 matrix, with 64-bit intermediates
+// out may alias v or m, the results are stored only once everything is computed
+template<int N>
+inline void MatrixRowMultScalar(s32* out, const s32* v, const s32* m)
+{
+    s64 res[4] = {0, 0, 0, 0};
+    for (int k = 0; k < N; k++)
+    {
+        res[0] += (s64)v[k]*m[k*4+0];
+        res[1] += (s64)v[k]*m[k*4+1];
+        res[2] += (s64)v[k]*m[k*4+2];
+        res[3] += (s64)v[k]*m[k*4+3];
+    }
+
+    out[0] = res[0] >> 12;
+    out[1] = res[1] >> 12;
+    out[2] = res[2] >> 12;
+    out[3] = res[3] >> 12;
+}
+
+// multiplies a normal by the 3x3 part of a matrix
+// unlike the other transforms, this one uses 32-bit intermediates
+// out needs room for 4 values, the last one being meaningless
+inline void NormalTransformScalar(s32* out, const s16* normal, const s32* m)
+{
+    out[0] = normal[0]*m[0] + normal[1]*m[4] + normal[2]*m[8];
+    out[1] = normal[0]*m[1] + normal[1]*m[5] + normal[2]*m[9];
+    out[2] = normal[0]*m[2] + normal[1]*m[6] + normal[2]*m[10];
+    out[3] = 0;
+}
+
+#if defined(MELONDS_SIMD_SSE2)
+// low 32 bits of a 32x32 multiply, on all four lanes
+inline __m128i MulLo32(__m128i a, __m128i b)
+{
+#if defined(MELONDS_SIMD_SSE41)
+    return _mm_mullo_epi32(a, b);
+#else
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+#endif
+
+// SSE2 only has an unsigned 32x32->64 multiply, correcting its results for signed
+// inputs ends up slower than the scalar code, so it's only vectorised from SSE4.1 on
+template<int N>
+inline void MatrixRowMult(s32* out, const s32* v, const s32* m)
+{
+#if defined(MELONDS_SIMD_NEON)
+    int64x2_t lo = vdupq_n_s64(0);
+    int64x2_t hi = vdupq_n_s64(0);
+    for (int k = 0; k < N; k++)
+    {
+        int32x4_t row = vld1q_s32(&m[k*4]);
+        int32x2_t vk = vdup_n_s32(v[k]);
+        lo = vmlal_s32(lo, vget_low_s32(row), vk);
+        hi = vmlal_s32(hi, vget_high_s32(row), vk);
+    }
+
+    // narrowing keeps the low 32 bits of the shifted values
+    vst1q_s32(out, vcombine_s32(vshrn_n_s64(lo, 12), vshrn_n_s64(hi, 12)));
+#elif defined(MELONDS_SIMD_SSE41)
+    __m128i even = _mm_setzero_si128();
+    __m128i odd = _mm_setzero_si128();
+    for (int k = 0; k < N; k++)
+    {
+        __m128i row = _mm_loadu_si128((const __m128i*)&m[k*4]);
+        __m128i vk = _mm_set1_epi32(v[k]);
+        even = _mm_add_epi64(even, _mm_mul_epi32(row, vk));
+        odd = _mm_add_epi64(odd, _mm_mul_epi32(_mm_srli_epi64(row, 32), vk));
+    }
+
+    // only the low 32 bits of the shifted values are kept
+    // so a logical shift is fine here
+    even = _mm_srli_epi64(even, 12);
+    odd = _mm_slli_epi64(_mm_srli_epi64(odd, 12), 32);
+    _mm_storeu_si128((__m128i*)out, _mm_blend_epi16(even, odd, 0xCC));
+#else
+    MatrixRowMultScalar<N>(out, v, m);
+#endif
+}
+
+inline void NormalTransform(s32* out, const s16* normal, const s32* m)
+{
+#if defined(MELONDS_SIMD_NEON)
+    int32x4_t res = vmulq_n_s32(vld1q_s32(&m[0]), normal[0]);
+    res = vmlaq_n_s32(res, vld1q_s32(&m[4]), normal[1]);
+    res = vmlaq_n_s32(res, vld1q_s32(&m[8]), normal[2]);
+    vst1q_s32(out, res);
+#elif defined(MELONDS_SIMD_SSE2)
+    __m128i res = MulLo32(_mm_loadu_si128((const __m128i*)&m[0]), _mm_set1_epi32(normal[0]));
+    res = _mm_add_epi32(res, MulLo32(_mm_loadu_si128((const __m128i*)&m[4]), _mm_set1_epi32(normal[1])));
+    res = _mm_add_epi32(res, MulLo32(_mm_loadu_si128((const __m128i*)&m[8]), _mm_set1_epi32(normal[2])));
+    _mm_storeu_si128((__m128i*)out, res);
+#else
+    NormalTransformScalar(out, normal, m);
+#endif
+}
+
+// tells on which sides of the view volume a clip-space position is, as tested by ClipAgainstPlane
+// bit0-2: X/Y/Z greater than W
+// bit4-6: X/Y/Z less than -W
+inline u32 ClipOutcodeScalar(const s32* position)
+{
+    u32 ret = 0;
+    for (int comp = 0; comp < 3; comp++)
+    {
+        if (position[comp] > position[3]) ret |= (1 << comp);
+        if (position[comp] < -position[3]) ret |= (0x10 << comp);
+    }
+    return ret;
+}
+
+inline u32 ClipOutcode(const s32* position)
+{
+#if defined(MELONDS_SIMD_SSE2)
+    __m128i pos = _mm_loadu_si128((const __m128i*)position);
+    __m128i w = _mm_shuffle_epi32(pos, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i negw = _mm_sub_epi32(_mm_setzero_si128(), w);
+
+    u32 above = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(pos, w)));
+    u32 below = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(pos, negw)));
+    return (above | (below << 4)) & 0x77;
+#elif defined(MELONDS_SIMD_NEON)
+    int32x4_t pos = vld1q_s32(position);
+    int32x4_t w = vdupq_laneq_s32(pos, 3);
+
+    // the compare results are all ones or all zeroes,
+    // keep one distinct bit per lane and add them up into a mask
+    const uint32x4_t bits = {1, 2, 4, 8};
+    u32 above = vaddvq_u32(vandq_u32(vcgtq_s32(pos, w), bits));
+    u32 below = vaddvq_u32(vandq_u32(vcltq_s32(pos, vnegq_s32(w)), bits));
+    return (above | (below << 4)) & 0x77;
+#else
+    return ClipOutcodeScalar(position);
+#endif
+}
+
+}
+
+#endif // GPU3D_MATH_H
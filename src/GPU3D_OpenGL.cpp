@@ -1117,6 +1117,9 @@ void GLRenderer::RenderFrame(GPU& gpu)
 {
     CurShaderID = -1;
 
+    // rasterization happens on the GPU, only the polygon counts are known here
+    Stats = {};
+
     glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, MainFramebuffer);
 
@@ -1267,11 +1270,14 @@ void GLRenderer::RenderFrame(GPU& gpu)
             SetupPolygon(&PolygonList[npolys], gpu.GPU3D.RenderPolygonRAM[i]);
             if (firsttrans < 0 && gpu.GPU3D.RenderPolygonRAM[i]->Translucent)
                 firsttrans = npolys;
+            if (gpu.GPU3D.RenderPolygonRAM[i]->IsShadowMask || gpu.GPU3D.RenderPolygonRAM[i]->IsShadow)
+                Stats.ShadowPolygons++;
 
             npolys++;
         }
         NumFinalPolys = npolys;
         NumOpaqueFinalPolys = firsttrans;
+        Stats.PolygonsRendered = npolys;
 
         BuildPolygons(&PolygonList[0], npolys);
         glBindBuffer(GL_ARRAY_BUFFER, VertexBufferID);
@@ -19,10 +19,12 @@
 #include "GPU3D_Soft.h"
 
 #include <algorithm>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "NDS.h"
 #include "GPU.h"
+#include "SIMD.h"
 
 namespace melonDS
 {
@@ -96,7 +98,7 @@ void SoftRenderer::EnableRenderThread()
 }
 
 SoftRenderer::SoftRenderer() noexcept
-    : Renderer3D(false)
+    : Renderer3D(false), Texcache(TexcacheSoftLoader())
 {
     Sema_RenderStart = Platform::Semaphore_Create();
     Sema_RenderDone = Platform::Semaphore_Create();
@@ -105,12 +107,16 @@ SoftRenderer::SoftRenderer() noexcept
     RenderThreadRunning = false;
     RenderThreadRendering = false;
     RenderThread = nullptr;
+
+    SetupBuffers();
 }
 
 SoftRenderer::~SoftRenderer()
 {
     StopRenderThread();
 
+    Texcache.Reset();
+
     Platform::Semaphore_Free(Sema_RenderStart);
     Platform::Semaphore_Free(Sema_RenderDone);
     Platform::Semaphore_Free(Sema_ScanlineCount);
@@ -118,13 +124,14 @@ SoftRenderer::~SoftRenderer()
 
 void SoftRenderer::Reset(GPU& gpu)
 {
-    memset(ColorBuffer, 0, BufferSize * 2 * 4);
-    memset(DepthBuffer, 0, BufferSize * 2 * 4);
-    memset(AttrBuffer, 0, BufferSize * 2 * 4);
+    memset(ColorBuffer.get(), 0, BufferSize * 2 * 4);
+    memset(DepthBuffer.get(), 0, BufferSize * 2 * 4);
+    memset(AttrBuffer.get(), 0, BufferSize * 2 * 4);
 
     PrevIsShadowMask = false;
 
     SetupRenderThread(gpu);
+    Texcache.Reset();
     EnableRenderThread();
 }
 
@@ -138,16 +145,45 @@ void SoftRenderer::SetThreaded(bool threaded, GPU& gpu) noexcept
     }
 }
 
-void SoftRenderer::TextureLookup(const GPU& gpu, u32 texparam, u32 texpal, s16 s, s16 t, u16* color, u8* alpha) const
+void SoftRenderer::SetRenderSettings(int scale, bool highResolutionCoordinates, GPU& gpu) noexcept
 {
-    u32 vramaddr = (texparam & 0xFFFF) << 3;
+    scale = std::clamp(scale, 1, GPU3D::MaxFramebufferScale);
+    if (scale == ScaleFactor && highResolutionCoordinates == HiresCoordinates)
+        return;
 
-    s32 width = 8 << ((texparam >> 20) & 0x7);
-    s32 height = 8 << ((texparam >> 23) & 0x7);
+    // make sure the render thread is done with the buffers before they're replaced
+    SetupRenderThread(gpu);
 
-    s >>= 4;
-    t >>= 4;
+    HiresCoordinates = highResolutionCoordinates;
+    if (scale != ScaleFactor)
+    {
+        ScaleFactor = scale;
+        SetupBuffers();
 
+        // the 2D renderer writes its output at the new resolution
+        gpu.InitFramebuffers();
+    }
+
+    EnableRenderThread();
+}
+
+void SoftRenderer::SetupBuffers()
+{
+    ScreenWidth = 256 * ScaleFactor;
+    ScreenHeight = 192 * ScaleFactor;
+
+    ScanlineWidth = ScreenWidth + 2;
+    NumScanlines = ScreenHeight + 2;
+    BufferSize = ScanlineWidth * NumScanlines;
+    FirstPixelOffset = ScanlineWidth + 1;
+
+    ColorBuffer = std::make_unique<u32[]>(BufferSize * 2);
+    DepthBuffer = std::make_unique<u32[]>(BufferSize * 2);
+    AttrBuffer = std::make_unique<u32[]>(BufferSize * 2);
+}
+
+void WrapTexCoords(u32 texparam, s32 width, s32 height, s16& s, s16& t)
+{
     // texture wrapping
     // TODO: optimize this somehow
     // testing shows that it's hardly worth optimizing, actually
@@ -183,6 +219,49 @@ void SoftRenderer::TextureLookup(const GPU& gpu, u32 texparam, u32 texpal, s16 s
         if (t < 0) t = 0;
         else if (t >= height) t = height-1;
     }
+}
+
+// the texture cache decodes textures linearly, without the address wraparound
+// and the slot 1 quirks of compressed textures that apply to per-texel accesses.
+// textures that could run into those are always decoded on the fly.
+bool CanCacheTexture(u32 texparam, u32 texpal)
+{
+    u32 vramaddr = (texparam & 0xFFFF) << 3;
+    u32 npixels = TextureWidth(texparam) * TextureHeight(texparam);
+    texpal <<= 4;
+
+    switch ((texparam >> 26) & 0x7)
+    {
+    case 1: return (vramaddr + npixels <= 0x80000) && (texpal + 32*2 <= 0x20000);
+    case 2: return (vramaddr + (npixels >> 2) <= 0x80000);
+    case 3: return (vramaddr + (npixels >> 1) <= 0x80000) && (texpal + 16*2 <= 0x20000);
+    case 4: return (vramaddr + npixels <= 0x80000) && (texpal + 256*2 <= 0x20000);
+    case 5:
+        {
+            // texel data has to fit entirely within one slot, other than slot 1
+            u32 end = vramaddr + (npixels >> 2);
+            if ((vramaddr ^ (end - 1)) & ~0x1FFFF) return false;
+            if ((vramaddr & 0x60000) == 0x20000) return false;
+            return (texpal + 0x10000 <= 0x20000);
+        }
+    case 6: return (vramaddr + npixels <= 0x80000) && (texpal + 8*2 <= 0x20000);
+    case 7: return (vramaddr + (npixels << 1) <= 0x80000);
+    }
+
+    return false;
+}
+
+void SoftRenderer::TextureLookup(const GPU& gpu, u32 texparam, u32 texpal, s16 s, s16 t, u16* color, u8* alpha) const
+{
+    u32 vramaddr = (texparam & 0xFFFF) << 3;
+
+    s32 width = 8 << ((texparam >> 20) & 0x7);
+    s32 height = 8 << ((texparam >> 23) & 0x7);
+
+    s >>= 4;
+    t >>= 4;
+
+    WrapTexCoords(texparam, width, height, s, t);
 
     u8 alpha0;
     if (texparam & (1<<29)) alpha0 = 0;
@@ -371,6 +450,19 @@ void SoftRenderer::TextureLookup(const GPU& gpu, u32 texparam, u32 texpal, s16 s
     }
 }
 
+u32 SoftRenderer::CachedTextureLookup(const u32* texdata, u32 texparam, s16 s, s16 t) const
+{
+    s32 width = 8 << ((texparam >> 20) & 0x7);
+    s32 height = 8 << ((texparam >> 23) & 0x7);
+
+    s >>= 4;
+    t >>= 4;
+
+    WrapTexCoords(texparam, width, height, s, t);
+
+    return texdata[(t * width) + s];
+}
+
 // depth test is 'less or equal' instead of 'less than' under the following conditions:
 // * when drawing a front-facing pixel over an opaque back-facing pixel
 // * when drawing wireframe edges, under certain conditions (TODO)
@@ -421,6 +513,320 @@ bool DepthTest_LessThan_FrontFacing(s32 dstz, s32 z, u32 dstattr)
     return false;
 }
 
+enum
+{
+    depthTest_LessThan,
+    depthTest_LessThan_FrontFacing,
+    depthTest_Equal_Z,
+    depthTest_Equal_W,
+};
+
+bool (*const DepthTestFuncs[4])(s32 dstz, s32 z, u32 dstattr) =
+{
+    DepthTest_LessThan,
+    DepthTest_LessThan_FrontFacing,
+    DepthTest_Equal_Z,
+    DepthTest_Equal_W,
+};
+
+int SelectDepthTest(const Polygon* polygon)
+{
+    if (polygon->Attr & (1<<14))
+        return polygon->WBuffer ? depthTest_Equal_W : depthTest_Equal_Z;
+    else if (polygon->FacingView)
+        return depthTest_LessThan_FrontFacing;
+    else
+        return depthTest_LessThan;
+}
+
+// span kernels
+// the per-pixel X interpolation requires a 64-bit division, which is the most
+// expensive part of rasterizing a pixel. the vectorized versions perform it
+// in double precision: all the operands stay well below 2^53, so the truncated
+// quotient always matches the integer division.
+// the Z values are derived in the same way, all intermediate products being exact.
+
+template<int dir>
+void SoftRenderer::Interpolator<dir>::InterpolateSpan(s32 xstart, s32 xend, s32 z0, s32 z1, bool wbuffer, u32* factors, s32* zs) const
+{
+    static_assert(dir == 0, "spans are only interpolated along X");
+
+    if (xdiff == 0 || linear)
+    {
+        // no division involved here, or linear mode where the factor isn't updated
+        Interpolator<dir> interp = *this;
+        for (s32 x = xstart; x < xend; x++)
+        {
+            interp.SetX(x);
+            factors[x] = interp.yfactor;
+            zs[x] = interp.InterpolateZ(z0, z1, wbuffer);
+        }
+        return;
+    }
+
+    // parameters for the Z interpolation
+    // Z = base + ((factor * zmul) >> zshift), factor being either the
+    // perspective factor or the pixel position depending on the mode
+    s32 zbase;
+    s64 zmul;
+    s32 zshift;
+    bool zinvert = z0 > z1;
+    if (wbuffer)
+    {
+        zbase = zinvert ? z1 : z0;
+        zmul = zinvert ? (z0 - z1) : (z1 - z0);
+        zshift = shift;
+    }
+    else
+    {
+        zbase = zinvert ? z1 : z0;
+        zmul = (s64)((zinvert ? (z0 - z1) : (z1 - z0)) >> 9) * xrecip_z;
+        zshift = 13;
+    }
+
+    s32 x = xstart;
+
+#if defined(MELONDS_SIMD_SSE2) || defined(MELONDS_SIMD_NEON)
+    const double numscale = (double)w0n * (1 << shift);
+    const double zscale = (double)zmul / (double)(1 << zshift);
+
+#if defined(MELONDS_SIMD_SSE2)
+    const __m128d vnumscale = _mm_set1_pd(numscale);
+    const __m128d vw0d = _mm_set1_pd(w0d);
+    const __m128d vw1d = _mm_set1_pd(w1d);
+    const __m128d vxdiff = _mm_set1_pd(xdiff);
+    const __m128d vzscale = _mm_set1_pd(zscale);
+    const __m128d vone = _mm_set1_pd(1 << shift);
+    const __m128d vzero = _mm_setzero_pd();
+    const __m128i vzbase = _mm_set1_epi32(zbase);
+
+    auto kernel = [&](__m128d vx, __m128i& factor, __m128i& z)
+    {
+        __m128d num = _mm_mul_pd(vx, vnumscale);
+        __m128d den = _mm_add_pd(_mm_mul_pd(vx, vw0d), _mm_mul_pd(_mm_sub_pd(vxdiff, vx), vw1d));
+        __m128d quo = _mm_andnot_pd(_mm_cmpeq_pd(den, vzero), _mm_div_pd(num, den));
+        quo = _mm_cvtepi32_pd(_mm_cvttpd_epi32(quo));
+        factor = _mm_cvttpd_epi32(quo);
+
+        __m128d zfactor;
+        if (wbuffer) zfactor = zinvert ? _mm_sub_pd(vone, quo) : quo;
+        else         zfactor = zinvert ? _mm_sub_pd(vxdiff, vx) : vx;
+        z = _mm_cvttpd_epi32(_mm_mul_pd(zfactor, vzscale));
+    };
+
+    for (; x + 4 <= xend; x += 4)
+    {
+        s32 xr = x - x0;
+        __m128i flo, fhi, zlo, zhi;
+        kernel(_mm_set_pd(xr+1, xr), flo, zlo);
+        kernel(_mm_set_pd(xr+3, xr+2), fhi, zhi);
+
+        _mm_storeu_si128((__m128i*)&factors[x], _mm_unpacklo_epi64(flo, fhi));
+        _mm_storeu_si128((__m128i*)&zs[x], _mm_add_epi32(_mm_unpacklo_epi64(zlo, zhi), vzbase));
+    }
+#else
+    const float64x2_t vnumscale = vdupq_n_f64(numscale);
+    const float64x2_t vw0d = vdupq_n_f64(w0d);
+    const float64x2_t vw1d = vdupq_n_f64(w1d);
+    const float64x2_t vxdiff = vdupq_n_f64(xdiff);
+    const float64x2_t vzscale = vdupq_n_f64(zscale);
+    const float64x2_t vone = vdupq_n_f64(1 << shift);
+    const float64x2_t vzero = vdupq_n_f64(0);
+    const int32x4_t vzbase = vdupq_n_s32(zbase);
+
+    auto kernel = [&](float64x2_t vx, int32x2_t& factor, int32x2_t& z)
+    {
+        float64x2_t num = vmulq_f64(vx, vnumscale);
+        float64x2_t den = vaddq_f64(vmulq_f64(vx, vw0d), vmulq_f64(vsubq_f64(vxdiff, vx), vw1d));
+        float64x2_t quo = vbslq_f64(vceqq_f64(den, vzero), vzero, vdivq_f64(num, den));
+        quo = vrndq_f64(quo);
+        factor = vmovn_s64(vcvtq_s64_f64(quo));
+
+        float64x2_t zfactor;
+        if (wbuffer) zfactor = zinvert ? vsubq_f64(vone, quo) : quo;
+        else         zfactor = zinvert ? vsubq_f64(vxdiff, vx) : vx;
+        z = vmovn_s64(vcvtq_s64_f64(vmulq_f64(zfactor, vzscale)));
+    };
+
+    for (; x + 4 <= xend; x += 4)
+    {
+        s32 xr = x - x0;
+        const double xlo[2] = {(double)xr, (double)(xr+1)};
+        const double xhi[2] = {(double)(xr+2), (double)(xr+3)};
+        int32x2_t flo, fhi, zlo, zhi;
+        kernel(vld1q_f64(xlo), flo, zlo);
+        kernel(vld1q_f64(xhi), fhi, zhi);
+
+        vst1q_u32(&factors[x], vreinterpretq_u32_s32(vcombine_s32(flo, fhi)));
+        vst1q_s32(&zs[x], vaddq_s32(vcombine_s32(zlo, zhi), vzbase));
+    }
+#endif
+#endif
+
+    for (; x < xend; x++)
+    {
+        s32 xr = x - x0;
+
+        s64 num = ((s64)xr * w0n) << shift;
+        s32 den = (xr * w0d) + ((xdiff-xr) * w1d);
+        u32 factor = (den == 0) ? 0 : (s32)(num / den);
+
+        s64 zfactor;
+        if (wbuffer) zfactor = zinvert ? ((1<<shift) - factor) : factor;
+        else         zfactor = zinvert ? (xdiff - xr) : xr;
+
+        factors[x] = factor;
+        zs[x] = zbase + ((zfactor * zmul) >> zshift);
+    }
+}
+
+void SoftRenderer::DepthTestSpan(int depthtest, s32 y, s32 xstart, s32 xend)
+{
+    u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth);
+    s32 x = xstart;
+
+#if defined(MELONDS_SIMD_SSE2)
+    for (; x + 4 <= xend; x += 4)
+    {
+        __m128i z = _mm_loadu_si128((__m128i*)&SpanZ[x]);
+        __m128i dstz = _mm_loadu_si128((__m128i*)&DepthBuffer[pixeladdr + x]);
+        __m128i pass;
+
+        switch (depthtest)
+        {
+        case depthTest_LessThan:
+            pass = _mm_cmplt_epi32(z, dstz);
+            break;
+
+        case depthTest_LessThan_FrontFacing:
+            {
+                __m128i dstattr = _mm_loadu_si128((__m128i*)&AttrBuffer[pixeladdr + x]);
+                __m128i backfacing = _mm_cmpeq_epi32(_mm_and_si128(dstattr, _mm_set1_epi32(0x00400010)), _mm_set1_epi32(0x00000010));
+                pass = _mm_or_si128(_mm_cmplt_epi32(z, dstz), _mm_and_si128(backfacing, _mm_cmpeq_epi32(z, dstz)));
+            }
+            break;
+
+        case depthTest_Equal_Z:
+        case depthTest_Equal_W:
+            {
+                // unsigned comparison, done by flipping the sign bits
+                s32 range = (depthtest == depthTest_Equal_Z) ? 0x200 : 0xFF;
+                __m128i diff = _mm_add_epi32(_mm_sub_epi32(dstz, z), _mm_set1_epi32(range + 0x80000000));
+                pass = _mm_cmpgt_epi32(diff, _mm_set1_epi32((range * 2) + 0x80000000));
+                pass = _mm_xor_si128(pass, _mm_set1_epi32(-1));
+            }
+            break;
+        }
+
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(pass));
+        SpanDepthPass[x+0] = mask & 0x1;
+        SpanDepthPass[x+1] = (mask >> 1) & 0x1;
+        SpanDepthPass[x+2] = (mask >> 2) & 0x1;
+        SpanDepthPass[x+3] = (mask >> 3) & 0x1;
+    }
+#elif defined(MELONDS_SIMD_NEON)
+    for (; x + 4 <= xend; x += 4)
+    {
+        int32x4_t z = vld1q_s32(&SpanZ[x]);
+        int32x4_t dstz = vreinterpretq_s32_u32(vld1q_u32(&DepthBuffer[pixeladdr + x]));
+        uint32x4_t pass;
+
+        switch (depthtest)
+        {
+        case depthTest_LessThan:
+            pass = vcltq_s32(z, dstz);
+            break;
+
+        case depthTest_LessThan_FrontFacing:
+            {
+                uint32x4_t dstattr = vld1q_u32(&AttrBuffer[pixeladdr + x]);
+                uint32x4_t backfacing = vceqq_u32(vandq_u32(dstattr, vdupq_n_u32(0x00400010)), vdupq_n_u32(0x00000010));
+                pass = vorrq_u32(vcltq_s32(z, dstz), vandq_u32(backfacing, vceqq_s32(z, dstz)));
+            }
+            break;
+
+        case depthTest_Equal_Z:
+        case depthTest_Equal_W:
+            {
+                u32 range = (depthtest == depthTest_Equal_Z) ? 0x200 : 0xFF;
+                uint32x4_t diff = vaddq_u32(vreinterpretq_u32_s32(vsubq_s32(dstz, z)), vdupq_n_u32(range));
+                pass = vcleq_u32(diff, vdupq_n_u32(range * 2));
+            }
+            break;
+        }
+
+        u32 lanes[4];
+        vst1q_u32(lanes, pass);
+        SpanDepthPass[x+0] = lanes[0] & 0x1;
+        SpanDepthPass[x+1] = lanes[1] & 0x1;
+        SpanDepthPass[x+2] = lanes[2] & 0x1;
+        SpanDepthPass[x+3] = lanes[3] & 0x1;
+    }
+#endif
+
+    auto fnDepthTest = DepthTestFuncs[depthtest];
+    for (; x < xend; x++)
+        SpanDepthPass[x] = fnDepthTest(DepthBuffer[pixeladdr + x], SpanZ[x], AttrBuffer[pixeladdr + x]);
+}
+
+// interpolates Z and depth tests pixels xstart to xend-1, skipping the tiles
+// whose farthest depth is at most zreject. returns false if they all are.
+bool SoftRenderer::CoarseDepthTestSpan(const Interpolator<0>& interpX, int depthtest, s32 y, s32 xstart, s32 xend, s32 zl, s32 zr, bool wbuffer, s32 zreject)
+{
+    bool visible = false;
+    s32 x = xstart;
+    while (x < xend)
+    {
+        // find a run of tiles that are either all hidden or all potentially visible
+        bool hidden = CoarseDepth[x >> CoarseTileShift] <= zreject;
+        s32 runend = x;
+        do
+        {
+            runend = std::min((runend | ((1 << CoarseTileShift) - 1)) + 1, xend);
+        }
+        while (runend < xend && (CoarseDepth[runend >> CoarseTileShift] <= zreject) == hidden);
+
+        if (hidden)
+        {
+            memset(&SpanDepthPass[x], 0, runend - x);
+        }
+        else
+        {
+            interpX.InterpolateSpan(x, runend, zl, zr, wbuffer, SpanFactor, SpanZ);
+            DepthTestSpan(depthtest, y, x, runend);
+            visible = true;
+        }
+
+        x = runend;
+    }
+
+    return visible;
+}
+
+void SoftRenderer::UpdateCoarseDepth(s32 y, s32 xstart, s32 xend)
+{
+    u32 rowaddr = FirstPixelOffset + (y*ScanlineWidth);
+    s32 tileend = (xend - 1) >> CoarseTileShift;
+
+    for (s32 tile = xstart >> CoarseTileShift; tile <= tileend; tile++)
+    {
+        u32 pixeladdr = rowaddr + (tile << CoarseTileShift);
+        s32 maxz = INT32_MIN;
+        u32 edges = 0;
+
+        for (int i = 0; i < (1 << CoarseTileShift); i++)
+        {
+            // front facing pixels also pass over opaque back facing ones with equal depth
+            u32 attr = AttrBuffer[pixeladdr + i];
+            s32 z = (s32)DepthBuffer[pixeladdr + i] + ((attr & 0x00400010) == 0x00000010);
+            maxz = std::max(maxz, z);
+            edges |= attr;
+        }
+
+        CoarseDepth[tile] = (edges & 0xF) ? INT32_MAX : maxz;
+    }
+}
+
 u32 SoftRenderer::AlphaBlend(const GPU3D& gpu3d, u32 srccolor, u32 dstcolor, u32 alpha) const noexcept
 {
     u32 dstalpha = dstcolor >> 24;
@@ -451,8 +857,9 @@ u32 SoftRenderer::AlphaBlend(const GPU3D& gpu3d, u32 srccolor, u32 dstcolor, u32
     return srcR | (srcG << 8) | (srcB << 16) | (dstalpha << 24);
 }
 
-u32 SoftRenderer::RenderPixel(const GPU& gpu, const Polygon* polygon, u8 vr, u8 vg, u8 vb, s16 s, s16 t) const
+u32 SoftRenderer::RenderPixel(const GPU& gpu, const RendererPolygon* rp, u8 vr, u8 vg, u8 vb, s16 s, s16 t) const
 {
+    const Polygon* polygon = rp->PolyData;
     u8 r, g, b, a;
 
     u32 blendmode = (polygon->Attr >> 4) & 0x3;
@@ -486,13 +893,27 @@ u32 SoftRenderer::RenderPixel(const GPU& gpu, const Polygon* polygon, u8 vr, u8
     if ((gpu.GPU3D.RenderDispCnt & (1<<0)) && (((polygon->TexParam >> 26) & 0x7) != 0))
     {
         u8 tr, tg, tb;
+        u8 talpha;
+
+        if (rp->TexData)
+        {
+            // cached textures are already converted to 6-bit color
+            u32 texel = CachedTextureLookup(rp->TexData, polygon->TexParam, s, t);
 
-        u16 tcolor; u8 talpha;
-        TextureLookup(gpu, polygon->TexParam, polygon->TexPalette, s, t, &tcolor, &talpha);
+            tr = texel & 0x3F;
+            tg = (texel >> 8) & 0x3F;
+            tb = (texel >> 16) & 0x3F;
+            talpha = texel >> 24;
+        }
+        else
+        {
+            u16 tcolor;
+            TextureLookup(gpu, polygon->TexParam, polygon->TexPalette, s, t, &tcolor, &talpha);
 
-        tr = (tcolor << 1) & 0x3E; if (tr) tr++;
-        tg = (tcolor >> 4) & 0x3E; if (tg) tg++;
-        tb = (tcolor >> 9) & 0x3E; if (tb) tb++;
+            tr = (tcolor << 1) & 0x3E; if (tr) tr++;
+            tg = (tcolor >> 4) & 0x3E; if (tg) tg++;
+            tb = (tcolor >> 9) & 0x3E; if (tb) tb++;
+        }
 
         if (blendmode & 0x1)
         {
@@ -602,7 +1023,7 @@ void SoftRenderer::SetupPolygonLeftEdge(SoftRenderer::RendererPolygon* rp, s32 y
 {
     Polygon* polygon = rp->PolyData;
 
-    while (y >= polygon->Vertices[rp->NextVL]->FinalPosition[1] && rp->CurVL != polygon->VBottom)
+    while (y >= rp->Positions[rp->NextVL][1] && rp->CurVL != rp->VBottom)
     {
         rp->CurVL = rp->NextVL;
 
@@ -620,8 +1041,8 @@ void SoftRenderer::SetupPolygonLeftEdge(SoftRenderer::RendererPolygon* rp, s32 y
         }
     }
 
-    rp->XL = rp->SlopeL.Setup(polygon->Vertices[rp->CurVL]->FinalPosition[0], polygon->Vertices[rp->NextVL]->FinalPosition[0],
-                              polygon->Vertices[rp->CurVL]->FinalPosition[1], polygon->Vertices[rp->NextVL]->FinalPosition[1],
+    rp->XL = rp->SlopeL.Setup(rp->Positions[rp->CurVL][0], rp->Positions[rp->NextVL][0],
+                              rp->Positions[rp->CurVL][1], rp->Positions[rp->NextVL][1],
                               polygon->FinalW[rp->CurVL], polygon->FinalW[rp->NextVL], y);
 }
 
@@ -629,7 +1050,7 @@ void SoftRenderer::SetupPolygonRightEdge(SoftRenderer::RendererPolygon* rp, s32
 {
     Polygon* polygon = rp->PolyData;
 
-    while (y >= polygon->Vertices[rp->NextVR]->FinalPosition[1] && rp->CurVR != polygon->VBottom)
+    while (y >= rp->Positions[rp->NextVR][1] && rp->CurVR != rp->VBottom)
     {
         rp->CurVR = rp->NextVR;
 
@@ -647,8 +1068,8 @@ void SoftRenderer::SetupPolygonRightEdge(SoftRenderer::RendererPolygon* rp, s32
         }
     }
 
-    rp->XR = rp->SlopeR.Setup(polygon->Vertices[rp->CurVR]->FinalPosition[0], polygon->Vertices[rp->NextVR]->FinalPosition[0],
-                              polygon->Vertices[rp->CurVR]->FinalPosition[1], polygon->Vertices[rp->NextVR]->FinalPosition[1],
+    rp->XR = rp->SlopeR.Setup(rp->Positions[rp->CurVR][0], rp->Positions[rp->NextVR][0],
+                              rp->Positions[rp->CurVR][1], rp->Positions[rp->NextVR][1],
                               polygon->FinalW[rp->CurVR], polygon->FinalW[rp->NextVR], y);
 }
 
@@ -659,6 +1080,55 @@ void SoftRenderer::SetupPolygon(SoftRenderer::RendererPolygon* rp, Polygon* poly
     u32 vtop = polygon->VTop, vbot = polygon->VBottom;
     s32 ytop = polygon->YTop, ybot = polygon->YBottom;
 
+    if (ScaleFactor == 1 && !HiresCoordinates)
+    {
+        for (u32 i = 0; i < nverts; i++)
+        {
+            rp->Positions[i][0] = polygon->Vertices[i]->FinalPosition[0];
+            rp->Positions[i][1] = polygon->Vertices[i]->FinalPosition[1];
+        }
+    }
+    else
+    {
+        // redo the bounds calculation from GPU3D::SubmitPolygon() on the scaled positions
+        s32 xbot = 0;
+        vtop = 0; vbot = 0;
+        ytop = ScreenHeight; ybot = 0;
+
+        for (u32 i = 0; i < nverts; i++)
+        {
+            s32 x, y;
+            if (HiresCoordinates)
+            {
+                x = (polygon->Vertices[i]->HiresPosition[0] * ScaleFactor) >> 4;
+                y = (polygon->Vertices[i]->HiresPosition[1] * ScaleFactor) >> 4;
+            }
+            else
+            {
+                x = polygon->Vertices[i]->FinalPosition[0] * ScaleFactor;
+                y = polygon->Vertices[i]->FinalPosition[1] * ScaleFactor;
+            }
+
+            rp->Positions[i][0] = x;
+            rp->Positions[i][1] = y;
+
+            if (y < ytop)
+            {
+                ytop = y;
+                vtop = i;
+            }
+            if (y > ybot || (y == ybot && x > xbot))
+            {
+                xbot = x;
+                ybot = y;
+                vbot = i;
+            }
+        }
+    }
+
+    rp->VTop = vtop; rp->VBottom = vbot;
+    rp->YTop = ytop; rp->YBottom = ybot;
+
     rp->PolyData = polygon;
 
     rp->CurVL = vtop;
@@ -685,18 +1155,18 @@ void SoftRenderer::SetupPolygon(SoftRenderer::RendererPolygon* rp, Polygon* poly
         int i;
 
         i = 1;
-        if (polygon->Vertices[i]->FinalPosition[0] < polygon->Vertices[vtop]->FinalPosition[0]) vtop = i;
-        if (polygon->Vertices[i]->FinalPosition[0] > polygon->Vertices[vbot]->FinalPosition[0]) vbot = i;
+        if (rp->Positions[i][0] < rp->Positions[vtop][0]) vtop = i;
+        if (rp->Positions[i][0] > rp->Positions[vbot][0]) vbot = i;
 
         i = nverts - 1;
-        if (polygon->Vertices[i]->FinalPosition[0] < polygon->Vertices[vtop]->FinalPosition[0]) vtop = i;
-        if (polygon->Vertices[i]->FinalPosition[0] > polygon->Vertices[vbot]->FinalPosition[0]) vbot = i;
+        if (rp->Positions[i][0] < rp->Positions[vtop][0]) vtop = i;
+        if (rp->Positions[i][0] > rp->Positions[vbot][0]) vbot = i;
 
         rp->CurVL = vtop; rp->NextVL = vtop;
         rp->CurVR = vbot; rp->NextVR = vbot;
 
-        rp->XL = rp->SlopeL.SetupDummy(polygon->Vertices[rp->CurVL]->FinalPosition[0]);
-        rp->XR = rp->SlopeR.SetupDummy(polygon->Vertices[rp->CurVR]->FinalPosition[0]);
+        rp->XL = rp->SlopeL.SetupDummy(rp->Positions[rp->CurVL][0]);
+        rp->XR = rp->SlopeR.SetupDummy(rp->Positions[rp->CurVR][0]);
     }
     else
     {
@@ -705,6 +1175,25 @@ void SoftRenderer::SetupPolygon(SoftRenderer::RendererPolygon* rp, Polygon* poly
     }
 }
 
+void SoftRenderer::SetupPolygonTexture(const GPU& gpu, RendererPolygon* rp)
+{
+    Polygon* polygon = rp->PolyData;
+
+    rp->TexData = nullptr;
+
+    if (!(gpu.GPU3D.RenderDispCnt & (1<<0)) || (((polygon->TexParam >> 26) & 0x7) == 0))
+        return;
+    if (!CanCacheTexture(polygon->TexParam, polygon->TexPalette))
+        return;
+
+    u32* texarray;
+    u32 layer;
+    u32* helper;
+    Texcache.GetTexture(gpu, polygon->TexParam, polygon->TexPalette, texarray, layer, helper);
+
+    rp->TexData = &texarray[TextureWidth(polygon->TexParam) * TextureHeight(polygon->TexParam) * layer];
+}
+
 void SoftRenderer::RenderShadowMaskScanline(const GPU3D& gpu3d, RendererPolygon* rp, s32 y)
 {
     Polygon* polygon = rp->PolyData;
@@ -715,27 +1204,22 @@ void SoftRenderer::RenderShadowMaskScanline(const GPU3D& gpu3d, RendererPolygon*
     u32 polyalpha = (polygon->Attr >> 16) & 0x1F;
     bool wireframe = (polyalpha == 0);
 
-    bool (*fnDepthTest)(s32 dstz, s32 z, u32 dstattr);
-    if (polygon->Attr & (1<<14))
-        fnDepthTest = polygon->WBuffer ? DepthTest_Equal_W : DepthTest_Equal_Z;
-    else if (polygon->FacingView)
-        fnDepthTest = DepthTest_LessThan_FrontFacing;
-    else
-        fnDepthTest = DepthTest_LessThan;
+    int depthtest = SelectDepthTest(polygon);
+    bool (*fnDepthTest)(s32 dstz, s32 z, u32 dstattr) = DepthTestFuncs[depthtest];
 
     if (!PrevIsShadowMask)
-        memset(&StencilBuffer[256 * (y&0x1)], 0, 256);
+        memset(&StencilBuffer[ScreenWidth * (y&0x1)], 0, ScreenWidth);
 
     PrevIsShadowMask = true;
 
-    if (polygon->YTop != polygon->YBottom)
+    if (rp->YTop != rp->YBottom)
     {
-        if (y >= polygon->Vertices[rp->NextVL]->FinalPosition[1] && rp->CurVL != polygon->VBottom)
+        if (y >= rp->Positions[rp->NextVL][1] && rp->CurVL != rp->VBottom)
         {
             SetupPolygonLeftEdge(rp, y);
         }
 
-        if (y >= polygon->Vertices[rp->NextVR]->FinalPosition[1] && rp->CurVR != polygon->VBottom)
+        if (y >= rp->Positions[rp->NextVR][1] && rp->CurVR != rp->VBottom)
         {
             SetupPolygonRightEdge(rp, y);
         }
@@ -790,10 +1274,10 @@ void SoftRenderer::RenderShadowMaskScanline(const GPU3D& gpu3d, RendererPolygon*
         else
         {
             l_filledge = (rp->SlopeR.Negative || !rp->SlopeR.XMajor)
-                || (y == polygon->YBottom-1) && rp->SlopeR.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]);
+                || (y == rp->YBottom-1) && rp->SlopeR.XMajor && (rp->Positions[rp->NextVL][0] != rp->Positions[rp->NextVR][0]);
             r_filledge = (!rp->SlopeL.Negative && rp->SlopeL.XMajor)
                 || (!(rp->SlopeL.Negative && rp->SlopeL.XMajor) && rp->SlopeR.Increment==0)
-                || (y == polygon->YBottom-1) && rp->SlopeL.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]);
+                || (y == rp->YBottom-1) && rp->SlopeL.XMajor && (rp->Positions[rp->NextVL][0] != rp->Positions[rp->NextVR][0]);
         }
     }
     else
@@ -818,10 +1302,10 @@ void SoftRenderer::RenderShadowMaskScanline(const GPU3D& gpu3d, RendererPolygon*
         else
         {
             l_filledge = ((rp->SlopeL.Negative || !rp->SlopeL.XMajor)
-                || (y == polygon->YBottom-1) && rp->SlopeL.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]))
+                || (y == rp->YBottom-1) && rp->SlopeL.XMajor && (rp->Positions[rp->NextVL][0] != rp->Positions[rp->NextVR][0]))
                 || (rp->SlopeL.Increment == rp->SlopeR.Increment) && (xstart+l_edgelen == xend+1);
             r_filledge = (!rp->SlopeR.Negative && rp->SlopeR.XMajor) || (rp->SlopeR.Increment==0)
-                || (y == polygon->YBottom-1) && rp->SlopeR.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]);
+                || (y == rp->YBottom-1) && rp->SlopeR.XMajor && (rp->Positions[rp->NextVL][0] != rp->Positions[rp->NextVR][0]);
         }
     }
 
@@ -836,8 +1320,8 @@ void SoftRenderer::RenderShadowMaskScanline(const GPU3D& gpu3d, RendererPolygon*
     // in wireframe mode, there are special rules for equal Z (TODO)
 
     int yedge = 0;
-    if (y == polygon->YTop)           yedge = 0x4;
-    else if (y == polygon->YBottom-1) yedge = 0x8;
+    if (y == rp->YTop)           yedge = 0x4;
+    else if (y == rp->YBottom-1) yedge = 0x8;
     int edge;
 
     s32 x = xstart;
@@ -849,11 +1333,15 @@ void SoftRenderer::RenderShadowMaskScanline(const GPU3D& gpu3d, RendererPolygon*
     // for shadow masks: set stencil bits where the depth test fails.
     // draw nothing.
 
+    s32 spanend = std::min(xend+1, ScreenWidth);
+    if (x < spanend)
+        interpX.InterpolateSpan(x, spanend, zl, zr, polygon->WBuffer, SpanFactor, SpanZ);
+
     // part 1: left edge
     edge = yedge | 0x1;
     xlimit = xstart+l_edgelen;
     if (xlimit > xend+1) xlimit = xend+1;
-    if (xlimit > 256) xlimit = 256;
+    if (xlimit > ScreenWidth) xlimit = ScreenWidth;
 
     if (!l_filledge) x = xlimit;
     else
@@ -861,19 +1349,17 @@ void SoftRenderer::RenderShadowMaskScanline(const GPU3D& gpu3d, RendererPolygon*
     {
         u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth) + x;
 
-        interpX.SetX(x);
-
-        s32 z = interpX.InterpolateZ(zl, zr, polygon->WBuffer);
+        s32 z = SpanZ[x];
         u32 dstattr = AttrBuffer[pixeladdr];
 
         if (!fnDepthTest(DepthBuffer[pixeladdr], z, dstattr))
-            StencilBuffer[256*(y&0x1) + x] = 1;
+            StencilBuffer[ScreenWidth*(y&0x1) + x] = 1;
 
         if (dstattr & 0xF)
         {
             pixeladdr += BufferSize;
             if (!fnDepthTest(DepthBuffer[pixeladdr], z, AttrBuffer[pixeladdr]))
-                StencilBuffer[256*(y&0x1) + x] |= 0x2;
+                StencilBuffer[ScreenWidth*(y&0x1) + x] |= 0x2;
         }
     }
 
@@ -881,51 +1367,47 @@ void SoftRenderer::RenderShadowMaskScanline(const GPU3D& gpu3d, RendererPolygon*
     edge = yedge;
     xlimit = xend-r_edgelen+1;
     if (xlimit > xend+1) xlimit = xend+1;
-    if (xlimit > 256) xlimit = 256;
+    if (xlimit > ScreenWidth) xlimit = ScreenWidth;
     if (wireframe && !edge) x = std::max(x, xlimit);
     else for (; x < xlimit; x++)
     {
         u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth) + x;
 
-        interpX.SetX(x);
-
-        s32 z = interpX.InterpolateZ(zl, zr, polygon->WBuffer);
+        s32 z = SpanZ[x];
         u32 dstattr = AttrBuffer[pixeladdr];
 
         if (!fnDepthTest(DepthBuffer[pixeladdr], z, dstattr))
-            StencilBuffer[256*(y&0x1) + x] = 1;
+            StencilBuffer[ScreenWidth*(y&0x1) + x] = 1;
 
         if (dstattr & 0xF)
         {
             pixeladdr += BufferSize;
             if (!fnDepthTest(DepthBuffer[pixeladdr], z, AttrBuffer[pixeladdr]))
-                StencilBuffer[256*(y&0x1) + x] |= 0x2;
+                StencilBuffer[ScreenWidth*(y&0x1) + x] |= 0x2;
         }
     }
 
     // part 3: right edge
     edge = yedge | 0x2;
     xlimit = xend+1;
-    if (xlimit > 256) xlimit = 256;
+    if (xlimit > ScreenWidth) xlimit = ScreenWidth;
 
     if (r_filledge)
     for (; x < xlimit; x++)
     {
         u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth) + x;
 
-        interpX.SetX(x);
-
-        s32 z = interpX.InterpolateZ(zl, zr, polygon->WBuffer);
+        s32 z = SpanZ[x];
         u32 dstattr = AttrBuffer[pixeladdr];
 
         if (!fnDepthTest(DepthBuffer[pixeladdr], z, dstattr))
-            StencilBuffer[256*(y&0x1) + x] = 1;
+            StencilBuffer[ScreenWidth*(y&0x1) + x] = 1;
 
         if (dstattr & 0xF)
         {
             pixeladdr += BufferSize;
             if (!fnDepthTest(DepthBuffer[pixeladdr], z, AttrBuffer[pixeladdr]))
-                StencilBuffer[256*(y&0x1) + x] |= 0x2;
+                StencilBuffer[ScreenWidth*(y&0x1) + x] |= 0x2;
         }
     }
 
@@ -943,24 +1425,19 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
     u32 polyalpha = (polygon->Attr >> 16) & 0x1F;
     bool wireframe = (polyalpha == 0);
 
-    bool (*fnDepthTest)(s32 dstz, s32 z, u32 dstattr);
-    if (polygon->Attr & (1<<14))
-        fnDepthTest = polygon->WBuffer ? DepthTest_Equal_W : DepthTest_Equal_Z;
-    else if (polygon->FacingView)
-        fnDepthTest = DepthTest_LessThan_FrontFacing;
-    else
-        fnDepthTest = DepthTest_LessThan;
+    int depthtest = SelectDepthTest(polygon);
+    bool (*fnDepthTest)(s32 dstz, s32 z, u32 dstattr) = DepthTestFuncs[depthtest];
 
     PrevIsShadowMask = false;
 
-    if (polygon->YTop != polygon->YBottom)
+    if (rp->YTop != rp->YBottom)
     {
-        if (y >= polygon->Vertices[rp->NextVL]->FinalPosition[1] && rp->CurVL != polygon->VBottom)
+        if (y >= rp->Positions[rp->NextVL][1] && rp->CurVL != rp->VBottom)
         {
             SetupPolygonLeftEdge(rp, y);
         }
 
-        if (y >= polygon->Vertices[rp->NextVR]->FinalPosition[1] && rp->CurVR != polygon->VBottom)
+        if (y >= rp->Positions[rp->NextVR][1] && rp->CurVR != rp->VBottom)
         {
             SetupPolygonRightEdge(rp, y);
         }
@@ -1025,10 +1502,10 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
         else
         {
             l_filledge = (rp->SlopeR.Negative || !rp->SlopeR.XMajor)
-                || (y == polygon->YBottom-1) && rp->SlopeR.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]);
+                || (y == rp->YBottom-1) && rp->SlopeR.XMajor && (rp->Positions[rp->NextVL][0] != rp->Positions[rp->NextVR][0]);
             r_filledge = (!rp->SlopeL.Negative && rp->SlopeL.XMajor)
                 || (!(rp->SlopeL.Negative && rp->SlopeL.XMajor) && rp->SlopeR.Increment==0)
-                || (y == polygon->YBottom-1) && rp->SlopeL.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]);
+                || (y == rp->YBottom-1) && rp->SlopeL.XMajor && (rp->Positions[rp->NextVL][0] != rp->Positions[rp->NextVR][0]);
         }
     }
     else
@@ -1060,10 +1537,10 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
         else
         {
             l_filledge = ((rp->SlopeL.Negative || !rp->SlopeL.XMajor)
-                || (y == polygon->YBottom-1) && rp->SlopeL.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]))
+                || (y == rp->YBottom-1) && rp->SlopeL.XMajor && (rp->Positions[rp->NextVL][0] != rp->Positions[rp->NextVR][0]))
                 || (rp->SlopeL.Increment == rp->SlopeR.Increment) && (xstart+l_edgelen == xend+1);
             r_filledge = (!rp->SlopeR.Negative && rp->SlopeR.XMajor) || (rp->SlopeR.Increment==0)
-                || (y == polygon->YBottom-1) && rp->SlopeR.XMajor && (vlnext->FinalPosition[0] != vrnext->FinalPosition[0]);
+                || (y == rp->YBottom-1) && rp->SlopeR.XMajor && (rp->Positions[rp->NextVL][0] != rp->Positions[rp->NextVR][0]);
         }
     }
 
@@ -1086,8 +1563,8 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
     // in wireframe mode, there are special rules for equal Z (TODO)
 
     int yedge = 0;
-    if (y == polygon->YTop)           yedge = 0x4;
-    else if (y == polygon->YBottom-1) yedge = 0x8;
+    if (y == rp->YTop)           yedge = 0x4;
+    else if (y == rp->YBottom-1) yedge = 0x8;
     int edge;
 
     s32 x = xstart;
@@ -1098,11 +1575,47 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
 
     s32 xcov = 0;
 
+    // coarse depth test
+    // every Z value interpolated along the span is at least min(zl, zr), as long as
+    // both W values are positive when W-buffering. with a 'less than' depth test,
+    // no pixel can pass over a tile whose farthest depth isn't above that.
+    bool coarse = !polygon->IsShadow
+        && (depthtest == depthTest_LessThan || depthtest == depthTest_LessThan_FrontFacing)
+        && (!polygon->WBuffer || (wl > 0 && wr > 0));
+    s32 zreject = std::min(zl, zr);
+
+    // interpolate Z and depth test the whole span first
+    // spans hidden behind what was already drawn end here
+    s32 spanend = std::min(xend+1, ScreenWidth);
+    s32 writestart = spanend, writeend = 0;
+    u32 depthrejects = 0, translucent = 0;
+    if (x < spanend)
+    {
+        CurStats.PixelsRasterized += spanend - x;
+
+        if (coarse)
+        {
+            if (!CoarseDepthTestSpan(interpX, depthtest, y, x, spanend, zl, zr, polygon->WBuffer, zreject))
+            {
+                CurStats.DepthRejects += spanend - x;
+                rp->XL = rp->SlopeL.Step();
+                rp->XR = rp->SlopeR.Step();
+                return;
+            }
+        }
+        else
+        {
+            interpX.InterpolateSpan(x, spanend, zl, zr, polygon->WBuffer, SpanFactor, SpanZ);
+            if (!polygon->IsShadow)
+                DepthTestSpan(depthtest, y, x, spanend);
+        }
+    }
+
     // part 1: left edge
     edge = yedge | 0x1;
     xlimit = xstart+l_edgelen;
     if (xlimit > xend+1) xlimit = xend+1;
-    if (xlimit > 256) xlimit = 256;
+    if (xlimit > ScreenWidth) xlimit = ScreenWidth;
     if (l_edgecov & (1<<31))
     {
         xcov = (l_edgecov >> 12) & 0x3FF;
@@ -1113,13 +1626,22 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
     else
     for (; x < xlimit; x++)
     {
+        // skip the rest of hidden tiles
+        if (coarse && CoarseDepth[x >> CoarseTileShift] <= zreject)
+        {
+            s32 last = std::min(x | ((1 << CoarseTileShift) - 1), xlimit - 1);
+            depthrejects += last - x + 1;
+            x = last;
+            continue;
+        }
+
         u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth) + x;
         u32 dstattr = AttrBuffer[pixeladdr];
 
         // check stencil buffer for shadows
         if (polygon->IsShadow)
         {
-            u8 stencil = StencilBuffer[256*(y&0x1) + x];
+            u8 stencil = StencilBuffer[ScreenWidth*(y&0x1) + x];
             if (!stencil)
                 continue;
             if (!(stencil & 0x1))
@@ -1128,20 +1650,28 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
                 dstattr &= ~0xF; // quick way to prevent drawing the shadow under antialiased edges
         }
 
-        interpX.SetX(x);
+        interpX.SetX(x, SpanFactor[x]);
 
-        s32 z = interpX.InterpolateZ(zl, zr, polygon->WBuffer);
+        s32 z = SpanZ[x];
 
         // if depth test against the topmost pixel fails, test
         // against the pixel underneath
-        if (!fnDepthTest(DepthBuffer[pixeladdr], z, dstattr))
+        // (shadows may be tested against the pixel underneath right away)
+        if (!(polygon->IsShadow ? fnDepthTest(DepthBuffer[pixeladdr], z, dstattr) : SpanDepthPass[x]))
         {
-            if (!(dstattr & 0xF) || pixeladdr >= BufferSize) continue;
+            if (!(dstattr & 0xF) || pixeladdr >= BufferSize)
+            {
+                depthrejects++;
+                continue;
+            }
 
             pixeladdr += BufferSize;
             dstattr = AttrBuffer[pixeladdr];
             if (!fnDepthTest(DepthBuffer[pixeladdr], z, dstattr))
+            {
+                depthrejects++;
                 continue;
+            }
         }
 
         u32 vr = interpX.Interpolate(rl, rr);
@@ -1151,7 +1681,7 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
         s16 s = interpX.Interpolate(sl, sr);
         s16 t = interpX.Interpolate(tl, tr);
 
-        u32 color = RenderPixel(gpu, polygon, vr>>3, vg>>3, vb>>3, s, t);
+        u32 color = RenderPixel(gpu, rp, vr>>3, vg>>3, vb>>3, s, t);
         u8 alpha = color >> 24;
 
         // alpha test
@@ -1187,10 +1717,15 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
             DepthBuffer[pixeladdr] = z;
             ColorBuffer[pixeladdr] = color;
             AttrBuffer[pixeladdr] = attr;
+            writestart = std::min(writestart, x);
+            writeend = x + 1;
         }
         else
         {
             if (!(polygon->Attr & (1<<11))) z = -1;
+            writestart = std::min(writestart, x);
+            writeend = x + 1;
+            translucent++;
             PlotTranslucentPixel(gpu.GPU3D, pixeladdr, color, z, polyattr, polygon->IsShadow);
 
             // blend with bottom pixel too, if needed
@@ -1203,19 +1738,28 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
     edge = yedge;
     xlimit = xend-r_edgelen+1;
     if (xlimit > xend+1) xlimit = xend+1;
-    if (xlimit > 256) xlimit = 256;
+    if (xlimit > ScreenWidth) xlimit = ScreenWidth;
 
     if (wireframe && !edge) x = std::max(x, xlimit);
     else
     for (; x < xlimit; x++)
     {
+        // skip the rest of hidden tiles
+        if (coarse && CoarseDepth[x >> CoarseTileShift] <= zreject)
+        {
+            s32 last = std::min(x | ((1 << CoarseTileShift) - 1), xlimit - 1);
+            depthrejects += last - x + 1;
+            x = last;
+            continue;
+        }
+
         u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth) + x;
         u32 dstattr = AttrBuffer[pixeladdr];
 
         // check stencil buffer for shadows
         if (polygon->IsShadow)
         {
-            u8 stencil = StencilBuffer[256*(y&0x1) + x];
+            u8 stencil = StencilBuffer[ScreenWidth*(y&0x1) + x];
             if (!stencil)
                 continue;
             if (!(stencil & 0x1))
@@ -1224,20 +1768,28 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
                 dstattr &= ~0xF; // quick way to prevent drawing the shadow under antialiased edges
         }
 
-        interpX.SetX(x);
+        interpX.SetX(x, SpanFactor[x]);
 
-        s32 z = interpX.InterpolateZ(zl, zr, polygon->WBuffer);
+        s32 z = SpanZ[x];
 
         // if depth test against the topmost pixel fails, test
         // against the pixel underneath
-        if (!fnDepthTest(DepthBuffer[pixeladdr], z, dstattr))
+        // (shadows may be tested against the pixel underneath right away)
+        if (!(polygon->IsShadow ? fnDepthTest(DepthBuffer[pixeladdr], z, dstattr) : SpanDepthPass[x]))
         {
-            if (!(dstattr & 0xF) || pixeladdr >= BufferSize) continue;
+            if (!(dstattr & 0xF) || pixeladdr >= BufferSize)
+            {
+                depthrejects++;
+                continue;
+            }
 
             pixeladdr += BufferSize;
             dstattr = AttrBuffer[pixeladdr];
             if (!fnDepthTest(DepthBuffer[pixeladdr], z, dstattr))
+            {
+                depthrejects++;
                 continue;
+            }
         }
 
         u32 vr = interpX.Interpolate(rl, rr);
@@ -1247,7 +1799,7 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
         s16 s = interpX.Interpolate(sl, sr);
         s16 t = interpX.Interpolate(tl, tr);
 
-        u32 color = RenderPixel(gpu, polygon, vr>>3, vg>>3, vb>>3, s, t);
+        u32 color = RenderPixel(gpu, rp, vr>>3, vg>>3, vb>>3, s, t);
         u8 alpha = color >> 24;
 
         // alpha test
@@ -1276,10 +1828,15 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
             DepthBuffer[pixeladdr] = z;
             ColorBuffer[pixeladdr] = color;
             AttrBuffer[pixeladdr] = attr;
+            writestart = std::min(writestart, x);
+            writeend = x + 1;
         }
         else
         {
             if (!(polygon->Attr & (1<<11))) z = -1;
+            writestart = std::min(writestart, x);
+            writeend = x + 1;
+            translucent++;
             PlotTranslucentPixel(gpu.GPU3D, pixeladdr, color, z, polyattr, polygon->IsShadow);
 
             // blend with bottom pixel too, if needed
@@ -1291,7 +1848,7 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
     // part 3: right edge
     edge = yedge | 0x2;
     xlimit = xend+1;
-    if (xlimit > 256) xlimit = 256;
+    if (xlimit > ScreenWidth) xlimit = ScreenWidth;
     if (r_edgecov & (1<<31))
     {
         xcov = (r_edgecov >> 12) & 0x3FF;
@@ -1301,13 +1858,22 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
     if (r_filledge)
     for (; x < xlimit; x++)
     {
+        // skip the rest of hidden tiles
+        if (coarse && CoarseDepth[x >> CoarseTileShift] <= zreject)
+        {
+            s32 last = std::min(x | ((1 << CoarseTileShift) - 1), xlimit - 1);
+            depthrejects += last - x + 1;
+            x = last;
+            continue;
+        }
+
         u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth) + x;
         u32 dstattr = AttrBuffer[pixeladdr];
 
         // check stencil buffer for shadows
         if (polygon->IsShadow)
         {
-            u8 stencil = StencilBuffer[256*(y&0x1) + x];
+            u8 stencil = StencilBuffer[ScreenWidth*(y&0x1) + x];
             if (!stencil)
                 continue;
             if (!(stencil & 0x1))
@@ -1316,20 +1882,28 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
                 dstattr &= ~0xF; // quick way to prevent drawing the shadow under antialiased edges
         }
 
-        interpX.SetX(x);
+        interpX.SetX(x, SpanFactor[x]);
 
-        s32 z = interpX.InterpolateZ(zl, zr, polygon->WBuffer);
+        s32 z = SpanZ[x];
 
         // if depth test against the topmost pixel fails, test
         // against the pixel underneath
-        if (!fnDepthTest(DepthBuffer[pixeladdr], z, dstattr))
+        // (shadows may be tested against the pixel underneath right away)
+        if (!(polygon->IsShadow ? fnDepthTest(DepthBuffer[pixeladdr], z, dstattr) : SpanDepthPass[x]))
         {
-            if (!(dstattr & 0xF) || pixeladdr >= BufferSize) continue;
+            if (!(dstattr & 0xF) || pixeladdr >= BufferSize)
+            {
+                depthrejects++;
+                continue;
+            }
 
             pixeladdr += BufferSize;
             dstattr = AttrBuffer[pixeladdr];
             if (!fnDepthTest(DepthBuffer[pixeladdr], z, dstattr))
+            {
+                depthrejects++;
                 continue;
+            }
         }
 
         u32 vr = interpX.Interpolate(rl, rr);
@@ -1339,7 +1913,7 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
         s16 s = interpX.Interpolate(sl, sr);
         s16 t = interpX.Interpolate(tl, tr);
 
-        u32 color = RenderPixel(gpu, polygon, vr>>3, vg>>3, vb>>3, s, t);
+        u32 color = RenderPixel(gpu, rp, vr>>3, vg>>3, vb>>3, s, t);
         u8 alpha = color >> 24;
 
         // alpha test
@@ -1375,10 +1949,15 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
             DepthBuffer[pixeladdr] = z;
             ColorBuffer[pixeladdr] = color;
             AttrBuffer[pixeladdr] = attr;
+            writestart = std::min(writestart, x);
+            writeend = x + 1;
         }
         else
         {
             if (!(polygon->Attr & (1<<11))) z = -1;
+            writestart = std::min(writestart, x);
+            writeend = x + 1;
+            translucent++;
             PlotTranslucentPixel(gpu.GPU3D, pixeladdr, color, z, polyattr, polygon->IsShadow);
 
             // blend with bottom pixel too, if needed
@@ -1387,18 +1966,26 @@ void SoftRenderer::RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s3
         }
     }
 
+    if (writestart < writeend)
+        UpdateCoarseDepth(y, writestart, writeend);
+
+    CurStats.DepthRejects += depthrejects;
+    CurStats.TranslucentPixels += translucent;
+
     rp->XL = rp->SlopeL.Step();
     rp->XR = rp->SlopeR.Step();
 }
 
 void SoftRenderer::RenderScanline(const GPU& gpu, s32 y, int npolys)
 {
+    UpdateCoarseDepth(y, 0, ScreenWidth);
+
     for (int i = 0; i < npolys; i++)
     {
         RendererPolygon* rp = &PolygonList[i];
         Polygon* polygon = rp->PolyData;
 
-        if (y >= polygon->YTop && (y < polygon->YBottom || (y == polygon->YTop && polygon->YBottom == polygon->YTop)))
+        if (y >= rp->YTop && (y < rp->YBottom || (y == rp->YTop && rp->YBottom == rp->YTop)))
         {
             if (polygon->IsShadowMask)
                 RenderShadowMaskScanline(gpu.GPU3D, rp, y);
@@ -1447,176 +2034,540 @@ u32 SoftRenderer::CalculateFogDensity(const GPU3D& gpu3d, u32 pixeladdr) const
     return density;
 }
 
-void SoftRenderer::ScanlineFinalPass(const GPU3D& gpu3d, s32 y)
+// the final pass kernels process 4 pixels at a time. colors are blended on
+// 16-bit lanes, one per channel, with each pixel's weight repeated over its
+// four channels.
+#if defined(MELONDS_SIMD_SSE2)
+// repeats each of the 4 values (which have to fit in 16 bits) over four 16-bit lanes
+inline void SpreadPixelWeights(__m128i val, __m128i& lo, __m128i& hi)
 {
-    // to consider:
-    // clearing all polygon fog flags if the master flag isn't set?
-    // merging all final pass loops into one?
+    __m128i pairs = _mm_packs_epi32(val, val);
+    pairs = _mm_unpacklo_epi16(pairs, pairs);
+    lo = _mm_unpacklo_epi32(pairs, pairs);
+    hi = _mm_unpackhi_epi32(pairs, pairs);
+}
 
-    if (gpu3d.RenderDispCnt & (1<<5))
+// (a * weight + b * ((1 << shift) - weight)) >> shift, for each channel of 4 colors
+template <int shift>
+inline __m128i BlendColors4(__m128i a, __m128i b, __m128i weightlo, __m128i weighthi)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i total = _mm_set1_epi16(1 << shift);
+
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), weightlo),
+                               _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), _mm_sub_epi16(total, weightlo)));
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), weighthi),
+                               _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), _mm_sub_epi16(total, weighthi)));
+    return _mm_packus_epi16(_mm_srli_epi16(lo, shift), _mm_srli_epi16(hi, shift));
+}
+
+inline __m128i MultiplyLo32(__m128i a, __m128i b)
+{
+#if defined(MELONDS_SIMD_SSE41)
+    return _mm_mullo_epi32(a, b);
+#else
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+#endif
+}
+
+// CalculateFogDensity() for 4 depth values
+inline __m128i CalculateFogDensity4(const GPU3D& gpu3d, __m128i z)
+{
+    // unsigned comparison, done by flipping the sign bits
+    const __m128i signflip = _mm_set1_epi32(0x80000000);
+    const __m128i offset = _mm_set1_epi32(gpu3d.RenderFogOffset);
+    __m128i below = _mm_cmplt_epi32(_mm_xor_si128(z, signflip), _mm_xor_si128(offset, signflip));
+
+    z = _mm_srli_epi32(_mm_sub_epi32(z, offset), 2);
+    z = _mm_sll_epi32(z, _mm_cvtsi32_si128(gpu3d.RenderFogShift));
+
+    __m128i densityid = _mm_srli_epi32(z, 17);
+    __m128i densityfrac = _mm_and_si128(z, _mm_set1_epi32(0x1FFFF));
+    __m128i clamp = _mm_cmpgt_epi32(densityid, _mm_set1_epi32(31));
+    densityid = _mm_or_si128(_mm_andnot_si128(clamp, densityid), _mm_and_si128(clamp, _mm_set1_epi32(32)));
+    densityid = _mm_andnot_si128(below, densityid);
+    densityfrac = _mm_andnot_si128(_mm_or_si128(clamp, below), densityfrac);
+
+    // there are no gathers, the table entries are fetched one by one
+    alignas(16) u32 ids[4];
+    _mm_store_si128((__m128i*)ids, densityid);
+    const u8* table = gpu3d.RenderFogDensityTable;
+    __m128i density0 = _mm_setr_epi32(table[ids[0]], table[ids[1]], table[ids[2]], table[ids[3]]);
+    __m128i density1 = _mm_setr_epi32(table[ids[0]+1], table[ids[1]+1], table[ids[2]+1], table[ids[3]+1]);
+
+    __m128i density = _mm_srli_epi32(_mm_add_epi32(
+        MultiplyLo32(density0, _mm_sub_epi32(_mm_set1_epi32(0x20000), densityfrac)),
+        MultiplyLo32(density1, densityfrac)), 17);
+
+    __m128i full = _mm_cmpgt_epi32(density, _mm_set1_epi32(126));
+    return _mm_or_si128(_mm_andnot_si128(full, density), _mm_and_si128(full, _mm_set1_epi32(128)));
+}
+#elif defined(MELONDS_SIMD_NEON)
+// repeats each of the 4 values (which have to fit in 16 bits) over four 16-bit lanes
+inline void SpreadPixelWeights(uint32x4_t val, uint16x8_t& lo, uint16x8_t& hi)
+{
+    uint16x4_t narrow = vmovn_u32(val);
+    lo = vcombine_u16(vdup_lane_u16(narrow, 0), vdup_lane_u16(narrow, 1));
+    hi = vcombine_u16(vdup_lane_u16(narrow, 2), vdup_lane_u16(narrow, 3));
+}
+
+// (a * weight + b * ((1 << shift) - weight)) >> shift, for each channel of 4 colors
+template <int shift>
+inline uint32x4_t BlendColors4(uint32x4_t a, uint32x4_t b, uint16x8_t weightlo, uint16x8_t weighthi)
+{
+    const uint16x8_t total = vdupq_n_u16(1 << shift);
+    uint8x16_t a8 = vreinterpretq_u8_u32(a);
+    uint8x16_t b8 = vreinterpretq_u8_u32(b);
+
+    uint16x8_t lo = vmlaq_u16(vmulq_u16(vmovl_u8(vget_low_u8(a8)), weightlo),
+                              vmovl_u8(vget_low_u8(b8)), vsubq_u16(total, weightlo));
+    uint16x8_t hi = vmlaq_u16(vmulq_u16(vmovl_high_u8(a8), weighthi),
+                              vmovl_high_u8(b8), vsubq_u16(total, weighthi));
+    return vreinterpretq_u32_u8(vcombine_u8(vshrn_n_u16(lo, shift), vshrn_n_u16(hi, shift)));
+}
+
+// CalculateFogDensity() for 4 depth values
+inline uint32x4_t CalculateFogDensity4(const GPU3D& gpu3d, uint32x4_t z)
+{
+    const uint32x4_t offset = vdupq_n_u32(gpu3d.RenderFogOffset);
+    uint32x4_t below = vcltq_u32(z, offset);
+
+    z = vshrq_n_u32(vsubq_u32(z, offset), 2);
+    z = vshlq_u32(z, vdupq_n_s32(gpu3d.RenderFogShift));
+
+    uint32x4_t densityid = vshrq_n_u32(z, 17);
+    uint32x4_t densityfrac = vandq_u32(z, vdupq_n_u32(0x1FFFF));
+    uint32x4_t clamp = vcgtq_u32(densityid, vdupq_n_u32(31));
+    densityid = vbslq_u32(clamp, vdupq_n_u32(32), densityid);
+    densityid = vbicq_u32(densityid, below);
+    densityfrac = vbicq_u32(densityfrac, vorrq_u32(clamp, below));
+
+    // there are no gathers, the table entries are fetched one by one
+    u32 ids[4];
+    vst1q_u32(ids, densityid);
+    const u8* table = gpu3d.RenderFogDensityTable;
+    const u32 densities0[4] = {table[ids[0]], table[ids[1]], table[ids[2]], table[ids[3]]};
+    const u32 densities1[4] = {table[ids[0]+1], table[ids[1]+1], table[ids[2]+1], table[ids[3]+1]};
+
+    uint32x4_t density = vshrq_n_u32(vmlaq_u32(
+        vmulq_u32(vld1q_u32(densities0), vsubq_u32(vdupq_n_u32(0x20000), densityfrac)),
+        vld1q_u32(densities1), densityfrac), 17);
+
+    return vbslq_u32(vcgtq_u32(density, vdupq_n_u32(126)), vdupq_n_u32(128), density);
+}
+#endif
+
+void SoftRenderer::EdgeMarkScanline(const GPU3D& gpu3d, u32 lineaddr)
+{
+    // edge marking
+    // only applied to topmost pixels
+
+    u32 edgecolors[8];
+    for (int i = 0; i < 8; i++)
+    {
+        u16 edgecolor = gpu3d.RenderEdgeTable[i];
+        u32 edgeR = (edgecolor << 1) & 0x3E; if (edgeR) edgeR++;
+        u32 edgeG = (edgecolor >> 4) & 0x3E; if (edgeG) edgeG++;
+        u32 edgeB = (edgecolor >> 9) & 0x3E; if (edgeB) edgeB++;
+        edgecolors[i] = edgeR | (edgeG << 8) | (edgeB << 16);
+    }
+
+    auto markpixel = [&](u32 pixeladdr)
+    {
+        u32 polyid = AttrBuffer[pixeladdr] >> 24;
+        ColorBuffer[pixeladdr] = edgecolors[polyid >> 3] | (ColorBuffer[pixeladdr] & 0xFF000000);
+
+        // break antialiasing coverage (checkme)
+        AttrBuffer[pixeladdr] = (AttrBuffer[pixeladdr] & 0xFFFFE0FF) | 0x00001000;
+    };
+
+    // the marked pixels only have their coverage changed, which doesn't affect
+    // the test for their neighbours. the whole scanline is tested first, then
+    // the pixels are marked: interleaving both would have the vector loads
+    // stall on the stores to the previous pixels
+    const s32 neighbours[4] = {-1, 1, -ScanlineWidth, ScanlineWidth};
+    u8 edgemasks[(256*GPU3D::MaxFramebufferScale) / 4];
+    s32 x = 0;
+
+#if defined(MELONDS_SIMD_SSE2)
+    const __m128i signflip = _mm_set1_epi32(0x80000000);
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 4 <= ScreenWidth; x += 4)
     {
-        // edge marking
-        // only applied to topmost pixels
+        u32 pixeladdr = lineaddr + x;
 
-        for (int x = 0; x < 256; x++)
+        __m128i attr = _mm_loadu_si128((__m128i*)&AttrBuffer[pixeladdr]);
+        __m128i notedge = _mm_cmpeq_epi32(_mm_and_si128(attr, _mm_set1_epi32(0xF)), zero);
+        if (_mm_movemask_ps(_mm_castsi128_ps(notedge)) == 0xF)
         {
-            u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth) + x;
+            edgemasks[x >> 2] = 0;
+            continue;
+        }
 
-            u32 attr = AttrBuffer[pixeladdr];
-            if (!(attr & 0xF)) continue;
+        __m128i polyid = _mm_srli_epi32(attr, 24); // opaque polygon IDs are used for edgemarking
+        __m128i z = _mm_xor_si128(_mm_loadu_si128((__m128i*)&DepthBuffer[pixeladdr]), signflip);
 
-            u32 polyid = attr >> 24; // opaque polygon IDs are used for edgemarking
-            u32 z = DepthBuffer[pixeladdr];
+        __m128i edge = zero;
+        for (s32 offset : neighbours)
+        {
+            __m128i otherid = _mm_srli_epi32(_mm_loadu_si128((__m128i*)&AttrBuffer[pixeladdr + offset]), 24);
+            __m128i otherz = _mm_xor_si128(_mm_loadu_si128((__m128i*)&DepthBuffer[pixeladdr + offset]), signflip);
+            edge = _mm_or_si128(edge, _mm_andnot_si128(_mm_cmpeq_epi32(polyid, otherid), _mm_cmplt_epi32(z, otherz)));
+        }
+        edge = _mm_andnot_si128(notedge, edge);
 
-            if (((polyid != (AttrBuffer[pixeladdr-1] >> 24)) && (z < DepthBuffer[pixeladdr-1])) ||
-                ((polyid != (AttrBuffer[pixeladdr+1] >> 24)) && (z < DepthBuffer[pixeladdr+1])) ||
-                ((polyid != (AttrBuffer[pixeladdr-ScanlineWidth] >> 24)) && (z < DepthBuffer[pixeladdr-ScanlineWidth])) ||
-                ((polyid != (AttrBuffer[pixeladdr+ScanlineWidth] >> 24)) && (z < DepthBuffer[pixeladdr+ScanlineWidth])))
-            {
-                u16 edgecolor = gpu3d.RenderEdgeTable[polyid >> 3];
-                u32 edgeR = (edgecolor << 1) & 0x3E; if (edgeR) edgeR++;
-                u32 edgeG = (edgecolor >> 4) & 0x3E; if (edgeG) edgeG++;
-                u32 edgeB = (edgecolor >> 9) & 0x3E; if (edgeB) edgeB++;
+        edgemasks[x >> 2] = _mm_movemask_ps(_mm_castsi128_ps(edge));
+    }
+#elif defined(MELONDS_SIMD_NEON)
+    for (; x + 4 <= ScreenWidth; x += 4)
+    {
+        u32 pixeladdr = lineaddr + x;
 
-                ColorBuffer[pixeladdr] = edgeR | (edgeG << 8) | (edgeB << 16) | (ColorBuffer[pixeladdr] & 0xFF000000);
+        uint32x4_t attr = vld1q_u32(&AttrBuffer[pixeladdr]);
+        uint32x4_t isedge = vtstq_u32(attr, vdupq_n_u32(0xF));
+        if (!vmaxvq_u32(isedge))
+        {
+            edgemasks[x >> 2] = 0;
+            continue;
+        }
 
-                // break antialiasing coverage (checkme)
-                AttrBuffer[pixeladdr] = (AttrBuffer[pixeladdr] & 0xFFFFE0FF) | 0x00001000;
-            }
+        uint32x4_t polyid = vshrq_n_u32(attr, 24); // opaque polygon IDs are used for edgemarking
+        uint32x4_t z = vld1q_u32(&DepthBuffer[pixeladdr]);
+
+        uint32x4_t edge = vdupq_n_u32(0);
+        for (s32 offset : neighbours)
+        {
+            uint32x4_t otherid = vshrq_n_u32(vld1q_u32(&AttrBuffer[pixeladdr + offset]), 24);
+            uint32x4_t otherz = vld1q_u32(&DepthBuffer[pixeladdr + offset]);
+            edge = vorrq_u32(edge, vbicq_u32(vcltq_u32(z, otherz), vceqq_u32(polyid, otherid)));
+        }
+        edge = vandq_u32(edge, isedge);
+
+        // the lanes are all ones or all zeroes,
+        // keep one distinct bit per lane and add them up into a mask
+        const uint32x4_t bits = {1, 2, 4, 8};
+        edgemasks[x >> 2] = vaddvq_u32(vandq_u32(edge, bits));
+    }
+#endif
+
+    for (s32 i = 0; i < (x >> 2); i++)
+    {
+        u32 mask = edgemasks[i];
+        while (mask)
+        {
+            markpixel(lineaddr + (i << 2) + __builtin_ctz(mask));
+            mask &= mask - 1;
         }
     }
 
-    if (gpu3d.RenderDispCnt & (1<<7))
+    for (; x < ScreenWidth; x++)
     {
-        // fog
+        u32 pixeladdr = lineaddr + x;
+
+        u32 attr = AttrBuffer[pixeladdr];
+        if (!(attr & 0xF)) continue;
+
+        u32 polyid = attr >> 24; // opaque polygon IDs are used for edgemarking
+        u32 z = DepthBuffer[pixeladdr];
+
+        for (s32 offset : neighbours)
+        {
+            if ((polyid != (AttrBuffer[pixeladdr + offset] >> 24)) && (z < DepthBuffer[pixeladdr + offset]))
+            {
+                markpixel(pixeladdr);
+                break;
+            }
+        }
+    }
+}
 
-        // hardware testing shows that the fog step is 0x80000>>SHIFT
-        // basically, the depth values used in GBAtek need to be
-        // multiplied by 0x200 to match Z-buffer values
+void SoftRenderer::FogScanline(const GPU3D& gpu3d, u32 lineaddr)
+{
+    // fog
 
-        // fog is applied to the topmost two pixels, which is required for
-        // proper antialiasing
+    // hardware testing shows that the fog step is 0x80000>>SHIFT
+    // basically, the depth values used in GBAtek need to be
+    // multiplied by 0x200 to match Z-buffer values
 
-        // TODO: check the 'fog alpha glitch with small Z' GBAtek talks about
+    // fog is applied to the topmost two pixels, which is required for
+    // proper antialiasing
 
-        bool fogcolor = !(gpu3d.RenderDispCnt & (1<<6));
+    // TODO: check the 'fog alpha glitch with small Z' GBAtek talks about
 
-        u32 fogR = (gpu3d.RenderFogColor << 1) & 0x3E; if (fogR) fogR++;
-        u32 fogG = (gpu3d.RenderFogColor >> 4) & 0x3E; if (fogG) fogG++;
-        u32 fogB = (gpu3d.RenderFogColor >> 9) & 0x3E; if (fogB) fogB++;
-        u32 fogA = (gpu3d.RenderFogColor >> 16) & 0x1F;
+    bool fogcolor = !(gpu3d.RenderDispCnt & (1<<6));
 
-        for (int x = 0; x < 256; x++)
-        {
-            u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth) + x;
-            u32 density, srccolor, srcR, srcG, srcB, srcA;
+    u32 fogR = (gpu3d.RenderFogColor << 1) & 0x3E; if (fogR) fogR++;
+    u32 fogG = (gpu3d.RenderFogColor >> 4) & 0x3E; if (fogG) fogG++;
+    u32 fogB = (gpu3d.RenderFogColor >> 9) & 0x3E; if (fogB) fogB++;
+    u32 fogA = (gpu3d.RenderFogColor >> 16) & 0x1F;
 
-            u32 attr = AttrBuffer[pixeladdr];
-            if (attr & (1<<15))
-            {
-                density = CalculateFogDensity(gpu3d, pixeladdr);
+    s32 x = 0;
 
-                srccolor = ColorBuffer[pixeladdr];
-                srcR = srccolor & 0x3F;
-                srcG = (srccolor >> 8) & 0x3F;
-                srcB = (srccolor >> 16) & 0x3F;
-                srcA = (srccolor >> 24) & 0x1F;
+#if defined(MELONDS_SIMD_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i fogflag = _mm_set1_epi32(1<<15);
+    const __m128i fogcolors = _mm_set1_epi32(fogR | (fogG << 8) | (fogB << 16) | (fogA << 24));
+    const __m128i channelmask = _mm_set1_epi32(0x1F3F3F3F);
+    // without the fog color, only the alpha channel is blended
+    const __m128i weightmask = _mm_set1_epi64x(fogcolor ? -1 : (s64)0xFFFF000000000000);
 
-                if (fogcolor)
-                {
-                    srcR = ((fogR * density) + (srcR * (128-density))) >> 7;
-                    srcG = ((fogG * density) + (srcG * (128-density))) >> 7;
-                    srcB = ((fogB * density) + (srcB * (128-density))) >> 7;
-                }
+    auto fogpixels = [&](u32 pixeladdr, __m128i mask)
+    {
+        __m128i srccolor = _mm_loadu_si128((__m128i*)&ColorBuffer[pixeladdr]);
+        __m128i density = CalculateFogDensity4(gpu3d, _mm_loadu_si128((__m128i*)&DepthBuffer[pixeladdr]));
 
-                srcA = ((fogA * density) + (srcA * (128-density))) >> 7;
+        __m128i densitylo, densityhi;
+        SpreadPixelWeights(density, densitylo, densityhi);
+        __m128i dstcolor = BlendColors4<7>(fogcolors, _mm_and_si128(srccolor, channelmask),
+                                           _mm_and_si128(densitylo, weightmask), _mm_and_si128(densityhi, weightmask));
 
-                ColorBuffer[pixeladdr] = srcR | (srcG << 8) | (srcB << 16) | (srcA << 24);
-            }
+        dstcolor = _mm_or_si128(_mm_and_si128(mask, dstcolor), _mm_andnot_si128(mask, srccolor));
+        _mm_storeu_si128((__m128i*)&ColorBuffer[pixeladdr], dstcolor);
+    };
 
-            // fog for lower pixel
-            // TODO: make this code nicer, but avoid using a loop
+    for (; x + 4 <= ScreenWidth; x += 4)
+    {
+        u32 pixeladdr = lineaddr + x;
 
-            if (!(attr & 0xF)) continue;
-            pixeladdr += BufferSize;
+        __m128i attr = _mm_loadu_si128((__m128i*)&AttrBuffer[pixeladdr]);
+        __m128i top = _mm_cmpeq_epi32(_mm_and_si128(attr, fogflag), fogflag);
 
-            attr = AttrBuffer[pixeladdr];
-            if (!(attr & (1<<15))) continue;
+        // fog for lower pixel
+        __m128i lowerattr = _mm_loadu_si128((__m128i*)&AttrBuffer[pixeladdr + BufferSize]);
+        __m128i lower = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(attr, _mm_set1_epi32(0xF)), zero),
+                                         _mm_cmpeq_epi32(_mm_and_si128(lowerattr, fogflag), fogflag));
 
-            density = CalculateFogDensity(gpu3d, pixeladdr);
+        if (_mm_movemask_ps(_mm_castsi128_ps(top)))
+            fogpixels(pixeladdr, top);
+        if (_mm_movemask_ps(_mm_castsi128_ps(lower)))
+            fogpixels(pixeladdr + BufferSize, lower);
+    }
+#elif defined(MELONDS_SIMD_NEON)
+    const uint32x4_t fogflag = vdupq_n_u32(1<<15);
+    const uint32x4_t fogcolors = vdupq_n_u32(fogR | (fogG << 8) | (fogB << 16) | (fogA << 24));
+    const uint32x4_t channelmask = vdupq_n_u32(0x1F3F3F3F);
+    // without the fog color, only the alpha channel is blended
+    const uint16x8_t weightmask = vreinterpretq_u16_u64(vdupq_n_u64(fogcolor ? ~0ULL : 0xFFFF000000000000ULL));
+
+    auto fogpixels = [&](u32 pixeladdr, uint32x4_t mask)
+    {
+        uint32x4_t srccolor = vld1q_u32(&ColorBuffer[pixeladdr]);
+        uint32x4_t density = CalculateFogDensity4(gpu3d, vld1q_u32(&DepthBuffer[pixeladdr]));
 
-            srccolor = ColorBuffer[pixeladdr];
-            srcR = srccolor & 0x3F;
-            srcG = (srccolor >> 8) & 0x3F;
-            srcB = (srccolor >> 16) & 0x3F;
-            srcA = (srccolor >> 24) & 0x1F;
+        uint16x8_t densitylo, densityhi;
+        SpreadPixelWeights(density, densitylo, densityhi);
+        uint32x4_t dstcolor = BlendColors4<7>(fogcolors, vandq_u32(srccolor, channelmask),
+                                              vandq_u16(densitylo, weightmask), vandq_u16(densityhi, weightmask));
 
-            if (fogcolor)
-            {
-                srcR = ((fogR * density) + (srcR * (128-density))) >> 7;
-                srcG = ((fogG * density) + (srcG * (128-density))) >> 7;
-                srcB = ((fogB * density) + (srcB * (128-density))) >> 7;
-            }
+        vst1q_u32(&ColorBuffer[pixeladdr], vbslq_u32(mask, dstcolor, srccolor));
+    };
 
-            srcA = ((fogA * density) + (srcA * (128-density))) >> 7;
+    for (; x + 4 <= ScreenWidth; x += 4)
+    {
+        u32 pixeladdr = lineaddr + x;
 
-            ColorBuffer[pixeladdr] = srcR | (srcG << 8) | (srcB << 16) | (srcA << 24);
-        }
+        uint32x4_t attr = vld1q_u32(&AttrBuffer[pixeladdr]);
+        uint32x4_t top = vtstq_u32(attr, fogflag);
+
+        // fog for lower pixel
+        uint32x4_t lowerattr = vld1q_u32(&AttrBuffer[pixeladdr + BufferSize]);
+        uint32x4_t lower = vandq_u32(vtstq_u32(attr, vdupq_n_u32(0xF)), vtstq_u32(lowerattr, fogflag));
+
+        if (vmaxvq_u32(top))
+            fogpixels(pixeladdr, top);
+        if (vmaxvq_u32(lower))
+            fogpixels(pixeladdr + BufferSize, lower);
     }
+#endif
 
-    if (gpu3d.RenderDispCnt & (1<<4))
+    auto fogpixel = [&](u32 pixeladdr)
     {
-        // anti-aliasing
+        u32 density = CalculateFogDensity(gpu3d, pixeladdr);
 
-        // edges were flagged and their coverages calculated during rendering
-        // this is where such edge pixels are blended with the pixels underneath
+        u32 srccolor = ColorBuffer[pixeladdr];
+        u32 srcR = srccolor & 0x3F;
+        u32 srcG = (srccolor >> 8) & 0x3F;
+        u32 srcB = (srccolor >> 16) & 0x3F;
+        u32 srcA = (srccolor >> 24) & 0x1F;
 
-        for (int x = 0; x < 256; x++)
+        if (fogcolor)
         {
-            u32 pixeladdr = FirstPixelOffset + (y*ScanlineWidth) + x;
+            srcR = ((fogR * density) + (srcR * (128-density))) >> 7;
+            srcG = ((fogG * density) + (srcG * (128-density))) >> 7;
+            srcB = ((fogB * density) + (srcB * (128-density))) >> 7;
+        }
 
-            u32 attr = AttrBuffer[pixeladdr];
-            if (!(attr & 0xF)) continue;
+        srcA = ((fogA * density) + (srcA * (128-density))) >> 7;
 
-            u32 coverage = (attr >> 8) & 0x1F;
-            if (coverage == 0x1F) continue;
+        ColorBuffer[pixeladdr] = srcR | (srcG << 8) | (srcB << 16) | (srcA << 24);
+    };
 
-            if (coverage == 0)
-            {
-                ColorBuffer[pixeladdr] = ColorBuffer[pixeladdr+BufferSize];
-                continue;
-            }
+    for (; x < ScreenWidth; x++)
+    {
+        u32 pixeladdr = lineaddr + x;
 
-            u32 topcolor = ColorBuffer[pixeladdr];
-            u32 topR = topcolor & 0x3F;
-            u32 topG = (topcolor >> 8) & 0x3F;
-            u32 topB = (topcolor >> 16) & 0x3F;
-            u32 topA = (topcolor >> 24) & 0x1F;
+        u32 attr = AttrBuffer[pixeladdr];
+        if (attr & (1<<15))
+            fogpixel(pixeladdr);
 
-            u32 botcolor = ColorBuffer[pixeladdr+BufferSize];
-            u32 botR = botcolor & 0x3F;
-            u32 botG = (botcolor >> 8) & 0x3F;
-            u32 botB = (botcolor >> 16) & 0x3F;
-            u32 botA = (botcolor >> 24) & 0x1F;
+        // fog for lower pixel
+        if (!(attr & 0xF)) continue;
+        pixeladdr += BufferSize;
 
-            coverage++;
+        if (AttrBuffer[pixeladdr] & (1<<15))
+            fogpixel(pixeladdr);
+    }
+}
 
-            // only blend color if the bottom pixel isn't fully transparent
-            if (botA > 0)
-            {
-                topR = ((topR * coverage) + (botR * (32-coverage))) >> 5;
-                topG = ((topG * coverage) + (botG * (32-coverage))) >> 5;
-                topB = ((topB * coverage) + (botB * (32-coverage))) >> 5;
-            }
+void SoftRenderer::AntialiasScanline(u32 lineaddr)
+{
+    // anti-aliasing
+
+    // edges were flagged and their coverages calculated during rendering
+    // this is where such edge pixels are blended with the pixels underneath
+
+    s32 x = 0;
+
+#if defined(MELONDS_SIMD_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i channelmask = _mm_set1_epi32(0x1F3F3F3F);
+    const __m128i colormask = _mm_set1_epi64x(0x0000FFFFFFFFFFFF);
+    for (; x + 4 <= ScreenWidth; x += 4)
+    {
+        u32 pixeladdr = lineaddr + x;
+
+        __m128i attr = _mm_loadu_si128((__m128i*)&AttrBuffer[pixeladdr]);
+        __m128i coverage = _mm_and_si128(_mm_srli_epi32(attr, 8), _mm_set1_epi32(0x1F));
+        // edge pixels that aren't fully covered
+        __m128i blend = _mm_andnot_si128(_mm_or_si128(_mm_cmpeq_epi32(_mm_and_si128(attr, _mm_set1_epi32(0xF)), zero),
+                                                      _mm_cmpeq_epi32(coverage, _mm_set1_epi32(0x1F))),
+                                         _mm_set1_epi32(-1));
+        if (_mm_movemask_ps(_mm_castsi128_ps(blend)) == 0)
+            continue;
+
+        __m128i topcolor = _mm_loadu_si128((__m128i*)&ColorBuffer[pixeladdr]);
+        __m128i botcolor = _mm_loadu_si128((__m128i*)&ColorBuffer[pixeladdr + BufferSize]);
+
+        __m128i weightlo, weighthi, botclearlo, botclearhi;
+        SpreadPixelWeights(_mm_add_epi32(coverage, _mm_set1_epi32(1)), weightlo, weighthi);
+
+        // only blend color if the bottom pixel isn't fully transparent
+        // alpha is always blended
+        __m128i botclear = _mm_cmpeq_epi32(_mm_and_si128(botcolor, _mm_set1_epi32(0x1F000000)), zero);
+        SpreadPixelWeights(botclear, botclearlo, botclearhi);
+        botclearlo = _mm_and_si128(botclearlo, colormask);
+        botclearhi = _mm_and_si128(botclearhi, colormask);
+        weightlo = _mm_or_si128(_mm_andnot_si128(botclearlo, weightlo), _mm_and_si128(botclearlo, _mm_set1_epi16(32)));
+        weighthi = _mm_or_si128(_mm_andnot_si128(botclearhi, weighthi), _mm_and_si128(botclearhi, _mm_set1_epi16(32)));
+
+        __m128i dstcolor = BlendColors4<5>(_mm_and_si128(topcolor, channelmask), _mm_and_si128(botcolor, channelmask), weightlo, weighthi);
+
+        // pixels with no coverage are replaced with the one underneath
+        __m128i nocoverage = _mm_cmpeq_epi32(coverage, zero);
+        dstcolor = _mm_or_si128(_mm_andnot_si128(nocoverage, dstcolor), _mm_and_si128(nocoverage, botcolor));
+
+        dstcolor = _mm_or_si128(_mm_and_si128(blend, dstcolor), _mm_andnot_si128(blend, topcolor));
+        _mm_storeu_si128((__m128i*)&ColorBuffer[pixeladdr], dstcolor);
+    }
+#elif defined(MELONDS_SIMD_NEON)
+    const uint32x4_t channelmask = vdupq_n_u32(0x1F3F3F3F);
+    const uint16x8_t colormask = vreinterpretq_u16_u64(vdupq_n_u64(0x0000FFFFFFFFFFFFULL));
+    for (; x + 4 <= ScreenWidth; x += 4)
+    {
+        u32 pixeladdr = lineaddr + x;
+
+        uint32x4_t attr = vld1q_u32(&AttrBuffer[pixeladdr]);
+        uint32x4_t coverage = vandq_u32(vshrq_n_u32(attr, 8), vdupq_n_u32(0x1F));
+        // edge pixels that aren't fully covered
+        uint32x4_t blend = vbicq_u32(vtstq_u32(attr, vdupq_n_u32(0xF)), vceqq_u32(coverage, vdupq_n_u32(0x1F)));
+        if (!vmaxvq_u32(blend))
+            continue;
+
+        uint32x4_t topcolor = vld1q_u32(&ColorBuffer[pixeladdr]);
+        uint32x4_t botcolor = vld1q_u32(&ColorBuffer[pixeladdr + BufferSize]);
+
+        uint16x8_t weightlo, weighthi, botclearlo, botclearhi;
+        SpreadPixelWeights(vaddq_u32(coverage, vdupq_n_u32(1)), weightlo, weighthi);
+
+        // only blend color if the bottom pixel isn't fully transparent
+        // alpha is always blended
+        uint32x4_t botclear = vceqq_u32(vandq_u32(botcolor, vdupq_n_u32(0x1F000000)), vdupq_n_u32(0));
+        SpreadPixelWeights(botclear, botclearlo, botclearhi);
+        weightlo = vbslq_u16(vandq_u16(botclearlo, colormask), vdupq_n_u16(32), weightlo);
+        weighthi = vbslq_u16(vandq_u16(botclearhi, colormask), vdupq_n_u16(32), weighthi);
+
+        uint32x4_t dstcolor = BlendColors4<5>(vandq_u32(topcolor, channelmask), vandq_u32(botcolor, channelmask), weightlo, weighthi);
+
+        // pixels with no coverage are replaced with the one underneath
+        dstcolor = vbslq_u32(vceqq_u32(coverage, vdupq_n_u32(0)), botcolor, dstcolor);
+
+        vst1q_u32(&ColorBuffer[pixeladdr], vbslq_u32(blend, dstcolor, topcolor));
+    }
+#endif
+
+    for (; x < ScreenWidth; x++)
+    {
+        u32 pixeladdr = lineaddr + x;
+
+        u32 attr = AttrBuffer[pixeladdr];
+        if (!(attr & 0xF)) continue;
 
-            // alpha is always blended
-            topA = ((topA * coverage) + (botA * (32-coverage))) >> 5;
+        u32 coverage = (attr >> 8) & 0x1F;
+        if (coverage == 0x1F) continue;
 
-            ColorBuffer[pixeladdr] = topR | (topG << 8) | (topB << 16) | (topA << 24);
+        if (coverage == 0)
+        {
+            ColorBuffer[pixeladdr] = ColorBuffer[pixeladdr+BufferSize];
+            continue;
+        }
+
+        u32 topcolor = ColorBuffer[pixeladdr];
+        u32 topR = topcolor & 0x3F;
+        u32 topG = (topcolor >> 8) & 0x3F;
+        u32 topB = (topcolor >> 16) & 0x3F;
+        u32 topA = (topcolor >> 24) & 0x1F;
+
+        u32 botcolor = ColorBuffer[pixeladdr+BufferSize];
+        u32 botR = botcolor & 0x3F;
+        u32 botG = (botcolor >> 8) & 0x3F;
+        u32 botB = (botcolor >> 16) & 0x3F;
+        u32 botA = (botcolor >> 24) & 0x1F;
+
+        coverage++;
+
+        // only blend color if the bottom pixel isn't fully transparent
+        if (botA > 0)
+        {
+            topR = ((topR * coverage) + (botR * (32-coverage))) >> 5;
+            topG = ((topG * coverage) + (botG * (32-coverage))) >> 5;
+            topB = ((topB * coverage) + (botB * (32-coverage))) >> 5;
         }
+
+        // alpha is always blended
+        topA = ((topA * coverage) + (botA * (32-coverage))) >> 5;
+
+        ColorBuffer[pixeladdr] = topR | (topG << 8) | (topB << 16) | (topA << 24);
     }
 }
 
+void SoftRenderer::ScanlineFinalPass(const GPU3D& gpu3d, s32 y)
+{
+    // the passes each go over the whole scanline, in chunks of 4 pixels where possible
+
+    u32 lineaddr = FirstPixelOffset + (y*ScanlineWidth);
+
+    if (gpu3d.RenderDispCnt & (1<<5))
+        EdgeMarkScanline(gpu3d, lineaddr);
+
+    if (gpu3d.RenderDispCnt & (1<<7))
+        FogScanline(gpu3d, lineaddr);
+
+    if (gpu3d.RenderDispCnt & (1<<4))
+        AntialiasScanline(lineaddr);
+}
+
 void SoftRenderer::ClearBuffers(const GPU& gpu)
 {
     u32 clearz = ((gpu.GPU3D.RenderClearAttr2 & 0x7FFF) * 0x200) + 0x1FF;
@@ -1631,17 +2582,17 @@ void SoftRenderer::ClearBuffers(const GPU& gpu)
         AttrBuffer[x] = polyid;
     }
 
-    for (int x = ScanlineWidth; x < ScanlineWidth*193; x+=ScanlineWidth)
+    for (int x = ScanlineWidth; x < ScanlineWidth*(NumScanlines-1); x+=ScanlineWidth)
     {
         ColorBuffer[x] = 0;
         DepthBuffer[x] = clearz;
         AttrBuffer[x] = polyid;
-        ColorBuffer[x+257] = 0;
-        DepthBuffer[x+257] = clearz;
-        AttrBuffer[x+257] = polyid;
+        ColorBuffer[x+ScanlineWidth-1] = 0;
+        DepthBuffer[x+ScanlineWidth-1] = clearz;
+        AttrBuffer[x+ScanlineWidth-1] = polyid;
     }
 
-    for (int x = ScanlineWidth*193; x < ScanlineWidth*194; x++)
+    for (int x = ScanlineWidth*(NumScanlines-1); x < ScanlineWidth*NumScanlines; x++)
     {
         ColorBuffer[x] = 0;
         DepthBuffer[x] = clearz;
@@ -1655,12 +2606,17 @@ void SoftRenderer::ClearBuffers(const GPU& gpu)
         u8 xoff = (gpu.GPU3D.RenderClearAttr2 >> 16) & 0xFF;
         u8 yoff = (gpu.GPU3D.RenderClearAttr2 >> 24) & 0xFF;
 
-        for (int y = 0; y < ScanlineWidth*192; y+=ScanlineWidth)
+        // above the native resolution, each clear image texel covers several pixels
+        for (int y = 0; y < ScreenHeight; y++)
         {
+            u8 ty = yoff + (y / ScaleFactor);
+            u8 tx = xoff;
+            u32 pixeladdr = FirstPixelOffset + (y * ScanlineWidth);
+
             for (int x = 0; x < 256; x++)
             {
-                u16 val2 = ReadVRAM_Texture<u16>(0x40000 + (yoff << 9) + (xoff << 1), gpu);
-                u16 val3 = ReadVRAM_Texture<u16>(0x60000 + (yoff << 9) + (xoff << 1), gpu);
+                u16 val2 = ReadVRAM_Texture<u16>(0x40000 + (ty << 9) + (tx << 1), gpu);
+                u16 val3 = ReadVRAM_Texture<u16>(0x60000 + (ty << 9) + (tx << 1), gpu);
 
                 // TODO: confirm color conversion
                 u32 r = (val2 << 1) & 0x3E; if (r) r++;
@@ -1671,15 +2627,16 @@ void SoftRenderer::ClearBuffers(const GPU& gpu)
 
                 u32 z = ((val3 & 0x7FFF) * 0x200) + 0x1FF;
 
-                u32 pixeladdr = FirstPixelOffset + y + x;
-                ColorBuffer[pixeladdr] = color;
-                DepthBuffer[pixeladdr] = z;
-                AttrBuffer[pixeladdr] = polyid | (val3 & 0x8000);
+                for (int i = 0; i < ScaleFactor; i++)
+                {
+                    ColorBuffer[pixeladdr] = color;
+                    DepthBuffer[pixeladdr] = z;
+                    AttrBuffer[pixeladdr] = polyid | (val3 & 0x8000);
+                    pixeladdr++;
+                }
 
-                xoff++;
+                tx++;
             }
-
-            yoff++;
         }
     }
     else
@@ -1693,9 +2650,9 @@ void SoftRenderer::ClearBuffers(const GPU& gpu)
 
         polyid |= (gpu.GPU3D.RenderClearAttr1 & 0x8000);
 
-        for (int y = 0; y < ScanlineWidth*192; y+=ScanlineWidth)
+        for (int y = 0; y < ScanlineWidth*ScreenHeight; y+=ScanlineWidth)
         {
-            for (int x = 0; x < 256; x++)
+            for (int x = 0; x < ScreenWidth; x++)
             {
                 u32 pixeladdr = FirstPixelOffset + y + x;
                 ColorBuffer[pixeladdr] = color;
@@ -1708,26 +2665,52 @@ void SoftRenderer::ClearBuffers(const GPU& gpu)
 
 void SoftRenderer::RenderPolygons(const GPU& gpu, bool threaded, Polygon** polygons, int npolys)
 {
+    CurStats = {};
+    u64 time = Platform::GetUSCount();
+
+    ClearBuffers(gpu);
+
     int j = 0;
     for (int i = 0; i < npolys; i++)
     {
         if (polygons[i]->Degenerate) continue;
-        SetupPolygon(&PolygonList[j++], polygons[i]);
+        SetupPolygon(&PolygonList[j], polygons[i]);
+        SetupPolygonTexture(gpu, &PolygonList[j]);
+        if (polygons[i]->IsShadowMask || polygons[i]->IsShadow)
+            CurStats.ShadowPolygons++;
+        j++;
     }
 
+    CurStats.PolygonsRendered = j;
+
+    // phase times are accumulated per scanline, as rasterization and the final pass are interleaved
+    u64 now = Platform::GetUSCount();
+    CurStats.SetupTime = now - time;
+    time = now;
+
     RenderScanline(gpu, 0, j);
 
-    for (s32 y = 1; y < 192; y++)
+    for (s32 y = 1; y < ScreenHeight; y++)
     {
         RenderScanline(gpu, y, j);
+
+        now = Platform::GetUSCount();
+        CurStats.RasterTime += now - time;
+        time = now;
+
         ScanlineFinalPass(gpu.GPU3D, y-1);
 
+        now = Platform::GetUSCount();
+        CurStats.FinalPassTime += now - time;
+        time = now;
+
         if (threaded)
             // Notify the main thread that we're done with a scanline.
             Platform::Semaphore_Post(Sema_ScanlineCount);
     }
 
-    ScanlineFinalPass(gpu.GPU3D, 191);
+    ScanlineFinalPass(gpu.GPU3D, ScreenHeight-1);
+    CurStats.FinalPassTime += Platform::GetUSCount() - time;
 
     if (threaded)
         // If this renderer is threaded, notify the main thread that we're done with the frame.
@@ -1736,19 +2719,25 @@ void SoftRenderer::RenderPolygons(const GPU& gpu, bool threaded, Polygon** polyg
 
 void SoftRenderer::VCount144(GPU& gpu)
 {
-    if (RenderThreadRunning.load(std::memory_order_relaxed) && !gpu.GPU3D.AbortFrame)
+    if (RenderThreadRunning.load(std::memory_order_relaxed))
+    {
+        // an aborted frame may still be being rendered
+        if (gpu.GPU3D.AbortFrame)
+            return;
+
         Platform::Semaphore_Wait(Sema_RenderDone);
+    }
+
+    // the render thread is done with the frame, so its statistics can be published
+    Stats = CurStats;
 }
 
 void SoftRenderer::RenderFrame(GPU& gpu)
 {
-    auto textureDirty = gpu.VRAMDirty_Texture.DeriveState(gpu.VRAMMap_Texture, gpu);
-    auto texPalDirty = gpu.VRAMDirty_TexPal.DeriveState(gpu.VRAMMap_TexPal, gpu);
-
-    bool textureChanged = gpu.MakeVRAMFlat_TextureCoherent(textureDirty);
-    bool texPalChanged = gpu.MakeVRAMFlat_TexPalCoherent(texPalDirty);
+    // this also makes the flat texture VRAM coherent
+    bool texturesChanged = Texcache.Update(gpu);
 
-    FrameIdentical = !(textureChanged || texPalChanged) && gpu.GPU3D.RenderFrameIdentical;
+    FrameIdentical = !texturesChanged && gpu.GPU3D.RenderFrameIdentical;
 
     if (RenderThreadRunning.load(std::memory_order_relaxed))
     {
@@ -1757,7 +2746,6 @@ void SoftRenderer::RenderFrame(GPU& gpu)
     }
     else if (!FrameIdentical)
     {
-        ClearBuffers(gpu);
         RenderPolygons(gpu, false, &gpu.GPU3D.RenderPolygonRAM[0], gpu.GPU3D.RenderNumPolygons);
     }
 }
@@ -1785,11 +2773,10 @@ void SoftRenderer::RenderThreadFunc(GPU& gpu)
         RenderThreadRendering = true;
         if (FrameIdentical)
         { // If no rendering is needed, just say we're done.
-            Platform::Semaphore_Post(Sema_ScanlineCount, 192);
+            Platform::Semaphore_Post(Sema_ScanlineCount, ScreenHeight);
         }
         else
         {
-            ClearBuffers(gpu);
             RenderPolygons(gpu, true, &gpu.GPU3D.RenderPolygonRAM[0], gpu.GPU3D.RenderNumPolygons);
         }
 
@@ -1806,12 +2793,30 @@ u32* SoftRenderer::GetLine(int line)
     if (RenderThreadRunning.load(std::memory_order_relaxed))
     {
         if (line < 192)
+        {
             // We need a scanline, so let's wait for the render thread to finish it.
             // (both threads process scanlines from top-to-bottom,
             // so we don't need to wait for a specific row)
-            Platform::Semaphore_Wait(Sema_ScanlineCount);
+            // Above the native resolution, a scanline is made of several rows.
+            for (int i = 0; i < ScaleFactor; i++)
+                Platform::Semaphore_Wait(Sema_ScanlineCount);
+        }
     }
 
+    if (ScaleFactor == 1)
+        return &ColorBuffer[(line * ScanlineWidth) + FirstPixelOffset];
+
+    // point-sample the scaled output for display capture
+    const u32* src = &ColorBuffer[(line * ScaleFactor * ScanlineWidth) + FirstPixelOffset];
+    for (int x = 0; x < 256; x++)
+        NativeLine[x] = src[x * ScaleFactor];
+
+    return NativeLine;
+}
+
+u32* SoftRenderer::GetScaledLine(int line)
+{
+    // the rows of a scanline are all ready once GetLine() returned it
     return &ColorBuffer[(line * ScanlineWidth) + FirstPixelOffset];
 }
 
@@ -20,9 +20,11 @@
 
 #include "GPU.h"
 #include "GPU3D.h"
+#include "GPU3D_TexcacheSoft.h"
 #include "Platform.h"
 #include <thread>
 #include <atomic>
+#include <memory>
 
 namespace melonDS
 {
@@ -36,10 +38,17 @@ public:
     void SetThreaded(bool threaded, GPU& gpu) noexcept;
     [[nodiscard]] bool IsThreaded() const noexcept { return Threaded; }
 
+    // renders at an integer multiple of the native resolution (1 to GPU3D::MaxFramebufferScale),
+    // optionally using the vertices' subpixel positions instead of snapping them to native pixels
+    void SetRenderSettings(int scale, bool highResolutionCoordinates, GPU& gpu) noexcept;
+    [[nodiscard]] int GetScaleFactor() const noexcept { return ScaleFactor; }
+
     void VCount144(GPU& gpu) override;
     void RenderFrame(GPU& gpu) override;
     void RestartFrame(GPU& gpu) override;
     u32* GetLine(int line) override;
+    int GetFramebufferScale() const override { return ScaleFactor; }
+    u32* GetScaledLine(int line) override;
 
     void SetupRenderThread(GPU& gpu);
     void EnableRenderThread();
@@ -142,6 +151,17 @@ private:
             }
         }
 
+        // same as SetX(), with a factor precomputed by InterpolateSpan()
+        constexpr void SetX(s32 x, u32 factor)
+        {
+            this->x = x - x0;
+            this->yfactor = factor;
+        }
+
+        // computes the factors and Z values for pixels xstart to xend-1 in one go
+        // results are stored at index x in the output arrays
+        void InterpolateSpan(s32 xstart, s32 xend, s32 z0, s32 z1, bool wbuffer, u32* factors, s32* zs) const;
+
         constexpr s32 Interpolate(s32 y0, s32 y1) const
         {
             if (xdiff == 0 || y0 == y1) return y0;
@@ -452,39 +472,65 @@ private:
         u32 CurVL, CurVR;
         u32 NextVL, NextVR;
 
+        // decoded texture, if the polygon's texture can be sampled from the cache
+        const u32* TexData;
+
+        // vertex positions and bounds at the internal resolution
+        s32 Positions[10][2];
+        u32 VTop, VBottom;
+        s32 YTop, YBottom;
     };
 
     RendererPolygon PolygonList[2048];
     void TextureLookup(const GPU& gpu, u32 texparam, u32 texpal, s16 s, s16 t, u16* color, u8* alpha) const;
-    u32 RenderPixel(const GPU& gpu, const Polygon* polygon, u8 vr, u8 vg, u8 vb, s16 s, s16 t) const;
+    u32 CachedTextureLookup(const u32* texdata, u32 texparam, s16 s, s16 t) const;
+    u32 RenderPixel(const GPU& gpu, const RendererPolygon* rp, u8 vr, u8 vg, u8 vb, s16 s, s16 t) const;
     void PlotTranslucentPixel(const GPU3D& gpu3d, u32 pixeladdr, u32 color, u32 z, u32 polyattr, u32 shadow);
     void SetupPolygonLeftEdge(RendererPolygon* rp, s32 y) const;
     void SetupPolygonRightEdge(RendererPolygon* rp, s32 y) const;
     void SetupPolygon(RendererPolygon* rp, Polygon* polygon) const;
+    void SetupPolygonTexture(const GPU& gpu, RendererPolygon* rp);
+    void DepthTestSpan(int depthtest, s32 y, s32 xstart, s32 xend);
+    bool CoarseDepthTestSpan(const Interpolator<0>& interpX, int depthtest, s32 y, s32 xstart, s32 xend, s32 zl, s32 zr, bool wbuffer, s32 zreject);
+    void UpdateCoarseDepth(s32 y, s32 xstart, s32 xend);
     void RenderShadowMaskScanline(const GPU3D& gpu3d, RendererPolygon* rp, s32 y);
     void RenderPolygonScanline(const GPU& gpu, RendererPolygon* rp, s32 y);
     void RenderScanline(const GPU& gpu, s32 y, int npolys);
     u32 CalculateFogDensity(const GPU3D& gpu3d, u32 pixeladdr) const;
+    void EdgeMarkScanline(const GPU3D& gpu3d, u32 lineaddr);
+    void FogScanline(const GPU3D& gpu3d, u32 lineaddr);
+    void AntialiasScanline(u32 lineaddr);
     void ScanlineFinalPass(const GPU3D& gpu3d, s32 y);
     void ClearBuffers(const GPU& gpu);
+    void SetupBuffers();
     void RenderPolygons(const GPU& gpu, bool threaded, Polygon** polygons, int npolys);
 
     void RenderThreadFunc(GPU& gpu);
 
-    // buffer dimensions are 258x194 to add a offscreen 1px border
+    // internal resolution
+    // polygons are rasterized with the same rules as at the native resolution,
+    // with their vertex positions scaled up
+    int ScaleFactor = 1;
+    bool HiresCoordinates = false;
+    int ScreenWidth, ScreenHeight;
+
+    // buffer dimensions are 258x194 (at 1x) to add a offscreen 1px border
     // which simplifies edge marking tests
     // buffer is duplicated to keep track of the two topmost pixels
     // TODO: check if the hardware can accidentally plot pixels
     // offscreen in that border
 
-    static constexpr int ScanlineWidth = 258;
-    static constexpr int NumScanlines = 194;
-    static constexpr int BufferSize = ScanlineWidth * NumScanlines;
-    static constexpr int FirstPixelOffset = ScanlineWidth + 1;
+    int ScanlineWidth;
+    int NumScanlines;
+    int BufferSize;
+    int FirstPixelOffset;
 
-    u32 ColorBuffer[BufferSize * 2];
-    u32 DepthBuffer[BufferSize * 2];
-    u32 AttrBuffer[BufferSize * 2];
+    std::unique_ptr<u32[]> ColorBuffer;
+    std::unique_ptr<u32[]> DepthBuffer;
+    std::unique_ptr<u32[]> AttrBuffer;
+
+    // GetLine() output when rendering above the native resolution
+    u32 NativeLine[256];
 
     // attribute buffer:
     // bit0-3: edge flags (left/right/top/bottom)
@@ -495,13 +541,33 @@ private:
     // bit22: translucent flag
     // bit24-29: polygon ID for opaque pixels
 
-    u8 StencilBuffer[256*2];
+    // per-scanline scratch buffers for the span kernels
+    // padded so the kernels can always process whole vectors
+    alignas(16) u32 SpanFactor[256*GPU3D::MaxFramebufferScale + 8];
+    alignas(16) s32 SpanZ[256*GPU3D::MaxFramebufferScale + 8];
+    u8 SpanDepthPass[256*GPU3D::MaxFramebufferScale + 8];
+
+    // coarse depth buffer for the scanline being rendered
+    // holds the farthest depth of the topmost pixels of each 8-pixel tile (plus one
+    // for opaque back facing pixels, which equal depths pass over when front facing),
+    // or INT32_MAX if any of them is an edge (the pixel underneath can then be drawn over)
+    // spans that are entirely behind it are skipped without being interpolated
+    static constexpr int CoarseTileShift = 3;
+    s32 CoarseDepth[(256*GPU3D::MaxFramebufferScale) >> CoarseTileShift];
+
+    // statistics for the frame being rendered, only touched by the thread rendering it
+    // they're published to Stats in VCount144, once the emulation thread has waited for the frame
+    RenderStats CurStats {};
+
+    u8 StencilBuffer[256*GPU3D::MaxFramebufferScale * 2];
     bool PrevIsShadowMask;
 
     bool Enabled;
 
     bool FrameIdentical;
 
+    TexcacheSoft Texcache;
+
     // threading
 
     bool Threaded = false;
@@ -1,56 +1,9 @@
 #include "GPU3D_Texcache.h"
+#include "SIMD.h"
 
 namespace melonDS
 {
 
-inline u16 ColorAvg(u16 color0, u16 color1)
-{
-    u32 r0 = color0 & 0x001F;
-    u32 g0 = color0 & 0x03E0;
-    u32 b0 = color0 & 0x7C00;
-    u32 r1 = color1 & 0x001F;
-    u32 g1 = color1 & 0x03E0;
-    u32 b1 = color1 & 0x7C00;
-
-    u32 r = (r0 + r1) >> 1;
-    u32 g = ((g0 + g1) >> 1) & 0x03E0;
-    u32 b = ((b0 + b1) >> 1) & 0x7C00;
-
-    return r | g | b;
-}
-
-inline u16 Color5of3(u16 color0, u16 color1)
-{
-    u32 r0 = color0 & 0x001F;
-    u32 g0 = color0 & 0x03E0;
-    u32 b0 = color0 & 0x7C00;
-    u32 r1 = color1 & 0x001F;
-    u32 g1 = color1 & 0x03E0;
-    u32 b1 = color1 & 0x7C00;
-
-    u32 r = (r0*5 + r1*3) >> 3;
-    u32 g = ((g0*5 + g1*3) >> 3) & 0x03E0;
-    u32 b = ((b0*5 + b1*3) >> 3) & 0x7C00;
-
-    return r | g | b;
-}
-
-inline u16 Color3of5(u16 color0, u16 color1)
-{
-    u32 r0 = color0 & 0x001F;
-    u32 g0 = color0 & 0x03E0;
-    u32 b0 = color0 & 0x7C00;
-    u32 r1 = color1 & 0x001F;
-    u32 g1 = color1 & 0x03E0;
-    u32 b1 = color1 & 0x7C00;
-
-    u32 r = (r0*3 + r1*5) >> 3;
-    u32 g = ((g0*3 + g1*5) >> 3) & 0x03E0;
-    u32 b = ((b0*3 + b1*5) >> 3) & 0x7C00;
-
-    return r | g | b;
-}
-
 inline u32 ConvertRGB5ToRGB8(u16 val)
 {
     return (((u32)val & 0x1F) << 3)
@@ -59,9 +12,9 @@ inline u32 ConvertRGB5ToRGB8(u16 val)
 }
 inline u32 ConvertRGB5ToBGR8(u16 val)
 {
-    return (((u32)val & 0x1F) << 9)
+    return (((u32)val & 0x1F) << 19)
         | (((u32)val & 0x3E0) << 6)
-        | (((u32)val & 0x7C00) << 3);
+        | (((u32)val & 0x7C00) >> 7);
 }
 inline u32 ConvertRGB5ToRGB6(u16 val)
 {
@@ -74,196 +27,523 @@ inline u32 ConvertRGB5ToRGB6(u16 val)
     return (u32)r | ((u32)g << 8) | ((u32)b << 16);
 }
 
+// converts a RGB555 color and a 5-bit alpha to the output format
+template <int outputFmt>
+inline u32 ConvertColor(u16 color, u32 alpha)
+{
+    if (outputFmt == outputFmt_RGB6A5)
+        return ConvertRGB5ToRGB6(color) | alpha << 24;
+
+    // make sure full alpha == 255
+    if (outputFmt == outputFmt_RGBA8)
+        return ConvertRGB5ToRGB8(color) | (alpha << 27 | (alpha & 0x1C) << 22);
+    else
+        return ConvertRGB5ToBGR8(color) | (alpha << 27 | (alpha & 0x1C) << 22);
+}
+
+// the vectorised conversions work on 8 colors at the time, in 16-bit lanes:
+// each channel is isolated, scaled to the output precision and the result
+// is assembled as two 16-bit halves which are then interleaved.
+#if defined(MELONDS_SIMD_SSE2)
+template <int outputFmt>
+inline void ConvertColors8(u32* output, __m128i color, __m128i alpha)
+{
+    const __m128i mask = _mm_set1_epi16(0x1F);
+    __m128i r = _mm_and_si128(color, mask);
+    __m128i g = _mm_and_si128(_mm_srli_epi16(color, 5), mask);
+    __m128i b = _mm_and_si128(_mm_srli_epi16(color, 10), mask);
+
+    if (outputFmt == outputFmt_RGB6A5)
+    {
+        // non-zero components get one added, cmpgt yields -1 for them
+        const __m128i zero = _mm_setzero_si128();
+        r = _mm_sub_epi16(_mm_slli_epi16(r, 1), _mm_cmpgt_epi16(r, zero));
+        g = _mm_sub_epi16(_mm_slli_epi16(g, 1), _mm_cmpgt_epi16(g, zero));
+        b = _mm_sub_epi16(_mm_slli_epi16(b, 1), _mm_cmpgt_epi16(b, zero));
+    }
+    else
+    {
+        r = _mm_slli_epi16(r, 3);
+        g = _mm_slli_epi16(g, 3);
+        b = _mm_slli_epi16(b, 3);
+        alpha = _mm_or_si128(_mm_slli_epi16(alpha, 3), _mm_srli_epi16(alpha, 2));
+
+        if (outputFmt == outputFmt_BGRA8)
+            std::swap(r, b);
+    }
+
+    __m128i lo = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    __m128i hi = _mm_or_si128(b, _mm_slli_epi16(alpha, 8));
+    _mm_storeu_si128((__m128i*)&output[0], _mm_unpacklo_epi16(lo, hi));
+    _mm_storeu_si128((__m128i*)&output[4], _mm_unpackhi_epi16(lo, hi));
+}
+
+// alpha taken from bit 15 of each color
+template <int outputFmt>
+inline void ConvertColors8A1(u32* output, __m128i color)
+{
+    __m128i alpha = _mm_and_si128(_mm_srai_epi16(color, 15), _mm_set1_epi16(0x1F));
+    ConvertColors8<outputFmt>(output, color, alpha);
+}
+#elif defined(MELONDS_SIMD_NEON)
+template <int outputFmt>
+inline void ConvertColors8(u32* output, uint16x8_t color, uint16x8_t alpha)
+{
+    const uint16x8_t mask = vdupq_n_u16(0x1F);
+    uint16x8_t r = vandq_u16(color, mask);
+    uint16x8_t g = vandq_u16(vshrq_n_u16(color, 5), mask);
+    uint16x8_t b = vandq_u16(vshrq_n_u16(color, 10), mask);
+
+    if (outputFmt == outputFmt_RGB6A5)
+    {
+        // non-zero components get one added, the comparison yields all ones for them
+        r = vsubq_u16(vshlq_n_u16(r, 1), vtstq_u16(r, r));
+        g = vsubq_u16(vshlq_n_u16(g, 1), vtstq_u16(g, g));
+        b = vsubq_u16(vshlq_n_u16(b, 1), vtstq_u16(b, b));
+    }
+    else
+    {
+        r = vshlq_n_u16(r, 3);
+        g = vshlq_n_u16(g, 3);
+        b = vshlq_n_u16(b, 3);
+        alpha = vorrq_u16(vshlq_n_u16(alpha, 3), vshrq_n_u16(alpha, 2));
+
+        if (outputFmt == outputFmt_BGRA8)
+            std::swap(r, b);
+    }
+
+    uint16x8_t lo = vorrq_u16(r, vshlq_n_u16(g, 8));
+    uint16x8_t hi = vorrq_u16(b, vshlq_n_u16(alpha, 8));
+    vst1q_u32(&output[0], vreinterpretq_u32_u16(vzip1q_u16(lo, hi)));
+    vst1q_u32(&output[4], vreinterpretq_u32_u16(vzip2q_u16(lo, hi)));
+}
+
+// alpha taken from bit 15 of each color
+template <int outputFmt>
+inline void ConvertColors8A1(u32* output, uint16x8_t color)
+{
+    uint16x8_t alpha = vandq_u16(vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(color), 15)), vdupq_n_u16(0x1F));
+    ConvertColors8<outputFmt>(output, color, alpha);
+}
+#endif
+
+// converts count colors with their alpha taken from bit 15, count has to be a multiple of 8
+template <int outputFmt>
+void ConvertColorsA1(u32* output, const u16* colors, u32 count)
+{
+#if defined(MELONDS_SIMD_SSE2)
+    for (u32 i = 0; i < count; i += 8)
+        ConvertColors8A1<outputFmt>(&output[i], _mm_loadu_si128((const __m128i*)&colors[i]));
+#elif defined(MELONDS_SIMD_NEON)
+    for (u32 i = 0; i < count; i += 8)
+        ConvertColors8A1<outputFmt>(&output[i], vld1q_u16(&colors[i]));
+#else
+    for (u32 i = 0; i < count; i++)
+        output[i] = ConvertColor<outputFmt>(colors[i], (colors[i] & 0x8000) ? 0x1F : 0);
+#endif
+}
+
+// same with separate 5-bit alpha values
+template <int outputFmt>
+void ConvertColorsA5(u32* output, const u16* colors, const u16* alphas, u32 count)
+{
+#if defined(MELONDS_SIMD_SSE2)
+    for (u32 i = 0; i < count; i += 8)
+        ConvertColors8<outputFmt>(&output[i],
+            _mm_loadu_si128((const __m128i*)&colors[i]),
+            _mm_loadu_si128((const __m128i*)&alphas[i]));
+#elif defined(MELONDS_SIMD_NEON)
+    for (u32 i = 0; i < count; i += 8)
+        ConvertColors8<outputFmt>(&output[i], vld1q_u16(&colors[i]), vld1q_u16(&alphas[i]));
+#else
+    for (u32 i = 0; i < count; i++)
+        output[i] = ConvertColor<outputFmt>(colors[i], alphas[i]);
+#endif
+}
+
+// looks up 16 texels from 16 palette indices (0-15) in a converted palette,
+// stored as four byte planes so that each plane is a single byte shuffle.
+#if defined(MELONDS_SIMD_SSSE3)
+struct PalettePlanes
+{
+    __m128i Plane[4];
+
+    PalettePlanes(const u32* palette)
+    {
+        // gather byte n of each entry into plane n
+        const __m128i transpose = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+        __m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&palette[0]), transpose);
+        __m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&palette[4]), transpose);
+        __m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&palette[8]), transpose);
+        __m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&palette[12]), transpose);
+        __m128i t0 = _mm_unpacklo_epi32(p0, p1);
+        __m128i t1 = _mm_unpacklo_epi32(p2, p3);
+        __m128i t2 = _mm_unpackhi_epi32(p0, p1);
+        __m128i t3 = _mm_unpackhi_epi32(p2, p3);
+        Plane[0] = _mm_unpacklo_epi64(t0, t1);
+        Plane[1] = _mm_unpackhi_epi64(t0, t1);
+        Plane[2] = _mm_unpacklo_epi64(t2, t3);
+        Plane[3] = _mm_unpackhi_epi64(t2, t3);
+    }
+
+    void Lookup16(u32* output, __m128i indices) const
+    {
+        __m128i b0 = _mm_shuffle_epi8(Plane[0], indices);
+        __m128i b1 = _mm_shuffle_epi8(Plane[1], indices);
+        __m128i b2 = _mm_shuffle_epi8(Plane[2], indices);
+        __m128i b3 = _mm_shuffle_epi8(Plane[3], indices);
+        __m128i lo01 = _mm_unpacklo_epi8(b0, b1);
+        __m128i hi01 = _mm_unpackhi_epi8(b0, b1);
+        __m128i lo23 = _mm_unpacklo_epi8(b2, b3);
+        __m128i hi23 = _mm_unpackhi_epi8(b2, b3);
+        _mm_storeu_si128((__m128i*)&output[0], _mm_unpacklo_epi16(lo01, lo23));
+        _mm_storeu_si128((__m128i*)&output[4], _mm_unpackhi_epi16(lo01, lo23));
+        _mm_storeu_si128((__m128i*)&output[8], _mm_unpacklo_epi16(hi01, hi23));
+        _mm_storeu_si128((__m128i*)&output[12], _mm_unpackhi_epi16(hi01, hi23));
+    }
+};
+#elif defined(MELONDS_SIMD_NEON)
+struct PalettePlanes
+{
+    uint8x16_t Plane[4];
+
+    PalettePlanes(const u32* palette)
+    {
+        uint8x16x4_t planes = vld4q_u8((const u8*)palette);
+        Plane[0] = planes.val[0];
+        Plane[1] = planes.val[1];
+        Plane[2] = planes.val[2];
+        Plane[3] = planes.val[3];
+    }
+
+    void Lookup16(u32* output, uint8x16_t indices) const
+    {
+        uint8x16x4_t res;
+        res.val[0] = vqtbl1q_u8(Plane[0], indices);
+        res.val[1] = vqtbl1q_u8(Plane[1], indices);
+        res.val[2] = vqtbl1q_u8(Plane[2], indices);
+        res.val[3] = vqtbl1q_u8(Plane[3], indices);
+        vst4q_u8((u8*)output, res);
+    }
+};
+#endif
+
 template <int outputFmt>
-void ConvertBitmapTexture(u32 width, u32 height, u32* output, u8* texData)
+void ConvertBitmapTexture(u32 width, u32 height, u32* output, const u8* texData)
+{
+    ConvertColorsA1<outputFmt>(output, (const u16*)texData, width*height);
+}
+
+template void ConvertBitmapTexture<outputFmt_RGB6A5>(u32 width, u32 height, u32* output, const u8* texData);
+
+// computes the third and fourth color of 8 compressed texture blocks at once,
+// color2/color3 come in holding the palette colors for the modes which use them
+inline void InterpolateBlockColors8(const u16* color0, const u16* color1, u16* color2, u16* color3, const u16* mode)
 {
-    for (u32 i = 0; i < width*height; i++)
+#if defined(MELONDS_SIMD_SSE2)
+    const __m128i mask = _mm_set1_epi16(0x1F);
+    __m128i c0 = _mm_loadu_si128((const __m128i*)color0);
+    __m128i c1 = _mm_loadu_si128((const __m128i*)color1);
+    __m128i m = _mm_loadu_si128((const __m128i*)mode);
+    __m128i r0 = _mm_and_si128(c0, mask);
+    __m128i g0 = _mm_and_si128(_mm_srli_epi16(c0, 5), mask);
+    __m128i b0 = _mm_and_si128(_mm_srli_epi16(c0, 10), mask);
+    __m128i r1 = _mm_and_si128(c1, mask);
+    __m128i g1 = _mm_and_si128(_mm_srli_epi16(c1, 5), mask);
+    __m128i b1 = _mm_and_si128(_mm_srli_epi16(c1, 10), mask);
+
+    auto combine = [](__m128i r, __m128i g, __m128i b)
+    {
+        return _mm_or_si128(_mm_or_si128(r, _mm_slli_epi16(g, 5)),
+            _mm_or_si128(_mm_slli_epi16(b, 10), _mm_set1_epi16((s16)0x8000)));
+    };
+    auto mix = [](__m128i a, __m128i b)
+    {
+        return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(a, _mm_set1_epi16(5)), _mm_mullo_epi16(b, _mm_set1_epi16(3))), 3);
+    };
+
+    __m128i avg = combine(_mm_srli_epi16(_mm_add_epi16(r0, r1), 1),
+        _mm_srli_epi16(_mm_add_epi16(g0, g1), 1),
+        _mm_srli_epi16(_mm_add_epi16(b0, b1), 1));
+    __m128i mix53 = combine(mix(r0, r1), mix(g0, g1), mix(b0, b1));
+    __m128i mix35 = combine(mix(r1, r0), mix(g1, g0), mix(b1, b0));
+
+    __m128i mode1 = _mm_cmpeq_epi16(m, _mm_set1_epi16(1));
+    __m128i mode3 = _mm_cmpeq_epi16(m, _mm_set1_epi16(3));
+    __m128i c2 = _mm_loadu_si128((const __m128i*)color2);
+    __m128i c3 = _mm_loadu_si128((const __m128i*)color3);
+    c2 = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(mode1, mode3), c2),
+        _mm_or_si128(_mm_and_si128(mode1, avg), _mm_and_si128(mode3, mix53)));
+    c3 = _mm_or_si128(_mm_andnot_si128(mode3, c3), _mm_and_si128(mode3, mix35));
+    _mm_storeu_si128((__m128i*)color2, c2);
+    _mm_storeu_si128((__m128i*)color3, c3);
+#elif defined(MELONDS_SIMD_NEON)
+    const uint16x8_t mask = vdupq_n_u16(0x1F);
+    uint16x8_t c0 = vld1q_u16(color0);
+    uint16x8_t c1 = vld1q_u16(color1);
+    uint16x8_t m = vld1q_u16(mode);
+    uint16x8_t r0 = vandq_u16(c0, mask);
+    uint16x8_t g0 = vandq_u16(vshrq_n_u16(c0, 5), mask);
+    uint16x8_t b0 = vandq_u16(vshrq_n_u16(c0, 10), mask);
+    uint16x8_t r1 = vandq_u16(c1, mask);
+    uint16x8_t g1 = vandq_u16(vshrq_n_u16(c1, 5), mask);
+    uint16x8_t b1 = vandq_u16(vshrq_n_u16(c1, 10), mask);
+
+    auto combine = [](uint16x8_t r, uint16x8_t g, uint16x8_t b)
+    {
+        return vorrq_u16(vorrq_u16(r, vshlq_n_u16(g, 5)), vorrq_u16(vshlq_n_u16(b, 10), vdupq_n_u16(0x8000)));
+    };
+    auto mix = [](uint16x8_t a, uint16x8_t b)
     {
-        u16 value = *(u16*)&texData[i * 2];
+        return vshrq_n_u16(vmlaq_n_u16(vmulq_n_u16(a, 5), b, 3), 3);
+    };
+
+    uint16x8_t avg = combine(vhaddq_u16(r0, r1), vhaddq_u16(g0, g1), vhaddq_u16(b0, b1));
+    uint16x8_t mix53 = combine(mix(r0, r1), mix(g0, g1), mix(b0, b1));
+    uint16x8_t mix35 = combine(mix(r1, r0), mix(g1, g0), mix(b1, b0));
+
+    uint16x8_t mode1 = vceqq_u16(m, vdupq_n_u16(1));
+    uint16x8_t mode3 = vceqq_u16(m, vdupq_n_u16(3));
+    uint16x8_t c2 = vbslq_u16(mode1, avg, vld1q_u16(color2));
+    c2 = vbslq_u16(mode3, mix53, c2);
+    uint16x8_t c3 = vbslq_u16(mode3, mix35, vld1q_u16(color3));
+    vst1q_u16(color2, c2);
+    vst1q_u16(color3, c3);
+#else
+    for (int i = 0; i < 8; i++)
+    {
+        u32 r0 = color0[i] & 0x1F, g0 = (color0[i] >> 5) & 0x1F, b0 = (color0[i] >> 10) & 0x1F;
+        u32 r1 = color1[i] & 0x1F, g1 = (color1[i] >> 5) & 0x1F, b1 = (color1[i] >> 10) & 0x1F;
 
-        switch (outputFmt)
+        if (mode[i] == 1)
+        {
+            color2[i] = ((r0 + r1) >> 1)
+                | (((g0 + g1) >> 1) << 5)
+                | (((b0 + b1) >> 1) << 10) | 0x8000;
+        }
+        else if (mode[i] == 3)
         {
-        case outputFmt_RGB6A5:
-            output[i] = ConvertRGB5ToRGB6(value) | (value & 0x8000 ? 0x1F000000 : 0);
-            break;
-        case outputFmt_RGBA8:
-            output[i] = ConvertRGB5ToRGB8(value) | (value & 0x8000 ? 0xFF000000 : 0);
-            break;
-        case outputFmt_BGRA8:
-            output[i] = ConvertRGB5ToBGR8(value) | (value & 0x8000 ? 0xFF000000 : 0);
-            break;
+            color2[i] = ((r0*5 + r1*3) >> 3)
+                | (((g0*5 + g1*3) >> 3) << 5)
+                | (((b0*5 + b1*3) >> 3) << 10) | 0x8000;
+            color3[i] = ((r0*3 + r1*5) >> 3)
+                | (((g0*3 + g1*5) >> 3) << 5)
+                | (((b0*3 + b1*5) >> 3) << 10) | 0x8000;
         }
     }
+#endif
 }
 
-template void ConvertBitmapTexture<outputFmt_RGB6A5>(u32 width, u32 height, u32* output, u8* texData);
-
 template <int outputFmt>
-void ConvertCompressedTexture(u32 width, u32 height, u32* output, u8* texData, u8* texAuxData, u16* palData)
+void ConvertCompressedTexture(u32 width, u32 height, u32* output, const u8* texData, const u8* texAuxData, const u16* palData)
 {
-    // we process a whole block at the time
-    for (int y = 0; y < height / 4; y++)
+    // blocks are decoded 8 at the time along each row of blocks:
+    // their four colors are computed and converted together,
+    // then each block's texels are picked from its converted colors
+    u32 blocksPerRow = width / 4;
+
+    for (u32 y = 0; y < height / 4; y++)
     {
-        for (int x = 0; x < width / 4; x++)
+        for (u32 x = 0; x < blocksPerRow; x += 8)
         {
-            u32 data = ((u32*)texData)[x + y * (width / 4)];
-            u16 auxData = ((u16*)texAuxData)[x + y * (width / 4)];
+            u32 numBlocks = std::min(blocksPerRow - x, 8u);
+            u32 blockIdx = x + y * blocksPerRow;
 
-            u32 paletteOffset = auxData & 0x3FFF;
-            u16 color0 = palData[paletteOffset*2] | 0x8000;
-            u16 color1 = palData[paletteOffset*2+1] | 0x8000;
-            u16 color2, color3;
+            alignas(16) u16 colors[4][8] {};
+            alignas(16) u16 modes[8] {};
 
-            switch ((auxData >> 14) & 0x3)
+            for (u32 i = 0; i < numBlocks; i++)
             {
-            case 0:
-                color2 = palData[paletteOffset*2+2] | 0x8000;
-                color3 = 0;
-                break;
-            case 1:
-                {
-                    u32 r0 = color0 & 0x001F;
-                    u32 g0 = color0 & 0x03E0;
-                    u32 b0 = color0 & 0x7C00;
-                    u32 r1 = color1 & 0x001F;
-                    u32 g1 = color1 & 0x03E0;
-                    u32 b1 = color1 & 0x7C00;
-
-                    u32 r = (r0 + r1) >> 1;
-                    u32 g = ((g0 + g1) >> 1) & 0x03E0;
-                    u32 b = ((b0 + b1) >> 1) & 0x7C00;
-                    color2 = r | g | b | 0x8000;
-                }
-                color3 = 0;
-                break;
-            case 2:
-                color2 = palData[paletteOffset*2+2] | 0x8000;
-                color3 = palData[paletteOffset*2+3] | 0x8000;
-                break;
-            case 3:
-                {
-                    u32 r0 = color0 & 0x001F;
-                    u32 g0 = color0 & 0x03E0;
-                    u32 b0 = color0 & 0x7C00;
-                    u32 r1 = color1 & 0x001F;
-                    u32 g1 = color1 & 0x03E0;
-                    u32 b1 = color1 & 0x7C00;
-
-                    u32 r = (r0*5 + r1*3) >> 3;
-                    u32 g = ((g0*5 + g1*3) >> 3) & 0x03E0;
-                    u32 b = ((b0*5 + b1*3) >> 3) & 0x7C00;
-
-                    color2 = r | g | b | 0x8000;
-                }
-                {
-                    u32 r0 = color0 & 0x001F;
-                    u32 g0 = color0 & 0x03E0;
-                    u32 b0 = color0 & 0x7C00;
-                    u32 r1 = color1 & 0x001F;
-                    u32 g1 = color1 & 0x03E0;
-                    u32 b1 = color1 & 0x7C00;
-
-                    u32 r = (r0*3 + r1*5) >> 3;
-                    u32 g = ((g0*3 + g1*5) >> 3) & 0x03E0;
-                    u32 b = ((b0*3 + b1*5) >> 3) & 0x7C00;
-
-                    color3 = r | g | b | 0x8000;
-                }
-                break;
+                u16 auxData = ((const u16*)texAuxData)[blockIdx + i];
+
+                u32 paletteOffset = auxData & 0x3FFF;
+                u32 mode = (auxData >> 14) & 0x3;
+                modes[i] = mode;
+                colors[0][i] = palData[paletteOffset*2] | 0x8000;
+                colors[1][i] = palData[paletteOffset*2+1] | 0x8000;
+                if (!(mode & 1))
+                    colors[2][i] = palData[paletteOffset*2+2] | 0x8000;
+                if (mode == 2)
+                    colors[3][i] = palData[paletteOffset*2+3] | 0x8000;
             }
 
-            // in 2020 our default data types are big enough to be used as lookup tables...
-            u64 packed = color0 | ((u64)color1 << 16) | ((u64)color2 << 32) | ((u64)color3 << 48);
+            InterpolateBlockColors8(colors[0], colors[1], colors[2], colors[3], modes);
+
+            alignas(16) u32 converted[4][8];
+            ConvertColorsA1<outputFmt>(&converted[0][0], &colors[0][0], 4*8);
 
-            for (int j = 0; j < 4; j++)
+            for (u32 i = 0; i < numBlocks; i++)
             {
-                for (int i = 0; i < 4; i++)
+                u32 data = ((const u32*)texData)[blockIdx + i];
+                u32* dst = &output[(x + i) * 4 + y * 4 * width];
+
+                for (int j = 0; j < 4; j++)
                 {
-                    u16 color = (packed >> 16 * (data >> 2 * (i + j * 4))) & 0xFFFF;
-                    u32 res;
-                    switch (outputFmt)
-                    {
-                    case outputFmt_RGB6A5: res = ConvertRGB5ToRGB6(color)
-                        | ((color & 0x8000) ? 0x1F000000 : 0); break;
-                    case outputFmt_RGBA8: res = ConvertRGB5ToRGB8(color)
-                        | ((color & 0x8000) ? 0xFF000000 : 0); break;
-                    case outputFmt_BGRA8: res = ConvertRGB5ToBGR8(color)
-                        | ((color & 0x8000) ? 0xFF000000 : 0); break;
-                    }
-                    output[x * 4 + i + (y * 4 + j) * width] = res;
+                    dst[0] = converted[(data >> 0) & 0x3][i];
+                    dst[1] = converted[(data >> 2) & 0x3][i];
+                    dst[2] = converted[(data >> 4) & 0x3][i];
+                    dst[3] = converted[(data >> 6) & 0x3][i];
+                    data >>= 8;
+                    dst += width;
                 }
             }
         }
     }
 }
 
-template void ConvertCompressedTexture<outputFmt_RGB6A5>(u32, u32, u32*, u8*, u8*, u16*);
+template void ConvertCompressedTexture<outputFmt_RGB6A5>(u32, u32, u32*, const u8*, const u8*, const u16*);
 
 template <int outputFmt, int X, int Y>
-void ConvertAXIYTexture(u32 width, u32 height, u32* output, u8* texData, u16* palData)
+void ConvertAXIYTexture(u32 width, u32 height, u32* output, const u8* texData, const u16* palData)
 {
-    for (int y = 0; y < height; y++)
-    {
-        for (int x = 0; x < width; x++)
-        {
-            u8 val = texData[x + y * width];
+    // the palette colors and alpha levels are converted separately first,
+    // so that each texel only needs to combine two table entries
+    constexpr u32 numColors = 1 << Y;
+    constexpr u32 numAlphas = 1 << X;
 
-            u32 idx = val & ((1 << Y) - 1);
+    alignas(16) u16 colors[numColors];
+    alignas(16) u16 zero[numColors] {};
+    for (u32 i = 0; i < numColors; i++)
+        colors[i] = palData[i];
 
-            u16 color = palData[idx];
-            u32 alpha = (val >> Y) & ((1 << X) - 1);
-            if (X != 5)
-                alpha = alpha * 4 + alpha / 2;
+    alignas(16) u32 colorTable[numColors];
+    ConvertColorsA5<outputFmt>(colorTable, colors, zero, numColors);
 
-            u32 res;
-            switch (outputFmt)
-            {
-            case outputFmt_RGB6A5: res = ConvertRGB5ToRGB6(color) | alpha << 24; break;
-            // make sure full alpha == 255
-            case outputFmt_RGBA8: res = ConvertRGB5ToRGB8(color) | (alpha << 27 | (alpha & 0x1C) << 22); break;
-            case outputFmt_BGRA8: res = ConvertRGB5ToBGR8(color) | (alpha << 27 | (alpha & 0x1C) << 22); break;
-            }
-            output[x + y * width] = res;
+    u32 alphaTable[numAlphas];
+    for (u32 i = 0; i < numAlphas; i++)
+    {
+        u32 alpha = i;
+        if (X != 5)
+            alpha = alpha * 4 + alpha / 2;
+
+        alphaTable[i] = ConvertColor<outputFmt>(0, alpha);
+    }
+
+    u32 numTexels = width*height;
+    if (numTexels < 256)
+    {
+        for (u32 i = 0; i < numTexels; i++)
+        {
+            u8 val = texData[i];
+            output[i] = colorTable[val & (numColors - 1)] | alphaTable[val >> Y];
         }
+        return;
     }
+
+    // for larger textures it pays off to combine them into a single table
+    u32 lut[256];
+    for (u32 val = 0; val < 256; val++)
+        lut[val] = colorTable[val & (numColors - 1)] | alphaTable[val >> Y];
+
+    for (u32 i = 0; i < numTexels; i++)
+        output[i] = lut[texData[i]];
 }
 
-template void ConvertAXIYTexture<outputFmt_RGB6A5, 5, 3>(u32, u32, u32*, u8*, u16*);
-template void ConvertAXIYTexture<outputFmt_RGB6A5, 3, 5>(u32, u32, u32*, u8*, u16*);
+template void ConvertAXIYTexture<outputFmt_RGB6A5, 5, 3>(u32, u32, u32*, const u8*, const u16*);
+template void ConvertAXIYTexture<outputFmt_RGB6A5, 3, 5>(u32, u32, u32*, const u8*, const u16*);
 
 template <int outputFmt, int colorBits>
-void ConvertNColorsTexture(u32 width, u32 height, u32* output, u8* texData, u16* palData, bool color0Transparent)
+void ConvertNColorsTexture(u32 width, u32 height, u32* output, const u8* texData, const u16* palData, bool color0Transparent)
 {
-    for (int y = 0; y < height; y++)
+    constexpr u32 numColors = 1 << colorBits;
+
+    // convert the palette first, the transparent color goes in with its alpha bit cleared.
+    // the table always holds at least 16 entries so that it can be used for shuffles
+    constexpr u32 tableSize = std::max(numColors, 16u);
+    alignas(16) u16 colors[tableSize] {};
+    for (u32 i = 0; i < numColors; i++)
+        colors[i] = palData[i] | 0x8000;
+    if (color0Transparent)
+        colors[0] &= 0x7FFF;
+
+    alignas(16) u32 palette[tableSize];
+    ConvertColorsA1<outputFmt>(palette, colors, tableSize);
+
+    u32 numTexels = width*height;
+
+    if (colorBits == 8)
     {
-        for (int x = 0; x < width / (8 / colorBits); x++)
-        {
-            u8 val = texData[x + y * (width / (8 / colorBits))];
+        for (u32 i = 0; i < numTexels; i++)
+            output[i] = palette[texData[i]];
+        return;
+    }
 
-            for (int i = 0; i < 8 / colorBits; i++)
-            {
-                u32 index = (val >> (i * colorBits)) & ((1 << colorBits) - 1);
-                u16 color = palData[index];
+#if defined(MELONDS_SIMD_SSSE3) || defined(MELONDS_SIMD_NEON)
+    if (colorBits == 2)
+    {
+        // for 2-bit indices the table lookup is done on 4-bit values:
+        // each texel's bit pair is masked in place, and the pairs in the
+        // upper nibbles are shifted down. This leaves even texels with their
+        // index and odd texels with their index << 2, both map to the same color.
+        for (u32 i = 4; i < 16; i += 4)
+            palette[i] = palette[i >> 2];
+    }
 
-                bool transparent = color0Transparent && index == 0;
-                u32 res;
-                switch (outputFmt)
-                {
-                case outputFmt_RGB6A5: res = ConvertRGB5ToRGB6(color)
-                    | (transparent ? 0 : 0x1F000000); break;
-                case outputFmt_RGBA8: res = ConvertRGB5ToRGB8(color)
-                    | (transparent ? 0 : 0xFF000000); break;
-                case outputFmt_BGRA8: res = ConvertRGB5ToBGR8(color)
-                    | (transparent ? 0 : 0xFF000000); break;
-                }
-                output[x * (8 / colorBits) + y * width + i] = res;
-            }
+    PalettePlanes planes(palette);
+#endif
+
+#if defined(MELONDS_SIMD_SSSE3)
+    if (colorBits == 4)
+    {
+        const __m128i mask = _mm_set1_epi8(0x0F);
+        for (u32 i = 0; i < numTexels; i += 16)
+        {
+            __m128i data = _mm_loadl_epi64((const __m128i*)&texData[i / 2]);
+            __m128i lo = _mm_and_si128(data, mask);
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(data, 4), mask);
+            planes.Lookup16(&output[i], _mm_unpacklo_epi8(lo, hi));
         }
     }
+    else
+    {
+        const __m128i spread = _mm_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3);
+        const __m128i fields = _mm_set1_epi32(0xC0300C03);
+        const __m128i mask = _mm_set1_epi8(0x0F);
+        for (u32 i = 0; i < numTexels; i += 16)
+        {
+            __m128i data = _mm_cvtsi32_si128(*(const s32*)&texData[i / 4]);
+            data = _mm_and_si128(_mm_shuffle_epi8(data, spread), fields);
+            data = _mm_and_si128(_mm_or_si128(data, _mm_srli_epi16(data, 4)), mask);
+            planes.Lookup16(&output[i], data);
+        }
+    }
+#elif defined(MELONDS_SIMD_NEON)
+    if (colorBits == 4)
+    {
+        const uint8x8_t mask = vdup_n_u8(0x0F);
+        for (u32 i = 0; i < numTexels; i += 16)
+        {
+            uint8x8_t data = vld1_u8(&texData[i / 2]);
+            uint8x8x2_t split = vzip_u8(vand_u8(data, mask), vshr_n_u8(data, 4));
+            planes.Lookup16(&output[i], vcombine_u8(split.val[0], split.val[1]));
+        }
+    }
+    else
+    {
+        const uint8x16_t spread = {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3};
+        const uint8x16_t fields = vreinterpretq_u8_u32(vdupq_n_u32(0xC0300C03));
+        const uint8x16_t mask = vdupq_n_u8(0x0F);
+        for (u32 i = 0; i < numTexels; i += 16)
+        {
+            uint8x16_t data = vreinterpretq_u8_u32(vdupq_n_u32(*(const u32*)&texData[i / 4]));
+            data = vandq_u8(vqtbl1q_u8(data, spread), fields);
+            data = vandq_u8(vorrq_u8(data, vshrq_n_u8(data, 4)), mask);
+            planes.Lookup16(&output[i], data);
+        }
+    }
+#else
+    for (u32 i = 0; i < numTexels / (8 / colorBits); i++)
+    {
+        u8 val = texData[i];
+
+        for (u32 j = 0; j < 8 / colorBits; j++)
+            output[i * (8 / colorBits) + j] = palette[(val >> (j * colorBits)) & (numColors - 1)];
+    }
+#endif
 }
 
-template void ConvertNColorsTexture<outputFmt_RGB6A5, 2>(u32, u32, u32*, u8*, u16*, bool);
-template void ConvertNColorsTexture<outputFmt_RGB6A5, 4>(u32, u32, u32*, u8*, u16*, bool);
-template void ConvertNColorsTexture<outputFmt_RGB6A5, 8>(u32, u32, u32*, u8*, u16*, bool);
+template void ConvertNColorsTexture<outputFmt_RGB6A5, 2>(u32, u32, u32*, const u8*, const u16*, bool);
+template void ConvertNColorsTexture<outputFmt_RGB6A5, 4>(u32, u32, u32*, const u8*, const u16*, bool);
+template void ConvertNColorsTexture<outputFmt_RGB6A5, 8>(u32, u32, u32*, const u8*, const u16*, bool);
 
-}
\ No newline at end of file
+}
@@ -5,7 +5,7 @@
 #include "GPU.h"
 
 #include <assert.h>
-#include <unordered_map>
+#include <algorithm>
 #include <vector>
 
 #define XXH_STATIC_LINKING_ONLY
@@ -32,13 +32,13 @@ enum
 };
 
 template <int outputFmt>
-void ConvertBitmapTexture(u32 width, u32 height, u32* output, u8* texData);
+void ConvertBitmapTexture(u32 width, u32 height, u32* output, const u8* texData);
 template <int outputFmt>
-void ConvertCompressedTexture(u32 width, u32 height, u32* output, u8* texData, u8* texAuxData, u16* palData);
+void ConvertCompressedTexture(u32 width, u32 height, u32* output, const u8* texData, const u8* texAuxData, const u16* palData);
 template <int outputFmt, int X, int Y>
-void ConvertAXIYTexture(u32 width, u32 height, u32* output, u8* texData, u16* palData);
+void ConvertAXIYTexture(u32 width, u32 height, u32* output, const u8* texData, const u16* palData);
 template <int outputFmt, int colorBits>
-void ConvertNColorsTexture(u32 width, u32 height, u32* output, u8* texData, u16* palData, bool color0Transparent);
+void ConvertNColorsTexture(u32 width, u32 height, u32* output, const u8* texData, const u16* palData, bool color0Transparent);
 
 template <typename TexLoaderT, typename TexHandleT>
 class Texcache
@@ -58,58 +58,35 @@ public:
 
         if (textureChanged || texPalChanged)
         {
-            //printf("check invalidation %d\n", TexCache.size());
-            for (auto it = Cache.begin(); it != Cache.end();)
+            // only look at the entries which overlap a dirty block
+            CurCheckStamp++;
+            Invalidated.clear();
+
+            if (textureChanged)
             {
-                TexCacheEntry& entry = it->second;
-                if (textureChanged)
+                for (auto it = textureDirty.Begin(); it != textureDirty.End(); it++)
                 {
-                    for (u32 i = 0; i < 2; i++)
-                    {
-                        u32 startBit = entry.TextureRAMStart[i] / VRAMDirtyGranularity;
-                        u32 bitsCount = ((entry.TextureRAMStart[i] + entry.TextureRAMSize[i] + VRAMDirtyGranularity - 1) / VRAMDirtyGranularity) - startBit;
-
-                        u32 startEntry = startBit >> 6;
-                        u64 entriesCount = ((startBit + bitsCount + 0x3F) >> 6) - startEntry;
-                        for (u32 j = startEntry; j < startEntry + entriesCount; j++)
-                        {
-                            if (GetRangedBitMask(j, startBit, bitsCount) & textureDirty.Data[j])
-                            {
-                                u64 newTexHash = XXH3_64bits(&gpu.VRAMFlat_Texture[entry.TextureRAMStart[i]], entry.TextureRAMSize[i]);
-
-                                if (newTexHash != entry.TextureHash[i])
-                                    goto invalidate;
-                            }
-                        }
-                    }
+                    for (u32 idx : TextureBlockEntries[*it])
+                        CheckEntry(gpu, idx, textureChanged, textureDirty, texPalChanged, texPalDirty);
                 }
-
-                if (texPalChanged && entry.TexPalSize > 0)
+            }
+            if (texPalChanged)
+            {
+                for (auto it = texPalDirty.Begin(); it != texPalDirty.End(); it++)
                 {
-                    u32 startBit = entry.TexPalStart / VRAMDirtyGranularity;
-                    u32 bitsCount = ((entry.TexPalStart + entry.TexPalSize + VRAMDirtyGranularity - 1) / VRAMDirtyGranularity) - startBit;
-
-                    u32 startEntry = startBit >> 6;
-                    u64 entriesCount = ((startBit + bitsCount + 0x3F) >> 6) - startEntry;
-                    for (u32 j = startEntry; j < startEntry + entriesCount; j++)
-                    {
-                        if (GetRangedBitMask(j, startBit, bitsCount) & texPalDirty.Data[j])
-                        {
-                            u64 newPalHash = XXH3_64bits(&gpu.VRAMFlat_TexPal[entry.TexPalStart], entry.TexPalSize);
-                            if (newPalHash != entry.TexPalHash)
-                                goto invalidate;
-                        }
-                    }
+                    for (u32 idx : TexPalBlockEntries[*it])
+                        CheckEntry(gpu, idx, textureChanged, textureDirty, texPalChanged, texPalDirty);
                 }
+            }
 
-                it++;
-                continue;
-            invalidate:
+            for (u32 idx : Invalidated)
+            {
+                TexCacheEntry& entry = Entries[idx];
                 FreeTextures[entry.WidthLog2][entry.HeightLog2].push_back(entry.Texture);
 
                 //printf("invalidating texture %d\n", entry.ImageDescriptor);
 
-                it = Cache.erase(it);
+                RemoveEntry(idx);
             }
 
             return true;
@@ -118,7 +95,7 @@ public:
         return false;
     }
 
-    void GetTexture(GPU& gpu, u32 texParam, u32 palBase, TexHandleT& textureHandle, u32& layer, u32*& helper)
+    void GetTexture(const GPU& gpu, u32 texParam, u32 palBase, TexHandleT& textureHandle, u32& layer, u32*& helper)
     {
         // remove sampling and texcoord gen params
         texParam &= ~0xC00F0000;
@@ -135,13 +112,14 @@ public:
 
         assert(fmt != 0 && "no texture is not a texture format!");
 
-        auto it = Cache.find(key);
+        u32 found = FindEntry(key);
 
-        if (it != Cache.end())
+        if (found != InvalidEntry)
         {
-            textureHandle = it->second.Texture.TextureID;
-            layer = it->second.Texture.Layer;
-            helper = &it->second.LastVariant;
+            TexCacheEntry& cached = Entries[found];
+            textureHandle = cached.Texture.TextureID;
+            layer = cached.Texture.Layer;
+            helper = &cached.LastVariant;
             return;
         }
 
@@ -154,6 +132,7 @@ public:
 
         TexCacheEntry entry = {0};
 
+        entry.Key = key;
         entry.TextureRAMStart[0] = addr;
         entry.WidthLog2 = widthLog2;
         entry.HeightLog2 = heightLog2;
@@ -167,13 +146,13 @@ public:
         }
         else if (fmt == 5)
         {
-            u8* texData = &gpu.VRAMFlat_Texture[addr];
+            const u8* texData = &gpu.VRAMFlat_Texture[addr];
             u32 slot1addr = 0x20000 + ((addr & 0x1FFFC) >> 1);
             if (addr >= 0x40000)
                 slot1addr += 0x10000;
-            u8* texAuxData = &gpu.VRAMFlat_Texture[slot1addr];
+            const u8* texAuxData = &gpu.VRAMFlat_Texture[slot1addr];
 
-            u16* palData = (u16*)(gpu.VRAMFlat_TexPal + palBase*16);
+            const u16* palData = (const u16*)(gpu.VRAMFlat_TexPal + palBase*16);
 
             entry.TextureRAMSize[0] = width*height/16*4;
             entry.TextureRAMStart[1] = slot1addr;
@@ -204,8 +183,8 @@ public:
             entry.TexPalStart = palAddr;
             entry.TexPalSize = numPalEntries*2;
 
-            u8* texData = &gpu.VRAMFlat_Texture[addr];
-            u16* palData = (u16*)(gpu.VRAMFlat_TexPal + palAddr);
+            const u8* texData = &gpu.VRAMFlat_Texture[addr];
+            const u16* palData = (const u16*)(gpu.VRAMFlat_TexPal + palAddr);
 
             //assert(entry.TexPalStart+entry.TexPalSize <= 128*1024*1024);
 
@@ -259,7 +238,7 @@ public:
 
         textureHandle = storagePlace.TextureID;
         layer = storagePlace.Layer;
-        helper = &Cache.emplace(std::make_pair(key, entry)).first->second.LastVariant;
+        helper = &Entries[AddEntry(entry)].LastVariant;
     }
 
     void Reset()
@@ -274,7 +253,14 @@ public:
                 FreeTextures[i][j].clear();
             }
         }
-        Cache.clear();
+
+        Slots.clear();
+        Entries.clear();
+        FreeEntries.clear();
+        for (auto& blockEntries : TextureBlockEntries)
+            blockEntries.clear();
+        for (auto& blockEntries : TexPalBlockEntries)
+            blockEntries.clear();
     }
 private:
     struct TexArrayEntry
@@ -287,6 +273,9 @@ private:
     {
         u32 LastVariant; // very cheap way to make variant lookup faster
 
+        u64 Key;
+        u32 CheckStamp;
+
         u32 TextureRAMStart[2], TextureRAMSize[2];
         u32 TexPalStart, TexPalSize;
         u8 WidthLog2, HeightLog2;
@@ -295,7 +284,222 @@ private:
         u64 TextureHash[2];
         u64 TexPalHash;
     };
-    std::unordered_map<u64, TexCacheEntry> Cache;
+
+    static constexpr u32 InvalidEntry = 0xFFFFFFFF;
+    static constexpr u32 NumTextureBlocks = 512*1024 / VRAMDirtyGranularity;
+    static constexpr u32 NumTexPalBlocks = 128*1024 / VRAMDirtyGranularity;
+
+    // the entries are looked up through an open addressing hash table (linear probing),
+    // which maps the texture key to an index in Entries.
+    // freed entries are recycled, so these indices are stable.
+    struct CacheSlot
+    {
+        u64 Key;
+        u32 Entry;
+    };
+
+    static u32 HashKey(u64 key)
+    {
+        key ^= key >> 33;
+        key *= 0xFF51AFD7ED558CCDULL;
+        key ^= key >> 33;
+        return (u32)key;
+    }
+
+    u32 FindEntry(u64 key) const
+    {
+        if (Slots.empty())
+            return InvalidEntry;
+
+        u32 mask = Slots.size() - 1;
+        for (u32 i = HashKey(key) & mask;; i = (i + 1) & mask)
+        {
+            const CacheSlot& slot = Slots[i];
+            if (slot.Entry == InvalidEntry)
+                return InvalidEntry;
+            if (slot.Key == key)
+                return slot.Entry;
+        }
+    }
+
+    void InsertSlot(u64 key, u32 idx)
+    {
+        u32 mask = Slots.size() - 1;
+        u32 i = HashKey(key) & mask;
+        while (Slots[i].Entry != InvalidEntry)
+            i = (i + 1) & mask;
+
+        Slots[i] = {key, idx};
+    }
+
+    void RemoveSlot(u64 key)
+    {
+        u32 mask = Slots.size() - 1;
+        u32 i = HashKey(key) & mask;
+        while (Slots[i].Key != key || Slots[i].Entry == InvalidEntry)
+            i = (i + 1) & mask;
+
+        // backward shift deletion, so that no tombstones are needed
+        for (u32 j = (i + 1) & mask; Slots[j].Entry != InvalidEntry; j = (j + 1) & mask)
+        {
+            u32 home = HashKey(Slots[j].Key) & mask;
+            if (((j - home) & mask) >= ((j - i) & mask))
+            {
+                Slots[i] = Slots[j];
+                i = j;
+            }
+        }
+
+        Slots[i].Entry = InvalidEntry;
+    }
+
+    template <typename F>
+    static void ForEachBlock(u32 start, u32 size, u32 numBlocks, F&& func)
+    {
+        u32 startBlock = start / VRAMDirtyGranularity;
+        u32 endBlock = std::min((start + size + VRAMDirtyGranularity - 1) / VRAMDirtyGranularity, numBlocks);
+        for (u32 i = startBlock; i < endBlock; i++)
+            func(i);
+    }
+
+    u32 AddEntry(const TexCacheEntry& entry)
+    {
+        u32 numEntries = Entries.size() - FreeEntries.size();
+        if ((numEntries + 1) * 4 > Slots.size() * 3)
+        {
+            // grow the table and reinsert everything
+            std::vector<CacheSlot> oldSlots = std::move(Slots);
+            Slots.assign(std::max<size_t>(oldSlots.size() * 2, 256), CacheSlot{0, InvalidEntry});
+            for (const CacheSlot& slot : oldSlots)
+            {
+                if (slot.Entry != InvalidEntry)
+                    InsertSlot(slot.Key, slot.Entry);
+            }
+        }
+
+        u32 idx;
+        if (!FreeEntries.empty())
+        {
+            idx = FreeEntries.back();
+            FreeEntries.pop_back();
+            Entries[idx] = entry;
+        }
+        else
+        {
+            idx = Entries.size();
+            Entries.push_back(entry);
+        }
+
+        Entries[idx].CheckStamp = CurCheckStamp;
+        InsertSlot(entry.Key, idx);
+
+        for (u32 i = 0; i < 2; i++)
+        {
+            if (entry.TextureRAMSize[i])
+                ForEachBlock(entry.TextureRAMStart[i], entry.TextureRAMSize[i], NumTextureBlocks,
+                    [&](u32 block) { TextureBlockEntries[block].push_back(idx); });
+        }
+        if (entry.TexPalSize)
+            ForEachBlock(entry.TexPalStart, entry.TexPalSize, NumTexPalBlocks,
+                [&](u32 block) { TexPalBlockEntries[block].push_back(idx); });
+
+        return idx;
+    }
+
+    static void RemoveFromBlock(std::vector<u32>& blockEntries, u32 idx)
+    {
+        // both texture ranges of a large compressed texture can cover the same block
+        blockEntries.erase(std::remove(blockEntries.begin(), blockEntries.end(), idx), blockEntries.end());
+    }
+
+    void RemoveEntry(u32 idx)
+    {
+        const TexCacheEntry& entry = Entries[idx];
+
+        RemoveSlot(entry.Key);
+
+        for (u32 i = 0; i < 2; i++)
+        {
+            if (entry.TextureRAMSize[i])
+                ForEachBlock(entry.TextureRAMStart[i], entry.TextureRAMSize[i], NumTextureBlocks,
+                    [&](u32 block) { RemoveFromBlock(TextureBlockEntries[block], idx); });
+        }
+        if (entry.TexPalSize)
+            ForEachBlock(entry.TexPalStart, entry.TexPalSize, NumTexPalBlocks,
+                [&](u32 block) { RemoveFromBlock(TexPalBlockEntries[block], idx); });
+
+        FreeEntries.push_back(idx);
+    }
+
+    template <typename TextureDirtyT, typename TexPalDirtyT>
+    void CheckEntry(GPU& gpu, u32 idx,
+        bool textureChanged, const TextureDirtyT& textureDirty,
+        bool texPalChanged, const TexPalDirtyT& texPalDirty)
+    {
+        TexCacheEntry& entry = Entries[idx];
+
+        // an entry can be listed in several dirty blocks
+        if (entry.CheckStamp == CurCheckStamp)
+            return;
+        entry.CheckStamp = CurCheckStamp;
+
+        if (textureChanged)
+        {
+            for (u32 i = 0; i < 2; i++)
+            {
+                u32 startBit = entry.TextureRAMStart[i] / VRAMDirtyGranularity;
+                u32 bitsCount = ((entry.TextureRAMStart[i] + entry.TextureRAMSize[i] + VRAMDirtyGranularity - 1) / VRAMDirtyGranularity) - startBit;
+
+                u32 startEntry = startBit >> 6;
+                u64 entriesCount = ((startBit + bitsCount + 0x3F) >> 6) - startEntry;
+                for (u32 j = startEntry; j < startEntry + entriesCount; j++)
+                {
+                    if (GetRangedBitMask(j, startBit, bitsCount) & textureDirty.Data[j])
+                    {
+                        u64 newTexHash = XXH3_64bits(&gpu.VRAMFlat_Texture[entry.TextureRAMStart[i]], entry.TextureRAMSize[i]);
+
+                        if (newTexHash != entry.TextureHash[i])
+                        {
+                            Invalidated.push_back(idx);
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (texPalChanged && entry.TexPalSize > 0)
+        {
+            u32 startBit = entry.TexPalStart / VRAMDirtyGranularity;
+            u32 bitsCount = ((entry.TexPalStart + entry.TexPalSize + VRAMDirtyGranularity - 1) / VRAMDirtyGranularity) - startBit;
+
+            u32 startEntry = startBit >> 6;
+            u64 entriesCount = ((startBit + bitsCount + 0x3F) >> 6) - startEntry;
+            for (u32 j = startEntry; j < startEntry + entriesCount; j++)
+            {
+                if (GetRangedBitMask(j, startBit, bitsCount) & texPalDirty.Data[j])
+                {
+                    u64 newPalHash = XXH3_64bits(&gpu.VRAMFlat_TexPal[entry.TexPalStart], entry.TexPalSize);
+                    if (newPalHash != entry.TexPalHash)
+                    {
+                        Invalidated.push_back(idx);
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<CacheSlot> Slots;
+    std::vector<TexCacheEntry> Entries;
+    std::vector<u32> FreeEntries;
+
+    // reverse index: which entries overlap each VRAMDirtyGranularity sized block
+    std::vector<u32> TextureBlockEntries[NumTextureBlocks];
+    std::vector<u32> TexPalBlockEntries[NumTexPalBlocks];
+
+    u32 CurCheckStamp = 0;
+    std::vector<u32> Invalidated;
 
     TexLoaderT TexLoader;
 
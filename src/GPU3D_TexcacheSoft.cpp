@@ -0,0 +1,23 @@
+#include "GPU3D_TexcacheSoft.h"
+
+#include <string.h>
+
+namespace melonDS
+{
+
+u32* TexcacheSoftLoader::GenerateTexture(u32 width, u32 height, u32 layers)
+{
+    return new u32[width * height * layers];
+}
+
+void TexcacheSoftLoader::UploadTexture(u32* handle, u32 width, u32 height, u32 layer, void* data)
+{
+    memcpy(&handle[width * height * layer], data, width * height * sizeof(u32));
+}
+
+void TexcacheSoftLoader::DeleteTexture(u32* handle)
+{
+    delete[] handle;
+}
+
+}
@@ -0,0 +1,26 @@
+#ifndef GPU3D_TEXCACHESOFT
+#define GPU3D_TEXCACHESOFT
+
+#include "GPU3D_Texcache.h"
+
+namespace melonDS
+{
+
+template <typename, typename>
+class Texcache;
+
+// keeps the decoded textures in system memory, in RGB6A5 format
+// a texture handle points to the start of an array of layers
+class TexcacheSoftLoader
+{
+public:
+    u32* GenerateTexture(u32 width, u32 height, u32 layers);
+    void UploadTexture(u32* handle, u32 width, u32 height, u32 layer, void* data);
+    void DeleteTexture(u32* handle);
+};
+
+using TexcacheSoft = Texcache<TexcacheSoftLoader, u32*>;
+
+}
+
+#endif
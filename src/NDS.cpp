@@ -130,6 +130,8 @@ NDS::NDS(NDSArgs&& args, int type, void* userdata) noexcept :
     MainRAM = JIT.Memory.GetMainRAM();
     SharedWRAM = JIT.Memory.GetSharedWRAM();
     ARM7WRAM = JIT.Memory.GetARM7WRAM();
+
+    NDSCartSlot.SetBurstTransfers(args.CartBurstTransfers);
 }
 
 NDS::~NDS() noexcept
@@ -289,9 +291,10 @@ bool NDS::NeedsDirectBoot() const
 
 void NDS::SetupDirectBoot()
 {
-    const NDSHeader& header = NDSCartSlot.GetCart()->GetHeader();
-    u32 cartid = NDSCartSlot.GetCart()->ID();
-    const u8* cartrom = NDSCartSlot.GetCart()->GetROM();
+    const NDSCart::CartCommon* cart = NDSCartSlot.GetCart();
+    const NDSHeader& header = cart->GetHeader();
+    u32 cartid = cart->ID();
+    std::unique_ptr<u8[]> cartheader = cart->CopyROM(0, 0x170);
     MapSharedWRAM(3);
 
     // Copy the Nintendo logo from the NDS ROM header to the ARM9 BIOS if using FreeBIOS
@@ -305,7 +308,7 @@ void NDS::SetupDirectBoot()
 
     for (u32 i = 0; i < 0x170; i+=4)
     {
-        u32 tmp = *(u32*)&cartrom[i];
+        u32 tmp = *(u32*)&cartheader[i];
         NDS::ARM9Write32(0x027FFE00+i, tmp);
     }
 
@@ -342,15 +345,17 @@ void NDS::SetupDirectBoot()
 
     // CHECKME: firmware seems to load this in 0x200 byte chunks
 
+    std::unique_ptr<u8[]> arm9bin = cart->CopyROM(header.ARM9ROMOffset, header.ARM9Size);
     for (u32 i = arm9start; i < header.ARM9Size; i+=4)
     {
-        u32 tmp = *(u32*)&cartrom[header.ARM9ROMOffset+i];
+        u32 tmp = *(u32*)&arm9bin[i];
         NDS::ARM9Write32(header.ARM9RAMAddress+i, tmp);
     }
 
+    std::unique_ptr<u8[]> arm7bin = cart->CopyROM(header.ARM7ROMOffset, header.ARM7Size);
     for (u32 i = 0; i < header.ARM7Size; i+=4)
     {
-        u32 tmp = *(u32*)&cartrom[header.ARM7ROMOffset+i];
+        u32 tmp = *(u32*)&arm7bin[i];
         NDS::ARM7Write32(header.ARM7RAMAddress+i, tmp);
     }
 
@@ -585,6 +590,13 @@ void NDS::Stop(Platform::StopReason reason)
 
 bool NDS::DoSavestate(Savestate* file)
 {
+    // the DSP thread can still raise IRQs and access memory, it needs to be done before any of that is saved
+    if (ConsoleType == 1)
+    {
+        auto& dsi = dynamic_cast<melonDS::DSi&>(*this);
+        dsi.DSP.SyncThread();
+    }
+
     file->Section("NDSG");
 
     if (file->Saving)
@@ -178,17 +178,23 @@ CartCommon::CartCommon(const u8* rom, u32 len, u32 chipid, bool badDSiDump, ROML
 {
 }
 
-CartCommon::CartCommon(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, bool badDSiDump, ROMListEntry romparams, melonDS::NDSCart::CartType type, void* userdata) :
+CartCommon::CartCommon(ROMPointer&& rom, u32 len, u32 chipid, bool badDSiDump, ROMListEntry romparams, melonDS::NDSCart::CartType type, void* userdata, std::unique_ptr<ChunkedROM>&& chunked) :
     ROM(std::move(rom)),
+    Chunked(std::move(chunked)),
     ROMLength(len),
     ChipID(chipid),
     ROMParams(romparams),
     CartType(type),
     UserData(userdata)
 {
-    memcpy(&Header, ROM.get(), sizeof(Header));
+    ReadROM(0, sizeof(Header), (u8*)&Header, 0);
     IsDSi = Header.IsDSi() && !badDSiDump;
     DSiBase = Header.DSiRegionStart << 19;
+
+    // the frontend can look at the banner from another thread while the cart is in use,
+    // pin the whole struct now, the DSi-only parts of it can still be looked at
+    if (Chunked && HasBanner())
+        ChunkedBanner = reinterpret_cast<const NDSBanner*>(Chunked->Pin(Header.BannerOffset, sizeof(NDSBanner)));
 }
 
 CartCommon::~CartCommon() = default;
@@ -196,15 +202,27 @@ CartCommon::~CartCommon() = default;
 u32 CartCommon::Checksum() const
 {
     const NDSHeader& header = GetHeader();
-    u32 crc = CRC32(ROM.get(), 0x40);
+    u32 crc = 0;
+
+    auto checksumrange = [&](u32 addr, u32 len)
+    {
+        u8 buf[0x1000];
+        for (u32 pos = 0; pos < len; pos += sizeof(buf))
+        {
+            u32 chunk = std::min(len - pos, (u32)sizeof(buf));
+            ReadROM(addr + pos, chunk, buf, 0);
+            crc = CRC32(buf, chunk, crc);
+        }
+    };
 
-    crc = CRC32(&ROM[header.ARM9ROMOffset], header.ARM9Size, crc);
-    crc = CRC32(&ROM[header.ARM7ROMOffset], header.ARM7Size, crc);
+    checksumrange(0, 0x40);
+    checksumrange(header.ARM9ROMOffset, header.ARM9Size);
+    checksumrange(header.ARM7ROMOffset, header.ARM7Size);
 
     if (IsDSi)
     {
-        crc = CRC32(&ROM[header.DSiARM9iROMOffset], header.DSiARM9iSize, crc);
-        crc = CRC32(&ROM[header.DSiARM7iROMOffset], header.DSiARM7iSize, crc);
+        checksumrange(header.DSiARM9iROMOffset, header.DSiARM9iSize);
+        checksumrange(header.DSiARM7iROMOffset, header.DSiARM7iSize);
     }
 
     return crc;
@@ -262,7 +280,7 @@ int CartCommon::ROMCommandStart(NDS& nds, NDSCartSlot& cartslot, const u8* cmd,
 
         case 0x3C:
             CmdEncMode = 1;
-            cartslot.Key1_InitKeycode(false, *(u32*)&ROM[0xC], 2, 2, nds.GetARM7BIOS().data(), ARM7BIOSSize);
+            cartslot.Key1_InitKeycode(false, Header.GameCodeAsU32(), 2, 2, nds.GetARM7BIOS().data(), ARM7BIOSSize);
             DSiMode = false;
             return 0;
 
@@ -271,7 +289,7 @@ int CartCommon::ROMCommandStart(NDS& nds, NDSCartSlot& cartslot, const u8* cmd,
             {
                 auto& dsi = static_cast<DSi&>(nds);
                 CmdEncMode = 1;
-                cartslot.Key1_InitKeycode(true, *(u32*)&ROM[0xC], 1, 2, &dsi.ARM7iBIOS[0], sizeof(DSi::ARM7iBIOS));
+                cartslot.Key1_InitKeycode(true, Header.GameCodeAsU32(), 1, 2, &dsi.ARM7iBIOS[0], sizeof(DSi::ARM7iBIOS));
                 DSiMode = true;
             }
             return 0;
@@ -361,17 +379,42 @@ void CartCommon::ReadROM(u32 addr, u32 len, u8* data, u32 offset) const
     if ((addr+len) > ROMLength)
         len = ROMLength - addr;
 
-    memcpy(data+offset, ROM.get()+addr, len);
+    if (Chunked)
+        Chunked->Read(addr, len, data+offset);
+    else
+        memcpy(data+offset, ROM.get()+addr, len);
 }
 
-const NDSBanner* CartCommon::Banner() const
+std::unique_ptr<u8[]> CartCommon::CopyROM(u32 addr, u32 len) const
+{
+    auto ret = std::make_unique<u8[]>((len + 3) & ~3);
+    ReadROM(addr, len, ret.get(), 0);
+    return ret;
+}
+
+u8* CartCommon::PatchROM(u32 offset, u32 len)
+{
+    if (Chunked)
+        return Chunked->Pin(offset, len);
+
+    MakeROMWritable(ROM, offset, len);
+    return &ROM[offset];
+}
+
+bool CartCommon::HasBanner() const
 {
     const NDSHeader& header = GetHeader();
     size_t bannersize = header.IsDSi() ? 0x23C0 : 0xA40;
-    if (header.BannerOffset >= 0x200 && header.BannerOffset < (ROMLength - bannersize))
-    {
-        return reinterpret_cast<const NDSBanner*>(ROM.get() + header.BannerOffset);
-    }
+    return header.BannerOffset >= 0x200 && header.BannerOffset < (ROMLength - bannersize);
+}
+
+const NDSBanner* CartCommon::Banner() const
+{
+    if (Chunked)
+        return ChunkedBanner;
+
+    if (HasBanner())
+        return reinterpret_cast<const NDSBanner*>(ROM.get() + GetHeader().BannerOffset);
 
     return nullptr;
 }
@@ -381,8 +424,8 @@ CartRetail::CartRetail(const u8* rom, u32 len, u32 chipid, bool badDSiDump, ROML
 {
 }
 
-CartRetail::CartRetail(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, bool badDSiDump, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata, melonDS::NDSCart::CartType type) :
-    CartCommon(std::move(rom), len, chipid, badDSiDump, romparams, type, userdata)
+CartRetail::CartRetail(ROMPointer&& rom, u32 len, u32 chipid, bool badDSiDump, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata, melonDS::NDSCart::CartType type, std::unique_ptr<ChunkedROM>&& chunked) :
+    CartCommon(std::move(rom), len, chipid, badDSiDump, romparams, type, userdata, std::move(chunked))
 {
     u32 savememtype = ROMParams.SaveMemType <= 10 ? ROMParams.SaveMemType : 0;
     constexpr int sramlengths[] =
@@ -559,7 +602,7 @@ void CartRetail::ReadROM_B7(u32 addr, u32 len, u8* data, u32 offset) const
             addr = 0x8000 + (addr & 0x1FF);
     }
 
-    memcpy(data+offset, ROM.get()+addr, len);
+    ReadROM(addr, len, data, offset);
 }
 
 u8 CartRetail::SRAMWrite_EEPROMTiny(u8 val, u32 pos, bool last)
@@ -844,8 +887,8 @@ CartRetailNAND::CartRetailNAND(const u8* rom, u32 len, u32 chipid, ROMListEntry
 {
 }
 
-CartRetailNAND::CartRetailNAND(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata) :
-    CartRetail(std::move(rom), len, chipid, false, romparams, std::move(sram), sramlen, userdata, CartType::RetailNAND)
+CartRetailNAND::CartRetailNAND(ROMPointer&& rom, u32 len, u32 chipid, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata, std::unique_ptr<ChunkedROM>&& chunked) :
+    CartRetail(std::move(rom), len, chipid, false, romparams, std::move(sram), sramlen, userdata, CartType::RetailNAND, std::move(chunked))
 {
     BuildSRAMID();
 }
@@ -861,7 +904,9 @@ void CartRetailNAND::Reset()
     SRAMWindow = 0;
 
     // ROM header 94/96 = SRAM addr start / 0x20000
-    SRAMBase = *(u16*)&ROM[0x96] << 17;
+    u16 srambase;
+    ReadROM(0x96, 2, (u8*)&srambase, 0);
+    SRAMBase = srambase << 17;
 
     memset(SRAMWriteBuffer, 0, 0x800);
 }
@@ -1077,7 +1122,7 @@ CartRetailIR::CartRetailIR(const u8* rom, u32 len, u32 chipid, u32 irversion, bo
 }
 
 CartRetailIR::CartRetailIR(
-    std::unique_ptr<u8[]>&& rom,
+    ROMPointer&& rom,
     u32 len,
     u32 chipid,
     u32 irversion,
@@ -1085,9 +1130,10 @@ CartRetailIR::CartRetailIR(
     ROMListEntry romparams,
     std::unique_ptr<u8[]>&& sram,
     u32 sramlen,
-    void* userdata
+    void* userdata,
+    std::unique_ptr<ChunkedROM>&& chunked
 ) :
-    CartRetail(std::move(rom), len, chipid, badDSiDump, romparams, std::move(sram), sramlen, userdata, CartType::RetailIR),
+    CartRetail(std::move(rom), len, chipid, badDSiDump, romparams, std::move(sram), sramlen, userdata, CartType::RetailIR, std::move(chunked)),
     IRVersion(irversion)
 {
 }
@@ -1135,8 +1181,8 @@ CartRetailBT::CartRetailBT(const u8* rom, u32 len, u32 chipid, ROMListEntry romp
 {
 }
 
-CartRetailBT::CartRetailBT(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata) :
-    CartRetail(std::move(rom), len, chipid, false, romparams, std::move(sram), sramlen, userdata, CartType::RetailBT)
+CartRetailBT::CartRetailBT(ROMPointer&& rom, u32 len, u32 chipid, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata, std::unique_ptr<ChunkedROM>&& chunked) :
+    CartRetail(std::move(rom), len, chipid, false, romparams, std::move(sram), sramlen, userdata, CartType::RetailBT, std::move(chunked))
 {
     Log(LogLevel::Info,"POKETYPE CART\n");
 }
@@ -1162,7 +1208,7 @@ CartSD::CartSD(const u8* rom, u32 len, u32 chipid, ROMListEntry romparams, void*
     CartSD(CopyToUnique(rom, len), len, chipid, romparams, userdata, std::move(sdcard))
 {}
 
-CartSD::CartSD(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, ROMListEntry romparams, void* userdata, std::optional<FATStorage>&& sdcard) :
+CartSD::CartSD(ROMPointer&& rom, u32 len, u32 chipid, ROMListEntry romparams, void* userdata, std::optional<FATStorage>&& sdcard) :
     CartCommon(std::move(rom), len, chipid, false, romparams, CartType::Homebrew, userdata),
     SD(std::move(sdcard))
 {
@@ -1288,7 +1334,7 @@ void CartSD::ApplyDLDIPatch(const u8* patch, u32 patchlen, bool readonly)
     u32 offset = *(u32*)&ROM[0x20];
     u32 size = *(u32*)&ROM[0x2C];
 
-    u8* binary = &ROM[offset];
+    u8* binary = PatchROM(offset, size);
 
     for (u32 i = 0; i < size; )
     {
@@ -1318,7 +1364,7 @@ CartHomebrew::CartHomebrew(const u8* rom, u32 len, u32 chipid, ROMListEntry romp
     CartSD(rom, len, chipid, romparams, userdata, std::move(sdcard))
 {}
 
-CartHomebrew::CartHomebrew(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, ROMListEntry romparams, void* userdata, std::optional<FATStorage>&& sdcard) :
+CartHomebrew::CartHomebrew(ROMPointer&& rom, u32 len, u32 chipid, ROMListEntry romparams, void* userdata, std::optional<FATStorage>&& sdcard) :
     CartSD(std::move(rom), len, chipid, romparams, userdata, std::move(sdcard))
 {}
 
@@ -1469,6 +1515,11 @@ void NDSCartSlot::DoSavestate(Savestate* file) noexcept
     file->Var32(&TransferDir);
     file->VarArray(TransferCmd.data(), sizeof(TransferCmd));
 
+    if (file->IsAtLeastVersion(12, 3))
+        file->Var32(&TransferBurst);
+    else
+        TransferBurst = 0;
+
     // cart inserted/len/ROM/etc should be already populated
     // savestate should be loaded after the right game is loaded
     // (TODO: system to verify that indeed the right ROM is loaded)
@@ -1545,12 +1596,11 @@ bool ReadROMParams(u32 gamecode, ROMListEntry* params)
 void NDSCartSlot::DecryptSecureArea(u8* out) noexcept
 {
     const NDSHeader& header = Cart->GetHeader();
-    const u8* cartrom = Cart->GetROM();
 
     u32 gamecode = header.GameCodeAsU32();
     u32 arm9base = header.ARM9ROMOffset;
 
-    memcpy(out, &cartrom[arm9base], 0x800);
+    Cart->ReadROM(arm9base, 0x800, out, 0);
 
     Key1_InitKeycode(false, gamecode, 2, 2, NDS.GetARM7BIOS().data(), ARM7BIOSSize);
     Key1_Decrypt((u32*)&out[0]);
@@ -1573,12 +1623,25 @@ void NDSCartSlot::DecryptSecureArea(u8* out) noexcept
     }
 }
 
+static bool IsR4Header(const NDSHeader& header)
+{
+    const char *gametitle = header.GameTitle;
+    return gametitle[0] == 0 && !strncmp("SD/TF-NDS", gametitle + 1, 9) && header.GameCodeAsU32() == 0x414D5341;
+}
+
+static std::unique_ptr<CartCommon> CreateCart(ROMPointer&& cartrom, std::unique_ptr<ChunkedROM>&& chunked, u32 romlen, u32 cartromsize, void* userdata, std::optional<NDSCartArgs>&& args);
+
 std::unique_ptr<CartCommon> ParseROM(const u8* romdata, u32 romlen, void* userdata, std::optional<NDSCartArgs>&& args)
 {
     return ParseROM(CopyToUnique(romdata, romlen), romlen, userdata, std::move(args));
 }
 
 std::unique_ptr<CartCommon> ParseROM(std::unique_ptr<u8[]>&& romdata, u32 romlen, void* userdata, std::optional<NDSCartArgs>&& args)
+{
+    return ParseROM(ROMPointer(std::move(romdata)), romlen, userdata, std::move(args));
+}
+
+std::unique_ptr<CartCommon> ParseROM(ROMPointer&& romdata, u32 romlen, void* userdata, std::optional<NDSCartArgs>&& args)
 {
     if (romdata == nullptr)
     {
@@ -1592,10 +1655,60 @@ std::unique_ptr<CartCommon> ParseROM(std::unique_ptr<u8[]>&& romdata, u32 romlen
         return nullptr;
     }
 
+    if (romdata.get_deleter().MappedLength)
+    {
+        NDSHeader header {};
+        memcpy(&header, romdata.get(), std::min<u32>(romlen, sizeof(header)));
+
+        // homebrew gets patched and copied to the SD card, and is often rebuilt while it's running,
+        // so it's copied out of the ROM file rather than kept mapped (see MapROMFile())
+        if (header.IsHomebrew() || IsR4Header(header))
+        {
+            ROMPointer copy(new u8[romlen]);
+            memcpy(copy.get(), romdata.get(), romlen);
+            romdata = std::move(copy);
+        }
+    }
+
     auto [cartrom, cartromsize] = PadToPowerOf2(std::move(romdata), romlen);
 
+    return CreateCart(std::move(cartrom), nullptr, romlen, cartromsize, userdata, std::move(args));
+}
+
+std::unique_ptr<CartCommon> ParseROM(std::unique_ptr<ChunkedROM>&& romdata, void* userdata, std::optional<NDSCartArgs>&& args)
+{
+    if (romdata == nullptr)
+    {
+        Log(LogLevel::Error, "NDSCart: romdata is null\n");
+        return nullptr;
+    }
+
     NDSHeader header {};
-    memcpy(&header, cartrom.get(), sizeof(header));
+    romdata->Read(0, sizeof(header), (u8*)&header);
+
+    u32 romlen = romdata->Length();
+    if (header.IsHomebrew() || IsR4Header(header))
+    {
+        // these get patched and copied to the SD card as a whole
+        ROMPointer flatrom(new u8[romlen]);
+        romdata->Read(0, romlen, flatrom.get());
+        return ParseROM(std::move(flatrom), romlen, userdata, std::move(args));
+    }
+
+    u32 cartromsize = 1;
+    while (cartromsize < romlen)
+        cartromsize <<= 1;
+
+    return CreateCart(nullptr, std::move(romdata), romlen, cartromsize, userdata, std::move(args));
+}
+
+static std::unique_ptr<CartCommon> CreateCart(ROMPointer&& cartrom, std::unique_ptr<ChunkedROM>&& chunked, u32 romlen, u32 cartromsize, void* userdata, std::optional<NDSCartArgs>&& args)
+{
+    NDSHeader header {};
+    if (chunked)
+        chunked->Read(0, sizeof(header), (u8*)&header);
+    else
+        memcpy(&header, cartrom.get(), sizeof(header));
 
     bool dsi = header.IsDSi();
     bool badDSiDump = false;
@@ -1607,7 +1720,6 @@ std::unique_ptr<CartCommon> ParseROM(std::unique_ptr<u8[]>&& romdata, u32 romlen
         dsi = false;
     }
 
-    const char *gametitle = header.GameTitle;
     u32 gamecode = header.GameCodeAsU32();
 
     u32 arm9base = header.ARM9ROMOffset;
@@ -1669,19 +1781,19 @@ std::unique_ptr<CartCommon> ParseROM(std::unique_ptr<u8[]>&& romdata, u32 romlen
         std::optional<FATStorage> sdcard = args && args->SDCard ? std::make_optional<FATStorage>(std::move(*args->SDCard)) : std::nullopt;
         cart = std::make_unique<CartHomebrew>(std::move(cartrom), cartromsize, cartid, romparams, userdata, std::move(sdcard));
     }
-    else if (gametitle[0] == 0 && !strncmp("SD/TF-NDS", gametitle + 1, 9) && gamecode == 0x414D5341)
+    else if (IsR4Header(header))
     {
         std::optional<FATStorage> sdcard = args && args->SDCard ? std::make_optional<FATStorage>(std::move(*args->SDCard)) : std::nullopt;
         cart = std::make_unique<CartR4>(std::move(cartrom), cartromsize, cartid, romparams, CartR4TypeR4, CartR4LanguageEnglish, userdata, std::move(sdcard));
     }
     else if (cartid & 0x08000000)
-        cart = std::make_unique<CartRetailNAND>(std::move(cartrom), cartromsize, cartid, romparams, std::move(sram), sramlen, userdata);
+        cart = std::make_unique<CartRetailNAND>(std::move(cartrom), cartromsize, cartid, romparams, std::move(sram), sramlen, userdata, std::move(chunked));
     else if (irversion != 0)
-        cart = std::make_unique<CartRetailIR>(std::move(cartrom), cartromsize, cartid, irversion, badDSiDump, romparams, std::move(sram), sramlen, userdata);
+        cart = std::make_unique<CartRetailIR>(std::move(cartrom), cartromsize, cartid, irversion, badDSiDump, romparams, std::move(sram), sramlen, userdata, std::move(chunked));
     else if ((gamecode & 0xFFFFFF) == 0x505A55) // UZPx
-        cart = std::make_unique<CartRetailBT>(std::move(cartrom), cartromsize, cartid, romparams, std::move(sram), sramlen, userdata);
+        cart = std::make_unique<CartRetailBT>(std::move(cartrom), cartromsize, cartid, romparams, std::move(sram), sramlen, userdata, std::move(chunked));
     else
-        cart = std::make_unique<CartRetail>(std::move(cartrom), cartromsize, cartid, badDSiDump, romparams, std::move(sram), sramlen, userdata);
+        cart = std::make_unique<CartRetail>(std::move(cartrom), cartromsize, cartid, badDSiDump, romparams, std::move(sram), sramlen, userdata, CartType::Retail, std::move(chunked));
 
     args = std::nullopt;
     return cart;
@@ -1704,22 +1816,25 @@ void NDSCartSlot::SetCart(std::unique_ptr<CartCommon>&& cart) noexcept
 
     const NDSHeader& header = Cart->GetHeader();
     const ROMListEntry romparams = Cart->GetROMParams();
-    const u8* cartrom = Cart->GetROM();
     if (header.ARM9ROMOffset >= 0x4000 && header.ARM9ROMOffset < 0x8000)
     {
+        u32 firstwords[5];
+        Cart->ReadROM(header.ARM9ROMOffset, sizeof(firstwords), (u8*)firstwords, 0);
+
         // reencrypt secure area if needed
-        if (*(u32*)&cartrom[header.ARM9ROMOffset] == 0xE7FFDEFF && *(u32*)&cartrom[header.ARM9ROMOffset + 0x10] != 0xE7FFDEFF)
+        if (firstwords[0] == 0xE7FFDEFF && firstwords[4] != 0xE7FFDEFF)
         {
             Log(LogLevel::Debug, "Re-encrypting cart secure area\n");
 
-            strncpy((char*)&cartrom[header.ARM9ROMOffset], "encryObj", 8);
+            u8* securearea = Cart->PatchROM(header.ARM9ROMOffset, 0x800);
+            strncpy((char*)securearea, "encryObj", 8);
 
             Key1_InitKeycode(false, romparams.GameCode, 3, 2, NDS.GetARM7BIOS().data(), ARM7BIOSSize);
             for (u32 i = 0; i < 0x800; i += 8)
-                Key1_Encrypt((u32*)&cartrom[header.ARM9ROMOffset + i]);
+                Key1_Encrypt((u32*)&securearea[i]);
 
             Key1_InitKeycode(false, romparams.GameCode, 2, 2, NDS.GetARM7BIOS().data(), ARM7BIOSSize);
-            Key1_Encrypt((u32*)&cartrom[header.ARM9ROMOffset]);
+            Key1_Encrypt((u32*)securearea);
 
             Log(LogLevel::Debug, "Re-encrypted cart secure area\n");
         }
@@ -1782,6 +1897,7 @@ void NDSCartSlot::ResetCart() noexcept
     TransferDir = 0;
     memset(TransferCmd.data(), 0, sizeof(TransferCmd));
     TransferCmd[0] = 0xFF;
+    TransferBurst = 0;
 
     if (Cart) Cart->Reset();
 }
@@ -1902,15 +2018,58 @@ void NDSCartSlot::WriteROMCnt(u32 val) noexcept
     }
 
     if (datasize == 0)
+    {
+        TransferBurst = 0;
         NDS.ScheduleEvent(Event_ROMTransfer, false, xfercycle*cmddelay, ROMTransfer_End, 0);
+    }
     else
-        NDS.ScheduleEvent(Event_ROMTransfer, false, xfercycle*(cmddelay+4), ROMTransfer_PrepareData, 0);
+    {
+        u32 burst = GetTransferBurst();
+        TransferBurst = burst - 1;
+        NDS.ScheduleEvent(Event_ROMTransfer, false, xfercycle*(cmddelay+(4*burst)), ROMTransfer_PrepareData, 0);
+    }
+}
+
+// When a DMA is reading the data, sending it one word at a time means going through the scheduler
+// for every word. With burst transfers enabled, a whole block is sent at once instead, at the time
+// its last word would have come in, and the DMA reads all of it right away (see DMA::Run9()/Run7()).
+// Returns how many words are sent at once for the word at TransferPos.
+u32 NDSCartSlot::GetTransferBurst() const noexcept
+{
+    if (!BurstTransfers)
+        return 1;
+    if (TransferDir != 0 || (ROMCnt & (1<<30)))
+        return 1;
+    if (TransferPos & 0x1FF)
+        return 1;
+    if (TransferPos >= TransferLen)
+        return 1;
+
+    u32 cpu = (NDS.ExMemCnt[0] >> 11) & 0x1;
+    u32 mode = cpu ? 0x12 : 0x05;
+    // only the legacy DMAs are checked here: DSi::DMAsInMode() would also count
+    // the NDMAs, which have to be ruled out separately below
+    if (!NDS.NDS::DMAsInMode(cpu, mode))
+        return 1;
+
+    // the DSi NDMAs don't restart on their own
+    if (NDS.ConsoleType == 1 && static_cast<DSi&>(NDS).NDMAsInDMAMode(cpu, mode))
+        return 1;
+
+    return std::min(TransferLen - TransferPos, 0x200u) >> 2;
 }
 
 void NDSCartSlot::AdvanceROMTransfer() noexcept
 {
     ROMCnt &= ~(1<<23);
 
+    if (TransferBurst > 0)
+    {
+        TransferBurst--;
+        ROMPrepareData(0);
+        return;
+    }
+
     if (TransferPos < TransferLen)
     {
         u32 xfercycle = (ROMCnt & (1<<27)) ? 8 : 5;
@@ -1921,6 +2080,10 @@ void NDSCartSlot::AdvanceROMTransfer() noexcept
                 delay += ((ROMCnt >> 16) & 0x3F);
         }
 
+        u32 burst = GetTransferBurst();
+        TransferBurst = burst - 1;
+        delay += 4 * (burst - 1);
+
         NDS.ScheduleEvent(Event_ROMTransfer, false, xfercycle*delay, ROMTransfer_PrepareData, 0);
     }
     else
@@ -1931,12 +2094,15 @@ u32 NDSCartSlot::ReadROMData() noexcept
 {
     if (ROMCnt & (1<<30)) return 0;
 
+    // the next word may be put in right away
+    u32 ret = ROMData;
+
     if (ROMCnt & (1<<23))
     {
         AdvanceROMTransfer();
     }
 
-    return ROMData;
+    return ret;
 }
 
 void NDSCartSlot::WriteROMData(u32 val) noexcept
@@ -29,6 +29,8 @@
 #include "NDS_Header.h"
 #include "FATStorage.h"
 #include "ROMList.h"
+#include "ROMFile.h"
+#include "ChunkedROM.h"
 
 namespace melonDS
 {
@@ -77,7 +79,7 @@ class CartCommon
 {
 public:
     CartCommon(const u8* rom, u32 len, u32 chipid, bool badDSiDump, ROMListEntry romparams, CartType type, void* userdata);
-    CartCommon(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, bool badDSiDump, ROMListEntry romparams, CartType type, void* userdata);
+    CartCommon(ROMPointer&& rom, u32 len, u32 chipid, bool badDSiDump, ROMListEntry romparams, CartType type, void* userdata, std::unique_ptr<ChunkedROM>&& chunked = nullptr);
     virtual ~CartCommon();
 
     [[nodiscard]] u32 Type() const { return CartType; };
@@ -106,14 +108,31 @@ public:
     [[nodiscard]] const NDSBanner* Banner() const;
     [[nodiscard]] const ROMListEntry& GetROMParams() const { return ROMParams; };
     [[nodiscard]] u32 ID() const { return ChipID; }
+
+    /// @return The ROM data, or \c nullptr if it's read from a chunked ROM file as needed
+    /// (see ::ChunkedROM), in which case ::ReadROM() has to be used instead.
     [[nodiscard]] const u8* GetROM() const { return ROM.get(); }
     [[nodiscard]] u32 GetROMLength() const { return ROMLength; }
-protected:
+
+    /// @return A pointer to the ROM data at \c offset, that \c len bytes can be written to.
+    /// The ROM data may be mapped from the ROM file (see ::MapROMFile()),
+    /// so this has to be used for anything that patches it.
+    [[nodiscard]] u8* PatchROM(u32 offset, u32 len);
+
+    /// Copies \c len bytes of ROM data from \c addr to \c data + \c offset.
+    /// Works regardless of where the ROM data is stored.
     void ReadROM(u32 addr, u32 len, u8* data, u32 offset) const;
 
+    /// @return A copy of part of the ROM data, zero-padded to a multiple of 4 bytes.
+    [[nodiscard]] std::unique_ptr<u8[]> CopyROM(u32 addr, u32 len) const;
+protected:
     void* UserData;
 
-    std::unique_ptr<u8[]> ROM = nullptr;
+    [[nodiscard]] bool HasBanner() const;
+
+    ROMPointer ROM = nullptr;
+    std::unique_ptr<ChunkedROM> Chunked = nullptr;
+    const NDSBanner* ChunkedBanner = nullptr; // pinned when the cart is created, as ChunkedROM isn't thread-safe
     u32 ROMLength = 0;
     u32 ChipID = 0;
     bool IsDSi = false;
@@ -145,14 +164,15 @@ public:
         melonDS::NDSCart::CartType type = CartType::Retail
     );
     CartRetail(
-        std::unique_ptr<u8[]>&& rom,
+        ROMPointer&& rom,
         u32 len, u32 chipid,
         bool badDSiDump,
         ROMListEntry romparams,
         std::unique_ptr<u8[]>&& sram,
         u32 sramlen,
         void* userdata,
-        melonDS::NDSCart::CartType type = CartType::Retail
+        melonDS::NDSCart::CartType type = CartType::Retail,
+        std::unique_ptr<ChunkedROM>&& chunked = nullptr
     );
     ~CartRetail() override;
 
@@ -192,7 +212,7 @@ class CartRetailNAND : public CartRetail
 {
 public:
     CartRetailNAND(const u8* rom, u32 len, u32 chipid, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata);
-    CartRetailNAND(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata);
+    CartRetailNAND(ROMPointer&& rom, u32 len, u32 chipid, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata, std::unique_ptr<ChunkedROM>&& chunked = nullptr);
     ~CartRetailNAND() override;
 
     void Reset() override;
@@ -221,7 +241,7 @@ class CartRetailIR : public CartRetail
 {
 public:
     CartRetailIR(const u8* rom, u32 len, u32 chipid, u32 irversion, bool badDSiDump, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata);
-    CartRetailIR(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, u32 irversion, bool badDSiDump, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata);
+    CartRetailIR(ROMPointer&& rom, u32 len, u32 chipid, u32 irversion, bool badDSiDump, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata, std::unique_ptr<ChunkedROM>&& chunked = nullptr);
     ~CartRetailIR() override;
 
     void Reset() override;
@@ -240,7 +260,7 @@ class CartRetailBT : public CartRetail
 {
 public:
     CartRetailBT(const u8* rom, u32 len, u32 chipid, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata);
-    CartRetailBT(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata);
+    CartRetailBT(ROMPointer&& rom, u32 len, u32 chipid, ROMListEntry romparams, std::unique_ptr<u8[]>&& sram, u32 sramlen, void* userdata, std::unique_ptr<ChunkedROM>&& chunked = nullptr);
     ~CartRetailBT() override;
 
     u8 SPIWrite(u8 val, u32 pos, bool last) override;
@@ -251,7 +271,7 @@ class CartSD : public CartCommon
 {
 public:
     CartSD(const u8* rom, u32 len, u32 chipid, ROMListEntry romparams, void* userdata, std::optional<FATStorage>&& sdcard = std::nullopt);
-    CartSD(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, ROMListEntry romparams, void* userdata, std::optional<FATStorage>&& sdcard = std::nullopt);
+    CartSD(ROMPointer&& rom, u32 len, u32 chipid, ROMListEntry romparams, void* userdata, std::optional<FATStorage>&& sdcard = std::nullopt);
     ~CartSD() override;
 
     [[nodiscard]] const std::optional<FATStorage>& GetSDCard() const noexcept { return SD; }
@@ -293,7 +313,7 @@ class CartHomebrew : public CartSD
 {
 public:
     CartHomebrew(const u8* rom, u32 len, u32 chipid, ROMListEntry romparams, void* userdata, std::optional<FATStorage>&& sdcard = std::nullopt);
-    CartHomebrew(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, ROMListEntry romparams, void* userdata, std::optional<FATStorage>&& sdcard = std::nullopt);
+    CartHomebrew(ROMPointer&& rom, u32 len, u32 chipid, ROMListEntry romparams, void* userdata, std::optional<FATStorage>&& sdcard = std::nullopt);
     ~CartHomebrew() override;
 
     void Reset() override;
@@ -326,7 +346,7 @@ enum CartR4Language
 class CartR4 : public CartSD
 {
 public:
-    CartR4(std::unique_ptr<u8[]>&& rom, u32 len, u32 chipid, ROMListEntry romparams, CartR4Type ctype, CartR4Language clanguage, void* userdata,
+    CartR4(ROMPointer&& rom, u32 len, u32 chipid, ROMListEntry romparams, CartR4Type ctype, CartR4Language clanguage, void* userdata,
         std::optional<FATStorage>&& sdcard = std::nullopt);
     ~CartR4() override;
 
@@ -414,6 +434,14 @@ public:
     [[nodiscard]] u8 GetROMCommand(u8 index) const noexcept { return ROMCommand[index]; }
     void SetROMCommand(u8 index, u8 val) noexcept { ROMCommand[index] = val; }
 
+    /// Whether ROM data read by a DMA is sent a whole 0x200-byte block at once,
+    /// instead of one word at a time (see GetTransferBurst()).
+    /// This saves going through the scheduler for every word, but the DMA then reads
+    /// the block back to back once it's all there, which changes when it runs
+    /// and how long the CPU is stalled. Disabled by default.
+    void SetBurstTransfers(bool burst) noexcept { BurstTransfers = burst; }
+    [[nodiscard]] bool GetBurstTransfers() const noexcept { return BurstTransfers; }
+
     [[nodiscard]] u32 GetROMCnt() const noexcept { return ROMCnt; }
     [[nodiscard]] u16 GetSPICnt() const noexcept { return SPICnt; }
     void SetSPICnt(u16 val) noexcept { SPICnt = val; }
@@ -434,6 +462,9 @@ private:
     u32 TransferLen = 0;
     u32 TransferDir = 0;
     std::array<u8, 8> TransferCmd {};
+    // words that are ready to be read right away after the current one, see GetTransferBurst()
+    u32 TransferBurst = 0;
+    bool BurstTransfers = false;
 
     std::unique_ptr<CartCommon> Cart = nullptr;
 
@@ -451,9 +482,14 @@ private:
     void ROMEndTransfer(u32 param) noexcept;
     void ROMPrepareData(u32 param) noexcept;
     void AdvanceROMTransfer() noexcept;
+    [[nodiscard]] u32 GetTransferBurst() const noexcept;
     void SPITransferDone(u32 param) noexcept;
 };
 
+/// Looks up the given game code in the ROM list.
+/// @return \c true if the game was found, in which case \c params is filled in.
+bool ReadROMParams(u32 gamecode, ROMListEntry* params);
+
 /// Parses the given ROM data and constructs a \c NDSCart::CartCommon subclass
 /// that can be inserted into the emulator or used to extract information about the cart beforehand.
 /// @param romdata The ROM data to parse.
@@ -467,6 +503,15 @@ private:
 /// or \c nullptr if the ROM data couldn't be parsed.
 std::unique_ptr<CartCommon> ParseROM(const u8* romdata, u32 romlen, void* userdata = nullptr, std::optional<NDSCartArgs>&& args = std::nullopt);
 std::unique_ptr<CartCommon> ParseROM(std::unique_ptr<u8[]>&& romdata, u32 romlen, void* userdata = nullptr, std::optional<NDSCartArgs>&& args = std::nullopt);
+
+/// Same as above, for ROM data that may be mapped from the ROM file with ::MapROMFile().
+/// In that case, \c romlen is the length of the file.
+/// Homebrew ROMs are copied out of the mapping, so that the file can be rebuilt while they run.
+std::unique_ptr<CartCommon> ParseROM(ROMPointer&& romdata, u32 romlen, void* userdata = nullptr, std::optional<NDSCartArgs>&& args = std::nullopt);
+
+/// Same as above, for a chunked ROM file that's decompressed as it's read.
+/// Homebrew ROMs are decompressed in whole, since they get patched and copied to the SD card.
+std::unique_ptr<CartCommon> ParseROM(std::unique_ptr<ChunkedROM>&& romdata, void* userdata = nullptr, std::optional<NDSCartArgs>&& args = std::nullopt);
 }
 
 #endif
@@ -0,0 +1,200 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif !defined(__SWITCH__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <string.h>
+#include "ROMFile.h"
+#include "Platform.h"
+
+namespace melonDS
+{
+using Platform::Log;
+using Platform::LogLevel;
+
+// same limit as the frontend uses when reading ROMs
+constexpr u32 MaxROMFileLength = 0x40000000;
+
+static u32 NextPowerOf2(u32 len)
+{
+    u32 ret = 1;
+    while (ret < len)
+        ret <<= 1;
+    return ret;
+}
+
+void ROMDeleter::operator()(u8* data) const noexcept
+{
+    if (!MappedLength)
+    {
+        delete[] data;
+        return;
+    }
+
+#if defined(_WIN32)
+    UnmapViewOfFile(data);
+#elif !defined(__SWITCH__)
+    munmap(data, MappedLength);
+#endif
+}
+
+#if defined(_WIN32)
+
+ROMPointer MapROMFile(const std::string& path, u32& len) noexcept
+{
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+    if (wlen <= 0) return nullptr;
+    std::wstring wpath(wlen, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wpath.data(), wlen);
+
+    HANDLE file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || size.QuadPart > MaxROMFileLength)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    // a view can't be followed by anonymous memory for the padding,
+    // so those files are left to be read the regular way
+    u32 filelen = (u32)size.QuadPart;
+    if (NextPowerOf2(filelen) != filelen)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) return nullptr;
+
+    // the view keeps the mapping alive
+    void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, filelen);
+    CloseHandle(mapping);
+    if (!view) return nullptr;
+
+    DWORD oldprotect;
+    VirtualProtect(view, filelen, PAGE_READONLY, &oldprotect);
+
+    ROMDeleter deleter;
+    deleter.MappedLength = filelen;
+
+    len = filelen;
+    return ROMPointer((u8*)view, deleter);
+}
+
+void MakeROMWritable(const ROMPointer& rom, u32 offset, u32 len) noexcept
+{
+    if (!rom.get_deleter().MappedLength || !len) return;
+
+    DWORD oldprotect;
+    VirtualProtect(&rom[offset], len, PAGE_WRITECOPY, &oldprotect);
+}
+
+#elif defined(__SWITCH__)
+
+ROMPointer MapROMFile(const std::string& path, u32& len) noexcept
+{
+    return nullptr;
+}
+
+void MakeROMWritable(const ROMPointer& rom, u32 offset, u32 len) noexcept
+{
+}
+
+#else
+
+ROMPointer MapROMFile(const std::string& path, u32& len) noexcept
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0 || st.st_size > MaxROMFileLength)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    u32 filelen = (u32)st.st_size;
+    u32 maplen = NextPowerOf2(filelen);
+
+    // reserve the whole padded range as zeroed anonymous memory, then map the file over the start of it
+    u8* base = (u8*)mmap(nullptr, maplen, PROT_READ, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    void* file = mmap(base, filelen, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED)
+    {
+        munmap(base, maplen);
+        return nullptr;
+    }
+
+    Log(LogLevel::Debug, "Mapped ROM file %s (%u bytes)\n", path.c_str(), filelen);
+
+    ROMDeleter deleter;
+    deleter.MappedLength = maplen;
+
+    len = filelen;
+    return ROMPointer(base, deleter);
+}
+
+void MakeROMWritable(const ROMPointer& rom, u32 offset, u32 len) noexcept
+{
+    if (!rom.get_deleter().MappedLength || !len) return;
+
+    uintptr_t pagesize = sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)&rom[offset] & ~(pagesize - 1);
+    uintptr_t end = ((uintptr_t)&rom[offset] + len + pagesize - 1) & ~(pagesize - 1);
+
+    if (mprotect((void*)start, end - start, PROT_READ | PROT_WRITE) != 0)
+        Log(LogLevel::Error, "Failed to make ROM range %08X-%08X writable\n", offset, offset + len);
+}
+
+#endif
+
+std::pair<ROMPointer, u32> PadToPowerOf2(ROMPointer&& data, u32 len) noexcept
+{
+    if (data == nullptr || len == 0)
+        return {nullptr, 0};
+
+    u32 newlen = NextPowerOf2(len);
+    if (newlen == len || data.get_deleter().MappedLength >= newlen)
+        return {std::move(data), newlen};
+
+    ROMPointer newdata(new u8[newlen] {});
+    memcpy(newdata.get(), data.get(), len);
+    data = nullptr;
+    return {std::move(newdata), newlen};
+}
+
+}
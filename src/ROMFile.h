@@ -0,0 +1,77 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef MELONDS_ROMFILE_H
+#define MELONDS_ROMFILE_H
+
+#include <memory>
+#include <string>
+#include <utility>
+#include "types.h"
+
+namespace melonDS
+{
+/// Frees ROM data, which is either a regular heap buffer
+/// or a mapping of the ROM file made by ::MapROMFile().
+struct ROMDeleter
+{
+    ROMDeleter() noexcept = default;
+
+    /// Allows heap buffers to be passed wherever ROM data is expected.
+    ROMDeleter(std::default_delete<u8[]>) noexcept {}
+
+    void operator()(u8* data) const noexcept;
+
+    /// The length of the mapping, or 0 if the data is a heap buffer.
+    u32 MappedLength = 0;
+};
+
+using ROMPointer = std::unique_ptr<u8[], ROMDeleter>;
+
+/// Maps a ROM file to memory instead of reading it.
+///
+/// The mapping is private and read-only: its pages are only loaded as they're used,
+/// and they're shared with the OS file cache and with any other mapping of the same file.
+/// Anything that needs to patch the ROM data has to use ::MakeROMWritable() first.
+/// Like ::PadToPowerOf2(), the mapping is zero-padded up to the next power of 2 in length.
+///
+/// The file stays mapped for as long as the ROM data is alive, and what happens when it's
+/// changed on disk in the meantime depends on the platform:
+/// - On POSIX systems, pages that haven't been read yet show the new contents of the file,
+///   and reading past the end of a file that was truncated raises SIGBUS.
+/// - On Windows, the file can't be truncated or deleted while it's mapped.
+/// Homebrew, which tends to be rebuilt while it's running, isn't kept mapped
+/// (see NDSCart::ParseROM()).
+///
+/// @param path The path to the ROM file.
+/// @param[out] len The length of the file, not including the padding.
+/// @return The mapped ROM data, or \c nullptr if the file couldn't be mapped.
+/// Files that can't be mapped can still be read the regular way.
+ROMPointer MapROMFile(const std::string& path, u32& len) noexcept;
+
+/// Makes part of the ROM data writable.
+/// For mapped ROMs, the pages in this range are copied the first time they're written to,
+/// the file itself is never modified. Does nothing for heap buffers.
+void MakeROMWritable(const ROMPointer& rom, u32 offset, u32 len) noexcept;
+
+/// Same as ::PadToPowerOf2(), for ROM data.
+/// Mapped ROMs are already padded, and are returned unchanged.
+std::pair<ROMPointer, u32> PadToPowerOf2(ROMPointer&& data, u32 len) noexcept;
+}
+
+#endif // MELONDS_ROMFILE_H
@@ -0,0 +1,314 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+
+#include "ROMIndex.h"
+#include "NDS_Header.h"
+#include "NDSCart.h"
+#include "Platform.h"
+
+#define XXH_STATIC_LINKING_ONLY
+#include "xxhash/xxhash.h"
+
+namespace melonDS
+{
+using namespace Platform;
+namespace fs = std::filesystem;
+
+constexpr u32 ROMIndexMagic = 0x58444952; // "RIDX"
+constexpr u32 ROMIndexVersion = 1;
+
+void DecodeBannerIcon(const u8 (&data)[512], const u16 (&palette)[16], u32 (&out)[32*32])
+{
+    u32 paletteRGBA[16];
+    for (int i = 0; i < 16; i++)
+    {
+        u8 r = ((palette[i] >> 0)  & 0x1F) * 255 / 31;
+        u8 g = ((palette[i] >> 5)  & 0x1F) * 255 / 31;
+        u8 b = ((palette[i] >> 10) & 0x1F) * 255 / 31;
+        u8 a = i ? 255 : 0;
+        paletteRGBA[i] = r | (g << 8) | (b << 16) | (a << 24);
+    }
+
+    // 4x4 tiles of 8x8 pixels, 4 bits per pixel
+    int count = 0;
+    for (int ytile = 0; ytile < 4; ytile++)
+    {
+        for (int xtile = 0; xtile < 4; xtile++)
+        {
+            for (int ypixel = 0; ypixel < 8; ypixel++)
+            {
+                for (int xpixel = 0; xpixel < 8; xpixel++)
+                {
+                    u8 pal_index = count % 2 ? data[count/2] >> 4 : data[count/2] & 0x0F;
+                    out[ytile*256 + ypixel*32 + xtile*8 + xpixel] = paletteRGBA[pal_index];
+                    count++;
+                }
+            }
+        }
+    }
+}
+
+static bool ReadAt(FileHandle* file, u64 offset, void* data, u32 len)
+{
+    return FileSeek(file, offset, FileSeekOrigin::Start) && FileRead(data, len, 1, file) == 1;
+}
+
+bool ScanROMFile(const std::string& path, ROMFileInfo& info, bool hash)
+{
+    FileHandle* file = OpenFile(path, FileMode::Read);
+    if (!file) return false;
+
+    u64 filelen = FileLength(file);
+    if (filelen < 0x200 || filelen > 0x40000000)
+    {
+        CloseFile(file);
+        return false;
+    }
+
+    // small homebrew can have a header shorter than the struct
+    NDSHeader header {};
+    if (!ReadAt(file, 0, &header, std::min<u64>(filelen, sizeof(header))))
+    {
+        CloseFile(file);
+        return false;
+    }
+
+    info = {};
+    memcpy(info.GameTitle, header.GameTitle, sizeof(info.GameTitle));
+    info.GameCode = header.GameCodeAsU32();
+
+    bool homebrew = header.IsHomebrew();
+    if (header.IsDSi()) info.Flags |= ROMFileInfo::DSi;
+    if (homebrew) info.Flags |= ROMFileInfo::Homebrew;
+
+    ROMListEntry romparams {};
+    if (NDSCart::ReadROMParams(info.GameCode, &romparams))
+    {
+        info.Flags |= ROMFileInfo::InROMList;
+        info.ROMSize = romparams.ROMSize;
+        info.SaveMemType = romparams.SaveMemType;
+    }
+    else
+    {
+        u32 romsize = 1;
+        while (romsize < filelen)
+            romsize <<= 1;
+
+        info.ROMSize = romsize;
+        info.SaveMemType = homebrew ? 0 : 2;
+    }
+
+    // only the parts of the banner that are the same for DS and DSi ROMs
+    constexpr u32 bannerlen = offsetof(NDSBanner, Reserved2);
+    if (header.BannerOffset >= 0x200 && (u64)header.BannerOffset + bannerlen <= filelen)
+    {
+        auto banner = std::make_unique<NDSBanner>();
+        if (ReadAt(file, header.BannerOffset, banner.get(), bannerlen))
+        {
+            info.Flags |= ROMFileInfo::HasBanner;
+            memcpy(info.Title, banner->EnglishTitle, sizeof(info.Title));
+            memcpy(info.Icon, banner->Icon, sizeof(info.Icon));
+            memcpy(info.Palette, banner->Palette, sizeof(info.Palette));
+        }
+    }
+
+    bool ret = true;
+    if (hash)
+    {
+        constexpr u32 chunklen = 0x100000;
+        auto buf = std::make_unique<u8[]>(chunklen);
+        XXH3_state_t* hashstate = XXH3_createState();
+        XXH3_64bits_reset(hashstate);
+
+        FileRewind(file);
+        for (u64 pos = 0; pos < filelen; pos += chunklen)
+        {
+            u32 len = std::min<u64>(chunklen, filelen - pos);
+            if (FileRead(buf.get(), len, 1, file) != 1)
+            {
+                ret = false;
+                break;
+            }
+
+            XXH3_64bits_update(hashstate, buf.get(), len);
+        }
+
+        info.Hash = XXH3_64bits_digest(hashstate);
+        XXH3_freeState(hashstate);
+        if (ret) info.Flags |= ROMFileInfo::Hashed;
+    }
+
+    CloseFile(file);
+    return ret;
+}
+
+bool ROMIndex::Load(const std::string& path)
+{
+    FileHandle* file = OpenFile(path, FileMode::Read);
+    if (!file) return false;
+
+    u32 header[3] {};
+    if (FileRead(header, sizeof(header), 1, file) != 1 ||
+        header[0] != ROMIndexMagic || header[1] != ROMIndexVersion || header[2] > 0x1000000)
+    {
+        Log(LogLevel::Warn, "ROMIndex: %s is not a valid index\n", path.c_str());
+        CloseFile(file);
+        return false;
+    }
+
+    // the count isn't trusted to size the list up front, entries are only added as they're read
+    constexpr u64 minentrylen = sizeof(u32) + sizeof(u64) + sizeof(s64) + sizeof(ROMFileInfo);
+    std::vector<ROMIndexEntry> entries;
+    entries.reserve(std::min<u64>(header[2], FileLength(file) / minentrylen));
+    for (u32 i = 0; i < header[2]; i++)
+    {
+        ROMIndexEntry& entry = entries.emplace_back();
+        u32 pathlen = 0;
+        bool ok = FileRead(&pathlen, sizeof(pathlen), 1, file) == 1 && pathlen < 0x10000;
+        if (ok)
+        {
+            entry.Path.resize(pathlen);
+            ok = (pathlen == 0 || FileRead(entry.Path.data(), pathlen, 1, file) == 1) &&
+                FileRead(&entry.FileSize, sizeof(entry.FileSize), 1, file) == 1 &&
+                FileRead(&entry.FileTime, sizeof(entry.FileTime), 1, file) == 1 &&
+                FileRead(&entry.Info, sizeof(entry.Info), 1, file) == 1;
+        }
+
+        if (!ok)
+        {
+            Log(LogLevel::Warn, "ROMIndex: %s is truncated\n", path.c_str());
+            CloseFile(file);
+            return false;
+        }
+    }
+
+    CloseFile(file);
+    Entries = std::move(entries);
+    return true;
+}
+
+bool ROMIndex::Save(const std::string& path) const
+{
+    FileHandle* file = OpenFile(path, FileMode::Write);
+    if (!file) return false;
+
+    u32 header[3] = {ROMIndexMagic, ROMIndexVersion, (u32)Entries.size()};
+    bool ok = FileWrite(header, sizeof(header), 1, file) == 1;
+
+    for (const ROMIndexEntry& entry : Entries)
+    {
+        if (!ok) break;
+
+        u32 pathlen = entry.Path.size();
+        ok = FileWrite(&pathlen, sizeof(pathlen), 1, file) == 1 &&
+            (pathlen == 0 || FileWrite(entry.Path.data(), pathlen, 1, file) == 1) &&
+            FileWrite(&entry.FileSize, sizeof(entry.FileSize), 1, file) == 1 &&
+            FileWrite(&entry.FileTime, sizeof(entry.FileTime), 1, file) == 1 &&
+            FileWrite(&entry.Info, sizeof(entry.Info), 1, file) == 1;
+    }
+
+    if (!ok)
+        Log(LogLevel::Error, "ROMIndex: couldn't write %s\n", path.c_str());
+
+    CloseFile(file);
+    return ok;
+}
+
+u32 ROMIndex::Update(const std::vector<std::string>& paths, int numthreads, bool hash, const ProgressCallback& progress)
+{
+    std::unordered_map<std::string, const ROMIndexEntry*> oldentries;
+    for (const ROMIndexEntry& entry : Entries)
+        oldentries[entry.Path] = &entry;
+
+    std::vector<ROMIndexEntry> entries(paths.size());
+    std::vector<u32> toscan;
+
+    for (u32 i = 0; i < paths.size(); i++)
+    {
+        ROMIndexEntry& entry = entries[i];
+        entry.Path = paths[i];
+
+        std::error_code err;
+        fs::path fspath = fs::u8path(paths[i]);
+        entry.FileSize = fs::file_size(fspath, err);
+        if (err) entry.FileSize = 0;
+        entry.FileTime = fs::last_write_time(fspath, err).time_since_epoch().count();
+        if (err) entry.FileTime = 0;
+
+        auto old = oldentries.find(paths[i]);
+        if (old != oldentries.end() &&
+            old->second->FileSize == entry.FileSize &&
+            old->second->FileTime == entry.FileTime &&
+            (!hash || (old->second->Info.Flags & (ROMFileInfo::Hashed | ROMFileInfo::Invalid))))
+        {
+            entry.Info = old->second->Info;
+        }
+        else
+            toscan.push_back(i);
+    }
+
+    // the worker threads each take the next file that's left,
+    // and write to their own entry so they don't need to lock anything else
+    std::atomic<u32> next = 0;
+    std::atomic<u32> done = 0;
+    auto worker = [&]()
+    {
+        for (;;)
+        {
+            u32 n = next++;
+            if (n >= toscan.size()) break;
+
+            ROMIndexEntry& entry = entries[toscan[n]];
+            if (!ScanROMFile(entry.Path, entry.Info, hash))
+            {
+                Log(LogLevel::Warn, "ROMIndex: couldn't read %s\n", entry.Path.c_str());
+                entry.Info = {};
+                entry.Info.Flags = ROMFileInfo::Invalid;
+            }
+
+            u32 count = ++done;
+            if (progress) progress(count, toscan.size());
+        }
+    };
+
+    numthreads = std::max(1, std::min<int>(numthreads, toscan.size()));
+    std::vector<Thread*> threads;
+    for (int i = 1; i < numthreads; i++)
+        threads.push_back(Thread_Create(worker));
+
+    worker();
+
+    for (Thread* thread : threads)
+    {
+        Thread_Wait(thread);
+        Thread_Free(thread);
+    }
+
+    Entries = std::move(entries);
+    return toscan.size();
+}
+
+}
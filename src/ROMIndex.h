@@ -0,0 +1,118 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef MELONDS_ROMINDEX_H
+#define MELONDS_ROMINDEX_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "types.h"
+
+namespace melonDS
+{
+/// What a ROM library needs to know about a ROM,
+/// taken from its header and banner without loading the rest of it.
+/// Stored as-is in index files, so it has to stay a plain struct.
+struct ROMFileInfo
+{
+    enum : u8
+    {
+        InROMList = 1 << 0,
+        DSi = 1 << 1,
+        Homebrew = 1 << 2,
+        HasBanner = 1 << 3,
+        Hashed = 1 << 4,
+
+        /// The file couldn't be read as a DS ROM, it's only looked at again once it changes.
+        Invalid = 1 << 5,
+    };
+
+    char GameTitle[12];
+    u32 GameCode;
+
+    /// The ROM size from the ROM list, or the file size rounded up to a power of 2.
+    u32 ROMSize;
+
+    /// The save memory type, as used by ::ROMListEntry and \c NDSCart::CartRetail.
+    /// The same default as \c NDSCart::ParseROM() is used for ROMs that aren't in the ROM list.
+    u32 SaveMemType;
+
+    u8 Flags;
+    u8 Reserved[7];
+
+    /// XXH3 hash of the whole file, if it was asked for.
+    u64 Hash;
+
+    /// The English title from the banner.
+    char16_t Title[128];
+
+    /// The banner icon, see ::DecodeBannerIcon().
+    u8 Icon[512];
+    u16 Palette[16];
+};
+
+static_assert(sizeof(ROMFileInfo) == 840, "ROMFileInfo is not 840 bytes!");
+
+struct ROMIndexEntry
+{
+    std::string Path;
+
+    /// Used to tell whether the file changed since it was scanned.
+    u64 FileSize = 0;
+    s64 FileTime = 0;
+
+    ROMFileInfo Info {};
+};
+
+/// Decodes a banner icon to 32x32 RGBA pixels. Color 0 is transparent.
+void DecodeBannerIcon(const u8 (&data)[512], const u16 (&palette)[16], u32 (&out)[32*32]);
+
+/// Reads the header and banner of a ROM file, and hashes the whole file if \c hash is set.
+/// The rest of the file is never loaded in memory.
+/// @return \c false if the file couldn't be read or is too small to be a DS ROM.
+bool ScanROMFile(const std::string& path, ROMFileInfo& info, bool hash);
+
+/// An index of ROM files, that can be kept on disk and updated
+/// by only scanning the files that changed since the last time.
+class ROMIndex
+{
+public:
+    /// Called after each file is scanned, with the number of files scanned so far and the total.
+    /// Called from the worker threads.
+    using ProgressCallback = std::function<void(u32 done, u32 total)>;
+
+    /// @return \c false if the file doesn't exist or isn't a valid index.
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+
+    /// Brings the index in line with the given files.
+    /// Files whose size and modification time match their current entry keep it,
+    /// new or changed ones are scanned across \c numthreads threads,
+    /// and entries for files that aren't in \c paths are dropped.
+    /// @return The number of files that were scanned.
+    u32 Update(const std::vector<std::string>& paths, int numthreads, bool hash, const ProgressCallback& progress = nullptr);
+
+    [[nodiscard]] const std::vector<ROMIndexEntry>& GetEntries() const noexcept { return Entries; }
+private:
+    std::vector<ROMIndexEntry> Entries;
+};
+
+}
+
+#endif // MELONDS_ROMINDEX_H
@@ -0,0 +1,49 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+#ifndef MELONDS_SIMD_H
+#define MELONDS_SIMD_H
+
+// Selects the vector instruction set used by the hand-vectorised kernels.
+//
+// By default only the baseline extensions of each architecture are used
+// (SSE2 on x86-64, NEON on AArch64), as the build doesn't enable any
+// target-specific flags.
+// Every kernel has a scalar fallback for other targets, and all of them
+// are required to produce bit-identical results to their scalar counterpart.
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MELONDS_SIMD_SSE2
+
+// SSSE3 (byte shuffles) and SSE4.1 (signed 32-bit multiplies) are only used
+// when the compiler is allowed to target them (eg. -march=native)
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define MELONDS_SIMD_SSSE3
+#endif
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#define MELONDS_SIMD_SSE41
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define MELONDS_SIMD_NEON
+#endif
+
+#endif // MELONDS_SIMD_H
@@ -23,6 +23,7 @@
 #include "NDS.h"
 #include "DSi.h"
 #include "SPU.h"
+#include "SIMD.h"
 
 namespace melonDS
 {
@@ -199,7 +200,7 @@ SPU::SPU(melonDS::NDS& nds, AudioBitDepth bitdepth, AudioInterpolation interpola
         SPUCaptureUnit(0, nds),
         SPUCaptureUnit(1, nds),
     },
-    AudioLock(Platform::Mutex_Create()),
+    OutputSema(Platform::Semaphore_Create()),
     Degrade10Bit(bitdepth == AudioBitDepth::_10Bit || (nds.ConsoleType == 1 && bitdepth == AudioBitDepth::Auto))
 {
     NDS.RegisterEventFunc(Event_SPU, 0, MemberEventFunc(SPU, Mix));
@@ -210,14 +211,12 @@ SPU::SPU(melonDS::NDS& nds, AudioBitDepth bitdepth, AudioInterpolation interpola
     memset(OutputFrontBuffer, 0, 2*OutputBufferSize*2);
 
     OutputBackbufferWritePosition = 0;
-    OutputFrontBufferReadPosition = 0;
-    OutputFrontBufferWritePosition = 0;
 }
 
 SPU::~SPU()
 {
-    Platform::Mutex_Free(AudioLock);
-    AudioLock = nullptr;
+    Platform::Semaphore_Free(OutputSema);
+    OutputSema = nullptr;
 
     NDS.UnregisterEventFunc(Event_SPU, 0);
 }
@@ -236,18 +235,14 @@ void SPU::Reset()
     Capture[0].Reset();
     Capture[1].Reset();
 
-    NDS.ScheduleEvent(Event_SPU, false, 1024, 0, 0);
+    MixTimestamp = NDS.ARM7Timestamp + 1024;
+    NDS.ScheduleEvent(Event_SPU, false, 1024 * MixBatchSamples, 0, 0);
 }
 
 void SPU::Stop()
 {
-    Platform::Mutex_Lock(AudioLock);
-    memset(OutputFrontBuffer, 0, 2*OutputBufferSize*2);
-
     OutputBackbufferWritePosition = 0;
-    OutputFrontBufferReadPosition = 0;
-    OutputFrontBufferWritePosition = 0;
-    Platform::Mutex_Unlock(AudioLock);
+    DropOutput(0);
 }
 
 void SPU::DoSavestate(Savestate* file)
@@ -258,6 +253,11 @@ void SPU::DoSavestate(Savestate* file)
     file->Var8(&MasterVolume);
     file->Var16(&Bias);
 
+    if (file->IsAtLeastVersion(12, 2))
+        file->Var64(&MixTimestamp);
+    else
+        MixTimestamp = NDS.SchedList[Event_SPU].Timestamp; // older versions mixed one sample per event
+
     for (SPUChannel& channel : Channels)
         channel.DoSavestate(file);
 
@@ -450,6 +450,40 @@ void SPUChannel::Start()
     }
 }
 
+// how many samples can be mixed, at most, before this channel plays data it hasn't read from memory yet
+// the FIFO refill is done late, at the end of the batch, but never after the sample that needs its data:
+// until then, the data that was already in the FIFO is played, like on hardware
+// this errs on the short side, as it assumes the largest possible read for every sample
+u32 SPUChannel::SamplesUntilFetch(u32 max) const
+{
+    if (!(Cnt & (1<<31))) return max;
+
+    u32 type = (Cnt >> 29) & 0x3;
+    if (type == 3) return max;
+    if ((Length+LoopPos) < 16) return max;
+
+    // Start() fills the FIFO on the first sample
+    if (KeyOn) return 1;
+
+    // one-shot sound that has been read entirely, see FIFO_BufferData()
+    u32 repeatmode = (Cnt >> 27) & 0x3;
+    if ((repeatmode == 2) && (FIFOReadOffset >= (LoopPos + Length)))
+        return max;
+
+    u32 readsize;
+    if      (type == 1) readsize = 2;
+    else if (type == 2) readsize = (Pos < 0) ? 4 : 1; // ADPCM header
+    else                readsize = 1;
+
+    // the read after these is the first one that needs refilled data
+    u32 reads = FIFOLevel / readsize;
+
+    // the timer overflows at most 512/period + 1 times in a sample, see Run()
+    u32 period = 0x10000 - TimerReload;
+    u64 ret = 1 + (((u64)reads * period) >> 9);
+    return (ret < max) ? (u32)ret : max;
+}
+
 void SPUChannel::NextSample_PCM8()
 {
     Pos++;
@@ -679,10 +713,78 @@ s32 SPUChannel::Run()
     return val;
 }
 
-void SPUChannel::PanOutput(s32 in, s32& left, s32& right)
+template<u32 type>
+void SPUChannel::Run(s32* buf, u32 samples)
+{
+    for (u32 i = 0; i < samples; i++)
+        buf[i] = Run<type>();
+}
+
+#if defined(MELONDS_SIMD_SSE2)
+// ((s64)val * mul) >> shift, for 4 values and 0 <= mul <= 128 (repeated over all 16-bit lanes)
+// the values are split so that all the products fit in 32 bits:
+// (val * mul) >> shift == (((val >> 5) * mul) + (((val & 0x1F) * mul) >> 5)) >> (shift - 5)
+// this is exact as long as the values fit in 28 bits, which holds for channel and mixer output
+template<int shift>
+inline __m128i MultiplyShift(__m128i val, __m128i mul)
+{
+    __m128i hi = _mm_srai_epi32(val, 5);
+    __m128i lo = _mm_and_si128(val, _mm_set1_epi32(0x1F));
+
+    // 32x16-bit multiply, from the 16-bit products of both halves
+    hi = _mm_add_epi32(_mm_mullo_epi16(hi, mul), _mm_slli_epi32(_mm_mulhi_epu16(hi, mul), 16));
+    lo = _mm_mullo_epi16(lo, mul);
+
+    return _mm_srai_epi32(_mm_add_epi32(hi, _mm_srli_epi32(lo, 5)), shift - 5);
+}
+#elif defined(MELONDS_SIMD_NEON)
+// ((s64)val * mul) >> shift, for 4 values
+template<int shift>
+inline int32x4_t MultiplyShift(int32x4_t val, int32x2_t mul)
+{
+    return vcombine_s32(
+        vshrn_n_s64(vmull_s32(vget_low_s32(val), mul), shift),
+        vshrn_n_s64(vmull_s32(vget_high_s32(val), mul), shift));
+}
+#endif
+
+void SPUChannel::PanOutput(const s32* in, s32* left, s32* right, u32 samples)
 {
-    left += ((s64)in * (128-Pan)) >> 10;
-    right += ((s64)in * Pan) >> 10;
+    s32 leftpan = 128 - Pan;
+    s32 rightpan = Pan;
+
+    u32 i = 0;
+#if defined(MELONDS_SIMD_SSE2)
+    const __m128i leftmul = _mm_set1_epi16(leftpan);
+    const __m128i rightmul = _mm_set1_epi16(rightpan);
+
+    for (; i + 4 <= samples; i += 4)
+    {
+        __m128i val = _mm_loadu_si128((const __m128i*)&in[i]);
+        __m128i l = _mm_loadu_si128((const __m128i*)&left[i]);
+        __m128i r = _mm_loadu_si128((const __m128i*)&right[i]);
+
+        _mm_storeu_si128((__m128i*)&left[i], _mm_add_epi32(l, MultiplyShift<10>(val, leftmul)));
+        _mm_storeu_si128((__m128i*)&right[i], _mm_add_epi32(r, MultiplyShift<10>(val, rightmul)));
+    }
+#elif defined(MELONDS_SIMD_NEON)
+    const int32x2_t leftmul = vdup_n_s32(leftpan);
+    const int32x2_t rightmul = vdup_n_s32(rightpan);
+
+    for (; i + 4 <= samples; i += 4)
+    {
+        int32x4_t val = vld1q_s32(&in[i]);
+
+        vst1q_s32(&left[i], vaddq_s32(vld1q_s32(&left[i]), MultiplyShift<10>(val, leftmul)));
+        vst1q_s32(&right[i], vaddq_s32(vld1q_s32(&right[i]), MultiplyShift<10>(val, rightmul)));
+    }
+#endif
+
+    for (; i < samples; i++)
+    {
+        left[i] += ((s64)in[i] * leftpan) >> 10;
+        right[i] += ((s64)in[i] * rightpan) >> 10;
+    }
 }
 
 
@@ -811,54 +913,118 @@ void SPUCaptureUnit::Run(s32 sample)
 
 void SPU::Mix(u32 dummy)
 {
-    s32 left = 0, right = 0;
-    s32 leftoutput = 0, rightoutput = 0;
+    CatchUp(NDS.SchedList[Event_SPU].Timestamp, dummy);
 
-    if ((Cnt & (1<<15)) && (!dummy))
+    // the next event comes at the last sample of the next batch
+    NDS.ScheduleEvent(Event_SPU, true, 1024 * NextBatchSize(), 0, 0);
+}
+
+// how many samples can be mixed in one event without making memory accesses late
+u32 SPU::NextBatchSize() const
+{
+    // captured data goes to memory that the CPU and the channels can read back
+    // without going through the SPU registers, so it is mixed one sample at a time
+    if (IsCapturing()) return 1;
+
+    if (!(Cnt & (1<<15))) return MixBatchSamples;
+
+    // channels read sound data from memory as they play, those reads can't come after the data is played
+    // as it may be rewritten while it plays (streamed sound with a looping buffer)
+    u32 ret = MixBatchSamples;
+    for (const SPUChannel& chan : Channels)
+        ret = chan.SamplesUntilFetch(ret);
+
+    return ret;
+}
+
+// brings the pending event forward after a register write,
+// if the next batch has to be shorter than what it was scheduled for
+// register writes only come from the ARM7, so the event is scheduled relative to it
+void SPU::UpdateMixEvent()
+{
+    u64 next = MixTimestamp + ((NextBatchSize() - 1) << 10);
+    if (next >= NDS.SchedList[Event_SPU].Timestamp) return;
+
+    NDS.CancelEvent(Event_SPU);
+    NDS.ScheduleEvent(Event_SPU, false, next - NDS.ARM7Timestamp, 0, 0);
+}
+
+void SPU::CatchUp(u64 timestamp, bool dummy)
+{
+    // mix all the samples that are due by the given time (1 sample = 1024 cycles at 33MHz)
+    // this is done whenever the SPU registers are accessed, so that the mixer state
+    // doesn't need to be kept in sync with the emulated CPU at every sample
+    if (timestamp < MixTimestamp) return;
+
+    u64 samples = ((timestamp - MixTimestamp) >> 10) + 1;
+    MixTimestamp += samples << 10;
+
+    while (samples > 0)
     {
-        s32 ch0 = Channels[0].DoRun();
-        s32 ch1 = Channels[1].DoRun();
-        s32 ch2 = Channels[2].DoRun();
-        s32 ch3 = Channels[3].DoRun();
+        // the samples mixed here are all due already, so the channels' reads from memory
+        // don't need to be split up like in Mix()
+        u32 batch = IsCapturing() ? 1 : MixBatchSamples;
+        if (batch > samples) batch = samples;
 
-        // TODO: addition from capture registers
-        Channels[0].PanOutput(ch0, left, right);
-        Channels[2].PanOutput(ch2, left, right);
+        MixSamples(batch, dummy);
+        samples -= batch;
+    }
+}
+
+void SPU::MixSamples(u32 samples, bool dummy)
+{
+    s32 leftoutput[MixBatchSamples] {}, rightoutput[MixBatchSamples] {};
 
-        if (!(Cnt & (1<<12))) Channels[1].PanOutput(ch1, left, right);
-        if (!(Cnt & (1<<13))) Channels[3].PanOutput(ch3, left, right);
+    if ((Cnt & (1<<15)) && (!dummy))
+    {
+        s32 left[MixBatchSamples] {}, right[MixBatchSamples] {};
+        s32 ch1[MixBatchSamples] {}, ch3[MixBatchSamples] {};
+        s32 buf[MixBatchSamples];
 
-        for (int i = 4; i < 16; i++)
+        for (int i = 0; i < 16; i++)
         {
             SPUChannel* chan = &Channels[i];
 
-            s32 channel = chan->DoRun();
-            chan->PanOutput(channel, left, right);
+            // a stopped channel outputs nothing, and can only be started by a register write
+            if (!(chan->Cnt & (1<<31)))
+                continue;
+
+            s32* channel = (i == 1) ? ch1 : ((i == 3) ? ch3 : buf);
+            chan->DoRun(channel, samples);
+
+            // TODO: addition from capture registers
+            if ((i == 1) && (Cnt & (1<<12))) continue;
+            if ((i == 3) && (Cnt & (1<<13))) continue;
+
+            chan->PanOutput(channel, left, right, samples);
         }
 
         // sound capture
         // TODO: other sound capture sources, along with their bugs
 
-        if (Capture[0].Cnt & (1<<7))
+        for (u32 s = 0; s < samples; s++)
         {
-            s32 val = left;
+            if (Capture[0].Cnt & (1<<7))
+            {
+                s32 val = left[s];
 
-            val >>= 8;
-            if      (val < -0x8000) val = -0x8000;
-            else if (val > 0x7FFF)  val = 0x7FFF;
+                val >>= 8;
+                if      (val < -0x8000) val = -0x8000;
+                else if (val > 0x7FFF)  val = 0x7FFF;
 
-            Capture[0].Run(val);
-        }
+                Capture[0].Run(val);
+            }
 
-        if (Capture[1].Cnt & (1<<7))
-        {
-            s32 val = right;
+            if (Capture[1].Cnt & (1<<7))
+            {
+                s32 val = right[s];
 
-            val >>= 8;
-            if      (val < -0x8000) val = -0x8000;
-            else if (val > 0x7FFF)  val = 0x7FFF;
+                val >>= 8;
+                if      (val < -0x8000) val = -0x8000;
+                else if (val > 0x7FFF)  val = 0x7FFF;
 
-            Capture[1].Run(val);
+                Capture[1].Run(val);
+            }
         }
 
         // final output
@@ -866,25 +1032,28 @@ void SPU::Mix(u32 dummy)
         switch (Cnt & 0x0300)
         {
         case 0x0000: // left mixer
-            leftoutput = left;
+            memcpy(leftoutput, left, samples * sizeof(s32));
             break;
         case 0x0100: // channel 1
             {
                 s32 pan = 128 - Channels[1].Pan;
-                leftoutput = ((s64)ch1 * pan) >> 10;
+                for (u32 s = 0; s < samples; s++)
+                    leftoutput[s] = ((s64)ch1[s] * pan) >> 10;
             }
             break;
         case 0x0200: // channel 3
             {
                 s32 pan = 128 - Channels[3].Pan;
-                leftoutput = ((s64)ch3 * pan) >> 10;
+                for (u32 s = 0; s < samples; s++)
+                    leftoutput[s] = ((s64)ch3[s] * pan) >> 10;
             }
             break;
         case 0x0300: // channel 1+3
             {
                 s32 pan1 = 128 - Channels[1].Pan;
                 s32 pan3 = 128 - Channels[3].Pan;
-                leftoutput = (((s64)ch1 * pan1) >> 10) + (((s64)ch3 * pan3) >> 10);
+                for (u32 s = 0; s < samples; s++)
+                    leftoutput[s] = (((s64)ch1[s] * pan1) >> 10) + (((s64)ch3[s] * pan3) >> 10);
             }
             break;
         }
@@ -892,142 +1061,198 @@ void SPU::Mix(u32 dummy)
         switch (Cnt & 0x0C00)
         {
         case 0x0000: // right mixer
-            rightoutput = right;
+            memcpy(rightoutput, right, samples * sizeof(s32));
             break;
         case 0x0400: // channel 1
             {
                 s32 pan = Channels[1].Pan;
-                rightoutput = ((s64)ch1 * pan) >> 10;
+                for (u32 s = 0; s < samples; s++)
+                    rightoutput[s] = ((s64)ch1[s] * pan) >> 10;
             }
             break;
         case 0x0800: // channel 3
             {
                 s32 pan = Channels[3].Pan;
-                rightoutput = ((s64)ch3 * pan) >> 10;
+                for (u32 s = 0; s < samples; s++)
+                    rightoutput[s] = ((s64)ch3[s] * pan) >> 10;
             }
             break;
         case 0x0C00: // channel 1+3
             {
                 s32 pan1 = Channels[1].Pan;
                 s32 pan3 = Channels[3].Pan;
-                rightoutput = (((s64)ch1 * pan1) >> 10) + (((s64)ch3 * pan3) >> 10);
+                for (u32 s = 0; s < samples; s++)
+                    rightoutput[s] = (((s64)ch1[s] * pan1) >> 10) + (((s64)ch3[s] * pan3) >> 10);
             }
             break;
         }
     }
 
-    leftoutput = ((s64)leftoutput * MasterVolume) >> 7;
-    rightoutput = ((s64)rightoutput * MasterVolume) >> 7;
-
-    leftoutput >>= 8;
-    rightoutput >>= 8;
+    s16 output[2 * MixBatchSamples];
+    u32 s = 0;
 
-    // Add SOUNDBIAS value
-    // The value used by all commercial games is 0x200, so we subtract that so it won't offset the final sound output.
-    if (ApplyBias)
+#if defined(MELONDS_SIMD_SSE2)
     {
-        leftoutput += (Bias << 6) - 0x8000;
-        rightoutput += (Bias << 6) - 0x8000;
+        const __m128i mastervol = _mm_set1_epi16(MasterVolume);
+        const __m128i bias = _mm_set1_epi32(ApplyBias ? ((Bias << 6) - 0x8000) : 0);
+        const __m128i mask = _mm_set1_epi16(Degrade10Bit ? 0xFFC0 : 0xFFFF);
+
+        for (; s + 4 <= samples; s += 4)
+        {
+            // master volume, then the >>8 down to 16 bits
+            __m128i leftval = MultiplyShift<15>(_mm_loadu_si128((const __m128i*)&leftoutput[s]), mastervol);
+            __m128i rightval = MultiplyShift<15>(_mm_loadu_si128((const __m128i*)&rightoutput[s]), mastervol);
+
+            leftval = _mm_add_epi32(leftval, bias);
+            rightval = _mm_add_epi32(rightval, bias);
+
+            // interleave the channels, and clamp them through signed saturation
+            __m128i out = _mm_packs_epi32(_mm_unpacklo_epi32(leftval, rightval), _mm_unpackhi_epi32(leftval, rightval));
+            out = _mm_srai_epi16(_mm_and_si128(out, mask), 1);
+            _mm_storeu_si128((__m128i*)&output[s*2], out);
+        }
     }
+#elif defined(MELONDS_SIMD_NEON)
+    {
+        const int32x2_t mastervol = vdup_n_s32(MasterVolume);
+        const int32x4_t bias = vdupq_n_s32(ApplyBias ? ((Bias << 6) - 0x8000) : 0);
+        const int16x8_t mask = vdupq_n_s16(Degrade10Bit ? (s16)0xFFC0 : (s16)0xFFFF);
 
-    if      (leftoutput < -0x8000) leftoutput = -0x8000;
-    else if (leftoutput > 0x7FFF)  leftoutput = 0x7FFF;
-    if      (rightoutput < -0x8000) rightoutput = -0x8000;
-    else if (rightoutput > 0x7FFF)  rightoutput = 0x7FFF;
+        for (; s + 4 <= samples; s += 4)
+        {
+            int32x4_t leftval = vaddq_s32(MultiplyShift<15>(vld1q_s32(&leftoutput[s]), mastervol), bias);
+            int32x4_t rightval = vaddq_s32(MultiplyShift<15>(vld1q_s32(&rightoutput[s]), mastervol), bias);
 
-    // The original DS and DS lite degrade the output from 16 to 10 bit before output
-    if (Degrade10Bit)
+            int16x4x2_t zipped = vzip_s16(vqmovn_s32(leftval), vqmovn_s32(rightval));
+            int16x8_t out = vcombine_s16(zipped.val[0], zipped.val[1]);
+            out = vshrq_n_s16(vandq_s16(out, mask), 1);
+            vst1q_s16(&output[s*2], out);
+        }
+    }
+#endif
+
+    for (; s < samples; s++)
     {
-        leftoutput &= 0xFFFFFFC0;
-        rightoutput &= 0xFFFFFFC0;
+        s32 leftval = ((s64)leftoutput[s] * MasterVolume) >> 7;
+        s32 rightval = ((s64)rightoutput[s] * MasterVolume) >> 7;
+
+        leftval >>= 8;
+        rightval >>= 8;
+
+        // Add SOUNDBIAS value
+        // The value used by all commercial games is 0x200, so we subtract that so it won't offset the final sound output.
+        if (ApplyBias)
+        {
+            leftval += (Bias << 6) - 0x8000;
+            rightval += (Bias << 6) - 0x8000;
+        }
+
+        if      (leftval < -0x8000) leftval = -0x8000;
+        else if (leftval > 0x7FFF)  leftval = 0x7FFF;
+        if      (rightval < -0x8000) rightval = -0x8000;
+        else if (rightval > 0x7FFF)  rightval = 0x7FFF;
+
+        // The original DS and DS lite degrade the output from 16 to 10 bit before output
+        if (Degrade10Bit)
+        {
+            leftval &= 0xFFFFFFC0;
+            rightval &= 0xFFFFFFC0;
+        }
+
+        output[s*2    ] = leftval >> 1;
+        output[s*2 + 1] = rightval >> 1;
     }
 
     // OutputBufferFrame can never get full because it's
     // transfered to OutputBuffer at the end of the frame
     // FIXME: apparently this does happen!!!
-    if (OutputBackbufferWritePosition * 2 < OutputBufferSize - 1)
+    for (s = 0; s < samples; s++)
     {
-        OutputBackbuffer[OutputBackbufferWritePosition    ] = leftoutput >> 1;
-        OutputBackbuffer[OutputBackbufferWritePosition + 1] = rightoutput >> 1;
+        if (OutputBackbufferWritePosition * 2 >= OutputBufferSize - 1)
+            break;
+
+        OutputBackbuffer[OutputBackbufferWritePosition    ] = output[s*2    ];
+        OutputBackbuffer[OutputBackbufferWritePosition + 1] = output[s*2 + 1];
         OutputBackbufferWritePosition += 2;
     }
+}
 
-    NDS.ScheduleEvent(Event_SPU, true, 1024, 0, 0);
+void SPU::SetCaptureCnt(u32 num, u8 val)
+{
+    Capture[num].SetCnt(val);
+
+    // switch the mixer to one sample per event right away, see NextBatchSize()
+    UpdateMixEvent();
 }
 
 void SPU::TransferOutput()
 {
-    Platform::Mutex_Lock(AudioLock);
-    for (u32 i = 0; i < OutputBackbufferWritePosition; i += 2)
+    CatchUp(NDS.ARM7Timestamp);
+
+    u32 numsamples = OutputBackbufferWritePosition >> 1;
+    u32 writepos = OutputFrontBufferWritePosition.load(std::memory_order_relaxed);
+    u32 readpos = OutputFrontBufferReadPosition.load();
+
+    // if the ring is too full, drop the oldest samples to avoid losing the entire FIFO
+    // the audio thread may be reading them at the same time, it will notice and try again
+    while ((writepos - readpos + numsamples) > OutputBufferSize)
     {
-        OutputFrontBuffer[OutputFrontBufferWritePosition    ] = OutputBackbuffer[i   ];
-        OutputFrontBuffer[OutputFrontBufferWritePosition + 1] = OutputBackbuffer[i + 1];
+        if (OutputFrontBufferReadPosition.compare_exchange_weak(readpos, writepos + numsamples - OutputBufferSize))
+            break;
+    }
 
-        OutputFrontBufferWritePosition += 2;
-        OutputFrontBufferWritePosition &= OutputBufferSize*2-1;
-        if (OutputFrontBufferWritePosition == OutputFrontBufferReadPosition)
-        {
-            // advance the read position too, to avoid losing the entire FIFO
-            OutputFrontBufferReadPosition += 2;
-            OutputFrontBufferReadPosition &= OutputBufferSize*2-1;
-        }
+    for (u32 i = 0; i < numsamples; i++)
+    {
+        u32 pos = ((writepos + i) & (OutputBufferSize-1)) << 1;
+        OutputFrontBuffer[pos    ] = OutputBackbuffer[(i << 1)    ];
+        OutputFrontBuffer[pos + 1] = OutputBackbuffer[(i << 1) + 1];
     }
+
+    OutputFrontBufferWritePosition.store(writepos + numsamples);
     OutputBackbufferWritePosition = 0;
-    Platform::Mutex_Unlock(AudioLock);;
 }
 
-void SPU::TrimOutput()
+void SPU::DropOutput(u32 keep)
 {
-    Platform::Mutex_Lock(AudioLock);
-    const int halflimit = (OutputBufferSize / 2);
+    // only ever moves the read position forward, the audio thread may be moving it too
+    u32 readpos = OutputFrontBufferReadPosition.load();
+    for (;;)
+    {
+        u32 writepos = OutputFrontBufferWritePosition.load();
+        if ((writepos - readpos) <= keep)
+            break;
 
-    int readpos = OutputFrontBufferWritePosition - (halflimit*2);
-    if (readpos < 0) readpos += (OutputBufferSize*2);
+        if (OutputFrontBufferReadPosition.compare_exchange_weak(readpos, writepos - keep))
+            break;
+    }
+}
 
-    OutputFrontBufferReadPosition = readpos;
-    Platform::Mutex_Unlock(AudioLock);
+void SPU::TrimOutput()
+{
+    const int halflimit = (OutputBufferSize / 2);
+    DropOutput(halflimit);
 }
 
 void SPU::DrainOutput()
 {
-    Platform::Mutex_Lock(AudioLock);
-    OutputFrontBufferWritePosition = 0;
-    OutputFrontBufferReadPosition = 0;
-    Platform::Mutex_Unlock(AudioLock);
+    DropOutput(0);
 }
 
 void SPU::InitOutput()
 {
-    Platform::Mutex_Lock(AudioLock);
     memset(OutputBackbuffer, 0, 2*OutputBufferSize*2);
-    memset(OutputFrontBuffer, 0, 2*OutputBufferSize*2);
-    OutputFrontBufferReadPosition = 0;
-    OutputFrontBufferWritePosition = 0;
-    Platform::Mutex_Unlock(AudioLock);
+    DropOutput(0);
 }
 
 int SPU::GetOutputSize() const
 {
-    Platform::Mutex_Lock(AudioLock);
-
-    int ret;
-    if (OutputFrontBufferWritePosition >= OutputFrontBufferReadPosition)
-        ret = OutputFrontBufferWritePosition - OutputFrontBufferReadPosition;
-    else
-        ret = (OutputBufferSize*2) - OutputFrontBufferReadPosition + OutputFrontBufferWritePosition;
-
-    ret >>= 1;
-
-    Platform::Mutex_Unlock(AudioLock);
-    return ret;
+    u32 readpos = OutputFrontBufferReadPosition.load();
+    u32 writepos = OutputFrontBufferWritePosition.load();
+    return writepos - readpos;
 }
 
 void SPU::Sync(bool wait)
 {
-    // this function is currently not used anywhere
-    // depending on the usage context the thread safety measures could be made
-    // a lot faster
-
     // sync to audio output in case the core is running too fast
     // * wait=true: wait until enough audio data has been played
     // * wait=false: merely skip some audio data to avoid a FIFO overflow
@@ -1035,54 +1260,80 @@ void SPU::Sync(bool wait)
     const int halflimit = (OutputBufferSize / 2);
 
     if (wait)
+        WaitForOutput(halflimit, -1);
+    else
+        DropOutput(halflimit);
+}
+
+// blocks until there are at most the given number of samples left to be played
+// returns false if that didn't happen before the timeout (a negative timeout waits forever)
+bool SPU::WaitForOutput(int samples, int timeout_ms)
+{
+    u64 start = Platform::GetMSCount();
+
+    while (GetOutputSize() > samples)
     {
-        // TODO: less CPU-intensive wait?
-        while (GetOutputSize() > halflimit);
-    }
-    else if (GetOutputSize() > halflimit)
-    {
-        Platform::Mutex_Lock(AudioLock);
+        // ReadOutput() signals the semaphore when it sees the flag set
+        // check again once it is set, in case ReadOutput() ran just before
+        OutputWaiting = true;
+        if (GetOutputSize() <= samples)
+            break;
 
-        int readpos = OutputFrontBufferWritePosition - (halflimit*2);
-        if (readpos < 0) readpos += (OutputBufferSize*2);
+        int wait = 100;
+        if (timeout_ms >= 0)
+        {
+            int remaining = timeout_ms - (int)(Platform::GetMSCount() - start);
+            if (remaining <= 0)
+            {
+                OutputWaiting = false;
+                return false;
+            }
 
-        OutputFrontBufferReadPosition = readpos;
+            if (wait > remaining) wait = remaining;
+        }
 
-        Platform::Mutex_Unlock(AudioLock);
+        Platform::Semaphore_TryWait(OutputSema, wait);
     }
+
+    OutputWaiting = false;
+    return true;
 }
 
 int SPU::ReadOutput(s16* data, int samples)
 {
-    Platform::Mutex_Lock(AudioLock);
-    if (OutputFrontBufferReadPosition == OutputFrontBufferWritePosition)
-    {
-        Platform::Mutex_Unlock(AudioLock);
-        return 0;
-    }
+    u32 readpos = OutputFrontBufferReadPosition.load();
+    u32 num;
 
-    for (int i = 0; i < samples; i++)
+    for (;;)
     {
-        *data++ = OutputFrontBuffer[OutputFrontBufferReadPosition];
-        *data++ = OutputFrontBuffer[OutputFrontBufferReadPosition + 1];
+        u32 writepos = OutputFrontBufferWritePosition.load();
 
-        OutputFrontBufferReadPosition += 2;
-        OutputFrontBufferReadPosition &= ((2*OutputBufferSize)-1);
+        num = writepos - readpos;
+        if (num > (u32)samples) num = samples;
 
-        if (OutputFrontBufferWritePosition == OutputFrontBufferReadPosition)
+        for (u32 i = 0; i < num; i++)
         {
-            Platform::Mutex_Unlock(AudioLock);
-            return i+1;
+            u32 pos = ((readpos + i) & (OutputBufferSize-1)) << 1;
+            data[(i << 1)    ] = OutputFrontBuffer[pos    ];
+            data[(i << 1) + 1] = OutputFrontBuffer[pos + 1];
         }
+
+        // if the emulator thread dropped samples in the meantime, what we read may have been overwritten
+        if (OutputFrontBufferReadPosition.compare_exchange_weak(readpos, readpos + num))
+            break;
     }
 
-    Platform::Mutex_Unlock(AudioLock);
-    return samples;
+    if (num && OutputWaiting.exchange(false))
+        Platform::Semaphore_Post(OutputSema);
+
+    return num;
 }
 
 
 u8 SPU::Read8(u32 addr)
 {
+    CatchUp(NDS.ARM7Timestamp);
+
     if (addr < 0x04000500)
     {
         SPUChannel* chan = &Channels[(addr >> 4) & 0xF];
@@ -1113,6 +1364,8 @@ u8 SPU::Read8(u32 addr)
 
 u16 SPU::Read16(u32 addr)
 {
+    CatchUp(NDS.ARM7Timestamp);
+
     if (addr < 0x04000500)
     {
         SPUChannel* chan = &Channels[(addr >> 4) & 0xF];
@@ -1140,6 +1393,8 @@ u16 SPU::Read16(u32 addr)
 
 u32 SPU::Read32(u32 addr)
 {
+    CatchUp(NDS.ARM7Timestamp);
+
     if (addr < 0x04000500)
     {
         SPUChannel* chan = &Channels[(addr >> 4) & 0xF];
@@ -1169,16 +1424,18 @@ u32 SPU::Read32(u32 addr)
 
 void SPU::Write8(u32 addr, u8 val)
 {
+    CatchUp(NDS.ARM7Timestamp);
+
     if (addr < 0x04000500)
     {
         SPUChannel* chan = &Channels[(addr >> 4) & 0xF];
 
         switch (addr & 0xF)
         {
-        case 0x0: chan->SetCnt((chan->Cnt & 0xFFFFFF00) | val); return;
-        case 0x1: chan->SetCnt((chan->Cnt & 0xFFFF00FF) | (val << 8)); return;
-        case 0x2: chan->SetCnt((chan->Cnt & 0xFF00FFFF) | (val << 16)); return;
-        case 0x3: chan->SetCnt((chan->Cnt & 0x00FFFFFF) | (val << 24)); return;
+        case 0x0: chan->SetCnt((chan->Cnt & 0xFFFFFF00) | val); UpdateMixEvent(); return;
+        case 0x1: chan->SetCnt((chan->Cnt & 0xFFFF00FF) | (val << 8)); UpdateMixEvent(); return;
+        case 0x2: chan->SetCnt((chan->Cnt & 0xFF00FFFF) | (val << 16)); UpdateMixEvent(); return;
+        case 0x3: chan->SetCnt((chan->Cnt & 0x00FFFFFF) | (val << 24)); UpdateMixEvent(); return;
         }
     }
     else
@@ -1192,14 +1449,15 @@ void SPU::Write8(u32 addr, u8 val)
             return;
         case 0x04000501:
             Cnt = (Cnt & 0x007F) | ((val & 0xBF) << 8);
+            UpdateMixEvent();
             return;
 
         case 0x04000508:
-            Capture[0].SetCnt(val);
+            SetCaptureCnt(0, val);
             if (val & 0x03) Log(LogLevel::Warn, "!! UNSUPPORTED SPU CAPTURE MODE %02X\n", val);
             return;
         case 0x04000509:
-            Capture[1].SetCnt(val);
+            SetCaptureCnt(1, val);
             if (val & 0x03) Log(LogLevel::Warn, "!! UNSUPPORTED SPU CAPTURE MODE %02X\n", val);
             return;
         }
@@ -1210,23 +1468,26 @@ void SPU::Write8(u32 addr, u8 val)
 
 void SPU::Write16(u32 addr, u16 val)
 {
+    CatchUp(NDS.ARM7Timestamp);
+
     if (addr < 0x04000500)
     {
         SPUChannel* chan = &Channels[(addr >> 4) & 0xF];
 
         switch (addr & 0xF)
         {
-        case 0x0: chan->SetCnt((chan->Cnt & 0xFFFF0000) | val); return;
-        case 0x2: chan->SetCnt((chan->Cnt & 0x0000FFFF) | (val << 16)); return;
+        case 0x0: chan->SetCnt((chan->Cnt & 0xFFFF0000) | val); UpdateMixEvent(); return;
+        case 0x2: chan->SetCnt((chan->Cnt & 0x0000FFFF) | (val << 16)); UpdateMixEvent(); return;
         case 0x8:
             chan->SetTimerReload(val);
             if      ((addr & 0xF0) == 0x10) Capture[0].SetTimerReload(val);
             else if ((addr & 0xF0) == 0x30) Capture[1].SetTimerReload(val);
+            UpdateMixEvent();
             return;
-        case 0xA: chan->SetLoopPos(val); return;
+        case 0xA: chan->SetLoopPos(val); UpdateMixEvent(); return;
 
-        case 0xC: chan->SetLength(((chan->Length >> 2) & 0xFFFF0000) | val); return;
-        case 0xE: chan->SetLength(((chan->Length >> 2) & 0x0000FFFF) | (val << 16)); return;
+        case 0xC: chan->SetLength(((chan->Length >> 2) & 0xFFFF0000) | val); UpdateMixEvent(); return;
+        case 0xE: chan->SetLength(((chan->Length >> 2) & 0x0000FFFF) | (val << 16)); UpdateMixEvent(); return;
         }
     }
     else
@@ -1237,6 +1498,7 @@ void SPU::Write16(u32 addr, u16 val)
             Cnt = val & 0xBF7F;
             MasterVolume = Cnt & 0x7F;
             if (MasterVolume == 127) MasterVolume++;
+            UpdateMixEvent();
             return;
 
         case 0x04000504:
@@ -1244,8 +1506,8 @@ void SPU::Write16(u32 addr, u16 val)
             return;
 
         case 0x04000508:
-            Capture[0].SetCnt(val & 0xFF);
-            Capture[1].SetCnt(val >> 8);
+            SetCaptureCnt(0, val & 0xFF);
+            SetCaptureCnt(1, val >> 8);
             if (val & 0x0303) Log(LogLevel::Warn, "!! UNSUPPORTED SPU CAPTURE MODE %04X\n", val);
             return;
 
@@ -1259,13 +1521,15 @@ void SPU::Write16(u32 addr, u16 val)
 
 void SPU::Write32(u32 addr, u32 val)
 {
+    CatchUp(NDS.ARM7Timestamp);
+
     if (addr < 0x04000500)
     {
         SPUChannel* chan = &Channels[(addr >> 4) & 0xF];
 
         switch (addr & 0xF)
         {
-        case 0x0: chan->SetCnt(val); return;
+        case 0x0: chan->SetCnt(val); UpdateMixEvent(); return;
         case 0x4: chan->SetSrcAddr(val); return;
         case 0x8:
             chan->SetLoopPos(val >> 16);
@@ -1273,8 +1537,9 @@ void SPU::Write32(u32 addr, u32 val)
             chan->SetTimerReload(val);
             if      ((addr & 0xF0) == 0x10) Capture[0].SetTimerReload(val);
             else if ((addr & 0xF0) == 0x30) Capture[1].SetTimerReload(val);
+            UpdateMixEvent();
             return;
-        case 0xC: chan->SetLength(val); return;
+        case 0xC: chan->SetLength(val); UpdateMixEvent(); return;
         }
     }
     else
@@ -1285,6 +1550,7 @@ void SPU::Write32(u32 addr, u32 val)
             Cnt = val & 0xBF7F;
             MasterVolume = Cnt & 0x7F;
             if (MasterVolume == 127) MasterVolume++;
+            UpdateMixEvent();
             return;
 
         case 0x04000504:
@@ -1292,8 +1558,8 @@ void SPU::Write32(u32 addr, u32 val)
             return;
 
         case 0x04000508:
-            Capture[0].SetCnt(val & 0xFF);
-            Capture[1].SetCnt(val >> 8);
+            SetCaptureCnt(0, val & 0xFF);
+            SetCaptureCnt(1, val >> 8);
             if (val & 0x0303) Log(LogLevel::Warn, "!! UNSUPPORTED SPU CAPTURE MODE %04X\n", val);
             return;
 
@@ -19,6 +19,8 @@
 #ifndef SPU_H
 #define SPU_H
 
+#include <string.h>
+#include <atomic>
 #include "Savestate.h"
 #include "Platform.h"
 
@@ -118,6 +120,7 @@ public:
     void SetLength(u32 val) { Length = (val & 0x001FFFFF) << 2; }
 
     void Start();
+    u32 SamplesUntilFetch(u32 max) const;
 
     void NextSample_PCM8();
     void NextSample_PCM16();
@@ -126,32 +129,34 @@ public:
     void NextSample_Noise();
 
     template<u32 type> s32 Run();
+    template<u32 type> void Run(s32* buf, u32 samples);
 
-    s32 DoRun()
+    void DoRun(s32* buf, u32 samples)
     {
         switch ((Cnt >> 29) & 0x3)
         {
-        case 0: return Run<0>(); break;
-        case 1: return Run<1>(); break;
-        case 2: return Run<2>(); break;
+        case 0: Run<0>(buf, samples); return;
+        case 1: Run<1>(buf, samples); return;
+        case 2: Run<2>(buf, samples); return;
         case 3:
             if (Num >= 14)
             {
-                return Run<4>();
-                break;
+                Run<4>(buf, samples);
+                return;
             }
             else if (Num >= 8)
             {
-                return Run<3>();
-                break;
+                Run<3>(buf, samples);
+                return;
             }
             [[fallthrough]];
         default:
-            return 0;
+            memset(buf, 0, samples * sizeof(s32));
+            return;
         }
     }
 
-    void PanOutput(s32 in, s32& left, s32& right);
+    void PanOutput(const s32* in, s32* left, s32* right, u32 samples);
 
 private:
     melonDS::NDS& NDS;
@@ -240,6 +245,7 @@ public:
     void InitOutput();
     int GetOutputSize() const;
     void Sync(bool wait);
+    bool WaitForOutput(int samples, int timeout_ms);
     int ReadOutput(s16* data, int samples);
     void TransferOutput();
 
@@ -252,15 +258,22 @@ public:
 
 private:
     static const u32 OutputBufferSize = 2*2048;
+    // samples are mixed in batches of up to this many, see CatchUp()
+    static const u32 MixBatchSamples = 32;
     melonDS::NDS& NDS;
     s16 OutputBackbuffer[2 * OutputBufferSize] {};
     u32 OutputBackbufferWritePosition = 0;
 
+    // single-producer single-consumer ring: the emulator thread writes to it in TransferOutput(),
+    // and the audio thread reads from it in ReadOutput(), without taking any lock.
+    // positions are in stereo samples and wrap around freely, the fill level is their difference.
     s16 OutputFrontBuffer[2 * OutputBufferSize] {};
-    u32 OutputFrontBufferWritePosition = 0;
-    u32 OutputFrontBufferReadPosition = 0;
+    std::atomic<u32> OutputFrontBufferWritePosition {0};
+    std::atomic<u32> OutputFrontBufferReadPosition {0};
 
-    Platform::Mutex* AudioLock;
+    // set while WaitForOutput() is blocked, so that ReadOutput() signals OutputSema
+    std::atomic_bool OutputWaiting {false};
+    Platform::Semaphore* OutputSema;
 
     u16 Cnt = 0;
     u8 MasterVolume = 0;
@@ -270,6 +283,18 @@ private:
 
     std::array<SPUChannel, 16> Channels;
     std::array<SPUCaptureUnit, 2> Capture;
+
+    u64 MixTimestamp = 0; // when the next sample is due
+
+    bool IsCapturing() const { return (Capture[0].Cnt | Capture[1].Cnt) & (1<<7); }
+    u32 NextBatchSize() const;
+    void UpdateMixEvent();
+    void SetCaptureCnt(u32 num, u8 val);
+
+    void CatchUp(u64 timestamp, bool dummy = false);
+    void MixSamples(u32 samples, bool dummy);
+
+    void DropOutput(u32 keep);
 };
 
 }
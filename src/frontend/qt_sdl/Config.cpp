@@ -54,6 +54,7 @@ DefaultList<int> DefaultInts =
     {"Instance*.Window*.Height", 384},
     {"Screen.VSyncInterval", 1},
     {"3D.Renderer", renderer3D_Software},
+    {"3D.Soft.ScaleFactor", 1},
     {"3D.GL.ScaleFactor", 1},
 #ifdef JIT_ENABLED
     {"JIT.MaxBlockSize", 32},
@@ -64,6 +65,7 @@ DefaultList<int> DefaultInts =
     {"MP.AudioMode", 1},
     {"MP.RecvTimeout", 25},
     {"Instance*.Audio.Volume", 256},
+    {"Audio.OutputRate", 48000},
     {"Mic.InputType", 1},
     {"Mouse.HideSeconds", 5},
     {"Instance*.DSi.Battery.Level", 0xF},
@@ -79,9 +81,11 @@ RangeList IntRanges =
     {"Emu.ConsoleType", {0, 1}},
     {"3D.Renderer", {0, renderer3D_Max-1}},
     {"Screen.VSyncInterval", {1, 20}},
+    {"3D.Soft.ScaleFactor", {1, 4}},
     {"3D.GL.ScaleFactor", {1, 16}},
     {"Audio.Interpolation", {0, 4}},
     {"Instance*.Audio.Volume", {0, 256}},
+    {"Audio.OutputRate", {8000, 192000}},
     {"Mic.InputType", {0, micInputType_MAX-1}},
     {"Instance*.Window*.ScreenRotation", {0, screenRot_MAX-1}},
     {"Instance*.Window*.ScreenGap", {0, 500}},
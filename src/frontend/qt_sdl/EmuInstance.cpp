@@ -47,6 +47,7 @@
 #include "RTC.h"
 #include "DSi_I2C.h"
 #include "FreeBIOS.h"
+#include "ROMIndex.h"
 #include "main.h"
 
 using std::make_unique;
@@ -1200,6 +1201,7 @@ bool EmuInstance::updateConsole(UpdateConsoleNDSArgs&& _ndsargs, UpdateConsoleGB
             static_cast<AudioInterpolation>(globalCfg.GetInt("Audio.Interpolation")),
             gdbargs,
     };
+    ndsargs.CartBurstTransfers = globalCfg.GetBool("Emu.CartBurstTransfers");
     NDSArgs* args = &ndsargs;
 
     std::optional<DSiArgs> dsiargs = std::nullopt;
@@ -1228,6 +1230,7 @@ bool EmuInstance::updateConsole(UpdateConsoleNDSArgs&& _ndsargs, UpdateConsoleGB
                 std::move(*nand),
                 std::move(sdcard),
                 globalCfg.GetBool("DSi.FullBIOSBoot"),
+                globalCfg.GetBool("DSi.DSPThreaded"),
         };
 
         dsiargs = std::move(_dsiargs);
@@ -1259,6 +1262,7 @@ bool EmuInstance::updateConsole(UpdateConsoleNDSArgs&& _ndsargs, UpdateConsoleGB
         // TODO GDB stub shit
         nds->SPU.SetInterpolation(args->Interpolation);
         nds->SPU.SetDegrade10Bit(args->BitDepth);
+        nds->NDSCartSlot.SetBurstTransfers(args->CartBurstTransfers);
 
         if (consoletype == 1)
         {
@@ -1266,6 +1270,7 @@ bool EmuInstance::updateConsole(UpdateConsoleNDSArgs&& _ndsargs, UpdateConsoleGB
             DSiArgs& _dsiargs = *dsiargs;
 
             dsi->SetFullBIOSBoot(_dsiargs.FullBIOSBoot);
+            dsi->DSP.SetThreaded(_dsiargs.DSPThreaded);
             dsi->ARM7iBIOS = *_dsiargs.ARM7iBIOS;
             dsi->ARM9iBIOS = *_dsiargs.ARM9iBIOS;
             dsi->SetNAND(std::move(_dsiargs.NANDImage));
@@ -1720,6 +1725,61 @@ bool EmuInstance::loadROMData(const QStringList& filepath, std::unique_ptr<u8[]>
         return false;
 }
 
+bool EmuInstance::loadROMData(const QStringList& filepath, ROMPointer& filedata, u32& filelen, string& basepath, string& romname) noexcept
+{
+    // plain ROM files are mapped rather than read in whole: the data is only loaded as it's used,
+    // and is shared with other instances running the same ROM
+    if (filepath.count() == 1)
+    {
+        std::string filename = filepath.at(0).toStdString();
+        if (!(filename.length() > 4 && filename.substr(filename.length() - 4) == ".zst"))
+        {
+            filedata = MapROMFile(filename, filelen);
+            if (filedata)
+            {
+                int pos = lastSep(filename);
+                if(pos != -1)
+                    basepath = filename.substr(0, pos);
+
+                romname = filename.substr(pos+1);
+                return true;
+            }
+        }
+    }
+
+    unique_ptr<u8[]> readdata = nullptr;
+    if (!loadROMData(filepath, readdata, filelen, basepath, romname))
+        return false;
+
+    filedata = std::move(readdata);
+    return true;
+}
+
+bool EmuInstance::loadROMData(const QStringList& filepath, std::unique_ptr<ChunkedROM>& filedata, string& basepath, string& romname) noexcept
+{
+    // chunked ROM files are decompressed a block at a time as the game reads them
+    if (filepath.count() != 1) return false;
+
+    std::string filename = filepath.at(0).toStdString();
+    std::shared_ptr<ZSTD_DCtx> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    filedata = ChunkedROM::Open(filename, [dctx](const u8* src, u32 srclen, u8* dst, u32 dstlen)
+    {
+        size_t ret = ZSTD_decompressDCtx(dctx.get(), dst, dstlen, src, srclen);
+        return !ZSTD_isError(ret) && ret == dstlen;
+    });
+    if (!filedata) return false;
+
+    // name things after the ROM the file was made from
+    filename = filename.substr(0, filename.length() - 4) + ".nds";
+
+    int pos = lastSep(filename);
+    if(pos != -1)
+        basepath = filename.substr(0, pos);
+
+    romname = filename.substr(pos+1);
+    return true;
+}
+
 QString EmuInstance::getSavErrorString(std::string& filepath, bool gba)
 {
     std::string console = gba ? "GBA" : "DS";
@@ -1733,12 +1793,17 @@ QString EmuInstance::getSavErrorString(std::string& filepath, bool gba)
 
 bool EmuInstance::loadROM(QStringList filepath, bool reset)
 {
-    unique_ptr<u8[]> filedata = nullptr;
+    ROMPointer filedata = nullptr;
+    unique_ptr<ChunkedROM> chunkeddata = nullptr;
     u32 filelen;
     std::string basepath;
     std::string romname;
 
-    if (!loadROMData(filepath, filedata, filelen, basepath, romname))
+    bool chunked = filepath.count() == 1 && filepath.at(0).endsWith(".ndz", Qt::CaseInsensitive);
+    bool loaded = chunked ?
+        loadROMData(filepath, chunkeddata, basepath, romname) :
+        loadROMData(filepath, filedata, filelen, basepath, romname);
+    if (!loaded)
     {
         QMessageBox::critical(mainWindow, "melonDS", "Failed to load the DS ROM.");
         return false;
@@ -1793,7 +1858,9 @@ bool EmuInstance::loadROM(QStringList filepath, bool reset)
             .SRAMLength = savelen,
     };
 
-    auto cart = NDSCart::ParseROM(std::move(filedata), filelen, this, std::move(cartargs));
+    auto cart = chunked ?
+        NDSCart::ParseROM(std::move(chunkeddata), this, std::move(cartargs)) :
+        NDSCart::ParseROM(std::move(filedata), filelen, this, std::move(cartargs));
     if (!cart)
     {
         // If we couldn't parse the ROM...
@@ -2000,32 +2067,7 @@ QString EmuInstance::gbaCartLabel()
 
 void EmuInstance::romIcon(const u8 (&data)[512], const u16 (&palette)[16], u32 (&iconRef)[32*32])
 {
-    u32 paletteRGBA[16];
-    for (int i = 0; i < 16; i++)
-    {
-        u8 r = ((palette[i] >> 0)  & 0x1F) * 255 / 31;
-        u8 g = ((palette[i] >> 5)  & 0x1F) * 255 / 31;
-        u8 b = ((palette[i] >> 10) & 0x1F) * 255 / 31;
-        u8 a = i ? 255 : 0;
-        paletteRGBA[i] = r | (g << 8) | (b << 16) | (a << 24);
-    }
-
-    int count = 0;
-    for (int ytile = 0; ytile < 4; ytile++)
-    {
-        for (int xtile = 0; xtile < 4; xtile++)
-        {
-            for (int ypixel = 0; ypixel < 8; ypixel++)
-            {
-                for (int xpixel = 0; xpixel < 8; xpixel++)
-                {
-                    u8 pal_index = count % 2 ? data[count/2] >> 4 : data[count/2] & 0x0F;
-                    iconRef[ytile*256 + ypixel*32 + xtile*8 + xpixel] = paletteRGBA[pal_index];
-                    count++;
-                }
-            }
-        }
-    }
+    DecodeBannerIcon(data, palette, iconRef);
 }
 
 #define SEQ_FLIPV(i) ((i & 0b1000000000000000) >> 15)
@@ -22,6 +22,7 @@
 #include <SDL2/SDL.h>
 
 #include "NDS.h"
+#include "AudioResampler.h"
 #include "EmuThread.h"
 #include "Window.h"
 #include "Config.h"
@@ -177,6 +178,8 @@ private:
     bool parseMacAddress(void* data);
     void customizeFirmware(melonDS::Firmware& firmware, bool overridesettings) noexcept;
     bool loadROMData(const QStringList& filepath, std::unique_ptr<melonDS::u8[]>& filedata, melonDS::u32& filelen, std::string& basepath, std::string& romname) noexcept;
+    bool loadROMData(const QStringList& filepath, melonDS::ROMPointer& filedata, melonDS::u32& filelen, std::string& basepath, std::string& romname) noexcept;
+    bool loadROMData(const QStringList& filepath, std::unique_ptr<melonDS::ChunkedROM>& filedata, std::string& basepath, std::string& romname) noexcept;
     QString getSavErrorString(std::string& filepath, bool gba);
     bool loadROM(QStringList filepath, bool reset);
     void ejectCart();
@@ -202,9 +205,6 @@ private:
     void micProcess();
     void setupMicInputData();
 
-    int audioGetNumSamplesOut(int outlen);
-    void audioResample(melonDS::s16* inbuf, int inlen, melonDS::s16* outbuf, int outlen, int volume);
-
     static void audioCallback(void* data, Uint8* stream, int len);
     static void micCallback(void* data, Uint8* stream, int len);
 
@@ -273,10 +273,8 @@ private:
 
     SDL_AudioDeviceID audioDevice;
     int audioFreq;
-    float audioSampleFrac;
+    melonDS::AudioResampler audioResampler;
     bool audioMuted;
-    SDL_cond* audioSyncCond;
-    SDL_mutex* audioSyncLock;
 
     int mpAudioMode;
 
@@ -27,78 +27,52 @@
 using namespace melonDS;
 
 
-int EmuInstance::audioGetNumSamplesOut(int outlen)
-{
-    float f_len_in = (outlen * 32823.6328125) / (float)audioFreq;
-    f_len_in += audioSampleFrac;
-    int len_in = (int)floor(f_len_in);
-    audioSampleFrac = f_len_in - len_in;
-
-    return len_in;
-}
-
-void EmuInstance::audioResample(s16* inbuf, int inlen, s16* outbuf, int outlen, int volume)
-{
-    float res_incr = inlen / (float)outlen;
-    float res_timer = -0.5;
-    int res_pos = 0;
-
-    for (int i = 0; i < outlen; i++)
-    {
-        s16 l1 = inbuf[res_pos * 2];
-        s16 l2 = inbuf[res_pos * 2 + 2];
-        s16 r1 = inbuf[res_pos * 2 + 1];
-        s16 r2 = inbuf[res_pos * 2 + 3];
-
-        float l = (float) l1 + ((l2 - l1) * res_timer);
-        float r = (float) r1 + ((r2 - r1) * res_timer);
-
-        outbuf[i*2  ] = (s16) (((s32) round(l) * volume) >> 8);
-        outbuf[i*2+1] = (s16) (((s32) round(r) * volume) >> 8);
-
-        res_timer += res_incr;
-        while (res_timer >= 1.0)
-        {
-            res_timer -= 1.0;
-            res_pos++;
-        }
-    }
-}
+// amount of SPU output the audio callback tries to keep buffered, see AudioResampler::UpdateRateControl()
+const int kAudioTargetBuffered = 1024;
 
 void EmuInstance::audioCallback(void* data, Uint8* stream, int len)
 {
     EmuInstance* inst = (EmuInstance*)data;
+    s16* out = (s16*)stream;
     len /= (sizeof(s16) * 2);
 
     // resample incoming audio to match the output sample rate
 
-    int len_in = inst->audioGetNumSamplesOut(len);
+    AudioResampler& resampler = inst->audioResampler;
+    resampler.UpdateRateControl(inst->nds->SPU.GetOutputSize(), kAudioTargetBuffered);
+
+    // at low output rates, a callback can need more input than fits in the buffer at once
     s16 buf_in[1024*2];
-    int num_in;
+    int num_out = 0;
+    while (num_out < len)
+    {
+        int len_in = std::min(resampler.GetInputNeeded(len - num_out), 1024);
+        int num_in = 0;
+        if (len_in > 0)
+        {
+            num_in = inst->nds->SPU.ReadOutput(buf_in, len_in);
+            resampler.Push(buf_in, num_in);
+        }
 
-    SDL_LockMutex(inst->audioSyncLock);
-    num_in = inst->nds->SPU.ReadOutput(buf_in, len_in);
-    SDL_CondSignal(inst->audioSyncCond);
-    SDL_UnlockMutex(inst->audioSyncLock);
+        int pulled = resampler.Pull(&out[num_out*2], len - num_out, inst->audioVolume);
+        num_out += pulled;
 
-    if ((num_in < 1) || inst->audioMuted)
-    {
-        memset(stream, 0, len*sizeof(s16)*2);
-        return;
+        // the SPU ran out of output
+        if (num_in < len_in || pulled == 0)
+            break;
     }
 
-    int margin = 6;
-    if (num_in < len_in-margin)
+    if (inst->audioMuted)
     {
-        int last = num_in-1;
-
-        for (int i = num_in; i < len_in-margin; i++)
-            ((u32*)buf_in)[i] = ((u32*)buf_in)[last];
-
-        num_in = len_in-margin;
+        memset(stream, 0, len*sizeof(s16)*2);
+        return;
     }
 
-    inst->audioResample(buf_in, num_in, (s16*)stream, len, inst->audioVolume);
+    // not enough input: hold the last sample rather than clicking back to silence
+    // if there was no output at all, there's nothing to hold, so it's silence
+    u32 last = (num_out > 0) ? ((u32*)out)[num_out-1] : 0;
+    for (int i = num_out; i < len; i++)
+        ((u32*)out)[i] = last;
 }
 
 void EmuInstance::micCallback(void* data, Uint8* stream, int len)
@@ -372,10 +346,8 @@ void EmuInstance::audioInit()
     audioDSiVolumeSync = localCfg.GetBool("Audio.DSiVolumeSync");
 
     audioMuted = false;
-    audioSyncCond = SDL_CreateCond();
-    audioSyncLock = SDL_CreateMutex();
 
-    audioFreq = 48000; // TODO: make configurable?
+    audioFreq = globalCfg.GetInt("Audio.OutputRate");
     SDL_AudioSpec whatIwant, whatIget;
     memset(&whatIwant, 0, sizeof(SDL_AudioSpec));
     whatIwant.freq = audioFreq;
@@ -396,7 +368,8 @@ void EmuInstance::audioInit()
         SDL_PauseAudioDevice(audioDevice, 1);
     }
 
-    audioSampleFrac = 0;
+    audioResampler.SetRates(AudioResampler::SPUOutputRate, audioFreq);
+    audioResampler.Reset();
 
     micDevice = 0;
 
@@ -417,12 +390,6 @@ void EmuInstance::audioDeInit()
     audioDevice = 0;
     micClose();
 
-    if (audioSyncCond) SDL_DestroyCond(audioSyncCond);
-    audioSyncCond = nullptr;
-
-    if (audioSyncLock) SDL_DestroyMutex(audioSyncLock);
-    audioSyncLock = nullptr;
-
     if (micWavBuffer) delete[] micWavBuffer;
     micWavBuffer = nullptr;
 }
@@ -430,15 +397,7 @@ void EmuInstance::audioDeInit()
 void EmuInstance::audioSync()
 {
     if (audioDevice)
-    {
-        SDL_LockMutex(audioSyncLock);
-        while (nds->SPU.GetOutputSize() > 1024)
-        {
-            int ret = SDL_CondWaitTimeout(audioSyncCond, audioSyncLock, 500);
-            if (ret == SDL_MUTEX_TIMEDOUT) break;
-        }
-        SDL_UnlockMutex(audioSyncLock);
-    }
+        nds->SPU.WaitForOutput(1024, 500);
 }
 
 void EmuInstance::audioUpdateSettings()
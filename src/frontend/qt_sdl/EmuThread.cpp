@@ -319,11 +319,13 @@ void EmuThread::run()
             {
                 FrontBufferLock.lock();
                 FrontBuffer = emuInstance->nds->GPU.FrontBuffer;
+                FrontBufferScale = emuInstance->nds->GPU.GetFramebufferScale();
                 FrontBufferLock.unlock();
             }
             else
             {
                 FrontBuffer = emuInstance->nds->GPU.FrontBuffer;
+                FrontBufferScale = emuInstance->nds->GPU.GetFramebufferScale();
                 emuInstance->drawScreenGL();
             }
 
@@ -662,6 +664,10 @@ bool EmuThread::emuIsActive()
 
 void EmuThread::updateRenderer()
 {
+    // the framebuffers may be reallocated at a different size,
+    // so the screen must not be reading them meanwhile
+    FrontBufferLock.lock();
+
     if (videoRenderer != lastVideoRenderer)
     {
         printf("creating renderer %d\n", videoRenderer);
@@ -688,6 +694,10 @@ void EmuThread::updateRenderer()
             static_cast<SoftRenderer&>(emuInstance->nds->GPU.GetRenderer3D()).SetThreaded(
                     cfg.GetBool("3D.Soft.Threaded"),
                     emuInstance->nds->GPU);
+            static_cast<SoftRenderer&>(emuInstance->nds->GPU.GetRenderer3D()).SetRenderSettings(
+                    cfg.GetInt("3D.Soft.ScaleFactor"),
+                    cfg.GetBool("3D.Soft.HiresCoordinates"),
+                    emuInstance->nds->GPU);
             break;
         case renderer3D_OpenGL:
             static_cast<GLRenderer&>(emuInstance->nds->GPU.GetRenderer3D()).SetRenderSettings(
@@ -701,6 +711,10 @@ void EmuThread::updateRenderer()
             break;
         default: __builtin_unreachable();
     }
+
+    FrontBuffer = emuInstance->nds->GPU.FrontBuffer;
+    FrontBufferScale = emuInstance->nds->GPU.GetFramebufferScale();
+    FrontBufferLock.unlock();
 }
 
 void EmuThread::compileShaders()
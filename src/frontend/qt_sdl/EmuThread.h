@@ -107,7 +107,10 @@ public:
     void deinitContext();
     void updateVideoSettings() { videoSettingsDirty = true; }
 
+    // the framebuffer to display and the scale it was rendered at,
+    // both only valid under FrontBufferLock when not using OpenGL
     int FrontBuffer = 0;
+    int FrontBufferScale = 1;
     QMutex FrontBufferLock;
 
 signals:
@@ -19,6 +19,7 @@
 #include <string.h>
 
 #include <optional>
+#include <vector>
 #include <cmath>
 
 #include <QPaintEvent>
@@ -689,8 +690,17 @@ void ScreenPanelNative::paintEvent(QPaintEvent* event)
             return;
         }
 
-        memcpy(screen[0].scanLine(0), nds->GPU.Framebuffer[frontbuf][0].get(), 256 * 192 * 4);
-        memcpy(screen[1].scanLine(0), nds->GPU.Framebuffer[frontbuf][1].get(), 256 * 192 * 4);
+        // the software renderer may render at a higher resolution
+        int scale = emuThread->FrontBufferScale;
+        if (scale != screenScale)
+        {
+            screenScale = scale;
+            screen[0] = QImage(256 * scale, 192 * scale, QImage::Format_RGB32);
+            screen[1] = QImage(256 * scale, 192 * scale, QImage::Format_RGB32);
+        }
+
+        memcpy(screen[0].scanLine(0), nds->GPU.Framebuffer[frontbuf][0].get(), 256 * 192 * 4 * scale * scale);
+        memcpy(screen[1].scanLine(0), nds->GPU.Framebuffer[frontbuf][1].get(), 256 * 192 * 4 * scale * scale);
         emuThread->FrontBufferLock.unlock();
 
         QRect screenrc(0, 0, 256, 192);
@@ -836,11 +846,7 @@ void ScreenPanelGL::initOpenGL()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256, paddedHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    // fill the padding
-    u8 zeroData[256*4*4];
-    memset(zeroData, 0, sizeof(zeroData));
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 192, 256, 2, GL_RGBA, GL_UNSIGNED_BYTE, zeroData);
+    allocScreenTexture(1);
 
 
     OpenGL::CompileVertexFragmentProgram(osdShader,
@@ -879,6 +885,18 @@ void ScreenPanelGL::initOpenGL()
     transferLayout();
 }
 
+void ScreenPanelGL::allocScreenTexture(int scale)
+{
+    // the texture holds both screens, with padding between them
+    // to prevent bleeding with bilinear filtering enabled
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 256*scale, (192*2+2)*scale, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    // fill the padding
+    std::vector<u8> zeroData(256*scale * 2*scale * 4, 0);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 192*scale, 256*scale, 2*scale, GL_RGBA, GL_UNSIGNED_BYTE, zeroData.data());
+
+    screenTextureScale = scale;
+}
+
 void ScreenPanelGL::deinitOpenGL()
 {
     if (!glContext) return;
@@ -988,9 +1006,13 @@ void ScreenPanelGL::drawScreenGL()
 
         if (nds->GPU.Framebuffer[frontbuf][0] && nds->GPU.Framebuffer[frontbuf][1])
         {
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 192, GL_RGBA,
+            int scale = emuThread->FrontBufferScale;
+            if (scale != screenTextureScale)
+                allocScreenTexture(scale);
+
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256*scale, 192*scale, GL_RGBA,
                             GL_UNSIGNED_BYTE, nds->GPU.Framebuffer[frontbuf][0].get());
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 192+2, 256, 192, GL_RGBA,
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, (192+2)*scale, 256*scale, 192*scale, GL_RGBA,
                             GL_UNSIGNED_BYTE, nds->GPU.Framebuffer[frontbuf][1].get());
         }
     }
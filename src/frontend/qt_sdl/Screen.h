@@ -159,6 +159,7 @@ private:
     void setupScreenLayout() override;
 
     QImage screen[2];
+    int screenScale = 1;
     QTransform screenTrans[kMaxScreenTransforms];
 };
 
@@ -195,11 +196,13 @@ protected:
 
 private:
     void setupScreenLayout() override;
+    void allocScreenTexture(int scale);
 
     std::unique_ptr<GL::Context> glContext;
 
     GLuint screenVertexBuffer, screenVertexArray;
     GLuint screenTexture;
+    int screenTextureScale = 1;
     GLuint screenShaderProgram;
     GLuint screenShaderTransformULoc, screenShaderScreenSizeULoc;
 
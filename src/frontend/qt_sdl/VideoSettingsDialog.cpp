@@ -45,9 +45,19 @@ void VideoSettingsDialog::setEnabled()
     bool softwareRenderer = renderer == renderer3D_Software;
     ui->cbGLDisplay->setEnabled(softwareRenderer);
     ui->cbSoftwareThreaded->setEnabled(softwareRenderer);
+    ui->cbxSoftResolution->setEnabled(softwareRenderer);
     ui->cbxGLResolution->setEnabled(!softwareRenderer);
     ui->cbBetterPolygons->setEnabled(renderer == renderer3D_OpenGL);
-    ui->cbxComputeHiResCoords->setEnabled(renderer == renderer3D_OpenGLCompute);
+    ui->cbxComputeHiResCoords->setEnabled(renderer != renderer3D_OpenGL);
+}
+
+const char* VideoSettingsDialog::hiresCoordinatesKey()
+{
+    // the software and compute renderers each have their own setting, shown in the same checkbox
+    auto& cfg = emuInstance->getGlobalConfig();
+    if (cfg.GetInt("3D.Renderer") == renderer3D_Software)
+        return "3D.Soft.HiresCoordinates";
+    return "3D.GL.HiresCoordinates";
 }
 
 VideoSettingsDialog::VideoSettingsDialog(QWidget* parent) : QDialog(parent), ui(new Ui::VideoSettingsDialog)
@@ -63,9 +73,11 @@ VideoSettingsDialog::VideoSettingsDialog(QWidget* parent) : QDialog(parent), ui(
     oldVSync = cfg.GetBool("Screen.VSync");
     oldVSyncInterval = cfg.GetInt("Screen.VSyncInterval");
     oldSoftThreaded = cfg.GetBool("3D.Soft.Threaded");
+    oldSoftScale = cfg.GetInt("3D.Soft.ScaleFactor");
     oldGLScale = cfg.GetInt("3D.GL.ScaleFactor");
     oldGLBetterPolygons = cfg.GetBool("3D.GL.BetterPolygons");
-    oldHiresCoordinates = cfg.GetBool("3D.GL.HiresCoordinates");
+    oldSoftHiresCoordinates = cfg.GetBool("3D.Soft.HiresCoordinates");
+    oldGLHiresCoordinates = cfg.GetBool("3D.GL.HiresCoordinates");
 
     grp3DRenderer = new QButtonGroup(this);
     grp3DRenderer->addButton(ui->rb3DSoftware, renderer3D_Software);
@@ -93,12 +105,16 @@ VideoSettingsDialog::VideoSettingsDialog(QWidget* parent) : QDialog(parent), ui(
 
     ui->cbSoftwareThreaded->setChecked(oldSoftThreaded);
 
+    for (int i = 1; i <= 4; i++)
+        ui->cbxSoftResolution->addItem(QString("%1x native (%2x%3)").arg(i).arg(256*i).arg(192*i));
+    ui->cbxSoftResolution->setCurrentIndex(oldSoftScale-1);
+
     for (int i = 1; i <= 16; i++)
         ui->cbxGLResolution->addItem(QString("%1x native (%2x%3)").arg(i).arg(256*i).arg(192*i));
     ui->cbxGLResolution->setCurrentIndex(oldGLScale-1);
 
     ui->cbBetterPolygons->setChecked(oldGLBetterPolygons != 0);
-    ui->cbxComputeHiResCoords->setChecked(oldHiresCoordinates != 0);
+    ui->cbxComputeHiResCoords->setChecked(cfg.GetBool(hiresCoordinatesKey()));
 
     if (!oldVSync)
         ui->sbVSyncInterval->setEnabled(false);
@@ -129,9 +145,11 @@ void VideoSettingsDialog::on_VideoSettingsDialog_rejected()
     cfg.SetBool("Screen.VSync", oldVSync);
     cfg.SetInt("Screen.VSyncInterval", oldVSyncInterval);
     cfg.SetBool("3D.Soft.Threaded", oldSoftThreaded);
+    cfg.SetInt("3D.Soft.ScaleFactor", oldSoftScale);
     cfg.SetInt("3D.GL.ScaleFactor", oldGLScale);
     cfg.SetBool("3D.GL.BetterPolygons", oldGLBetterPolygons);
-    cfg.SetBool("3D.GL.HiresCoordinates", oldHiresCoordinates);
+    cfg.SetBool("3D.Soft.HiresCoordinates", oldSoftHiresCoordinates);
+    cfg.SetBool("3D.GL.HiresCoordinates", oldGLHiresCoordinates);
 
     emit updateVideoSettings(old_gl != UsesGL());
 
@@ -152,6 +170,7 @@ void VideoSettingsDialog::onChange3DRenderer(int renderer)
     cfg.SetInt("3D.Renderer", renderer);
 
     setEnabled();
+    ui->cbxComputeHiResCoords->setChecked(cfg.GetBool(hiresCoordinatesKey()));
 
     emit updateVideoSettings(old_gl != UsesGL());
 }
@@ -195,6 +214,17 @@ void VideoSettingsDialog::on_cbSoftwareThreaded_stateChanged(int state)
     emit updateVideoSettings(false);
 }
 
+void VideoSettingsDialog::on_cbxSoftResolution_currentIndexChanged(int idx)
+{
+    // prevent a spurious change
+    if (ui->cbxSoftResolution->count() < 4) return;
+
+    auto& cfg = emuInstance->getGlobalConfig();
+    cfg.SetInt("3D.Soft.ScaleFactor", idx+1);
+
+    emit updateVideoSettings(false);
+}
+
 void VideoSettingsDialog::on_cbxGLResolution_currentIndexChanged(int idx)
 {
     // prevent a spurious change
@@ -219,7 +249,7 @@ void VideoSettingsDialog::on_cbBetterPolygons_stateChanged(int state)
 void VideoSettingsDialog::on_cbxComputeHiResCoords_stateChanged(int state)
 {
     auto& cfg = emuInstance->getGlobalConfig();
-    cfg.SetBool("3D.GL.HiresCoordinates", (state != 0));
+    cfg.SetBool(hiresCoordinatesKey(), (state != 0));
 
     emit updateVideoSettings(false);
 }
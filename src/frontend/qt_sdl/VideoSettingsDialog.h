@@ -71,9 +71,11 @@ private slots:
     void on_cbxComputeHiResCoords_stateChanged(int state);
 
     void on_cbSoftwareThreaded_stateChanged(int state);
+    void on_cbxSoftResolution_currentIndexChanged(int idx);
 private:
     void setVsyncControlEnable(bool hasOGL);
     void setEnabled();
+    const char* hiresCoordinatesKey();
 
     Ui::VideoSettingsDialog* ui;
     EmuInstance* emuInstance;
@@ -85,9 +87,11 @@ private:
     int oldVSync;
     int oldVSyncInterval;
     int oldSoftThreaded;
+    int oldSoftScale;
     int oldGLScale;
     int oldGLBetterPolygons;
-    int oldHiresCoordinates;
+    int oldSoftHiresCoordinates;
+    int oldGLHiresCoordinates;
 };
 
 #endif // VIDEOSETTINGSDIALOG_H
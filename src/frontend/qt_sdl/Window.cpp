@@ -200,11 +200,19 @@ static bool ZstdGbaRomByExtension(const QString& filename)
         GbaRomByExtension(filename.left(filename.size() - 4));
 }
 
+static bool ChunkedNdsRomByExtension(const QString& filename)
+{
+    return filename.endsWith(".ndz", Qt::CaseInsensitive);
+}
+
 static bool FileIsSupportedFiletype(const QString& filename, bool insideArchive = false)
 {
     if (ZstdNdsRomByExtension(filename) || ZstdGbaRomByExtension(filename))
         return true;
 
+    if (ChunkedNdsRomByExtension(filename))
+        return true;
+
     if (NdsRomByExtension(filename) || GbaRomByExtension(filename) || SupportedArchiveByExtension(filename))
         return true;
 
@@ -423,6 +431,9 @@ MainWindow::MainWindow(int id, EmuInstance* inst, QWidget* parent) :
             actRAMInfo = menu->addAction("RAM search");
             connect(actRAMInfo, &QAction::triggered, this, &MainWindow::onRAMInfo);
 
+            actCaptureGX = menu->addAction("Capture 3D frame");
+            connect(actCaptureGX, &QAction::triggered, this, &MainWindow::onCaptureGX);
+
             actTitleManager = menu->addAction("Manage DSi titles");
             connect(actTitleManager, &QAction::triggered, this, &MainWindow::onOpenTitleManager);
         }
@@ -707,6 +718,7 @@ MainWindow::MainWindow(int id, EmuInstance* inst, QWidget* parent) :
 
     actROMInfo->setEnabled(false);
     actRAMInfo->setEnabled(false);
+    actCaptureGX->setEnabled(false);
 
     actSavestateSRAMReloc->setChecked(globalCfg.GetBool("Savestate.RelocSRAM"));
 
@@ -929,6 +941,7 @@ void MainWindow::dropEvent(QDropEvent* event)
     bool isNdsRom = NdsRomByExtension(filename) || NdsRomByMimetype(mimetype);
     bool isGbaRom = GbaRomByExtension(filename) || GbaRomByMimetype(mimetype);
     isNdsRom |= ZstdNdsRomByExtension(filename);
+    isNdsRom |= ChunkedNdsRomByExtension(filename);
     isGbaRom |= ZstdGbaRomByExtension(filename);
 
     if (isNdsRom)
@@ -1176,6 +1189,12 @@ QStringList MainWindow::pickROM(bool gba)
     extraFilters += ");;Zstandard-compressed " + console + " ROMs (" + zstdROMs + ")";
     allROMs += " " + zstdROMs;
 
+    if (!gba)
+    {
+        extraFilters += ";;Chunked DS ROMs (*.ndz)";
+        allROMs += " *.ndz";
+    }
+
 #ifdef ARCHIVE_SUPPORT_ENABLED
     QString archives = "*" + ArchiveExtensions.join(" *");
     extraFilters += ";;Archives (" + archives + ")";
@@ -1213,6 +1232,7 @@ void MainWindow::updateCartInserted(bool gba)
         actSetupCheats->setEnabled(inserted);
         actROMInfo->setEnabled(inserted);
         actRAMInfo->setEnabled(inserted);
+        actCaptureGX->setEnabled(inserted);
     }
 }
 
@@ -1691,6 +1711,24 @@ void MainWindow::onRAMInfo()
     RAMInfoDialog* dlg = RAMInfoDialog::openDlg(this);
 }
 
+void MainWindow::onCaptureGX()
+{
+    emuThread->emuPause();
+
+    QString qfilename = QFileDialog::getSaveFileName(this,
+                                                     "Capture 3D frame",
+                                                     globalCfg.GetQString("LastROMFolder"),
+                                                     "GX captures (*.gxcap);;Any file (*.*)");
+    if (!qfilename.isEmpty())
+    {
+        // the capture is written out once the frame has been rendered
+        emuInstance->nds->GPU.GPU3D.StartCapture(std::make_unique<GXCapture>(qfilename.toStdString(), 1));
+        emuInstance->osdAddMessage(0, "Capturing 3D frame");
+    }
+
+    emuThread->emuUnpause();
+}
+
 void MainWindow::onOpenTitleManager()
 {
     TitleManagerDialog* dlg = TitleManagerDialog::openDlg(this);
@@ -169,6 +169,7 @@ private slots:
     void onCheatsDialogFinished(int res);
     void onROMInfo();
     void onRAMInfo();
+    void onCaptureGX();
     void onOpenTitleManager();
     void onMPNewInstance();
     void onLANStartHost();
@@ -288,6 +289,7 @@ public:
     QAction* actSetupCheats;
     QAction* actROMInfo;
     QAction* actRAMInfo;
+    QAction* actCaptureGX;
     QAction* actTitleManager;
     QAction* actMPNewInstance;
     QAction* actLANStartHost;
@@ -0,0 +1,147 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+// Replays a GX capture through the geometry engine and the software renderer,
+// reporting how long it took and a hash of every rendered frame.
+// With -s, the per-frame 3D pipeline statistics are printed as well.
+//
+// usage: melonDS-gxreplay [-s] <capture> [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "NDS.h"
+#include "GPU.h"
+#include "GPU3D_Capture.h"
+#include "GPU3D_Soft.h"
+
+#define XXH_STATIC_LINKING_ONLY
+#include "xxhash/xxhash.h"
+
+using namespace melonDS;
+using Clock = std::chrono::steady_clock;
+
+static double ElapsedMS(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    bool showstats = argc > 1 && !strcmp(argv[1], "-s");
+    if (showstats)
+    {
+        argv++;
+        argc--;
+    }
+
+    if (argc < 2)
+    {
+        printf("usage: %s [-s] <capture> [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    int iterations = (argc > 2) ? atoi(argv[2]) : 1;
+    if (iterations < 1) iterations = 1;
+
+    GXReplay replay;
+    if (!replay.Load(argv[1]))
+        return 1;
+
+    auto nds = std::make_unique<NDS>();
+    nds->Reset();
+    nds->GPU.SetRenderer3D(std::make_unique<SoftRenderer>());
+
+    std::vector<u64> hashes;
+    std::vector<GPU3DStats> stats;
+    double geometrytime = 0, rendertime = 0;
+
+    for (int i = 0; i < iterations; i++)
+    {
+        if (!replay.Restore(nds->GPU))
+        {
+            printf("failed to restore the captured GPU3D state\n");
+            return 1;
+        }
+
+        u32 frame = 0;
+        for (;;)
+        {
+            auto start = Clock::now();
+            if (!replay.AdvanceToRender(nds->GPU))
+                break;
+            auto mid = Clock::now();
+
+            nds->GPU.GPU3D.VCount215(nds->GPU);
+
+            XXH3_state_t* hashstate = XXH3_createState();
+            XXH3_64bits_reset(hashstate);
+            for (int line = 0; line < 192; line++)
+                XXH3_64bits_update(hashstate, nds->GPU.GetRenderer3D().GetLine(line), 256*4);
+            u64 hash = XXH3_64bits_digest(hashstate);
+            XXH3_freeState(hashstate);
+
+            // the renderer's statistics are published once it's done with the frame
+            nds->GPU.GPU3D.VCount144(nds->GPU);
+
+            auto end = Clock::now();
+            geometrytime += ElapsedMS(start, mid);
+            rendertime += ElapsedMS(mid, end);
+
+            if (i == 0)
+            {
+                hashes.push_back(hash);
+                stats.push_back(nds->GPU.GPU3D.GetStats());
+            }
+            else if (hashes[frame] != hash)
+                printf("frame %d: output differs between iterations\n", frame);
+
+            frame++;
+        }
+    }
+
+    for (size_t i = 0; i < hashes.size(); i++)
+    {
+        printf("frame %zu: %016llX\n", i, (unsigned long long)hashes[i]);
+        if (!showstats)
+            continue;
+
+        const GeometryStats& geom = stats[i].Geometry;
+        const RenderStats& render = stats[i].Render;
+        printf("  geometry: %u vertices, %u polygons submitted, %u culled, %u clipped, %u dropped\n",
+            geom.VerticesSubmitted, geom.PolygonsSubmitted, geom.PolygonsCulled, geom.PolygonsClipped, geom.PolygonsDropped);
+        printf("  render: %u polygons (%u shadow), %llu pixels, %llu depth rejects, %llu translucent\n",
+            render.PolygonsRendered, render.ShadowPolygons, (unsigned long long)render.PixelsRasterized,
+            (unsigned long long)render.DepthRejects, (unsigned long long)render.TranslucentPixels);
+        printf("  times: setup %u us, raster %u us, final pass %u us\n",
+            render.SetupTime, render.RasterTime, render.FinalPassTime);
+    }
+
+    u32 numframes = hashes.size() * iterations;
+    if (numframes)
+    {
+        printf("%d frames, geometry %.3f ms, render %.3f ms (%.3f ms/frame)\n",
+            numframes, geometrytime, rendertime, (geometrytime + rendertime) / numframes);
+    }
+
+    return 0;
+}
@@ -0,0 +1,301 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+// Times the geometry engine's polygon submission (transform, culling and clipping)
+// for random polygons that are inside the view volume, crossing its planes or
+// outside of it, as separate triangles, quads and strips.
+// A hash of the resulting polygon and vertex RAM is printed for each case,
+// so that results can be compared between builds.
+// The fixed-point kernels are also timed on their own, vectorised against scalar,
+// and the tool fails if their results differ.
+//
+// usage: melonDS-geombench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "NDS.h"
+#include "GPU.h"
+#include "GPU3D_Math.h"
+
+#define XXH_STATIC_LINKING_ONLY
+#include "xxhash/xxhash.h"
+
+using namespace melonDS;
+using Clock = std::chrono::steady_clock;
+
+enum class Placement
+{
+    Inside,
+    Crossing,
+    Outside,
+};
+
+struct GXCommand
+{
+    u8 Command;
+    u32 Param;
+};
+
+// polygons per batch, few enough that they always fit in polygon and vertex RAM once clipped
+constexpr int BatchPolygons = 500;
+
+static void RunCommand(GPU3D& gpu3d, u8 command, u32 param)
+{
+    gpu3d.Write32(0x04000400 + (command << 2), param);
+    while (!gpu3d.FlushRequest && !gpu3d.CmdPIPE.IsEmpty())
+        gpu3d.ExecuteCommand();
+}
+
+// with identity matrices, the view volume spans -1.0 to 1.0 (0x1000) on each axis
+static s32 RandomCoord(std::mt19937& rng, Placement placement, int vertex)
+{
+    switch (placement)
+    {
+    case Placement::Inside:
+        return (s32)(rng() % 0x1E00) - 0xF00;
+    case Placement::Crossing:
+        // alternate vertices inside and outside
+        return (vertex & 1) ? (s32)(rng() % 0x800) + 0x1200 : (s32)(rng() % 0x1000) - 0x800;
+    case Placement::Outside:
+    default:
+        return (s32)(rng() % 0x800) + 0x1200;
+    }
+}
+
+static std::vector<GXCommand> BuildBatch(std::mt19937& rng, Placement placement, int primtype)
+{
+    std::vector<GXCommand> cmds;
+
+    // POLYGON_ATTR: render both sides, so that nothing gets culled
+    cmds.push_back({0x29, 0x001F00C0});
+    cmds.push_back({0x40, (u32)primtype});
+
+    int numverts;
+    switch (primtype)
+    {
+    case 0: numverts = BatchPolygons * 3; break;
+    case 1: numverts = BatchPolygons * 4; break;
+    case 2: numverts = BatchPolygons + 2; break;
+    default: numverts = (BatchPolygons + 1) * 2; break;
+    }
+
+    for (int i = 0; i < numverts; i++)
+    {
+        s32 x = RandomCoord(rng, placement, i);
+        s32 y = RandomCoord(rng, placement, i + 1);
+        s32 z = (s32)(rng() % 0x1E00) - 0xF00;
+
+        cmds.push_back({0x20, (u32)rng() & 0x7FFF});
+        cmds.push_back({0x22, (u32)rng() & 0x3FF03FF0});
+        cmds.push_back({0x23, (u16)x | ((u32)(u16)y << 16)});
+        cmds.push_back({0x23, (u16)z});
+    }
+
+    cmds.push_back({0x41, 0});
+    cmds.push_back({0x50, 0});
+    return cmds;
+}
+
+// number of random inputs each kernel is run over
+constexpr int KernelInputs = 4096;
+
+template<typename F>
+static double TimeKernel(int iterations, F&& kernel)
+{
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++)
+        for (int j = 0; j < KernelInputs; j++)
+            kernel(j);
+
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (iterations * KernelInputs);
+}
+
+static bool CompareResults(const char* name, double scalarTime, double vectorTime, const s32* scalar, const s32* vector, int stride, int count)
+{
+    int mismatches = 0;
+    for (int i = 0; i < KernelInputs; i++)
+    {
+        for (int j = 0; j < count; j++)
+        {
+            if (scalar[i*stride + j] != vector[i*stride + j])
+            {
+                if (!mismatches)
+                    printf("%s: input %d, value %d: %08X instead of %08X\n",
+                        name, i, j, vector[i*stride + j], scalar[i*stride + j]);
+                mismatches++;
+            }
+        }
+    }
+
+    printf("%-18s %10.2f %10.2f %10.2fx   %s\n", name, scalarTime, vectorTime, scalarTime / vectorTime,
+        mismatches ? "MISMATCH" : "ok");
+    return mismatches == 0;
+}
+
+static bool BenchKernels(int iterations)
+{
+    std::mt19937 rng(5678);
+
+    // the full 32-bit range, to exercise sign handling and wrapping,
+    // except for a quarter of the inputs that use typical matrix values
+    std::vector<s32> matrices(KernelInputs * 16);
+    std::vector<s32> vectors(KernelInputs * 4);
+    std::vector<s16> normals(KernelInputs * 4);
+    std::vector<s32> positions(KernelInputs * 4);
+    for (int i = 0; i < KernelInputs; i++)
+    {
+        bool typical = (i & 3) == 0;
+        for (int j = 0; j < 16; j++)
+            matrices[i*16 + j] = typical ? (s32)(rng() % 0x4000) - 0x2000 : (s32)rng();
+        for (int j = 0; j < 4; j++)
+            vectors[i*4 + j] = typical ? (s32)(rng() % 0x10000) - 0x8000 : (s32)rng();
+        for (int j = 0; j < 3; j++)
+            normals[i*4 + j] = (s16)((s32)(rng() % 0x400) - 0x200);
+
+        // clip-space positions around the view volume, some of them right on its planes
+        s32 w = (s32)(rng() % 0x2000) - 0x200;
+        positions[i*4 + 3] = w;
+        for (int j = 0; j < 3; j++)
+        {
+            switch (rng() % 4)
+            {
+            case 0: positions[i*4 + j] = w; break;
+            case 1: positions[i*4 + j] = -w; break;
+            default: positions[i*4 + j] = (s32)(rng() % 0x6000) - 0x3000; break;
+            }
+        }
+    }
+
+    std::vector<s32> scalarOut(KernelInputs * 4);
+    std::vector<s32> vectorOut(KernelInputs * 4);
+    bool ok = true;
+
+    printf("%-18s %10s %10s %11s\n", "kernel", "scalar ns", "SIMD ns", "speedup");
+
+    double scalarTime = TimeKernel(iterations, [&](int i) { MatrixRowMultScalar<4>(&scalarOut[i*4], &vectors[i*4], &matrices[i*16]); });
+    double vectorTime = TimeKernel(iterations, [&](int i) { MatrixRowMult<4>(&vectorOut[i*4], &vectors[i*4], &matrices[i*16]); });
+    ok &= CompareResults("MatrixRowMult<4>", scalarTime, vectorTime, scalarOut.data(), vectorOut.data(), 4, 4);
+
+    scalarTime = TimeKernel(iterations, [&](int i) { MatrixRowMultScalar<3>(&scalarOut[i*4], &vectors[i*4], &matrices[i*16]); });
+    vectorTime = TimeKernel(iterations, [&](int i) { MatrixRowMult<3>(&vectorOut[i*4], &vectors[i*4], &matrices[i*16]); });
+    ok &= CompareResults("MatrixRowMult<3>", scalarTime, vectorTime, scalarOut.data(), vectorOut.data(), 4, 4);
+
+    scalarTime = TimeKernel(iterations, [&](int i) { MatrixRowMultScalar<1>(&scalarOut[i*4], &vectors[i*4], &matrices[i*16]); });
+    vectorTime = TimeKernel(iterations, [&](int i) { MatrixRowMult<1>(&vectorOut[i*4], &vectors[i*4], &matrices[i*16]); });
+    ok &= CompareResults("MatrixRowMult<1>", scalarTime, vectorTime, scalarOut.data(), vectorOut.data(), 4, 4);
+
+    // the last value is meaningless
+    scalarTime = TimeKernel(iterations, [&](int i) { NormalTransformScalar(&scalarOut[i*4], &normals[i*4], &matrices[i*16]); });
+    vectorTime = TimeKernel(iterations, [&](int i) { NormalTransform(&vectorOut[i*4], &normals[i*4], &matrices[i*16]); });
+    ok &= CompareResults("NormalTransform", scalarTime, vectorTime, scalarOut.data(), vectorOut.data(), 4, 3);
+
+    scalarTime = TimeKernel(iterations, [&](int i) { scalarOut[i] = ClipOutcodeScalar(&positions[i*4]); });
+    vectorTime = TimeKernel(iterations, [&](int i) { vectorOut[i] = ClipOutcode(&positions[i*4]); });
+    ok &= CompareResults("ClipOutcode", scalarTime, vectorTime, scalarOut.data(), vectorOut.data(), 1, 1);
+
+    printf("\n");
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 20;
+    if (iterations < 1) iterations = 1;
+
+    bool kernelsOk = BenchKernels(iterations * 50);
+
+    auto nds = std::make_unique<NDS>();
+    nds->Reset();
+    GPU3D& gpu3d = nds->GPU.GPU3D;
+    gpu3d.SetEnabled(true, true);
+
+    // identity projection and position matrices
+    for (int mode = 0; mode < 3; mode++)
+    {
+        RunCommand(gpu3d, 0x10, mode);
+        RunCommand(gpu3d, 0x15, 0);
+    }
+
+    const char* placementNames[] = {"inside", "crossing", "outside"};
+    const char* primNames[] = {"triangles", "quads", "tri strips", "quad strips"};
+
+    printf("%-10s %-12s %10s %10s %10s   %s\n", "placement", "primitives", "ns/poly", "output", "rejected", "hash");
+
+    std::mt19937 rng(1234);
+    for (int placement = 0; placement < 3; placement++)
+    {
+        for (int primtype = 0; primtype < 4; primtype++)
+        {
+            std::vector<GXCommand> cmds = BuildBatch(rng, (Placement)placement, primtype);
+
+            XXH3_state_t* hashstate = XXH3_createState();
+            XXH3_64bits_reset(hashstate);
+
+            double elapsed = 0;
+            u32 numpolys = 0;
+            GeometryStats stats {};
+            for (int i = 0; i < iterations; i++)
+            {
+                auto start = Clock::now();
+                for (const GXCommand& cmd : cmds)
+                    RunCommand(gpu3d, cmd.Command, cmd.Param);
+                elapsed += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+                // swaps the buffers, making the results available to the renderer
+                gpu3d.VBlank();
+
+                if (i == 0)
+                {
+                    stats = gpu3d.GetStats().Geometry;
+                    numpolys = gpu3d.RenderNumPolygons;
+                    for (u32 j = 0; j < gpu3d.RenderNumPolygons; j++)
+                    {
+                        const Polygon* poly = gpu3d.RenderPolygonRAM[j];
+                        XXH3_64bits_update(hashstate, &poly->NumVertices, sizeof(poly->NumVertices));
+                        for (u32 k = 0; k < poly->NumVertices; k++)
+                        {
+                            const Vertex* vtx = poly->Vertices[k];
+                            XXH3_64bits_update(hashstate, vtx->Position, sizeof(vtx->Position));
+                            XXH3_64bits_update(hashstate, vtx->Color, sizeof(vtx->Color));
+                            XXH3_64bits_update(hashstate, vtx->TexCoords, sizeof(vtx->TexCoords));
+                            XXH3_64bits_update(hashstate, vtx->FinalPosition, sizeof(vtx->FinalPosition));
+                            XXH3_64bits_update(hashstate, vtx->FinalColor, sizeof(vtx->FinalColor));
+                            XXH3_64bits_update(hashstate, &poly->FinalZ[k], sizeof(poly->FinalZ[k]));
+                            XXH3_64bits_update(hashstate, &poly->FinalW[k], sizeof(poly->FinalW[k]));
+                        }
+                    }
+                }
+            }
+
+            u64 hash = XXH3_64bits_digest(hashstate);
+            XXH3_freeState(hashstate);
+
+            printf("%-10s %-12s %10.1f %10u %10u   %016llX\n",
+                placementNames[placement], primNames[primtype],
+                elapsed / (iterations * stats.PolygonsSubmitted),
+                numpolys, stats.PolygonsClipped, (unsigned long long)hash);
+        }
+    }
+
+    return kernelsOk ? 0 : 1;
+}
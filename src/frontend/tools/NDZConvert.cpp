@@ -0,0 +1,232 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+// Converts DS ROMs to chunked ROM files (.ndz, see ChunkedROM.h) and back.
+// Each block is compressed with zstd on its own; the result is read back
+// and checked against the original before the tool reports success.
+//
+// usage: melonDS-ndzconvert <input.nds> <output.ndz> [block size in KB] [zstd level]
+//        melonDS-ndzconvert <input.ndz> <output.nds>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <zstd.h>
+
+#include "ChunkedROM.h"
+
+using namespace melonDS;
+
+static ChunkedROM::Decompressor ZstdDecompressor()
+{
+    std::shared_ptr<ZSTD_DCtx> dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    return [dctx](const u8* src, u32 srclen, u8* dst, u32 dstlen)
+    {
+        size_t ret = ZSTD_decompressDCtx(dctx.get(), dst, dstlen, src, srclen);
+        return !ZSTD_isError(ret) && ret == dstlen;
+    };
+}
+
+static std::vector<u8> ReadFile(const char* path)
+{
+    std::vector<u8> data;
+    FILE* f = fopen(path, "rb");
+    if (!f) return data;
+
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (len > 0 && len <= 0x40000000)
+    {
+        data.resize(len);
+        if (fread(data.data(), len, 1, f) != 1)
+            data.clear();
+    }
+
+    fclose(f);
+    return data;
+}
+
+static bool Compress(const char* inpath, const char* outpath, u32 blocksize, int level)
+{
+    std::vector<u8> rom = ReadFile(inpath);
+    if (rom.empty())
+    {
+        printf("couldn't read %s\n", inpath);
+        return false;
+    }
+
+    ChunkedROMHeader header {};
+    header.Magic = ChunkedROMMagic;
+    header.Version = ChunkedROMVersion;
+    header.Codec = ChunkedROMCodec::Zstd;
+    header.BlockSize = blocksize;
+    header.ROMLength = rom.size();
+    header.NumBlocks = (header.ROMLength + blocksize - 1) / blocksize;
+
+    FILE* f = fopen(outpath, "wb");
+    if (!f)
+    {
+        printf("couldn't open %s for writing\n", outpath);
+        return false;
+    }
+
+    // the index is written once all the block sizes are known
+    std::vector<u64> index(header.NumBlocks + 1);
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(index.data(), sizeof(u64), index.size(), f);
+
+    ZSTD_CCtx* cctx = ZSTD_createCCtx();
+    std::vector<u8> buf(ZSTD_compressBound(blocksize));
+    u64 pos = sizeof(header) + index.size() * sizeof(u64);
+    bool ok = true;
+
+    for (u32 i = 0; i < header.NumBlocks; i++)
+    {
+        const u8* block = &rom[i * blocksize];
+        u32 rawlen = std::min(blocksize, header.ROMLength - i*blocksize);
+
+        size_t complen = ZSTD_compressCCtx(cctx, buf.data(), buf.size(), block, rawlen, level);
+        if (ZSTD_isError(complen))
+        {
+            printf("couldn't compress block %u: %s\n", i, ZSTD_getErrorName(complen));
+            ok = false;
+            break;
+        }
+
+        // store the block as-is if compressing it didn't help
+        const u8* out = buf.data();
+        if (complen >= rawlen)
+        {
+            out = block;
+            complen = rawlen;
+        }
+
+        index[i] = pos;
+        fwrite(out, complen, 1, f);
+        pos += complen;
+    }
+
+    ZSTD_freeCCtx(cctx);
+
+    index[header.NumBlocks] = pos;
+    fseek(f, sizeof(header), SEEK_SET);
+    fwrite(index.data(), sizeof(u64), index.size(), f);
+    ok = ok && !ferror(f);
+    fclose(f);
+
+    if (!ok) return false;
+
+    // make sure it reads back the same
+    std::unique_ptr<ChunkedROM> check = ChunkedROM::Open(outpath, ZstdDecompressor());
+    if (!check || check->Length() != rom.size())
+    {
+        printf("couldn't read back %s\n", outpath);
+        return false;
+    }
+
+    std::vector<u8> readback(blocksize);
+    for (u32 offset = 0; offset < header.ROMLength; offset += blocksize)
+    {
+        u32 len = std::min(blocksize, header.ROMLength - offset);
+        check->Read(offset, len, readback.data());
+        if (memcmp(readback.data(), &rom[offset], len))
+        {
+            printf("%s doesn't match the original at %08X\n", outpath, offset);
+            return false;
+        }
+    }
+
+    printf("%s: %u bytes -> %llu bytes (%.1f%%), %u blocks of %u KB\n",
+        outpath, header.ROMLength, (unsigned long long)pos,
+        pos * 100.0 / header.ROMLength, header.NumBlocks, blocksize >> 10);
+    return true;
+}
+
+static bool Expand(const char* inpath, const char* outpath)
+{
+    std::unique_ptr<ChunkedROM> rom = ChunkedROM::Open(inpath, ZstdDecompressor());
+    if (!rom)
+    {
+        printf("couldn't open %s\n", inpath);
+        return false;
+    }
+
+    FILE* f = fopen(outpath, "wb");
+    if (!f)
+    {
+        printf("couldn't open %s for writing\n", outpath);
+        return false;
+    }
+
+    u32 blocksize = rom->BlockSize();
+    std::vector<u8> buf(blocksize);
+    for (u32 offset = 0; offset < rom->Length(); offset += blocksize)
+    {
+        u32 len = std::min(blocksize, rom->Length() - offset);
+        rom->Read(offset, len, buf.data());
+        fwrite(buf.data(), len, 1, f);
+    }
+
+    bool ok = !ferror(f);
+    fclose(f);
+
+    if (ok)
+        printf("%s: %u bytes\n", outpath, rom->Length());
+    return ok;
+}
+
+static bool IsChunkedROM(const char* path)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+
+    u32 magic = 0;
+    bool ret = fread(&magic, sizeof(magic), 1, f) == 1 && magic == ChunkedROMMagic;
+    fclose(f);
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printf("usage: %s <input.nds> <output.ndz> [block size in KB] [zstd level]\n", argv[0]);
+        printf("       %s <input.ndz> <output.nds>\n", argv[0]);
+        return 1;
+    }
+
+    if (IsChunkedROM(argv[1]))
+        return Expand(argv[1], argv[2]) ? 0 : 1;
+
+    u32 blocksize = (argc > 3) ? atoi(argv[3]) * 1024 : ChunkedROMDefaultBlockSize;
+    int level = (argc > 4) ? atoi(argv[4]) : 19;
+
+    if (blocksize < ChunkedROMMinBlockSize || blocksize > ChunkedROMMaxBlockSize || (blocksize & (blocksize-1)))
+    {
+        printf("block size must be a power of 2 between %u and %u KB\n", ChunkedROMMinBlockSize >> 10, ChunkedROMMaxBlockSize >> 10);
+        return 1;
+    }
+
+    return Compress(argv[1], argv[2], blocksize, level) ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+// Builds or updates an index of a ROM library (see ROMIndex.h) and prints it
+// as tab-separated values: game code, save type, hash, title, path.
+// Only files that changed since the index was last saved are scanned again.
+// With -icons, the banner icons are written to the given directory as .tga files,
+// named after the ROM file and its hash (or its game code with -nohash).
+//
+// usage: melonDS-romindex <index file> <directories or ROM files...> [-j threads] [-nohash] [-icons dir]
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ROMIndex.h"
+
+using namespace melonDS;
+using Clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+static const char* SaveTypeNames[] =
+{
+    "none",
+    "EEPROM 0.5K",
+    "EEPROM 8K", "EEPROM 64K", "EEPROM 128K",
+    "flash 256K", "flash 512K", "flash 1M",
+    "NAND 8M", "NAND 16M", "NAND 64M",
+};
+
+static bool IsROMFile(const fs::path& path)
+{
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".nds" || ext == ".srl" || ext == ".dsi" || ext == ".ids";
+}
+
+static std::string TitleLine(const char16_t (&title)[128])
+{
+    // the first line is the game name, the rest is usually the publisher
+    std::string ret;
+    for (char16_t c : title)
+    {
+        if (c == 0 || c == '\n') break;
+        if (c < 0x80) ret += (char)c;
+        else if (c < 0x800)
+        {
+            ret += (char)(0xC0 | (c >> 6));
+            ret += (char)(0x80 | (c & 0x3F));
+        }
+        else
+        {
+            ret += (char)(0xE0 | (c >> 12));
+            ret += (char)(0x80 | ((c >> 6) & 0x3F));
+            ret += (char)(0x80 | (c & 0x3F));
+        }
+    }
+
+    return ret;
+}
+
+static void WriteIcon(const std::string& path, const ROMFileInfo& info)
+{
+    u32 pixels[32*32];
+    DecodeBannerIcon(info.Icon, info.Palette, pixels);
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return;
+
+    // uncompressed 32bpp TGA, stored top to bottom
+    u8 header[18] = {0, 0, 2, 0,0,0,0,0, 0,0,0,0, 32,0, 32,0, 32, 0x28};
+    fwrite(header, sizeof(header), 1, f);
+    for (u32 pixel : pixels)
+    {
+        // RGBA to BGRA
+        u8 bgra[4] = {(u8)(pixel >> 16), (u8)(pixel >> 8), (u8)pixel, (u8)(pixel >> 24)};
+        fwrite(bgra, 4, 1, f);
+    }
+
+    fclose(f);
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        printf("usage: %s <index file> <directories or ROM files...> [-j threads] [-nohash] [-icons dir]\n", argv[0]);
+        return 1;
+    }
+
+    const char* indexpath = argv[1];
+    int numthreads = std::max(1u, std::thread::hardware_concurrency());
+    bool hash = true;
+    const char* icondir = nullptr;
+    std::vector<std::string> paths;
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-j") && i+1 < argc)
+            numthreads = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "-nohash"))
+            hash = false;
+        else if (!strcmp(argv[i], "-icons") && i+1 < argc)
+            icondir = argv[++i];
+        else if (fs::is_directory(argv[i]))
+        {
+            std::error_code err;
+            for (auto it = fs::recursive_directory_iterator(argv[i], fs::directory_options::skip_permission_denied, err);
+                 it != fs::recursive_directory_iterator(); it.increment(err))
+            {
+                if (err) break;
+                if (it->is_regular_file(err) && IsROMFile(it->path()))
+                    paths.push_back(it->path().u8string());
+            }
+        }
+        else
+            paths.push_back(argv[i]);
+    }
+
+    std::sort(paths.begin(), paths.end());
+
+    ROMIndex index;
+    if (!index.Load(indexpath))
+        fprintf(stderr, "starting a new index\n");
+
+    auto start = Clock::now();
+    u32 scanned = index.Update(paths, numthreads, hash, [](u32 done, u32 total)
+    {
+        if ((done % 256) == 0 || done == total)
+            fprintf(stderr, "\rscanned %u/%u", done, total);
+    });
+    double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+    fprintf(stderr, "%s%u files, %u scanned on %d threads in %.2f s\n", scanned ? "\n" : "", (u32)paths.size(), scanned, numthreads, secs);
+
+    if (!index.Save(indexpath))
+    {
+        fprintf(stderr, "couldn't write %s\n", indexpath);
+        return 1;
+    }
+
+    for (const ROMIndexEntry& entry : index.GetEntries())
+    {
+        const ROMFileInfo& info = entry.Info;
+        if (info.Flags & ROMFileInfo::Invalid)
+            continue;
+
+        char gamecode[5] = {};
+        memcpy(gamecode, &info.GameCode, 4);
+        for (char& c : gamecode)
+            if (c && (c < 0x20 || c > 0x7E)) c = '?';
+
+        const char* savetype = info.SaveMemType < std::size(SaveTypeNames) ? SaveTypeNames[info.SaveMemType] : "unknown";
+        std::string title = (info.Flags & ROMFileInfo::HasBanner) ? TitleLine(info.Title) : "";
+
+        printf("%s\t%s%s\t%016llX\t%s\t%s\n", gamecode, savetype,
+            (info.Flags & ROMFileInfo::InROMList) ? "" : " (guessed)",
+            (unsigned long long)info.Hash, title.c_str(), entry.Path.c_str());
+
+        if (icondir && (info.Flags & ROMFileInfo::HasBanner))
+        {
+            // ROMs in different directories can have the same file name,
+            // so the icons are told apart by the ROM hash, or the game code if there's none
+            char tag[17];
+            if (info.Flags & ROMFileInfo::Hashed)
+                snprintf(tag, sizeof(tag), "%016llX", (unsigned long long)info.Hash);
+            else
+            {
+                memcpy(tag, gamecode, 5);
+                for (char* c = tag; *c; c++)
+                    if (!isalnum((unsigned char)*c)) *c = '_';
+            }
+
+            std::string name = fs::u8path(entry.Path).stem().u8string() + "_" + tag;
+            WriteIcon((fs::u8path(icondir) / fs::u8path(name + ".tga")).u8string(), info);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+// Times the audio resampler converting the SPU output rate to common device rates,
+// reported as CPU time per second of audio, the way the audio callback uses it.
+// The signal-to-noise ratio for a few test tones is printed as well, as a sanity
+// check of the filter quality.
+//
+// usage: melonDS-resamplebench [seconds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "AudioResampler.h"
+
+using namespace melonDS;
+using Clock = std::chrono::steady_clock;
+
+// samples the device asks for per callback
+constexpr int CallbackSamples = 1024;
+
+static std::vector<s16> MakeTone(double freq, int samples)
+{
+    std::vector<s16> data(samples * 2);
+    for (int i = 0; i < samples; i++)
+    {
+        double t = i / AudioResampler::SPUOutputRate;
+        data[i*2] = (s16)lround(sin(2 * M_PI * freq * t) * 16000);
+        data[i*2 + 1] = (s16)lround(cos(2 * M_PI * freq * t) * 16000);
+    }
+
+    return data;
+}
+
+// runs the input through the resampler in callback-sized pieces
+static std::vector<s16> Resample(AudioResampler& resampler, const std::vector<s16>& input)
+{
+    std::vector<s16> output;
+    s16 buf[CallbackSamples * 2];
+
+    int inlen = input.size() / 2;
+    int inpos = 0;
+    while (inpos < inlen)
+    {
+        int needed = std::min(resampler.GetInputNeeded(CallbackSamples), inlen - inpos);
+        inpos += resampler.Push(&input[inpos * 2], needed);
+
+        int num = resampler.Pull(buf, CallbackSamples);
+        output.insert(output.end(), &buf[0], &buf[num * 2]);
+    }
+
+    return output;
+}
+
+// compares the left channel to the ideal sine, skipping the start where the filter is filling up
+static double ToneSNR(const std::vector<s16>& output, double freq, double outrate)
+{
+    double signal = 0, noise = 0;
+    for (size_t i = 64; i < output.size() / 2; i++)
+    {
+        double t = i / outrate;
+        double ideal = sin(2 * M_PI * freq * t) * 16000;
+        signal += ideal * ideal;
+        noise += (output[i*2] - ideal) * (output[i*2] - ideal);
+    }
+
+    return 10 * log10(signal / std::max(noise, 1e-9));
+}
+
+int main(int argc, char** argv)
+{
+    int seconds = (argc > 1) ? atoi(argv[1]) : 20;
+    if (seconds < 1) seconds = 1;
+
+    const double rates[] = {22050, 32000, 44100, 48000, 96000};
+    const double tones[] = {440, 4000, 12000};
+
+    int inlen = (int)(AudioResampler::SPUOutputRate * seconds);
+    std::vector<s16> input = MakeTone(1000, inlen);
+
+    printf("%-10s %12s %12s", "rate", "ms/second", "x realtime");
+    for (double tone : tones)
+        printf("   SNR %5.0fHz", tone);
+    printf("\n");
+
+    for (double rate : rates)
+    {
+        AudioResampler resampler(AudioResampler::SPUOutputRate, rate);
+
+        auto start = Clock::now();
+        Resample(resampler, input);
+        double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        printf("%-10.0f %12.4f %12.0f", rate, elapsed / seconds, (seconds * 1000.0) / elapsed);
+
+        // tones above the output Nyquist frequency are filtered out, there is nothing to compare against
+        for (double tone : tones)
+        {
+            if (tone >= rate * 0.44)
+            {
+                printf("   %12s", "-");
+                continue;
+            }
+
+            AudioResampler toneresampler(AudioResampler::SPUOutputRate, rate);
+            std::vector<s16> output = Resample(toneresampler, MakeTone(tone, (int)AudioResampler::SPUOutputRate));
+            printf("   %10.1fdB", ToneSNR(output, tone, rate));
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+    Copyright 2016-2024 melonDS team
+
+    This file is part of melonDS.
+
+    melonDS is free software: you can redistribute it and/or modify it under
+    the terms of the GNU General Public License as published by the Free
+    Software Foundation, either version 3 of the License, or (at your option)
+    any later version.
+
+    melonDS is distributed in the hope that it will be useful, but WITHOUT ANY
+    WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+    FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with melonDS. If not, see http://www.gnu.org/licenses/.
+*/
+
+// Times the texture cache's texture conversion functions for every texture
+// format over all texture sizes, using random texture and palette data.
+//
+// usage: melonDS-texbench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <random>
+
+#include "GPU3D_Texcache.h"
+
+using namespace melonDS;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv)
+{
+    int iterations = (argc > 1) ? atoi(argv[1]) : 20;
+    if (iterations < 1) iterations = 1;
+
+    // large enough for a 1024x1024 direct color texture and a full palette VRAM
+    auto texData = std::make_unique<u8[]>(1024*1024*2);
+    auto texAuxData = std::make_unique<u8[]>(1024*1024/8);
+    auto palData = std::make_unique<u16[]>(64*1024);
+    auto output = std::make_unique<u32[]>(1024*1024);
+
+    std::mt19937 rng(1234);
+    for (u32 i = 0; i < 1024*1024*2; i++)
+        texData[i] = rng();
+    for (u32 i = 0; i < 1024*1024/16; i++)
+    {
+        // keep the palette offsets within the palette
+        u16 aux = (rng() & 0xC000) | (rng() & 0x3FFF);
+        texAuxData[i*2] = aux & 0xFF;
+        texAuxData[i*2+1] = aux >> 8;
+    }
+    for (u32 i = 0; i < 64*1024; i++)
+        palData[i] = rng();
+
+    const char* formatNames[] = {"A3I5", "4-color", "16-color", "256-color", "4x4", "A5I3", "direct"};
+
+    printf("%-10s", "size");
+    for (const char* name : formatNames)
+        printf(" %10s", name);
+    printf("   (MTexels/s)\n");
+
+    for (u32 width = 8; width <= 1024; width <<= 1)
+    {
+        for (u32 height = 8; height <= 1024; height <<= 1)
+        {
+            printf("%4dx%-5d", width, height);
+
+            for (int fmt = 1; fmt <= 7; fmt++)
+            {
+                auto start = Clock::now();
+                for (int i = 0; i < iterations; i++)
+                {
+                    u32* out = output.get();
+                    const u8* tex = texData.get();
+                    const u16* pal = palData.get();
+                    switch (fmt)
+                    {
+                    case 1: ConvertAXIYTexture<outputFmt_RGB6A5, 3, 5>(width, height, out, tex, pal); break;
+                    case 2: ConvertNColorsTexture<outputFmt_RGB6A5, 2>(width, height, out, tex, pal, true); break;
+                    case 3: ConvertNColorsTexture<outputFmt_RGB6A5, 4>(width, height, out, tex, pal, true); break;
+                    case 4: ConvertNColorsTexture<outputFmt_RGB6A5, 8>(width, height, out, tex, pal, true); break;
+                    case 5: ConvertCompressedTexture<outputFmt_RGB6A5>(width, height, out, tex, texAuxData.get(), pal); break;
+                    case 6: ConvertAXIYTexture<outputFmt_RGB6A5, 5, 3>(width, height, out, tex, pal); break;
+                    case 7: ConvertBitmapTexture<outputFmt_RGB6A5>(width, height, out, tex); break;
+                    }
+                }
+                double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+                printf(" %10.1f", (double)width * height * iterations / secs / 1000000.0);
+            }
+            printf("\n");
+        }
+    }
+
+    return 0;
+}
@@ -72,6 +72,11 @@ public:
     // core
     void Run(unsigned cycle);
 
+    // decoded instructions are cached, and invalidated when the DSP writes to program memory.
+    // this needs to be called when program memory changes in any other way
+    // (eg. when the memory behind it is remapped).
+    void InvalidateProgramCache();
+
     void SetSharedMemoryCallback(const SharedMemoryCallback& callback);
     void SetAHBMCallback(const AHBMCallback& callback);
 
@@ -19,13 +19,31 @@ public:
         static constexpr u64 Infinity = std::numeric_limits<u64>::max();
     };
 
+    // Advances by one cycle. The callbacks are only run on the cycles where something happens
+    // (a timer interrupt, an audio sample going out, ...), the cycles in between are passed to
+    // them in bulk through Skip().
     void Tick() {
-        for (const auto& callbacks : registered_callbacks) {
-            callbacks->Tick();
+        if (++pending_ticks > max_skip) {
+            Flush();
+        }
+    }
+
+    // Brings the callbacks up to date. Needs to be done before their state is accessed from
+    // outside, and since that may change when their next event is, it's looked up again on
+    // the next tick.
+    void Sync() {
+        if (pending_ticks != 0) {
+            for (const auto& callbacks : registered_callbacks) {
+                callbacks->Skip(pending_ticks);
+            }
+            pending_ticks = 0;
         }
+        max_skip = 0;
     }
 
     u64 Skip(u64 maximum) {
+        Sync();
+
         u64 ticks = maximum;
         for (const auto& callbacks : registered_callbacks) {
             ticks = std::min(ticks, callbacks->GetMaxSkip());
@@ -36,11 +54,39 @@ public:
         return ticks;
     }
 
+    void Reset() {
+        pending_ticks = 0;
+        max_skip = 0;
+    }
+
     void RegisterCallbacks(Callbacks* callbacks) {
         registered_callbacks.push_back(std::move(callbacks));
     }
 
 private:
+    // the last of the pending ticks is the one where something happens
+    void Flush() {
+        if (pending_ticks > 1) {
+            for (const auto& callbacks : registered_callbacks) {
+                callbacks->Skip(pending_ticks - 1);
+            }
+        }
+        for (const auto& callbacks : registered_callbacks) {
+            callbacks->Tick();
+        }
+        pending_ticks = 0;
+
+        max_skip = Callbacks::Infinity;
+        for (const auto& callbacks : registered_callbacks) {
+            max_skip = std::min(max_skip, callbacks->GetMaxSkip());
+        }
+    }
+
     std::vector<Callbacks*> registered_callbacks;
+
+    // cycles that have passed without the callbacks being told yet
+    u64 pending_ticks = 0;
+    // how many cycles the callbacks can skip before the next one where something happens
+    u64 max_skip = 0;
 };
 } // namespace Teakra
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include "common_types.h"
+
+namespace Teakra {
+
+class Interpreter;
+
+// Holds the decoded form of every instruction the interpreter has run, by program address,
+// so that it doesn't need to fetch both words and go through the decoder table again.
+// Program memory is split in pages, which are only allocated once code runs from them.
+//
+// Program memory can change under the interpreter: every write to shared memory invalidates
+// the instructions it overlaps (see SharedMemory::WriteWord), and the emulator invalidates
+// everything when it remaps the memory behind the DSP.
+class DecodeCache {
+public:
+    using Handler = void (*)(Interpreter&, u16, u16);
+
+    struct Entry {
+        Handler handler = nullptr; // nullptr: not decoded
+        u16 opcode = 0;
+        u16 expansion = 0;
+        bool expanded = false;
+    };
+
+    // the DSi mirrors program memory every 256K words
+    static constexpr u32 AddressSpace = 0x40000;
+
+    Entry& Get(u32 address) {
+        std::unique_ptr<Page>& page = pages[address >> PageBits];
+        if (!page) {
+            page = std::make_unique<Page>();
+        }
+        return (*page)[address & PageMask];
+    }
+
+    void Invalidate(u32 address) {
+        address &= AddressSpace - 1;
+
+        // an instruction with an expansion word also covers the previous address
+        InvalidateEntry(address);
+        InvalidateEntry((address - 1) & (AddressSpace - 1));
+    }
+
+    void InvalidateAll() {
+        for (auto& page : pages) {
+            if (page) {
+                page->fill(Entry{});
+            }
+        }
+    }
+
+private:
+    static constexpr u32 PageBits = 10;
+    static constexpr u32 PageMask = (1 << PageBits) - 1;
+    using Page = std::array<Entry, 1 << PageBits>;
+
+    void InvalidateEntry(u32 address) {
+        const std::unique_ptr<Page>& page = pages[address >> PageBits];
+        if (page) {
+            (*page)[address & PageMask].handler = nullptr;
+        }
+    }
+
+    std::array<std::unique_ptr<Page>, AddressSpace / (1 << PageBits)> pages;
+};
+
+} // namespace Teakra
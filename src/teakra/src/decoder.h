@@ -54,29 +54,30 @@ struct VisitorFunction {
 
 template <typename V, u16 expected, typename... OperandAtT>
 struct MatcherCreator {
-    template <typename OperandListT>
-    struct Proxy;
-
     using F = typename VisitorFunction<V, OperandAtT...>::type;
 
-    template <typename... OperandAtTs>
-    struct Proxy<OperandList<OperandAtTs...>> {
-        F func;
-        auto operator()(V& visitor, [[maybe_unused]] u16 opcode,
-                        [[maybe_unused]] u16 expansion) const {
+    // the handler is a template parameter, so that every instruction form gets its own
+    // function with the operand extraction inlined into it
+    template <typename OperandListT, F func>
+    struct Proxy;
+
+    template <F func, typename... OperandAtTs>
+    struct Proxy<OperandList<OperandAtTs...>, func> {
+        static typename V::instruction_return_type Call(V& visitor, [[maybe_unused]] u16 opcode,
+                                                        [[maybe_unused]] u16 expansion) {
             return (visitor.*func)(OperandAtTs::Extract(opcode, expansion)...);
         }
     };
 
-    static Matcher<V> Create(const char* name, F func) {
+    template <F func>
+    static Matcher<V> Create(const char* name) {
         // Operands shouldn't overlap each other, nor overlap with the expected ones
         static_assert(NoOverlap<u16, expected, OperandAtT::Mask...>, "Error");
 
-        Proxy<typename FilterOperand<OperandAtT...>::result> proxy{func};
-
         constexpr u16 mask = (~OperandAtT::Mask & ... & 0xFFFF);
         constexpr bool expanded = (OperandAtT::NeedExpansion || ...);
-        return Matcher<V>(name, mask, expected, expanded, proxy);
+        return Matcher<V>(name, mask, expected, expanded,
+                          &Proxy<typename FilterOperand<OperandAtT...>::result, func>::Call);
     }
 };
 
@@ -91,7 +92,7 @@ template <typename V>
 std::vector<Matcher<V>> GetDecodeTable() {
     return {
 
-#define INST(name, ...) MatcherCreator<V, __VA_ARGS__>::Create(#name, &V::name)
+#define INST(name, ...) MatcherCreator<V, __VA_ARGS__>::template Create<&V::name>(#name)
 #define EXCEPT(...) Except(RejectorCreator<__VA_ARGS__>::rejector)
 
     // <<< Misc >>>
@@ -9,6 +9,7 @@
 #include "bit.h"
 #include "core_timing.h"
 #include "crash.h"
+#include "decode_cache.h"
 #include "decoder.h"
 #include "memory_interface.h"
 #include "operand.h"
@@ -25,7 +26,7 @@ public:
 class Interpreter {
 public:
     Interpreter(CoreTiming& core_timing, RegisterState& regs, MemoryInterface& mem)
-        : core_timing(core_timing), regs(regs), mem(mem) {}
+        : core_timing(core_timing), regs(regs), mem(mem), decode_cache(mem.GetDecodeCache()) {}
 
     void PushPC() {
         u16 l = (u16)(regs.pc & 0xFFFF);
@@ -74,22 +75,21 @@ public:
                 }
             }
 
-            for (std::size_t i = 0; i < 3; ++i) {
-                if (interrupt_pending[i].exchange(false)) {
-                    regs.ip[i] = 1;
+            // plain load first, the exchange is comparatively expensive to do every cycle
+            if (interrupt_pending.load(std::memory_order_acquire)) {
+                u32 pending = interrupt_pending.exchange(0);
+                for (std::size_t i = 0; i < 3; ++i) {
+                    if (pending & (1 << i)) {
+                        regs.ip[i] = 1;
+                    }
                 }
-            }
 
-            if (vinterrupt_pending.exchange(false)) {
-                regs.ipv = 1;
+                if (pending & VectoredInterruptPending) {
+                    regs.ipv = 1;
+                }
             }
 
-            u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            auto& decoder = decoders[opcode];
-            u16 expand_value = 0;
-            if (decoder.NeedExpansion()) {
-                expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            }
+            DecodeCache::Entry inst = Fetch();
 
             if (regs.rep) {
                 if (regs.repc == 0) {
@@ -110,7 +110,7 @@ public:
                 }
             }
 
-            decoder.call(*this, opcode, expand_value);
+            inst.handler(*this, inst.opcode, inst.expansion);
 
             // I am not sure if a single-instruction loop is interruptable and how it is handled,
             // so just disable interrupt for it for now.
@@ -147,12 +147,34 @@ public:
     }
 
     void SignalInterrupt(u32 i) {
-        interrupt_pending[i] = true;
+        interrupt_pending.fetch_or(1 << i);
     }
     void SignalVectoredInterrupt(u32 address, bool context_switch) {
         vinterrupt_address = address;
-        vinterrupt_pending = true;
         vinterrupt_context_switch = context_switch;
+        interrupt_pending.fetch_or(VectoredInterruptPending);
+    }
+
+    // fetches and decodes the instruction at pc, and moves pc past it
+    DecodeCache::Entry Fetch() {
+        DecodeCache::Entry uncached;
+        // the cache is only indexed by pc, it's bypassed for the rarely used other program pages
+        DecodeCache::Entry& inst = (regs.prpage == 0 && regs.pc < DecodeCache::AddressSpace)
+                                      ? decode_cache.Get(regs.pc)
+                                      : uncached;
+
+        if (!inst.handler) {
+            inst.opcode = mem.ProgramRead(regs.pc | (regs.prpage << 18));
+            const auto& decoder = decoders[inst.opcode];
+            inst.expanded = decoder.NeedExpansion();
+            inst.expansion = inst.expanded ? mem.ProgramRead((regs.pc + 1) | (regs.prpage << 18)) : 0;
+            inst.handler = decoder.GetHandler();
+        }
+
+        regs.pc += inst.expanded ? 2 : 1;
+
+        // returned by value, running the instruction may invalidate the cache entry
+        return inst;
     }
 
     using instruction_return_type = void;
@@ -1185,14 +1207,8 @@ public:
         // retd is supposed to kick in after 2 cycles
 
         for (int i = 0; i < 2; i++) {
-            u16 opcode = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            auto& decoder = decoders[opcode];
-            u16 expand_value = 0;
-            if (decoder.NeedExpansion()) {
-                expand_value = mem.ProgramRead((regs.pc++) | (regs.prpage << 18));
-            }
-
-            decoder.call(*this, opcode, expand_value);
+            DecodeCache::Entry inst = Fetch();
+            inst.handler(*this, inst.opcode, inst.expansion);
         }
 
         PopPC();
@@ -2950,8 +2966,9 @@ private:
     RegisterState& regs;
     MemoryInterface& mem;
 
-    std::array<std::atomic<bool>, 3> interrupt_pending{{false, false, false}};
-    std::atomic<bool> vinterrupt_pending{false};
+    // bits 0-2: interrupts 0-2, bit 3: vectored interrupt
+    static constexpr u32 VectoredInterruptPending = 1 << 3;
+    std::atomic<u32> interrupt_pending{0};
     std::atomic<bool> vinterrupt_context_switch;
     std::atomic<u32> vinterrupt_address;
 
@@ -3643,6 +3660,7 @@ private:
     }
 
     const std::vector<Matcher<Interpreter>> decoders = GetDecoderTable<Interpreter>();
+    DecodeCache& decode_cache;
 };
 
 } // namespace Teakra
@@ -1,7 +1,6 @@
 #pragma once
 
 #include <algorithm>
-#include <functional>
 #include <vector>
 #include "common_types.h"
 #include "crash.h"
@@ -19,13 +18,15 @@ class Matcher {
 public:
     using visitor_type = Visitor;
     using handler_return_type = typename Visitor::instruction_return_type;
-    using handler_function = std::function<handler_return_type(Visitor&, u16, u16)>;
+    // a plain function pointer rather than std::function, so that it can be called directly
+    // (see DecodeCache)
+    using handler_function = handler_return_type (*)(Visitor&, u16, u16);
 
     Matcher(const char* const name, u16 mask, u16 expected, bool expanded, handler_function func)
-        : name{name}, mask{mask}, expected{expected}, expanded{expanded}, fn{std::move(func)} {}
+        : name{name}, mask{mask}, expected{expected}, expanded{expanded}, fn{func} {}
 
     static Matcher AllMatcher(handler_function func) {
-        return Matcher("*", 0, 0, false, std::move(func));
+        return Matcher("*", 0, 0, false, func);
     }
 
     const char* GetName() const {
@@ -36,6 +37,10 @@ public:
         return expanded;
     }
 
+    handler_function GetHandler() const {
+        return fn;
+    }
+
     bool Matches(u16 instruction) const {
         return (instruction & mask) == expected &&
                std::none_of(rejectors.begin(), rejectors.end(),
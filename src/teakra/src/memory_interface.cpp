@@ -53,5 +53,8 @@ void MemoryInterface::MMIOWrite(u16 address, u16 value) {
     ASSERT(mmio != nullptr);
     mmio->Write(address & (MemoryInterfaceUnit::MMIOSize - 1), value);
 }
+DecodeCache& MemoryInterface::GetDecodeCache() {
+    return shared_memory.decode_cache;
+}
 
 } // namespace Teakra
@@ -50,6 +50,7 @@ public:
 
 struct SharedMemory;
 class MMIORegion;
+class DecodeCache;
 
 class MemoryInterface {
 public:
@@ -63,6 +64,7 @@ public:
     void DataWriteA32(u32 address, u16 value);
     u16 MMIORead(u16 address);
     void MMIOWrite(u16 address, u16 value);
+    DecodeCache& GetDecodeCache();
 
 private:
     SharedMemory& shared_memory;
@@ -5,6 +5,7 @@
 #include "ahbm.h"
 #include "apbp.h"
 #include "btdmp.h"
+#include "core_timing.h"
 #include "dma.h"
 #include "memory_interface.h"
 #include "mmio.h"
@@ -114,10 +115,10 @@ public:
     }
 };
 
-MMIORegion::MMIORegion(MemoryInterfaceUnit& miu, ICU& icu, Apbp& apbp_from_cpu, Apbp& apbp_from_dsp,
-                       std::array<Timer, 2>& timer, Dma& dma, Ahbm& ahbm,
-                       std::array<Btdmp, 2>& btdmp)
-    : impl(new Impl) {
+MMIORegion::MMIORegion(CoreTiming& core_timing, MemoryInterfaceUnit& miu, ICU& icu,
+                       Apbp& apbp_from_cpu, Apbp& apbp_from_dsp, std::array<Timer, 2>& timer,
+                       Dma& dma, Ahbm& ahbm, std::array<Btdmp, 2>& btdmp)
+    : impl(new Impl), core_timing(core_timing) {
     using namespace std::placeholders;
 
     impl->cells[0x01A] = Cell::ConstCell(0xC902); // chip detect
@@ -352,12 +353,17 @@ MMIORegion::MMIORegion(MemoryInterfaceUnit& miu, ICU& icu, Apbp& apbp_from_cpu,
 
 MMIORegion::~MMIORegion() = default;
 
+// timers and BTDMP are only brought up to date when something happens on them (see CoreTiming),
+// which includes the interrupts they raise, so anything reachable from here needs to see them
+// synced first
 u16 MMIORegion::Read(u16 addr) {
+    core_timing.Sync();
     u16 value = impl->cells[addr].get();
     return value;
 }
 
 void MMIORegion::Write(u16 addr, u16 value) {
+    core_timing.Sync();
     impl->cells[addr].set(value);
 }
 } // namespace Teakra
@@ -12,11 +12,13 @@ class Timer;
 class Dma;
 class Ahbm;
 class Btdmp;
+class CoreTiming;
 
 class MMIORegion {
 public:
-    MMIORegion(MemoryInterfaceUnit& miu, ICU& icu, Apbp& apbp_from_cpu, Apbp& apbp_from_dsp,
-               std::array<Timer, 2>& timer, Dma& dma, Ahbm& ahbm, std::array<Btdmp, 2>& btdmp);
+    MMIORegion(CoreTiming& core_timing, MemoryInterfaceUnit& miu, ICU& icu, Apbp& apbp_from_cpu,
+               Apbp& apbp_from_dsp, std::array<Timer, 2>& timer, Dma& dma, Ahbm& ahbm,
+               std::array<Btdmp, 2>& btdmp);
     ~MMIORegion();
     u16 Read(u16 addr); // not const because it can be a FIFO register
     void Write(u16 addr, u16 value);
@@ -24,6 +26,7 @@ public:
 private:
     class Impl;
     std::unique_ptr<Impl> impl;
+    CoreTiming& core_timing;
 };
 
 } // namespace Teakra
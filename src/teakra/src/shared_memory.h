@@ -2,6 +2,7 @@
 #include <array>
 #include <cstdio>
 #include "common_types.h"
+#include "decode_cache.h"
 
 namespace Teakra {
 struct SharedMemory {
@@ -10,6 +11,7 @@ struct SharedMemory {
     }
     void WriteWord(u32 word_address, u16 value) {
         write_external16(word_address << 1, value);
+        decode_cache.Invalidate(word_address);
     }
 
     void SetExternalMemoryCallback(
@@ -21,5 +23,8 @@ struct SharedMemory {
 
     std::function<u16(u32)> read_external16;
     std::function<void(u32, u16)> write_external16;
+
+    // decoded instructions of program memory, kept here so that every write can invalidate them
+    DecodeCache decode_cache;
 };
 } // namespace Teakra
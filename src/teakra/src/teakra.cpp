@@ -25,7 +25,7 @@ struct Teakra::Impl {
     Ahbm ahbm;
     Dma dma{shared_memory, ahbm};
     std::array<Btdmp, 2> btdmp{{{core_timing}, {core_timing}}};
-    MMIORegion mmio{miu, icu, apbp_from_cpu, apbp_from_dsp, timer, dma, ahbm, btdmp};
+    MMIORegion mmio{core_timing, miu, icu, apbp_from_cpu, apbp_from_dsp, timer, dma, ahbm, btdmp};
     MemoryInterface memory_interface{shared_memory, miu};
     Processor processor{core_timing, memory_interface};
 
@@ -50,6 +50,7 @@ struct Teakra::Impl {
     }
 
     void Reset() {
+        core_timing.Reset();
         miu.Reset();
         apbp_from_cpu.Reset();
         apbp_from_dsp.Reset();
@@ -60,6 +61,7 @@ struct Teakra::Impl {
         btdmp[0].Reset();
         btdmp[1].Reset();
         processor.Reset();
+        shared_memory.decode_cache.InvalidateAll();
     }
 };
 
@@ -72,6 +74,12 @@ void Teakra::Reset() {
 
 void Teakra::Run(unsigned cycle) {
     impl->processor.Run(cycle);
+    // so that the audio samples produced during this run are handed out now
+    impl->core_timing.Sync();
+}
+
+void Teakra::InvalidateProgramCache() {
+    impl->shared_memory.decode_cache.InvalidateAll();
 }
 
 bool Teakra::SendDataIsEmpty(std::uint8_t index) const {